@@ -0,0 +1,76 @@
+// Copyright (c) 2021 - 2022, Nemes <nemes@nemez.net>
+// SPDX-License-Identifier: MIT
+// 
+// MIT License
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software andassociated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, andto permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+// 
+// The above copyright notice andthis permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CHECKPOINT_RECORD_MAGIC             (0x4B435047)    // "GPCK"
+#define CHECKPOINT_FORMAT_VERSION           (3)
+
+typedef enum checkpoint_record_type_t {
+    checkpoint_record_unit,                                 /* A finished unit of a test, such as one region of a sweep */
+    checkpoint_record_calibration,                          /* The calibrated loop count of a unit, written before it is sampled */
+    checkpoint_record_complete                              /* The whole test finished */
+} checkpoint_record_type;
+
+/*
+ * The file is a plain sequence of these, only ever appended to and flushed after each one.
+ * A run that dies mid write leaves a short record at the end, which loading ignores.
+ * occurrence tells repeated runs of a test on the same device apart, so a resumed manifest lines up with the interrupted one.
+ * region_size is what the unit measured, a sweep whose sizes came out differently doesn't pick up another size's results.
+ * parameter_hash covers the test's version, its parameters and the options that change what it measures.
+ */
+typedef struct checkpoint_record_t {
+    uint32_t magic;
+    uint32_t format_version;
+    uint32_t type;
+    uint32_t occurrence;
+    uint32_t unit;
+    uint32_t workgroups;
+    uint64_t region_size;
+    uint64_t parameter_hash;
+    uint64_t iterations;
+    uint8_t uuid[RESULTS_UUID_SIZE];
+    char test_name[RESULTS_MAXIMUM_NAME_LENGTH];
+    statistics_summary summary;
+} checkpoint_record;
+
+test_status CheckpointInitialize(const char *filepath, bool resume);
+bool CheckpointIsEnabled();
+void CheckpointCleanUp();
+void CheckpointBeginTest(const char *test_name, const uint8_t *uuid, uint64_t parameter_hash);
+test_status CheckpointEndTest(bool complete);
+bool CheckpointIsTestComplete();
+bool CheckpointGetUnit(uint32_t unit, uint64_t region_size, uint64_t *iterations, statistics_summary *summary);
+test_status CheckpointRecordUnit(uint32_t unit, uint64_t region_size, uint64_t iterations, const statistics_summary *summary);
+bool CheckpointGetCalibration(uint32_t unit, uint64_t region_size, uint64_t *iterations, uint32_t *workgroups);
+test_status CheckpointRecordCalibration(uint32_t unit, uint64_t region_size, uint64_t iterations, uint32_t workgroups);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
\ No newline at end of file
@@ -0,0 +1,68 @@
+// Copyright (c) 2021 - 2022, Nemes <nemes@nemez.net>
+// SPDX-License-Identifier: MIT
+// 
+// MIT License
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software andassociated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, andto permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+// 
+// The above copyright notice andthis permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef COMPARE_H
+#define COMPARE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define COMPARE_DEFAULT_THRESHOLD           (2.0)           // Percent the median has to move before a significant change counts
+#define COMPARE_SIGNIFICANCE_LEVEL          (0.05)
+#define COMPARE_HISTORY_PREFIX              "history"
+#define COMPARE_DEFAULT_CANDIDATE           COMPARE_HISTORY_PREFIX "@latest"
+
+typedef enum compare_verdict_e {
+    compare_verdict_unchanged = 0,
+    compare_verdict_improvement,
+    compare_verdict_regression,
+    compare_verdict_inconclusive,                           /* Moved beyond the threshold, but without samples to tell it from noise */
+    compare_verdict_missing                                 /* Only in one of the sets */
+} compare_verdict;
+
+/* One measurement of a test on a device, repeated runs of it within a set are pooled */
+typedef struct compare_measurement_t {
+    char test_name[RESULTS_MAXIMUM_NAME_LENGTH];
+    char key[RESULTS_MAXIMUM_NAME_LENGTH];
+    char unit[RESULTS_MAXIMUM_UNIT_LENGTH];
+    char device_name[HISTORY_MAXIMUM_DEVICE_NAME_LENGTH];
+    uint8_t uuid[RESULTS_UUID_SIZE];
+    double median;                                          /* As recorded, used when there are no samples */
+    statistics_samples samples;
+} compare_measurement;
+
+/*
+ * A set is either a file of --json output or a selection from the history store:
+ *   history[@latest]       the most recent run of every test on every device
+ *   history@previous       the run before that
+ *   history@driver=<text>  every run with a driver version equal to <text> or driver info containing it
+ */
+test_status CompareLoadSet(const char *specification, const history_filter *filter, helper_arraylist *set);
+test_status CompareRun(const char *baseline, const char *candidate, const history_filter *filter, double threshold);
+void CompareCleanUpSet(helper_arraylist *set);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
\ No newline at end of file
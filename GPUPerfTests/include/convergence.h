@@ -0,0 +1,71 @@
+// Copyright (c) 2021 - 2022, Nemes <nemes@nemez.net>
+// SPDX-License-Identifier: MIT
+// 
+// MIT License
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software andassociated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, andto permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+// 
+// The above copyright notice andthis permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef CONVERGENCE_H
+#define CONVERGENCE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CONVERGENCE_DEFAULT_TOLERANCE       (1.0)           // Percent, relative 95% confidence interval half-width
+#define CONVERGENCE_DEFAULT_BUDGET_MS       (5000)          // Per measurement, including calibration
+#define CONVERGENCE_MAXIMUM_GROWTH          (16)            // Largest iteration count step during calibration
+#define CONVERGENCE_CALIBRATION_MARGIN      (1.1)           // Overshoot so the calibrated run lands past the target
+
+typedef enum convergence_state_t {
+    convergence_state_calibrating,
+    convergence_state_sampling,
+    convergence_state_finished
+} convergence_state;
+
+typedef struct convergence_controller_t {
+    statistics_samples samples;
+    statistics_samples timings;                             /* Run time of each sample in microseconds */
+    convergence_state state;
+    uint64_t iterations;
+    uint64_t maximum_iterations;
+    uint64_t target_time_us;
+    uint64_t budget_us;
+    uint32_t minimum_samples;
+    uint32_t maximum_samples;
+    double tolerance;
+    double relative_error;
+    bool converged;
+    helper_timer budget_timer;
+} convergence_controller;
+
+test_status ConvergenceInitialize(uint64_t target_time_us, uint64_t maximum_iterations, convergence_controller *controller);
+test_status ConvergenceCleanUp(convergence_controller *controller);
+void ConvergenceStart(convergence_controller *controller, uint64_t starting_iterations);
+void ConvergenceStartSampling(convergence_controller *controller, uint64_t iterations);
+test_status ConvergenceAddRun(convergence_controller *controller, uint64_t time_us, double value);
+test_status ConvergenceSummarize(convergence_controller *controller, statistics_summary *summary);
+uint64_t ConvergenceGetIterations(convergence_controller *controller);
+convergence_state ConvergenceGetState(convergence_controller *controller);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
\ No newline at end of file
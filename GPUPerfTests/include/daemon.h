@@ -0,0 +1,43 @@
+// Copyright (c) 2021 - 2022, Nemes <nemes@nemez.net>
+// SPDX-License-Identifier: MIT
+// 
+// MIT License
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software andassociated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, andto permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+// 
+// The above copyright notice andthis permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef DAEMON_H
+#define DAEMON_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DAEMON_LISTEN_BACKLOG       (8)
+#define DAEMON_CLIENT_TIMEOUT_MS    (10000)     // A client that stops sending or reading for this long is dropped
+#define DAEMON_TESTS_KEY            "tests"
+#define DAEMON_DEVICE_KEY           "device"
+#define DAEMON_SHUTDOWN_KEY         "shutdown"
+
+test_status DaemonRun(const char *socket_path);
+test_status DaemonRequest(const char *socket_path, manifest_entry *request, bool shutdown);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
\ No newline at end of file
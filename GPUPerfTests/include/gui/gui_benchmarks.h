@@ -28,6 +28,8 @@
 extern "C" {
 #endif
 
+#define GUI_BENCHMARKS_MAXIMUM_LABEL_LENGTH (32)
+
 typedef enum gui_benchmarks_type_t {
     gui_benchmarks_type_single_result,
     gui_benchmarks_type_multiple_result
@@ -54,6 +56,8 @@ typedef struct gui_benchmark_t {
     test_status completion_code;
     void *process_handle;
     bool has_been_run;
+    bool results_labelled;
+    bool results_keyed;
     gui_result_type result_type;
     helper_arraylist results;
     helper_arraylist raw_results;
@@ -66,7 +70,8 @@ typedef struct gui_section_t {
     bool selected_in_ui;
     gui_benchmarks_type benchmark_type;
     helper_arraylist runall_buttons;
-    helper_arraylist labels;
+    helper_arraylist labels;                                /* char[GUI_BENCHMARKS_MAXIMUM_LABEL_LENGTH] */
+    helper_arraylist capacities;                            /* uint64_t, the region size behind each label */
     helper_arraylist benchmarks[1];
 } gui_section;
 
@@ -82,11 +87,15 @@ typedef struct gui_panel_t {
 
 typedef struct gui_queued_benchmark_t {
     gui_benchmark *benchmark;
+    const char *manifest_path;
+    int32_t manifest_entry;
     uint32_t sequential_queue_id;
     gui_translated_benchmark_result_string cancel_button;
 } gui_queued_benchmark;
 
 test_status GuiBenchmarksRegister(helper_arraylist **list, uint32_t gpu_count);
+test_status GuiBenchmarksAddResultLabels(gui_section *section, gui_benchmark *benchmark);
+bool GuiBenchmarksFindResult(gui_section *section, gui_benchmark *benchmark, size_t label_index, size_t *result_index);
 
 #ifdef __cplusplus
 }
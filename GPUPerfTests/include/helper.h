@@ -29,12 +29,19 @@ extern "C" {
 #endif
 
 #define HELPER_ARRAYLIST_SIZE_STEP  16
+#define HELPER_HASH_SEED            (14695981039346656037ULL)
 
 #define max(x, y)   (((x) > (y)) ? (x) : (y))
 #define min(x, y)   (((x) < (y)) ? (x) : (y))
 
 #define HelperClear(structure)      memset(&structure, 0, sizeof(structure))
 
+#ifdef _MSC_VER
+#define HELPER_THREAD_LOCAL         __declspec(thread)
+#else
+#define HELPER_THREAD_LOCAL         _Thread_local
+#endif
+
 typedef struct helper_arraylist_t {
     void *data;
     size_t capacity;
@@ -53,6 +60,10 @@ typedef struct helper_linkedlist_t {
     helper_linkedlist_node *root;
 } helper_linkedlist;
 
+typedef struct helper_timer_t {
+    uint64_t start;
+} helper_timer;
+
 typedef struct helper_unit_pair_t {
     float value;
     char units[4];
@@ -60,6 +71,7 @@ typedef struct helper_unit_pair_t {
 
 typedef void *helper_thread;
 typedef void (*helper_thread_func)(uint32_t thread_id, void *input_data);
+typedef void *helper_mutex;
 
 typedef uint32_t helper_atomic_bool;
 typedef int16_t helper_atomic_int16;
@@ -73,10 +85,18 @@ test_status HelperLoadFile(const char *filepath, const char **data, size_t *size
 void *HelperOpenFileForWriting(const char *filepath);
 void HelperWriteFile(void *file_handle, const char *format, ...);
 void HelperCloseFile(void *file_handle);
+test_status HelperWriteFileAtomic(const char *filepath, const void *data, size_t size);
+test_status HelperGetUserCacheDirectory(const char *subdirectory, const char **path);
+test_status HelperGetUserDataDirectory(const char *subdirectory, const char **path);
 const char *HelperDecodePng(const char *data, size_t size, int spng_format, uint32_t *image_width, uint32_t *image_height);
 void HelperResetTimestamp();
 uint64_t HelperGetTimestamp();
 uint64_t HelperMarkTimestamp();
+void HelperTimerReset(helper_timer *timer);
+uint64_t HelperTimerGetNanoseconds(helper_timer *timer);
+uint64_t HelperTimerMarkNanoseconds(helper_timer *timer);
+uint64_t HelperTimerGet(helper_timer *timer);
+uint64_t HelperTimerMark(helper_timer *timer);
 void HelperSleep(uint64_t milliseconds);
 test_status HelperPrintToBuffer(const char **buffer, size_t *length, const char *format, ...);
 test_status HelperArrayListInitialize(helper_arraylist *arraylist, size_t element_size);
@@ -84,6 +104,7 @@ test_status HelperArrayListAdd(helper_arraylist *arraylist, const void *element_
 test_status HelperArrayListClean(helper_arraylist *arraylist);
 void *HelperArrayListGet(helper_arraylist *arraylist, size_t index);
 size_t HelperArrayListSize(helper_arraylist *arraylist);
+void HelperArrayListTruncate(helper_arraylist *arraylist, size_t size);
 void *HelperArrayListRawData(helper_arraylist *arraylist);
 test_status HelperArrayListCopy(helper_arraylist *destination, helper_arraylist *source);
 test_status HelperLinkedListInitialize(helper_linkedlist *linkedlist);
@@ -96,6 +117,10 @@ bool HelperLinkedListIteratorHasNext(helper_linkedlist *linkedlist, void **conte
 void *HelperLinkedListIteratorNext(helper_linkedlist *linkedlist, void **context);
 uint64_t HelperFindLargestPowerOfTwo(uint64_t bound);
 bool HelperStringPresent(const char *string, const char **strings, uint32_t strings_count);
+bool HelperMatchPattern(const char *pattern, size_t pattern_length, const char *string);
+const char *HelperNextPattern(const char *patterns, size_t *pattern_length);
+bool HelperMatchPatternList(const char *patterns, const char *string);
+uint64_t HelperHash(uint64_t hash, const void *data, size_t size);
 void HelperConvertUnitsBytes1024(uint64_t number, helper_unit_pair *unit_pair);
 void HelperConvertUnitsBits1024(uint64_t number, helper_unit_pair *unit_pair);
 void HelperConvertUnitsBytes1000(uint64_t number, helper_unit_pair *unit_pair);
@@ -110,6 +135,11 @@ void HelperCleanUpThread(helper_thread thread);
 helper_thread *HelperCreateThreads(uint32_t thread_count, helper_thread_func thread_func, void **data);
 void HelperWaitForThreads(helper_thread *threads, uint32_t thread_count);
 void HelperCleanUpThreads(helper_thread *threads, uint32_t thread_count);
+test_status HelperPinThread(uint32_t first_processor, uint32_t processor_count);
+helper_mutex HelperCreateMutex();
+void HelperLockMutex(helper_mutex mutex);
+void HelperUnlockMutex(helper_mutex mutex);
+void HelperCleanUpMutex(helper_mutex mutex);
 int16_t HelperAtomicIncrementInt16(helper_atomic_int16 *value);
 uint16_t HelperAtomicIncrementUint16(helper_atomic_uint16 *value);
 int32_t HelperAtomicIncrementInt32(helper_atomic_int32 *value);
@@ -0,0 +1,132 @@
+// Copyright (c) 2021 - 2022, Nemes <nemes@nemez.net>
+// SPDX-License-Identifier: MIT
+// 
+// MIT License
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software andassociated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, andto permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+// 
+// The above copyright notice andthis permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HISTORY_DIRECTORY                   "history"
+#define HISTORY_LOG_FILENAME                "results.log"
+#define HISTORY_INDEX_FILENAME              "results.idx"
+#define HISTORY_RECORD_MAGIC                (0x48545047)    // "GPTH"
+#define HISTORY_FORMAT_VERSION              (2)             // 1 had no samples
+#define HISTORY_MAXIMUM_DEVICE_NAME_LENGTH  (256)
+#define HISTORY_MAXIMUM_DRIVER_INFO_LENGTH  (256)
+
+/*
+ * The log holds one record per test run on a device: this header, then its measurements, its parameters and its samples.
+ * The index holds one entry per record, so looking up a device never has to walk the log.
+ * Both files are only ever appended to, all fields are fixed width and stored in host byte order.
+ */
+typedef struct history_record_header_t {
+    uint32_t magic;
+    uint32_t format_version;
+    uint32_t size;                                          /* Bytes after the header */
+    uint32_t measurement_count;
+    uint32_t parameter_count;
+    uint32_t vendor_id;
+    uint32_t device_id;
+    uint32_t driver_version;
+    uint32_t api_version;
+    uint32_t tool_version;
+    uint32_t test_version;
+    uint32_t sample_count;
+    uint64_t timestamp;                                     /* Seconds since the Unix epoch */
+    uint8_t uuid[RESULTS_UUID_SIZE];
+    char test_name[RESULTS_MAXIMUM_NAME_LENGTH];
+    char device_name[HISTORY_MAXIMUM_DEVICE_NAME_LENGTH];
+    char driver_info[HISTORY_MAXIMUM_DRIVER_INFO_LENGTH];
+} history_record_header;
+
+typedef struct history_measurement_t {
+    uint32_t id;
+    uint32_t sample_count;
+    uint32_t rejected_outliers;
+    uint32_t reserved;
+    char key[RESULTS_MAXIMUM_NAME_LENGTH];
+    char unit[RESULTS_MAXIMUM_UNIT_LENGTH];
+    double median;
+    double mean;
+    double minimum;
+    double maximum;
+    double p5;
+    double p95;
+    double standard_deviation;
+    double confidence_low;
+    double confidence_high;
+} history_measurement;
+
+typedef struct history_parameter_t {
+    char name[RESULTS_MAXIMUM_NAME_LENGTH];
+    uint64_t value;
+} history_parameter;
+
+/* Before outlier rejection, in the unit of the measurement with the same id */
+typedef struct history_sample_t {
+    uint32_t id;
+    uint32_t reserved;
+    double value;
+    double time_us;
+} history_sample;
+
+typedef struct history_index_entry_t {
+    uint64_t offset;                                        /* Of the record header in the log */
+    uint64_t timestamp;
+    uint8_t uuid[RESULTS_UUID_SIZE];
+    uint32_t driver_version;
+    uint32_t tool_version;
+    uint32_t test_version;
+    uint32_t record_size;                                   /* Header included */
+} history_index_entry;
+
+/* A record read back from the log */
+typedef struct history_entry_t {
+    history_record_header header;
+    helper_arraylist measurements;                          /* history_measurement */
+    helper_arraylist parameters;                            /* history_parameter */
+    helper_arraylist samples;                               /* history_sample */
+} history_entry;
+
+/* Every field left NULL matches everything */
+typedef struct history_filter_t {
+    const uint8_t *uuid;
+    const char *device_name;
+    const char *test_patterns;                              /* Same syntax as --test */
+} history_filter;
+
+test_status HistoryInitialize();
+bool HistoryIsEnabled();
+test_status HistoryRecord(const results_context *context);
+test_status HistoryQuery(const history_filter *filter, helper_arraylist *entries);
+test_status HistoryPrint(const history_filter *filter);
+void HistoryCleanUpEntries(helper_arraylist *entries);
+void HistoryFormatTimestamp(uint64_t timestamp, char *buffer, size_t buffer_size);
+void HistoryCleanUp();
+
+#ifdef __cplusplus
+}
+#endif
+#endif
\ No newline at end of file
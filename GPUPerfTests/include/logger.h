@@ -35,12 +35,55 @@ extern "C" {
 #define DEBUG(format, ...)              LOG("DEBUG", format, ##__VA_ARGS__)
 #define WARNING(format, ...)            LOG("WARN ", format, ##__VA_ARGS__)
 #define FATAL(format, ...)              LOG("FATAL", format, ##__VA_ARGS__)
-#define ABORT(code)                     LOG("ABORT", "0x%08lx %s\n", code, LoggerLookUpError(code))
+#define ABORT(code)                     do { LOG("ABORT", "0x%08lx %s\n", code, LoggerLookUpError(code)); LoggerChannelSendError(code); } while (0)
 #define SEPARATOR()                     LoggerLogMessage("[SEPAR] ------------------------------------------\n")
-#define LOG_RESULT(id, key_fmt, value_fmt, key, value)  LOG("RESLT", "%lu: " key_fmt " = " value_fmt "\n", id, key, value)
+#define LOG_RESULT(id, key_fmt, value_fmt, key, value)  do { LOG("RESLT", "%lu: " key_fmt " = " value_fmt "\n", id, key, value); LoggerChannelSendResult(id, (uint64_t)(value), key_fmt, key); } while (0)
+#define LOG_RESULT_STATISTICS(id, key_fmt, key, summary) LOG("RSTAT", "%lu: " key_fmt " = median %.3f min %.3f max %.3f p5 %.3f p95 %.3f stddev %.3f ci95 %.3f %.3f samples %lu outliers %lu\n", id, key, (summary)->median, (summary)->minimum, (summary)->maximum, (summary)->p5, (summary)->p95, (summary)->standard_deviation, (summary)->confidence_low, (summary)->confidence_high, (summary)->sample_count, (summary)->rejected_outliers)
+#define LOG_RESULT_METADATA(key, value_fmt, value)     LOG("RMETA", key " = " value_fmt "\n", value)
+#define LOG_RESULT_SERIES(id, time_ms, value)          LOG("RSERI", "%lu: %llu = %.3f\n", id, time_ms, value)
+
+#define LOGGER_CHANNEL_RECORD_RESULT        (1)
+#define LOGGER_CHANNEL_RECORD_PROGRESS      (2)
+#define LOGGER_CHANNEL_RECORD_ERROR         (3)
+#define LOGGER_CHANNEL_RECORD_REQUEST       (4)             // Daemon clients only, settings as 'key=value' strings each followed by a terminator
+#define LOGGER_CHANNEL_RECORD_FINISHED      (5)             // Daemon only, a logger_channel_error with the status of the whole request
+#define LOGGER_CHANNEL_MAXIMUM_RECORD_SIZE  (4096)          // Header included, small enough for a single atomic pipe write
+
+/* Both ends are the same binary, so records are plain structs in native byte order */
+typedef struct logger_channel_header_t {
+    uint32_t type;
+    uint32_t size;                                          /* Bytes of payload following the header */
+} logger_channel_header;
+
+typedef struct logger_channel_result_t {
+    uint64_t value;
+    uint32_t id;
+    uint32_t key_length;                                    /* Key bytes follow without a terminator */
+} logger_channel_result;
+
+typedef struct logger_channel_progress_t {
+    uint32_t completed;
+    uint32_t total;
+} logger_channel_progress;
+
+typedef struct logger_channel_error_t {
+    test_status code;
+} logger_channel_error;
 
 test_status LoggerLogMessage(const char *format, ...);
+void LoggerBeginCapture();
+void LoggerEndCapture();
+void LoggerFlushCapture();
 const char *LoggerLookUpError(test_status status);
+test_status LoggerChannelOpen(const char *handle);
+void LoggerChannelClose();
+test_status LoggerChannelAttach(uintptr_t handle);
+void LoggerChannelDetach();
+bool LoggerChannelIsOpen();
+void LoggerChannelSendResult(uint32_t id, uint64_t value, const char *key_format, ...);
+void LoggerChannelSendProgress(uint32_t completed, uint32_t total);
+void LoggerChannelSendError(test_status code);
+void LoggerChannelSendFinished(test_status code);
 
 #ifdef __cplusplus
 }
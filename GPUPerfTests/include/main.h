@@ -42,6 +42,7 @@ extern "C" {
 #define VULKAN_COMMAND_BUFFER_TRACE
 #define VULKAN_STAGING_TRACE
 #define VULKAN_TEXTURE_TRACE
+#define VULKAN_QUERY_TRACE
 #endif
 #define PROCESS_RUNNER_TRACE
 
@@ -92,6 +93,13 @@ extern "C" {
 #define TEST_EMBEDDED_RESOURCE_NOT_FOUND                    20
 #define TEST_FAILED_TO_LOAD_WINDOW_ICON                     21
 #define TEST_FAILED_TO_DECODE_WINDOW_ICON                   22
+#define TEST_MANIFEST_SYNTAX_ERROR                          23
+#define TEST_UNKNOWN_OPTION                                 24
+#define TEST_REGRESSION_DETECTED                            25
+#define TEST_TIMEOUT                                        26
+#define TEST_SKIPPED                                        27
+#define TEST_DAEMON_CONNECTION_ERROR                        28
+#define TEST_DAEMON_PROTOCOL_ERROR                          29
 
 /* Vulkan status range 2048-4095 */
 #define TEST_VK_CREATE_INSTANCE_ERROR                       2048
@@ -152,6 +160,10 @@ extern "C" {
 #define TEST_VK_INVALID_QUEUE_INDEX                         2103
 #define TEST_VK_COMMAND_SEQUENCE_NOT_MULTI_QUEUE            2104
 #define TEST_VK_WAIT_FOR_FENCES_NOT_READY                   2105
+#define TEST_VK_TIMESTAMPS_UNSUPPORTED                      2106
+#define TEST_VK_QUERY_POOL_CREATION_ERROR                   2107
+#define TEST_VK_QUERY_RESULTS_ERROR                         2108
+#define TEST_VK_PIPELINE_CACHE_ERROR                        2109
 
 /* Windows status range 4096-4099 */
 #define WIN_D3DKMT_FAIL_INIT                                4096
@@ -163,7 +175,8 @@ typedef uint32_t test_status;
 typedef enum test_result_output_t {
     test_result_readable,
     test_result_raw,
-    test_result_csv
+    test_result_csv,
+    test_result_json
 } test_result_output;
 
 typedef enum test_ui_mode_t {
@@ -171,7 +184,38 @@ typedef enum test_ui_mode_t {
     test_ui_mode_cli
 } test_ui_mode;
 
+/* Options that tune how tests measure, a manifest may change them for each of its entries */
+typedef struct main_options_t {
+    bool use_host_timer;
+    bool subtract_overhead;
+    bool validate_invocations;
+    bool parallel_devices;
+    uint32_t trial_count;
+    double convergence_tolerance;
+    uint64_t convergence_budget;
+    uint32_t soak_minutes;
+    uint32_t step_timeout_ms;
+    uint32_t test_timeout_seconds;
+    const char *serialized_tests;
+    const char *test_filter;
+} main_options;
+
 test_result_output MainGetTestResultFormat();
+bool MainGetUseHostTimer();
+bool MainGetSubtractOverhead();
+bool MainGetValidateInvocations();
+uint32_t MainGetSoakMinutes();
+bool MainGetParallelDevices();
+const char *MainGetSerializedTests();
+const char *MainGetTestFilter();
+uint32_t MainGetTrialCount();
+double MainGetConvergenceTolerance();
+uint64_t MainGetConvergenceBudget();
+uint32_t MainGetStepTimeout();
+uint32_t MainGetTestTimeout();
+void MainGetOptions(main_options *saved_options);
+void MainSetOptions(const main_options *saved_options);
+test_status MainSetOption(const char *name, const char *value);
 const char *MainGetBinaryPath();
 test_ui_mode MainGetTestUIMode();
 void MainToggleConsoleWindow();
@@ -0,0 +1,74 @@
+// Copyright (c) 2021 - 2022, Nemes <nemes@nemez.net>
+// SPDX-License-Identifier: MIT
+// 
+// MIT License
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software andassociated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, andto permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+// 
+// The above copyright notice andthis permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef MANIFEST_H
+#define MANIFEST_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MANIFEST_DEFAULTS_SECTION       "defaults"
+#define MANIFEST_MAXIMUM_LINE_LENGTH    (512)
+#define MANIFEST_MAXIMUM_KEY_LENGTH     (64)
+#define MANIFEST_MAXIMUM_VALUE_LENGTH   (256)
+#define MANIFEST_MAXIMUM_REPEAT         (10000)
+#define MANIFEST_ALL_ENTRIES            (-1)
+
+typedef struct manifest_setting_t {
+    char key[MANIFEST_MAXIMUM_KEY_LENGTH];
+    char value[MANIFEST_MAXIMUM_VALUE_LENGTH];
+} manifest_setting;
+
+/* One [section] of the file: the tests it names, where and how often to run them and everything else it sets */
+typedef struct manifest_entry_t {
+    char tests[MANIFEST_MAXIMUM_VALUE_LENGTH];
+    int32_t device_id;
+    uint32_t repeat;
+    uint32_t line;
+    helper_arraylist settings;
+} manifest_entry;
+
+/* What an entry changed, so the next one starts from the command line again */
+typedef struct manifest_saved_state_t {
+    main_options options;
+    size_t parameter_count;
+} manifest_saved_state;
+
+typedef struct manifest_t {
+    const char *filepath;
+    helper_arraylist entries;
+} manifest;
+
+test_status ManifestLoad(const char *filepath, manifest *manifest);
+size_t ManifestGetEntryCount(manifest *manifest);
+manifest_entry *ManifestGetEntry(manifest *manifest, size_t index);
+test_status ManifestApplyEntry(manifest_entry *entry, manifest_saved_state *saved_state);
+void ManifestRestoreEntry(const manifest_saved_state *saved_state);
+test_status ManifestExecute(manifest *manifest, int32_t entry_index, const char *test_names, int32_t device_id);
+void ManifestCleanUp(manifest *manifest);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
\ No newline at end of file
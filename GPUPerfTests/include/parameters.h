@@ -0,0 +1,80 @@
+// Copyright (c) 2021 - 2022, Nemes <nemes@nemez.net>
+// SPDX-License-Identifier: MIT
+// 
+// MIT License
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software andassociated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, andto permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+// 
+// The above copyright notice andthis permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef PARAMETERS_H
+#define PARAMETERS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PARAMETERS_MAXIMUM_NAME_LENGTH      (64)
+#define PARAMETERS_MAXIMUM_VALUE_LENGTH     (128)
+#define PARAMETERS_TARGET_TIME_MINIMUM_US   (1000)
+#define PARAMETERS_TARGET_TIME_MAXIMUM_US   (60000000)
+#define PARAMETERS_COUNT(definitions)       ((uint32_t)(sizeof(definitions) / sizeof((definitions)[0])))
+
+typedef enum parameters_type_t {
+    parameters_type_integer,
+    parameters_type_size,               /* Bytes, accepts K, M, G and T suffixes */
+    parameters_type_power_of_two        /* Like size, rounded down to a power of two */
+} parameters_type;
+
+typedef struct parameters_definition_t {
+    const char *name;
+    parameters_type type;
+    uint64_t default_value;
+    uint64_t minimum;
+    uint64_t maximum;
+    const char *description;
+} parameters_definition;
+
+/* The parameters a group of tests reads, test_pattern uses the --test syntax */
+typedef struct parameters_declaration_t {
+    const char *test_pattern;
+    const parameters_definition *definitions;
+    uint32_t definition_count;
+} parameters_declaration;
+
+typedef struct parameters_override_t {
+    char name[PARAMETERS_MAXIMUM_NAME_LENGTH];
+    char value[PARAMETERS_MAXIMUM_VALUE_LENGTH];
+} parameters_override;
+
+test_status ParametersDeclare(const char *test_pattern, const parameters_definition *definitions, uint32_t definition_count);
+test_status ParametersSet(const char *name, const char *value);
+test_status ParametersSetAssignment(const char *assignment);
+size_t ParametersGetOverrideCount();
+void ParametersRestore(size_t override_count);
+test_status ParametersValidate();
+uint64_t ParametersGet(const parameters_definition *definition);
+void ParametersGetAll(const parameters_definition *definitions, uint32_t definition_count, uint64_t *values);
+void ParametersLogResult(const parameters_definition *definitions, const uint64_t *values, uint32_t definition_count);
+uint64_t ParametersHash(const char *test_name, uint64_t hash);
+void ParametersPrint();
+void ParametersCleanUp();
+
+#ifdef __cplusplus
+}
+#endif
+#endif
\ No newline at end of file
@@ -0,0 +1,59 @@
+// Copyright (c) 2021 - 2022, Nemes <nemes@nemez.net>
+// SPDX-License-Identifier: MIT
+// 
+// MIT License
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software andassociated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, andto permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+// 
+// The above copyright notice andthis permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef PLANNER_H
+#define PLANNER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PLANNER_SETUP_TIME_US               (500000)        // Device, pipeline and memory set up of one test on one device
+#define PLANNER_CALIBRATION_RUNS            (1)             // Runs of target length a calibration adds, the shorter ones before the last sum to less than one
+#define PLANNER_MINIMUM_STEP_BUDGET_MS      (100)           // A squeezed step still gets this long to converge before it stops at the trial count
+
+/*
+ * What a test expects to cost on a device with the current options and parameters.
+ * Steps are the measurements the convergence controller samples, the scheduler only ever shortens those.
+ */
+typedef struct planner_estimate_t {
+    uint32_t step_count;
+    uint64_t sample_time_us;                                /* One run of a step, the calibrated target time */
+    uint64_t fixed_time_us;                                 /* Set up, warmup, searches, soaks and fixed length runs */
+} planner_estimate;
+
+test_status PlannerInitialize();
+bool PlannerIsEstimating();
+test_status PlannerAddEstimate(const char *test_name, const char *device_name, const uint8_t *uuid, const planner_estimate *estimate);
+void PlannerPrint(uint64_t budget_us);
+test_status PlannerStartSchedule(uint64_t budget_us);
+void PlannerCleanUp();
+void PlannerBeginTest(const char *test_name, const uint8_t *uuid);
+void PlannerEndTest();
+uint64_t PlannerGetStepBudget(uint64_t default_budget_us);
+void PlannerEndStep(uint64_t time_us);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
\ No newline at end of file
@@ -28,17 +28,25 @@
 extern "C" {
 #endif
 
-#define PROCESS_RUNNER_MAXIMUM_RESULT_LENGTH    (128)
+/* One LOG_RESULT of the child, received over the binary result channel */
+typedef struct process_runner_result_t {
+    uint32_t id;
+    uint64_t value;
+    char *key;                  /* Owned by the result, released by ProcessRunnerCleanUpResults */
+} process_runner_result;
 
-typedef struct process_runner_keypair_t {
-    char key[PROCESS_RUNNER_MAXIMUM_RESULT_LENGTH];
-    char result[PROCESS_RUNNER_MAXIMUM_RESULT_LENGTH];
-} process_runner_keypair;
+/* Latest progress record of the child, total is 0 until the test reports any */
+typedef struct process_runner_progress_t {
+    volatile uint32_t completed;
+    volatile uint32_t total;
+} process_runner_progress;
 
 test_status ProcessRunnerRunTest(const char *test_name, uint32_t device_index, helper_arraylist *results);
-test_status ProcessRunnerRunTestKillable(const char *test_name, uint32_t device_index, helper_arraylist *results, bool *kill_process);
-test_status ProcessRunnerRunTestAsync(const char *test_name, uint32_t device_index, helper_arraylist *results, test_status *completion_code, void **kill_handle);
+test_status ProcessRunnerRunTestKillable(const char *test_name, uint32_t device_index, const char *manifest_path, int32_t manifest_entry, helper_arraylist *results, process_runner_progress *progress, bool *kill_process);
+test_status ProcessRunnerRunTestAsync(const char *test_name, uint32_t device_index, const char *manifest_path, int32_t manifest_entry, helper_arraylist *results, test_status *completion_code, void **kill_handle);
+test_status ProcessRunnerGetProgress(void *kill_handle, uint32_t *completed, uint32_t *total);
 test_status ProcessRunnerTerminateAsync(void *kill_handle);
+void ProcessRunnerCleanUpResults(helper_arraylist *results);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,57 @@
+// Copyright (c) 2021 - 2022, Nemes <nemes@nemez.net>
+// SPDX-License-Identifier: MIT
+// 
+// MIT License
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software andassociated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, andto permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+// 
+// The above copyright notice andthis permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef REGION_SWEEP_H
+#define REGION_SWEEP_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define REGION_SWEEP_MAXIMUM_POINTS_PER_OCTAVE  (64)
+#define REGION_SWEEP_MAXIMUM_REFINE_PASSES      (3)             // Every pass can halve the gaps around a knee once more
+#define REGION_SWEEP_MAXIMUM_THRESHOLD          (1000)          // Percent
+
+/* Region sizes spaced geometrically between a minimum and a maximum, each a multiple of the granularity
+ * Refinement points are appended after the whole base sweep, so the index of a size doesn't depend on how much of it a device can measure */
+typedef struct region_sweep_t {
+    helper_arraylist sizes;                                     /* uint64_t */
+    uint64_t granularity;
+    size_t base_count;
+    uint32_t refine_passes;
+} region_sweep;
+
+test_status RegionSweepInitialize(uint64_t minimum_size, uint64_t maximum_size, uint32_t points_per_octave, uint64_t granularity, region_sweep *sweep);
+test_status RegionSweepCleanUp(region_sweep *sweep);
+size_t RegionSweepGetCount(region_sweep *sweep);
+size_t RegionSweepGetMaximumCount(region_sweep *sweep);
+uint64_t RegionSweepGetSize(region_sweep *sweep, size_t index);
+const uint64_t *RegionSweepGetSizes(region_sweep *sweep);
+size_t RegionSweepFindLargest(region_sweep *sweep, uint64_t maximum_size);
+test_status RegionSweepRefine(region_sweep *sweep, const statistics_summary *results, uint32_t threshold_percent, size_t *added_count);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
\ No newline at end of file
@@ -0,0 +1,97 @@
+// Copyright (c) 2021 - 2022, Nemes <nemes@nemez.net>
+// SPDX-License-Identifier: MIT
+// 
+// MIT License
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software andassociated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, andto permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+// 
+// The above copyright notice andthis permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef RESULTS_H
+#define RESULTS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RESULTS_MAXIMUM_NAME_LENGTH         (64)
+#define RESULTS_MAXIMUM_UNIT_LENGTH         (16)
+#define RESULTS_UUID_SIZE                   (16)
+#define RESULTS_API_VERSION_MAJOR(version)  ((version) >> 22)            // Vulkan packing, without pulling the Vulkan headers in here
+#define RESULTS_API_VERSION_MINOR(version)  (((version) >> 12) & 0x3FF)
+#define RESULTS_API_VERSION_PATCH(version)  ((version) & 0xFFF)
+
+/* Who produced the records, filled in by the runner of the test */
+typedef struct results_device_t {
+    const char *name;
+    const char *driver_name;
+    const char *driver_info;
+    uint8_t uuid[RESULTS_UUID_SIZE];
+    uint32_t index;
+    uint32_t vendor_id;
+    uint32_t device_id;
+    uint32_t driver_version;
+    uint32_t api_version;
+} results_device;
+
+typedef struct results_measurement_t {
+    uint32_t id;
+    char key[RESULTS_MAXIMUM_NAME_LENGTH];
+    char unit[RESULTS_MAXIMUM_UNIT_LENGTH];
+    statistics_summary summary;
+} results_measurement;
+
+typedef struct results_sample_t {
+    uint32_t id;
+    double value;                                           /* In the unit of the measurement with the same id */
+    double time_us;                                         /* Run time the value was derived from */
+} results_sample;
+
+typedef struct results_value_t {
+    char name[RESULTS_MAXIMUM_NAME_LENGTH];
+    bool integer;
+    uint64_t integer_value;
+    double real_value;
+} results_value;
+
+/* Everything a test reports is held until it finishes, so each record can carry the parameters and metadata logged last */
+typedef struct results_context_t {
+    bool active;
+    const char *test_name;
+    uint32_t test_version;
+    results_device device;
+    helper_arraylist measurements;
+    helper_arraylist samples;
+    helper_arraylist parameters;
+    helper_arraylist metadata;
+    bool replayed;                                          /* Every measurement came from a checkpoint, the run is already in the history */
+} results_context;
+
+bool ResultsIsEnabled();
+void ResultsBeginTest(const char *test_name, uint32_t test_version, const results_device *device);
+test_status ResultsEndTest(bool complete);
+void ResultsSetReplayed();
+test_status ResultsAddMeasurement(uint32_t id, const char *key, const char *unit, const statistics_summary *summary);
+test_status ResultsRecordSamples(uint32_t id, statistics_samples *values, statistics_samples *timings, double scale);
+test_status ResultsAddParameter(const char *name, uint64_t value);
+test_status ResultsAddMetadata(const char *name, double value);
+void ResultsCleanUp();
+
+#ifdef __cplusplus
+}
+#endif
+#endif
\ No newline at end of file
@@ -29,21 +29,44 @@ extern "C" {
 #endif
 
 #define RUNNER_TEST_LIST_INCREMENT_SIZE 16
+#define RUNNER_MAXIMUM_NAME_LENGTH      (64)
+#define RUNNER_INDEX_LOAD_FACTOR        (2)             // Index slots per registered test
+
+#define RUNNER_TEST_FLAG_NONE           0
+/* Saturates host memory or PCIe, never runs next to another such test when devices run in parallel */
+#define RUNNER_TEST_FLAG_HOST_EXCLUSIVE (1 << 0)
+/* Covers every device by itself, runs once instead of once per device when devices run in parallel */
+#define RUNNER_TEST_FLAG_ALL_DEVICES    (1 << 1)
+/* Checkpoints its units and replays them on --resume, other tests the checkpoint has as complete are skipped */
+#define RUNNER_TEST_FLAG_RESUMABLE      (1 << 2)
 
 typedef test_status(test_main)(int32_t device_id, void *config_data);
+/* Hands the planner what the test would cost on the selected devices, instead of running it */
+typedef test_status(test_estimate)(int32_t device_id, void *config_data);
+/* Queues the pipelines the test creates, so a batch has all of them compiled before it starts measuring */
+typedef test_status(test_prepare)(int32_t device_id, void *config_data);
 
 typedef struct runner_test_t {
     test_main *entry;
+    test_estimate *estimate;                            /* NULL if the test takes no noticeable time */
+    test_prepare *prepare;                              /* NULL if the test creates no pipelines */
     void *config_data;
     const char *name;
+    const char *tags;                                   /* Comma separated category, data type and required features */
     uint32_t version;
+    uint32_t flags;
 } runner_test;
 
-test_status RunnerRegisterTest(test_main *test_entry, void *config_data, const char * const test_name, uint32_t test_version);
+test_status RunnerRegisterTest(test_main *test_entry, test_estimate *estimate_entry, test_prepare *prepare_entry, void *config_data, const char * const test_name, uint32_t test_version, uint32_t flags, const char *tags);
 test_status RunnerRegisterTests();
 test_status RunnerCleanUp();
-test_status RunnerExecuteTests(const char *test_name, int32_t device_id);
+test_status RunnerExecuteTests(const char *test_names, int32_t device_id);
+test_status RunnerValidateTests(const char *test_names);
+test_status RunnerPrepareTests(const char *test_names, int32_t device_id);
 test_status RunnerPrintTests();
+runner_test *RunnerFindTest(const char *test_name, size_t name_length);
+test_status RunnerPrintHistory(const char *test_names, int32_t device_id);
+test_status RunnerCompareResults(const char *baseline, const char *candidate, const char *test_names, int32_t device_id, double threshold);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,69 @@
+// Copyright (c) 2021 - 2022, Nemes <nemes@nemez.net>
+// SPDX-License-Identifier: MIT
+// 
+// MIT License
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software andassociated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, andto permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+// 
+// The above copyright notice andthis permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef SOAK_H
+#define SOAK_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SOAK_MAXIMUM_MINUTES                (24 * 60)
+#define SOAK_MINIMUM_BUCKET_MS              (1000)
+#define SOAK_MAXIMUM_BUCKETS                (4096)          // Longer soaks get wider buckets instead of more of them
+#define SOAK_SUSTAINED_FRACTION             (4)             // The last 1/n of the buckets make up the sustained result
+#define SOAK_THROTTLE_THRESHOLD             (0.95)          // Fraction of the peak a bucket has to stay above to count as unthrottled
+
+typedef struct soak_bucket_t {
+    double work;                                            /* Bytes or operations completed by runs that ended in this bucket */
+    uint64_t busy_us;                                       /* Measured time of those runs */
+} soak_bucket;
+
+typedef struct soak_series_t {
+    soak_bucket *buckets;
+    uint32_t bucket_count;
+    uint64_t bucket_us;
+    uint64_t duration_us;
+    uint64_t elapsed_us;
+    helper_timer timer;
+} soak_series;
+
+typedef struct soak_summary_t {
+    double sustained;                                       /* Per second */
+    double peak;                                            /* Per second */
+    bool throttled;
+    uint64_t throttle_start_us;
+} soak_summary;
+
+test_status SoakInitialize(uint32_t minutes, soak_series *series);
+test_status SoakCleanUp(soak_series *series);
+void SoakAddRun(soak_series *series, uint64_t time_us, double work);
+bool SoakIsFinished(soak_series *series);
+double SoakGetBucketRate(soak_series *series, uint32_t bucket_index);
+void SoakSummarize(soak_series *series, soak_summary *summary);
+void SoakLogResult(soak_series *series, const char *unit_name, double unit_scale);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
\ No newline at end of file
@@ -0,0 +1,71 @@
+// Copyright (c) 2021 - 2022, Nemes <nemes@nemez.net>
+// SPDX-License-Identifier: MIT
+// 
+// MIT License
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software andassociated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, andto permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+// 
+// The above copyright notice andthis permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef STATISTICS_H
+#define STATISTICS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define STATISTICS_DEFAULT_TRIAL_COUNT      (5)
+#define STATISTICS_MAXIMUM_TRIAL_COUNT      (1000)
+#define STATISTICS_OUTLIER_IQR_FACTOR       (1.5)
+#define STATISTICS_OUTLIER_MINIMUM_SAMPLES  (4)
+#define STATISTICS_EXACT_RANK_TEST_SAMPLES  (40)    // Combined sample count up to which Mann-Whitney uses the exact distribution
+
+#define STATISTICS_CSV_HEADER               "Min,Max,P5,P95,Std dev,CI95 low,CI95 high,Samples,Outliers"
+#define STATISTICS_CSV_FORMAT               "%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%lu,%lu"
+#define STATISTICS_CSV_VALUES(summary)      (summary)->minimum, (summary)->maximum, (summary)->p5, (summary)->p95, (summary)->standard_deviation, (summary)->confidence_low, (summary)->confidence_high, (summary)->sample_count, (summary)->rejected_outliers
+
+typedef struct statistics_samples_t {
+    helper_arraylist samples;
+} statistics_samples;
+
+typedef struct statistics_summary_t {
+    uint32_t sample_count;
+    uint32_t rejected_outliers;
+    double minimum;
+    double maximum;
+    double mean;
+    double median;
+    double p5;
+    double p95;
+    double standard_deviation;
+    double confidence_low;
+    double confidence_high;
+} statistics_summary;
+
+test_status StatisticsInitialize(statistics_samples *samples);
+test_status StatisticsCleanUp(statistics_samples *samples);
+test_status StatisticsAddSample(statistics_samples *samples, double value);
+void StatisticsReset(statistics_samples *samples);
+size_t StatisticsGetSampleCount(statistics_samples *samples);
+test_status StatisticsSummarize(statistics_samples *samples, statistics_summary *summary);
+void StatisticsScaleSummary(statistics_summary *summary, double factor);
+test_status StatisticsMannWhitney(statistics_samples *a, statistics_samples *b, double *p_value);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
\ No newline at end of file
@@ -28,7 +28,7 @@
 extern "C" {
 #endif
 
-#define TESTS_VULKAN_BANDWIDTH_VERSION  TEST_MKVERSION(1, 3, 2)
+#define TESTS_VULKAN_BANDWIDTH_VERSION  TEST_MKVERSION(1, 13, 0)
 #define TESTS_VULKAN_BANDWIDTH_NAME     "vk_bandwidth"
 
 test_status TestsVulkanBandwidthRegister();
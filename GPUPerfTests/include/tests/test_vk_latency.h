@@ -28,7 +28,7 @@
 extern "C" {
 #endif
 
-#define TESTS_VULKAN_LATENCY_VERSION    TEST_MKVERSION(1, 2, 1)
+#define TESTS_VULKAN_LATENCY_VERSION    TEST_MKVERSION(1, 10, 0)
 #define TESTS_VULKAN_LATENCY_VEC_NAME   "vk_latency_vector"
 #define TESTS_VULKAN_LATENCY_SCLR_NAME  "vk_latency_scalar"
 
@@ -28,7 +28,7 @@
 extern "C" {
 #endif
 
-#define TESTS_VULKAN_RATE_VERSION           TEST_MKVERSION(1, 5, 0)
+#define TESTS_VULKAN_RATE_VERSION           TEST_MKVERSION(1, 14, 0)
 
 #define TESTS_VULKAN_RATE_TYPE_FP16         "fp16"
 #define TESTS_VULKAN_RATE_TYPE_FP32         "fp32"
@@ -28,7 +28,7 @@
 extern "C" {
 #endif
 
-#define TESTS_VULKAN_UPLINK_VERSION                 TEST_MKVERSION(1, 1, 2)
+#define TESTS_VULKAN_UPLINK_VERSION                 TEST_MKVERSION(1, 5, 0)
 #define TESTS_VULKAN_UPLINK_CPU_READ_NAME           "vk_uplink_copy_read"
 #define TESTS_VULKAN_UPLINK_CPU_WRITE_NAME          "vk_uplink_copy_write"
 #define TESTS_VULKAN_UPLINK_GPU_READ_NAME           "vk_uplink_compute_read"
@@ -0,0 +1,71 @@
+// Copyright (c) 2021 - 2022, Nemes <nemes@nemez.net>
+// SPDX-License-Identifier: MIT
+// 
+// MIT License
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software andassociated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, andto permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+// 
+// The above copyright notice andthis permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef TIMELINE_H
+#define TIMELINE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TIMELINE_EVENTS_PER_THREAD      (1 << 16)
+#define TIMELINE_MAXIMUM_THREADS        (64)
+
+#define TIMELINE_TRACK_CPU              0
+#define TIMELINE_TRACK_GPU              1
+
+#define TIMELINE_CATEGORY_COMMAND       "command"
+#define TIMELINE_CATEGORY_TRANSFER      "transfer"
+#define TIMELINE_CATEGORY_MEMORY        "memory"
+#define TIMELINE_CATEGORY_GPU           "gpu"
+
+typedef struct timeline_event_t {
+    const char *name;
+    const char *category;
+    uint64_t start_ns;
+    uint64_t duration_ns;
+    uint64_t argument;
+    uint32_t track;
+} timeline_event;
+
+typedef struct timeline_thread_buffer_t {
+    timeline_event *events;
+    uint32_t event_count;
+    uint32_t dropped_count;
+    uint32_t thread_index;
+    helper_atomic_bool in_use;          /* Claimed by a live thread, an exited thread's successor keeps appending to it */
+} timeline_thread_buffer;
+
+test_status TimelineInitialize(const char *filepath);
+test_status TimelineFinish();
+bool TimelineIsEnabled();
+uint64_t TimelineBegin();
+void TimelineEnd(uint64_t start_ns, const char *name, const char *category, uint64_t argument);
+void TimelineRecordGpu(uint64_t duration_ns, const char *name, uint64_t argument);
+void TimelineReleaseThread();
+
+#ifdef __cplusplus
+}
+#endif
+#endif
\ No newline at end of file
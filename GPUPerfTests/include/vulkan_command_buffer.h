@@ -33,6 +33,8 @@ extern "C" {
 #define VULKAN_COMMAND_SEQUENCE_MULTI_QUEUE_USE     (1 << 1)
 
 #define VULKAN_COMMAND_SEQUENCE_WAIT_INFINITE       (0xFFFFFFFFFFFFFFFFULL)
+#define VULKAN_COMMAND_SEQUENCE_WAIT_STEP           (0xFFFFFFFFFFFFFFFEULL)     // The step timeout set by --step-timeout
+#define VULKAN_COMMAND_SEQUENCE_DRAIN_NANOSECONDS   (5000000000ULL)             // How long a timed out submission gets to finish before its device is given up
 
 #define VULKAN_COMMAND_COPY_SUBREGION_WHOLE_REGION  (0)
 
@@ -28,6 +28,8 @@
 extern "C" {
 #endif
 
+#define VULKAN_COMPUTE_PIPELINE_MAXIMUM_CONSTANTS   (8)
+
 typedef struct vulkan_compute_pipeline_t {
     vulkan_device *device;
     vulkan_shader *shader;
@@ -37,7 +39,17 @@ typedef struct vulkan_compute_pipeline_t {
     uint32_t *descriptor_set_indices;
 } vulkan_compute_pipeline;
 
+/* Everything vkCreateComputePipelines reads, the create info points into the rest of the struct so it can't be copied */
+typedef struct vulkan_compute_pipeline_description_t {
+    VkComputePipelineCreateInfo create_info;
+    VkSpecializationInfo specialization_info;
+    VkSpecializationMapEntry map_entries[VULKAN_COMPUTE_PIPELINE_MAXIMUM_CONSTANTS];
+    uint32_t constants[VULKAN_COMPUTE_PIPELINE_MAXIMUM_CONSTANTS];
+} vulkan_compute_pipeline_description;
+
 test_status VulkanComputePipelineInitialize(vulkan_shader *compute_shader, const char *entrypoint, vulkan_compute_pipeline *pipeline_handle);
+test_status VulkanComputePipelineInitializeSpecialized(vulkan_shader *compute_shader, const char *entrypoint, const uint32_t *constants, uint32_t constant_count, vulkan_compute_pipeline *pipeline_handle);
+test_status VulkanComputePipelineDescribe(vulkan_shader *compute_shader, const char *entrypoint, const uint32_t *constants, uint32_t constant_count, vulkan_compute_pipeline_description *description);
 test_status VulkanComputePipelineCleanUp(vulkan_compute_pipeline *pipeline_handle);
 test_status VulkanComputePipelineBind(vulkan_compute_pipeline *pipeline_handle, vulkan_memory *memory_handle, const char *binding_name);
 
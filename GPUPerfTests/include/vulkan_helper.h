@@ -37,6 +37,9 @@ extern "C" {
 
 // Helper value for VulkanCreateDeviceWithQueue and VulkanCommandBuffer*
 #define VULKAN_QUEUES_ALL                   (0xFFFFFFFFUL)
+// Logical devices kept alive between tests of a batch (enough for one per GPU when devices run in parallel), and the most queue families a cached device can use
+#define VULKAN_DEVICE_CACHE_SIZE            (16)
+#define VULKAN_DEVICE_CACHE_MAXIMUM_FAMILIES (16)
 
 typedef struct vulkan_queue_family_t {
     uint32_t family_index;
@@ -50,6 +53,7 @@ typedef struct vulkan_physical_device_t {
     VkPhysicalDeviceIDProperties physical_ID_properties;
     VkPhysicalDeviceFeatures2 physical_features;
     VkPhysicalDeviceVulkan12Properties physical_properties_vk12;
+    VkPhysicalDeviceVulkan11Features physical_features_vk11;
     VkPhysicalDeviceVulkan12Features physical_features_vk12;
     VkPhysicalDeviceMemoryProperties2 physical_memory_properties;
     VkPhysicalDeviceMaintenance3Properties physical_maintenance_properties_3;
@@ -63,6 +67,9 @@ typedef struct vulkan_device_t {
     uint32_t queue_family_count;
     uint32_t total_queue_count;
     VkQueue *queues;
+    VkPipelineCache pipeline_cache;
+    size_t pipeline_cache_loaded_size;
+    bool lost;                  /* The GPU never finished a timed out submission, nothing created on it is destroyed any more */
 } vulkan_device;
 
 typedef struct vulkan_instance_t {
@@ -93,9 +100,14 @@ test_status VulkanCreateDeviceWithQueues(vulkan_physical_device *physical_device
 test_status VulkanCreateDeviceWithQueue(vulkan_physical_device *physical_device, VkQueueFamilyProperties *queue_family_properties, uint32_t queue_family_index, uint32_t queue_count, vulkan_device *device, const void *pNext);
 test_status VulkanCreateDevice(vulkan_physical_device *physical_device, VkQueueFamilyProperties *queue_family_properties, uint32_t queue_family_count, VkQueueFlags required_flags, vulkan_device *device, const void *pNext);
 test_status VulkanDestroyDevice(vulkan_device *device);
+void VulkanDeviceMarkLost(vulkan_device *device);
+void VulkanDeviceCacheEnable();
+void VulkanDeviceCacheShare(bool shared);
+test_status VulkanDeviceCacheFlush();
 test_status VulkanCalculateWorkgroupDispatch(vulkan_device *device, uint64_t total_workgroups, uint32_t *x, uint32_t *y, uint32_t *z);
+uint64_t VulkanGetDeviceLocalMemorySize(vulkan_physical_device *physical_device);
 
 #ifdef __cplusplus
 }
 #endif
-#endif
+#endif
\ No newline at end of file
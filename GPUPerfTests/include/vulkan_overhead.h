@@ -0,0 +1,48 @@
+// Copyright (c) 2021 - 2022, Nemes <nemes@nemez.net>
+// SPDX-License-Identifier: MIT
+// 
+// MIT License
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software andassociated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, andto permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+// 
+// The above copyright notice andthis permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef VULKAN_OVERHEAD_H
+#define VULKAN_OVERHEAD_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define VULKAN_OVERHEAD_CALIBRATION_RUNS    (32)
+
+typedef struct vulkan_overhead_t {
+    uint64_t empty_submit_ns;       /* Submit and wait on a command buffer with nothing in it */
+    uint64_t dispatch_ns;           /* Submit and wait on a single workgroup of an empty shader */
+    bool gpu_timestamps;
+} vulkan_overhead;
+
+test_status VulkanOverheadCalibrate(vulkan_command_sequence *command_sequence, vulkan_query_pool *query_pool, vulkan_overhead *overhead);
+test_status VulkanOverheadPrepare(vulkan_pipeline_builder *builder);
+uint64_t VulkanOverheadSubtract(vulkan_overhead *overhead, uint64_t time_us);
+void VulkanOverheadLogResult(vulkan_overhead *overhead);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
\ No newline at end of file
@@ -0,0 +1,60 @@
+// Copyright (c) 2021 - 2022, Nemes <nemes@nemez.net>
+// SPDX-License-Identifier: MIT
+// 
+// MIT License
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software andassociated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, andto permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+// 
+// The above copyright notice andthis permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef VULKAN_PIPELINE_BUILDER_H
+#define VULKAN_PIPELINE_BUILDER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define VULKAN_PIPELINE_BUILDER_MINIMUM_BATCH   (4)     // Pipelines a worker compiles at least, fewer aren't worth another thread
+
+/*
+ * Compiles pipelines ahead of time on a worker pool. Every worker creates its share with one vkCreateComputePipelines
+ * call against the device's pipeline cache and throws the pipelines away, the compiled code stays in the cache.
+ */
+typedef struct vulkan_pipeline_builder_t {
+    vulkan_device *device;
+    helper_arraylist shaders;                           /* vulkan_shader *, cleaned up with the builder */
+    helper_arraylist requests;
+} vulkan_pipeline_builder;
+
+typedef struct vulkan_pipeline_builder_request_t {
+    vulkan_shader *shader;
+    const char *entrypoint;
+    uint32_t constants[VULKAN_COMPUTE_PIPELINE_MAXIMUM_CONSTANTS];
+    uint32_t constant_count;
+} vulkan_pipeline_builder_request;
+
+test_status VulkanPipelineBuilderInitialize(vulkan_device *device, vulkan_pipeline_builder *builder);
+test_status VulkanPipelineBuilderAddShader(vulkan_pipeline_builder *builder, vulkan_shader *shader, vulkan_shader **owned_shader);
+test_status VulkanPipelineBuilderAddPipeline(vulkan_pipeline_builder *builder, vulkan_shader *shader, const char *entrypoint, const uint32_t *constants, uint32_t constant_count);
+test_status VulkanPipelineBuilderBuild(vulkan_pipeline_builder *builder);
+void VulkanPipelineBuilderCleanUp(vulkan_pipeline_builder *builder);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
\ No newline at end of file
@@ -0,0 +1,64 @@
+// Copyright (c) 2021 - 2022, Nemes <nemes@nemez.net>
+// SPDX-License-Identifier: MIT
+// 
+// MIT License
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software andassociated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, andto permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+// 
+// The above copyright notice andthis permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef VULKAN_QUERY_H
+#define VULKAN_QUERY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define VULKAN_QUERY_TIMESTAMP_START        (0)
+#define VULKAN_QUERY_TIMESTAMP_END          (1)
+#define VULKAN_QUERY_TIMESTAMP_PAIR         (2)
+#define VULKAN_QUERY_INVOCATIONS            (0)
+#define VULKAN_QUERY_INVOCATIONS_COUNT      (1)
+
+typedef struct vulkan_query_pool_t {
+    vulkan_device *device;
+    VkQueryPool query_pool;
+    VkQueryType query_type;
+    uint32_t query_count;
+    uint64_t timestamp_mask;
+    double timestamp_period;
+} vulkan_query_pool;
+
+bool VulkanQueryTimestampsSupported(vulkan_command_buffer *command_handle);
+test_status VulkanQueryPoolInitializeTimestamps(vulkan_command_buffer *command_handle, uint32_t query_count, vulkan_query_pool *query_handle);
+bool VulkanQueryInvocationsSupported(vulkan_physical_device *physical_device);
+test_status VulkanQueryPoolInitializeInvocations(vulkan_command_buffer *command_handle, uint32_t query_count, vulkan_query_pool *query_handle);
+test_status VulkanQueryPoolCleanUp(vulkan_query_pool *query_handle);
+test_status VulkanQueryPoolReset(vulkan_command_sequence *sequence_handle, vulkan_query_pool *query_handle);
+test_status VulkanQueryWriteTimestamp(vulkan_command_sequence *sequence_handle, vulkan_query_pool *query_handle, VkPipelineStageFlagBits stage, uint32_t query_index);
+test_status VulkanQueryBegin(vulkan_command_sequence *sequence_handle, vulkan_query_pool *query_handle, uint32_t query_index);
+test_status VulkanQueryEnd(vulkan_command_sequence *sequence_handle, vulkan_query_pool *query_handle, uint32_t query_index);
+test_status VulkanQueryGetTimestamps(vulkan_query_pool *query_handle, uint32_t first_query, uint32_t query_count, uint64_t *timestamps);
+test_status VulkanQueryGetElapsedNanoseconds(vulkan_query_pool *query_handle, uint32_t start_query, uint32_t end_query, uint64_t *elapsed_nanoseconds);
+test_status VulkanQueryGetInvocations(vulkan_query_pool *query_handle, uint32_t query_index, uint64_t *invocations);
+test_status VulkanQueryCheckInvocations(vulkan_query_pool *query_handle, uint32_t query_index, uint64_t expected_invocations, bool *invocations_valid);
+void VulkanQueryLogInvocationResult(vulkan_query_pool *query_handle, bool invocations_valid);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
\ No newline at end of file
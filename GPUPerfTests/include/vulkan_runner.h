@@ -28,18 +28,42 @@
 extern "C" {
 #endif
 
+/* Device features a test can't run without, checked before it creates its logical device */
+#define VULKAN_RUNNER_FEATURE_NONE          (0)
+#define VULKAN_RUNNER_FEATURE_FLOAT16       (1 << 0)        // shaderFloat16 and 16-bit storage buffers
+#define VULKAN_RUNNER_FEATURE_FLOAT64       (1 << 1)
+#define VULKAN_RUNNER_FEATURE_INT8          (1 << 2)        // shaderInt8 and 8-bit storage buffers
+#define VULKAN_RUNNER_FEATURE_INT16         (1 << 3)        // shaderInt16 and 16-bit storage buffers
+#define VULKAN_RUNNER_FEATURE_INT64         (1 << 4)
+
 typedef test_status(vulkan_test_main)(vulkan_physical_device *device, void *config_data);
+/* Fills estimate from device limits and the current parameters without creating a logical device */
+typedef test_status(vulkan_test_estimate)(vulkan_physical_device *device, void *config_data, planner_estimate *estimate);
+/* Creates the logical device the test will run on and adds the pipelines it creates to that device's VulkanRunnerGetPipelineBuilder */
+struct vulkan_pipeline_builder_t;
+typedef test_status(vulkan_test_prepare)(vulkan_physical_device *device, void *config_data);
 
 typedef struct vulkan_runner_context_t {
     vulkan_test_main *entrypoint;
+    vulkan_test_estimate *estimate;
+    vulkan_test_prepare *prepare;
     void *config_data;
     uint32_t version;
     const char *name;
     bool graphical;
+    uint32_t flags;
+    uint32_t required_features;
 } vulkan_runner_context;
 
 test_status VulkanRunnerRegisterTests();
-test_status VulkanRunnerRegisterTest(vulkan_test_main *entrypoint, void *config_data, const char *const test_name, uint32_t test_version, bool graphical_context);
+test_status VulkanRunnerRegisterTest(vulkan_test_main *entrypoint, vulkan_test_estimate *estimate, vulkan_test_prepare *prepare, void *config_data, const char *const test_name, uint32_t test_version, bool graphical_context, uint32_t flags, const char *tags, uint32_t required_features);
+test_status VulkanRunnerBeginBatch();
+test_status VulkanRunnerBeginParallelBatch(uint32_t *device_count);
+test_status VulkanRunnerEndBatch();
+test_status VulkanRunnerBeginPipelineBuild(int32_t device_id);
+test_status VulkanRunnerEndPipelineBuild();
+test_status VulkanRunnerGetPipelineBuilder(vulkan_device *device, struct vulkan_pipeline_builder_t **builder);
+test_status VulkanRunnerGetDeviceUUID(uint32_t device_index, uint8_t *uuid);
 
 #ifdef __cplusplus
 }
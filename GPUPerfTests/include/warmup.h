@@ -0,0 +1,57 @@
+// Copyright (c) 2021 - 2022, Nemes <nemes@nemez.net>
+// SPDX-License-Identifier: MIT
+// 
+// MIT License
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software andassociated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, andto permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+// 
+// The above copyright notice andthis permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef WARMUP_H
+#define WARMUP_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define WARMUP_DEFAULT_TOLERANCE            (2.0)           // Percent, spread of the per-iteration time across the window
+#define WARMUP_WINDOW                       (4)             // Successive runs that have to agree
+#define WARMUP_MAXIMUM_RUNS                 (200)
+#define WARMUP_MAXIMUM_TIME_MS              (15000)
+
+typedef struct warmup_detector_t {
+    double window[WARMUP_WINDOW];                           /* Per-iteration times in microseconds, oldest first */
+    uint32_t run_count;
+    uint32_t maximum_runs;
+    uint64_t maximum_time_us;
+    uint64_t elapsed_us;
+    double tolerance;
+    bool steady;
+    bool finished;
+    helper_timer timer;
+} warmup_detector;
+
+void WarmupStart(warmup_detector *detector);
+void WarmupAddRun(warmup_detector *detector, uint64_t time_us, uint64_t iterations);
+bool WarmupIsFinished(warmup_detector *detector);
+void WarmupLogResult(warmup_detector *detector);
+uint64_t WarmupEstimateTime(uint64_t run_time_us);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
\ No newline at end of file
@@ -0,0 +1,54 @@
+// Copyright (c) 2021 - 2022, Nemes <nemes@nemez.net>
+// SPDX-License-Identifier: MIT
+// 
+// MIT License
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software andassociated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, andto permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+// 
+// The above copyright notice andthis permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef WATCHDOG_H
+#define WATCHDOG_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define WATCHDOG_DEFAULT_STEP_TIMEOUT_MS    (30000)
+#define WATCHDOG_GRACE_MS                   (10000)         // Time a timed out test gets to unwind before the process is ended
+#define WATCHDOG_POLL_MS                    (50)
+#define WATCHDOG_EXIT_CODE                  (3)
+
+/* One per test run, only referenced by the thread running the test and its backstop thread */
+typedef struct watchdog_t {
+    const char *test_name;
+    helper_timer timer;
+    uint64_t timeout_ns;
+    helper_atomic_bool finished;
+    helper_atomic_bool *abandoned;
+    helper_thread thread;
+} watchdog;
+
+test_status WatchdogArm(const char *test_name, uint32_t timeout_seconds, helper_atomic_bool *abandoned);
+void WatchdogDisarm();
+bool WatchdogHasExpired();
+uint64_t WatchdogGetRemainingNanoseconds();
+
+#ifdef __cplusplus
+}
+#endif
+#endif
\ No newline at end of file
@@ -30,6 +30,7 @@
 #include "vulkan_command_buffer.h"
 #include "vulkan_staging.h"
 #include "buffer_filler.h"
+#include "timeline.h"
 
 #define BUFFER_FILLER_MINIMUM_BLOCK_SIZE            (1024 * 1024)
 #define BUFFER_FILLER_MAXIMUM_BLOCK_SIZE            (16 * 1024 * 1024)
@@ -65,6 +66,7 @@ typedef struct buffer_filler_rng_t {
 } buffer_filler_rng;
 
 static void _BufferFillerThreadFunc(uint32_t thread_id, void *data);
+static test_status _BufferFillerGenericOffset(vulkan_region *region, size_t region_size_override, size_t offset_override, buffer_filler_block_func *block_function, size_t data_unit_size, void *custom_data, buffer_filler_prep_func *per_block_initialize, buffer_filler_prep_func *per_block_cleanup);
 
 static test_status _BufferFillerValueI8(void *block_data, size_t block_offset, size_t block_size, uint32_t block_index, void *custom_data);
 static test_status _BufferFillerValueI16(void *block_data, size_t block_offset, size_t block_size, uint32_t block_index, void *custom_data);
@@ -219,6 +221,13 @@ test_status BufferFillerGeneric(vulkan_region *region, buffer_filler_block_func
 }
 
 test_status BufferFillerGenericOffset(vulkan_region * region, size_t region_size_override, size_t offset_override, buffer_filler_block_func * block_function, size_t data_unit_size, void *custom_data, buffer_filler_prep_func *per_block_initialize, buffer_filler_prep_func *per_block_cleanup) {
+    uint64_t timeline_start = TimelineBegin();
+    test_status status = _BufferFillerGenericOffset(region, region_size_override, offset_override, block_function, data_unit_size, custom_data, per_block_initialize, per_block_cleanup);
+    TimelineEnd(timeline_start, "Fill buffer", TIMELINE_CATEGORY_MEMORY, region_size_override - offset_override);
+    return status;
+}
+
+static test_status _BufferFillerGenericOffset(vulkan_region * region, size_t region_size_override, size_t offset_override, buffer_filler_block_func * block_function, size_t data_unit_size, void *custom_data, buffer_filler_prep_func *per_block_initialize, buffer_filler_prep_func *per_block_cleanup) {
     if ((region_size_override + offset_override) > region->size && offset_override < region_size_override) {
         return TEST_INVALID_PARAMETER;
     }
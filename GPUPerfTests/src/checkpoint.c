@@ -0,0 +1,308 @@
+// Copyright (c) 2021 - 2022, Nemes <nemes@nemez.net>
+// SPDX-License-Identifier: MIT
+// 
+// MIT License
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software andassociated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, andto permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+// 
+// The above copyright notice andthis permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "main.h"
+#include "logger.h"
+#include "helper.h"
+#include "statistics.h"
+#include "results.h"
+#include "checkpoint.h"
+
+/* Which run of a test on a device this is, counted the same way by the interrupted and the resumed process */
+typedef struct checkpoint_occurrence_t {
+    uint8_t uuid[RESULTS_UUID_SIZE];
+    char test_name[RESULTS_MAXIMUM_NAME_LENGTH];
+    uint32_t count;
+} checkpoint_occurrence;
+
+/* The test the calling thread is running, parallel workers each have their own */
+typedef struct checkpoint_test_t {
+    bool active;
+    bool complete;
+    uint32_t occurrence;
+    uint64_t parameter_hash;
+    uint8_t uuid[RESULTS_UUID_SIZE];
+    char test_name[RESULTS_MAXIMUM_NAME_LENGTH];
+} checkpoint_test;
+
+static FILE *checkpoint_file;
+static helper_mutex checkpoint_mutex;
+static helper_arraylist checkpoint_resumed_records;
+static helper_arraylist checkpoint_occurrences;
+static HELPER_THREAD_LOCAL checkpoint_test checkpoint_local_test;
+
+static test_status _CheckpointLoad(const char *filepath);
+static const checkpoint_record *_CheckpointFind(checkpoint_record_type type, uint32_t unit, uint64_t region_size);
+static test_status _CheckpointWrite(checkpoint_record *record);
+static test_status _CheckpointWriteLocal(checkpoint_record_type type, uint32_t unit, uint64_t region_size, uint64_t iterations, uint32_t workgroups, const statistics_summary *summary);
+
+/*
+ * Resuming reads everything the interrupted run wrote and replaces the file with it, which also drops a record
+ * that was cut short. The file is replaced atomically so being interrupted again right then loses nothing.
+ * The resumed run then keeps appending to the same file, so it can be resumed again.
+ */
+test_status CheckpointInitialize(const char *filepath, bool resume) {
+    if (filepath == NULL || checkpoint_file != NULL) {
+        return TEST_INVALID_PARAMETER;
+    }
+    memset(&checkpoint_resumed_records, 0, sizeof(checkpoint_resumed_records));
+    memset(&checkpoint_occurrences, 0, sizeof(checkpoint_occurrences));
+    test_status status = TEST_OK;
+    if (resume) {
+        status = _CheckpointLoad(filepath);
+        if (!TEST_SUCCESS(status)) {
+            goto error;
+        }
+    }
+    checkpoint_mutex = HelperCreateMutex();
+    if (checkpoint_mutex == NULL) {
+        status = TEST_OUT_OF_MEMORY;
+        goto error;
+    }
+    if (resume) {
+        size_t record_count = HelperArrayListSize(&checkpoint_resumed_records);
+        status = HelperWriteFileAtomic(filepath, HelperArrayListRawData(&checkpoint_resumed_records), record_count * sizeof(checkpoint_record));
+        if (!TEST_SUCCESS(status)) {
+            goto cleanup_mutex;
+        }
+    }
+    checkpoint_file = fopen(filepath, resume ? "ab" : "wb");
+    if (checkpoint_file == NULL) {
+        status = TEST_FILE_IO_ERROR;
+        goto cleanup_mutex;
+    }
+    return TEST_OK;
+
+cleanup_mutex:
+    HelperCleanUpMutex(checkpoint_mutex);
+    checkpoint_mutex = NULL;
+error:
+    if (HelperArrayListRawData(&checkpoint_resumed_records) != NULL) {
+        HelperArrayListClean(&checkpoint_resumed_records);
+    }
+    return status;
+}
+
+bool CheckpointIsEnabled() {
+    return checkpoint_file != NULL;
+}
+
+void CheckpointCleanUp() {
+    if (checkpoint_file == NULL) {
+        return;
+    }
+    fclose(checkpoint_file);
+    checkpoint_file = NULL;
+    HelperCleanUpMutex(checkpoint_mutex);
+    checkpoint_mutex = NULL;
+    if (HelperArrayListRawData(&checkpoint_resumed_records) != NULL) {
+        HelperArrayListClean(&checkpoint_resumed_records);
+    }
+    if (HelperArrayListRawData(&checkpoint_occurrences) != NULL) {
+        HelperArrayListClean(&checkpoint_occurrences);
+    }
+}
+
+/* Records of a run with other parameters are ignored, the test is measured again */
+void CheckpointBeginTest(const char *test_name, const uint8_t *uuid, uint64_t parameter_hash) {
+    checkpoint_test *test = &checkpoint_local_test;
+    memset(test, 0, sizeof(checkpoint_test));
+    if (!CheckpointIsEnabled() || test_name == NULL || uuid == NULL) {
+        return;
+    }
+    strncpy(test->test_name, test_name, RESULTS_MAXIMUM_NAME_LENGTH - 1);
+    memcpy(test->uuid, uuid, RESULTS_UUID_SIZE);
+    test->parameter_hash = parameter_hash;
+
+    HelperLockMutex(checkpoint_mutex);
+    checkpoint_occurrence *occurrence = NULL;
+    size_t occurrence_count = HelperArrayListSize(&checkpoint_occurrences);
+    for (size_t i = 0; i < occurrence_count; i++) {
+        checkpoint_occurrence *candidate = (checkpoint_occurrence *)HelperArrayListGet(&checkpoint_occurrences, i);
+        if (strcmp(candidate->test_name, test->test_name) == 0 && memcmp(candidate->uuid, test->uuid, RESULTS_UUID_SIZE) == 0) {
+            occurrence = candidate;
+            break;
+        }
+    }
+    if (occurrence == NULL) {
+        checkpoint_occurrence first_occurrence;
+        memset(&first_occurrence, 0, sizeof(first_occurrence));
+        memcpy(first_occurrence.test_name, test->test_name, RESULTS_MAXIMUM_NAME_LENGTH);
+        memcpy(first_occurrence.uuid, test->uuid, RESULTS_UUID_SIZE);
+        size_t index = 0;
+        /* Without the counter every repetition is the first, which only costs replaying the same results again */
+        if (TEST_SUCCESS(HelperArrayListAdd(&checkpoint_occurrences, &first_occurrence, sizeof(first_occurrence), &index))) {
+            occurrence = (checkpoint_occurrence *)HelperArrayListGet(&checkpoint_occurrences, index);
+        }
+    }
+    if (occurrence != NULL) {
+        test->occurrence = occurrence->count++;
+    }
+    HelperUnlockMutex(checkpoint_mutex);
+
+    test->active = true;
+    test->complete = (_CheckpointFind(checkpoint_record_complete, 0, 0) != NULL);
+    size_t record_count = HelperArrayListSize(&checkpoint_resumed_records);
+    for (size_t i = 0; i < record_count; i++) {
+        const checkpoint_record *record = (const checkpoint_record *)HelperArrayListGet(&checkpoint_resumed_records, i);
+        if (record->parameter_hash != test->parameter_hash && record->occurrence == test->occurrence &&
+            memcmp(record->uuid, test->uuid, RESULTS_UUID_SIZE) == 0 && strcmp(record->test_name, test->test_name) == 0) {
+            WARNING("The checkpoint has %s with other parameters, measuring it again\n", test->test_name);
+            break;
+        }
+    }
+}
+
+test_status CheckpointEndTest(bool complete) {
+    checkpoint_test *test = &checkpoint_local_test;
+    if (!test->active) {
+        return TEST_OK;
+    }
+    test_status status = TEST_OK;
+    if (complete && !test->complete) {
+        status = _CheckpointWriteLocal(checkpoint_record_complete, 0, 0, 0, 0, NULL);
+    }
+    test->active = false;
+    return status;
+}
+
+/* True when the interrupted run already finished this test, its units can all be replayed */
+bool CheckpointIsTestComplete() {
+    return checkpoint_local_test.active && checkpoint_local_test.complete;
+}
+
+/* Units without a region size, such as a whole latency run, pass 0 */
+bool CheckpointGetUnit(uint32_t unit, uint64_t region_size, uint64_t *iterations, statistics_summary *summary) {
+    const checkpoint_record *record = _CheckpointFind(checkpoint_record_unit, unit, region_size);
+    if (record == NULL) {
+        return false;
+    }
+    if (iterations != NULL) {
+        *iterations = record->iterations;
+    }
+    if (summary != NULL) {
+        *summary = record->summary;
+    }
+    return true;
+}
+
+test_status CheckpointRecordUnit(uint32_t unit, uint64_t region_size, uint64_t iterations, const statistics_summary *summary) {
+    if (summary == NULL) {
+        return TEST_INVALID_PARAMETER;
+    }
+    return _CheckpointWriteLocal(checkpoint_record_unit, unit, region_size, iterations, 0, summary);
+}
+
+bool CheckpointGetCalibration(uint32_t unit, uint64_t region_size, uint64_t *iterations, uint32_t *workgroups) {
+    const checkpoint_record *record = _CheckpointFind(checkpoint_record_calibration, unit, region_size);
+    if (record == NULL) {
+        return false;
+    }
+    if (iterations != NULL) {
+        *iterations = record->iterations;
+    }
+    if (workgroups != NULL) {
+        *workgroups = record->workgroups;
+    }
+    return true;
+}
+
+test_status CheckpointRecordCalibration(uint32_t unit, uint64_t region_size, uint64_t iterations, uint32_t workgroups) {
+    return _CheckpointWriteLocal(checkpoint_record_calibration, unit, region_size, iterations, workgroups, NULL);
+}
+
+static test_status _CheckpointLoad(const char *filepath) {
+    FILE *previous = fopen(filepath, "rb");
+    if (previous == NULL) {
+        return TEST_FILE_NOT_FOUND;
+    }
+    test_status status = TEST_OK;
+    checkpoint_record record;
+    while (fread(&record, sizeof(record), 1, previous) == 1) {
+        if (record.magic != CHECKPOINT_RECORD_MAGIC || record.format_version != CHECKPOINT_FORMAT_VERSION) {
+            WARNING("%s holds records of another checkpoint format, ignoring everything from there on\n", filepath);
+            break;
+        }
+        record.test_name[RESULTS_MAXIMUM_NAME_LENGTH - 1] = '\0';
+        status = HelperArrayListAdd(&checkpoint_resumed_records, &record, sizeof(record), NULL);
+        if (!TEST_SUCCESS(status)) {
+            break;
+        }
+    }
+    fclose(previous);
+    if (TEST_SUCCESS(status)) {
+        INFO("Resuming from %s with %llu checkpoint records\n", filepath, (uint64_t)HelperArrayListSize(&checkpoint_resumed_records));
+    }
+    return status;
+}
+
+/* Only what the interrupted run wrote counts, the records of this run are never read back */
+static const checkpoint_record *_CheckpointFind(checkpoint_record_type type, uint32_t unit, uint64_t region_size) {
+    checkpoint_test *test = &checkpoint_local_test;
+    if (!test->active) {
+        return NULL;
+    }
+    size_t record_count = HelperArrayListSize(&checkpoint_resumed_records);
+    for (size_t i = 0; i < record_count; i++) {
+        const checkpoint_record *record = (const checkpoint_record *)HelperArrayListGet(&checkpoint_resumed_records, i);
+        if (record->type == (uint32_t)type && record->unit == unit && record->region_size == region_size && record->parameter_hash == test->parameter_hash && record->occurrence == test->occurrence &&
+            memcmp(record->uuid, test->uuid, RESULTS_UUID_SIZE) == 0 && strcmp(record->test_name, test->test_name) == 0) {
+            return record;
+        }
+    }
+    return NULL;
+}
+
+static test_status _CheckpointWrite(checkpoint_record *record) {
+    test_status status = TEST_OK;
+    HelperLockMutex(checkpoint_mutex);
+    if (fwrite(record, sizeof(checkpoint_record), 1, checkpoint_file) != 1 || fflush(checkpoint_file) != 0) {
+        status = TEST_FILE_IO_ERROR;
+    }
+    HelperUnlockMutex(checkpoint_mutex);
+    return status;
+}
+
+static test_status _CheckpointWriteLocal(checkpoint_record_type type, uint32_t unit, uint64_t region_size, uint64_t iterations, uint32_t workgroups, const statistics_summary *summary) {
+    checkpoint_test *test = &checkpoint_local_test;
+    if (!test->active) {
+        return TEST_OK;
+    }
+    checkpoint_record record;
+    memset(&record, 0, sizeof(record));
+    record.magic = CHECKPOINT_RECORD_MAGIC;
+    record.format_version = CHECKPOINT_FORMAT_VERSION;
+    record.type = (uint32_t)type;
+    record.occurrence = test->occurrence;
+    record.unit = unit;
+    record.workgroups = workgroups;
+    record.region_size = region_size;
+    record.parameter_hash = test->parameter_hash;
+    record.iterations = iterations;
+    memcpy(record.uuid, test->uuid, RESULTS_UUID_SIZE);
+    memcpy(record.test_name, test->test_name, RESULTS_MAXIMUM_NAME_LENGTH);
+    if (summary != NULL) {
+        record.summary = *summary;
+    }
+    return _CheckpointWrite(&record);
+}
\ No newline at end of file
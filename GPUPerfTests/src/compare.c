@@ -0,0 +1,555 @@
+// Copyright (c) 2021 - 2022, Nemes <nemes@nemez.net>
+// SPDX-License-Identifier: MIT
+// 
+// MIT License
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software andassociated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, andto permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+// 
+// The above copyright notice andthis permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "main.h"
+#include "logger.h"
+#include "helper.h"
+#include "statistics.h"
+#include "results.h"
+#include "history.h"
+#include "compare.h"
+#include <math.h>
+
+/* Reads back the --json output, which is the only JSON this has to understand */
+typedef struct compare_json_cursor_t {
+    const char *position;
+    const char *end;
+} compare_json_cursor;
+
+static const char *compare_verdict_names[] = {"unchanged", "improvement", "regression", "inconclusive", "missing"};
+
+static test_status _CompareLoadFile(const char *filepath, const history_filter *filter, helper_arraylist *set);
+static test_status _CompareLoadHistory(const char *selector, const history_filter *filter, helper_arraylist *set);
+static test_status _CompareAddMeasurement(helper_arraylist *set, compare_measurement *measurement);
+static compare_measurement *_CompareFind(helper_arraylist *set, const compare_measurement *measurement);
+static bool _CompareMatchesFilter(const history_filter *filter, const compare_measurement *measurement);
+static bool _CompareLowerIsBetter(const char *unit);
+static double _CompareGetMedian(compare_measurement *measurement);
+static void _CompareReport(compare_measurement *baseline, compare_measurement *candidate, double baseline_median, double candidate_median, double change, double p_value, compare_verdict verdict);
+static bool _CompareJsonParseRecord(compare_json_cursor *cursor, compare_measurement *measurement);
+
+test_status CompareLoadSet(const char *specification, const history_filter *filter, helper_arraylist *set) {
+    if (specification == NULL || set == NULL) {
+        return TEST_INVALID_PARAMETER;
+    }
+    test_status status = HelperArrayListInitialize(set, sizeof(compare_measurement));
+    TEST_RETFAIL(status);
+    size_t prefix_length = strlen(COMPARE_HISTORY_PREFIX);
+    if (strncmp(specification, COMPARE_HISTORY_PREFIX, prefix_length) == 0 && (specification[prefix_length] == '\0' || specification[prefix_length] == '@')) {
+        status = _CompareLoadHistory(specification + prefix_length, filter, set);
+    } else {
+        status = _CompareLoadFile(specification, filter, set);
+    }
+    if (!TEST_SUCCESS(status)) {
+        CompareCleanUpSet(set);
+    }
+    return status;
+}
+
+void CompareCleanUpSet(helper_arraylist *set) {
+    if (set == NULL || HelperArrayListRawData(set) == NULL) {
+        return;
+    }
+    for (size_t i = 0; i < HelperArrayListSize(set); i++) {
+        StatisticsCleanUp(&(((compare_measurement *)HelperArrayListGet(set, i))->samples));
+    }
+    HelperArrayListClean(set);
+}
+
+/* A change only counts if the rank-sum test says the two sample sets differ and the medians moved by more than threshold percent */
+test_status CompareRun(const char *baseline, const char *candidate, const history_filter *filter, double threshold) {
+    helper_arraylist baseline_set;
+    helper_arraylist candidate_set;
+    test_status status = CompareLoadSet(baseline, filter, &baseline_set);
+    if (!TEST_SUCCESS(status)) {
+        FATAL("Failed to load the baseline \"%s\"\n", baseline);
+        return status;
+    }
+    status = CompareLoadSet(candidate, filter, &candidate_set);
+    if (!TEST_SUCCESS(status)) {
+        FATAL("Failed to load the candidate \"%s\"\n", candidate);
+        CompareCleanUpSet(&baseline_set);
+        return status;
+    }
+    if (MainGetTestResultFormat() == test_result_csv) {
+        LOG_PLAIN("test,device,uuid,key,unit,baseline_median,candidate_median,change_percent,p_value,verdict\n");
+    }
+    uint32_t verdict_counts[compare_verdict_missing + 1] = {0};
+    size_t baseline_count = HelperArrayListSize(&baseline_set);
+    for (size_t i = 0; i < baseline_count && TEST_SUCCESS(status); i++) {
+        compare_measurement *baseline_measurement = (compare_measurement *)HelperArrayListGet(&baseline_set, i);
+        compare_measurement *candidate_measurement = _CompareFind(&candidate_set, baseline_measurement);
+        double baseline_median = _CompareGetMedian(baseline_measurement);
+        if (candidate_measurement == NULL) {
+            _CompareReport(baseline_measurement, NULL, baseline_median, NAN, NAN, NAN, compare_verdict_missing);
+            verdict_counts[compare_verdict_missing]++;
+            continue;
+        }
+        double candidate_median = _CompareGetMedian(candidate_measurement);
+        double change = (baseline_median != 0.0) ? (candidate_median - baseline_median) / fabs(baseline_median) * 100.0 : 0.0;
+        bool worse = _CompareLowerIsBetter(baseline_measurement->unit) ? (change > 0.0) : (change < 0.0);
+        bool has_samples = StatisticsGetSampleCount(&(baseline_measurement->samples)) > 0 && StatisticsGetSampleCount(&(candidate_measurement->samples)) > 0;
+        double p_value = NAN;
+        if (has_samples) {
+            status = StatisticsMannWhitney(&(baseline_measurement->samples), &(candidate_measurement->samples), &p_value);
+            if (!TEST_SUCCESS(status)) {
+                break;
+            }
+        }
+        compare_verdict verdict = compare_verdict_unchanged;
+        if (fabs(change) >= threshold) {
+            if (!has_samples) {
+                verdict = compare_verdict_inconclusive;
+            } else if (p_value < COMPARE_SIGNIFICANCE_LEVEL) {
+                verdict = worse ? compare_verdict_regression : compare_verdict_improvement;
+            }
+        }
+        _CompareReport(baseline_measurement, candidate_measurement, baseline_median, candidate_median, change, p_value, verdict);
+        verdict_counts[verdict]++;
+    }
+    size_t candidate_count = HelperArrayListSize(&candidate_set);
+    for (size_t i = 0; i < candidate_count && TEST_SUCCESS(status); i++) {
+        compare_measurement *candidate_measurement = (compare_measurement *)HelperArrayListGet(&candidate_set, i);
+        if (_CompareFind(&baseline_set, candidate_measurement) == NULL) {
+            _CompareReport(NULL, candidate_measurement, NAN, _CompareGetMedian(candidate_measurement), NAN, NAN, compare_verdict_missing);
+            verdict_counts[compare_verdict_missing]++;
+        }
+    }
+    CompareCleanUpSet(&baseline_set);
+    CompareCleanUpSet(&candidate_set);
+    TEST_RETFAIL(status);
+
+    if (MainGetTestResultFormat() != test_result_csv) {
+        INFO("%lu unchanged, %lu improved, %lu regressed, %lu inconclusive, %lu missing from one side (threshold %.2f%%, p < %.2f)\n", verdict_counts[compare_verdict_unchanged], verdict_counts[compare_verdict_improvement], verdict_counts[compare_verdict_regression], verdict_counts[compare_verdict_inconclusive], verdict_counts[compare_verdict_missing], threshold, COMPARE_SIGNIFICANCE_LEVEL);
+    }
+    return (verdict_counts[compare_verdict_regression] > 0) ? TEST_REGRESSION_DETECTED : TEST_OK;
+}
+
+static void _CompareReport(compare_measurement *baseline, compare_measurement *candidate, double baseline_median, double candidate_median, double change, double p_value, compare_verdict verdict) {
+    compare_measurement *measurement = (baseline != NULL) ? baseline : candidate;
+    if (MainGetTestResultFormat() == test_result_csv) {
+        char uuid[RESULTS_UUID_SIZE * 2 + 1];
+        for (uint32_t i = 0; i < RESULTS_UUID_SIZE; i++) {
+            snprintf(&(uuid[i * 2]), 3, "%02x", measurement->uuid[i]);
+        }
+        LOG_PLAIN("%s,\"%s\",%s,%s,%s,%.10g,%.10g,%.4f,%.6g,%s\n", measurement->test_name, measurement->device_name, uuid, measurement->key, measurement->unit, baseline_median, candidate_median, change, p_value, compare_verdict_names[verdict]);
+    } else if (verdict == compare_verdict_missing) {
+        INFO("%s %s on %s: only in the %s\n", measurement->test_name, measurement->key, measurement->device_name, (baseline != NULL) ? "baseline" : "candidate");
+    } else if (verdict == compare_verdict_regression) {
+        WARNING("%s %s on %s: %.4g -> %.4g %s (%+.2f%%, p = %.4f) REGRESSION\n", measurement->test_name, measurement->key, measurement->device_name, baseline_median, candidate_median, measurement->unit, change, p_value);
+    } else {
+        INFO("%s %s on %s: %.4g -> %.4g %s (%+.2f%%, p = %.4f) %s\n", measurement->test_name, measurement->key, measurement->device_name, baseline_median, candidate_median, measurement->unit, change, p_value, compare_verdict_names[verdict]);
+    }
+}
+
+/* Outlier rejection applies the same way it did to the reported result */
+static double _CompareGetMedian(compare_measurement *measurement) {
+    if (StatisticsGetSampleCount(&(measurement->samples)) == 0) {
+        return measurement->median;
+    }
+    statistics_summary summary;
+    if (!TEST_SUCCESS(StatisticsSummarize(&(measurement->samples), &summary))) {
+        return measurement->median;
+    }
+    return summary.median;
+}
+
+static bool _CompareLowerIsBetter(const char *unit) {
+    return strcmp(unit, "ns") == 0 || strcmp(unit, "us") == 0 || strcmp(unit, "ms") == 0 || strcmp(unit, "s") == 0;
+}
+
+static compare_measurement *_CompareFind(helper_arraylist *set, const compare_measurement *measurement) {
+    for (size_t i = 0; i < HelperArrayListSize(set); i++) {
+        compare_measurement *other = (compare_measurement *)HelperArrayListGet(set, i);
+        if (strcmp(other->test_name, measurement->test_name) == 0 && strcmp(other->key, measurement->key) == 0 && memcmp(other->uuid, measurement->uuid, RESULTS_UUID_SIZE) == 0) {
+            return other;
+        }
+    }
+    return NULL;
+}
+
+/* Takes ownership of the samples, pooling them into an existing entry for the same test, key and device */
+static test_status _CompareAddMeasurement(helper_arraylist *set, compare_measurement *measurement) {
+    compare_measurement *existing = _CompareFind(set, measurement);
+    if (existing == NULL) {
+        test_status status = HelperArrayListAdd(set, measurement, sizeof(compare_measurement), NULL);
+        if (!TEST_SUCCESS(status)) {
+            StatisticsCleanUp(&(measurement->samples));
+        }
+        return status;
+    }
+    test_status status = TEST_OK;
+    const double *values = (const double *)HelperArrayListRawData(&(measurement->samples.samples));
+    for (size_t i = 0; i < StatisticsGetSampleCount(&(measurement->samples)) && TEST_SUCCESS(status); i++) {
+        status = StatisticsAddSample(&(existing->samples), values[i]);
+    }
+    existing->median = measurement->median;
+    StatisticsCleanUp(&(measurement->samples));
+    return status;
+}
+
+static bool _CompareMatchesFilter(const history_filter *filter, const compare_measurement *measurement) {
+    if (filter == NULL) {
+        return true;
+    }
+    if (filter->uuid != NULL && memcmp(filter->uuid, measurement->uuid, RESULTS_UUID_SIZE) != 0) {
+        return false;
+    }
+    if (filter->device_name != NULL && strcmp(filter->device_name, measurement->device_name) != 0) {
+        return false;
+    }
+    return filter->test_patterns == NULL || HelperMatchPatternList(filter->test_patterns, measurement->test_name);
+}
+
+static bool _CompareMatchesDriver(const history_record_header *header, const char *driver) {
+    char *number_end = NULL;
+    unsigned long driver_version = strtoul(driver, &number_end, 0);
+    if (number_end != driver && *number_end == '\0') {
+        return header->driver_version == (uint32_t)driver_version;
+    }
+    return strstr(header->driver_info, driver) != NULL;
+}
+
+static test_status _CompareLoadHistory(const char *selector, const history_filter *filter, helper_arraylist *set) {
+    /* How many newer runs of the same test on the same device an entry may have, -1 selects by driver instead */
+    int32_t rank = 0;
+    const char *driver = NULL;
+    if (selector[0] == '\0' || strcmp(selector, "@latest") == 0) {
+        rank = 0;
+    } else if (strcmp(selector, "@previous") == 0) {
+        rank = 1;
+    } else if (strncmp(selector, "@driver=", 8) == 0 && selector[8] != '\0') {
+        rank = -1;
+        driver = selector + 8;
+    } else {
+        FATAL("Unknown history selection \"%s\", expected @latest, @previous or @driver=<version>\n", selector);
+        return TEST_INVALID_PARAMETER;
+    }
+    helper_arraylist entries;
+    test_status status = HistoryQuery(filter, &entries);
+    TEST_RETFAIL(status);
+    size_t entry_count = HelperArrayListSize(&entries);
+    for (size_t i = 0; i < entry_count && TEST_SUCCESS(status); i++) {
+        history_entry *entry = (history_entry *)HelperArrayListGet(&entries, i);
+        if (rank >= 0) {
+            int32_t newer_runs = 0;
+            for (size_t j = i + 1; j < entry_count; j++) {
+                history_entry *other = (history_entry *)HelperArrayListGet(&entries, j);
+                if (strcmp(other->header.test_name, entry->header.test_name) == 0 && memcmp(other->header.uuid, entry->header.uuid, RESULTS_UUID_SIZE) == 0) {
+                    newer_runs++;
+                }
+            }
+            if (newer_runs != rank) {
+                continue;
+            }
+        } else if (!_CompareMatchesDriver(&(entry->header), driver)) {
+            continue;
+        }
+        size_t measurement_count = HelperArrayListSize(&(entry->measurements));
+        size_t sample_count = HelperArrayListSize(&(entry->samples));
+        for (size_t j = 0; j < measurement_count && TEST_SUCCESS(status); j++) {
+            history_measurement *source = (history_measurement *)HelperArrayListGet(&(entry->measurements), j);
+            compare_measurement measurement;
+            memset(&measurement, 0, sizeof(measurement));
+            memcpy(measurement.test_name, entry->header.test_name, RESULTS_MAXIMUM_NAME_LENGTH);
+            memcpy(measurement.key, source->key, RESULTS_MAXIMUM_NAME_LENGTH);
+            memcpy(measurement.unit, source->unit, RESULTS_MAXIMUM_UNIT_LENGTH);
+            memcpy(measurement.device_name, entry->header.device_name, HISTORY_MAXIMUM_DEVICE_NAME_LENGTH);
+            memcpy(measurement.uuid, entry->header.uuid, RESULTS_UUID_SIZE);
+            measurement.median = source->median;
+            status = StatisticsInitialize(&(measurement.samples));
+            if (!TEST_SUCCESS(status)) {
+                break;
+            }
+            for (size_t k = 0; k < sample_count && TEST_SUCCESS(status); k++) {
+                history_sample *sample = (history_sample *)HelperArrayListGet(&(entry->samples), k);
+                if (sample->id == source->id) {
+                    status = StatisticsAddSample(&(measurement.samples), sample->value);
+                }
+            }
+            if (!TEST_SUCCESS(status)) {
+                StatisticsCleanUp(&(measurement.samples));
+                break;
+            }
+            status = _CompareAddMeasurement(set, &measurement);
+        }
+    }
+    HistoryCleanUpEntries(&entries);
+    return status;
+}
+
+/* Lines that aren't JSON objects, like log output redirected along with the results, are skipped */
+static test_status _CompareLoadFile(const char *filepath, const history_filter *filter, helper_arraylist *set) {
+    const char *data = NULL;
+    size_t size = 0;
+    test_status status = HelperLoadFile(filepath, &data, &size);
+    TEST_RETFAIL(status);
+    const char *end = data + size;
+    for (const char *line = data; line < end && TEST_SUCCESS(status);) {
+        const char *line_end = memchr(line, '\n', (size_t)(end - line));
+        if (line_end == NULL) {
+            line_end = end;
+        }
+        compare_json_cursor cursor = {line, line_end};
+        while (cursor.position < cursor.end && (*cursor.position == ' ' || *cursor.position == '\t')) {
+            cursor.position++;
+        }
+        if (cursor.position < cursor.end && *cursor.position == '{') {
+            compare_measurement measurement;
+            memset(&measurement, 0, sizeof(measurement));
+            status = StatisticsInitialize(&(measurement.samples));
+            if (!TEST_SUCCESS(status)) {
+                break;
+            }
+            if (_CompareJsonParseRecord(&cursor, &measurement) && _CompareMatchesFilter(filter, &measurement)) {
+                status = _CompareAddMeasurement(set, &measurement);
+            } else {
+                StatisticsCleanUp(&(measurement.samples));
+            }
+        }
+        line = line_end + 1;
+    }
+    free((void *)data);
+    return status;
+}
+
+static void _CompareJsonSkipWhitespace(compare_json_cursor *cursor) {
+    while (cursor->position < cursor->end && (*cursor->position == ' ' || *cursor->position == '\t' || *cursor->position == '\r' || *cursor->position == '\n')) {
+        cursor->position++;
+    }
+}
+
+static bool _CompareJsonExpect(compare_json_cursor *cursor, char character) {
+    _CompareJsonSkipWhitespace(cursor);
+    if (cursor->position < cursor->end && *cursor->position == character) {
+        cursor->position++;
+        return true;
+    }
+    return false;
+}
+
+/* Truncates to buffer_size, a NULL buffer just skips the string. Escapes outside ASCII become '?' */
+static bool _CompareJsonParseString(compare_json_cursor *cursor, char *buffer, size_t buffer_size) {
+    if (!_CompareJsonExpect(cursor, '"')) {
+        return false;
+    }
+    size_t length = 0;
+    while (cursor->position < cursor->end) {
+        char character = *(cursor->position++);
+        if (character == '"') {
+            if (buffer != NULL) {
+                buffer[min(length, buffer_size - 1)] = '\0';
+            }
+            return true;
+        }
+        if (character == '\\') {
+            if (cursor->position >= cursor->end) {
+                return false;
+            }
+            character = *(cursor->position++);
+            if (character == 'u') {
+                char hex[5] = {0};
+                if (cursor->end - cursor->position < 4) {
+                    return false;
+                }
+                memcpy(hex, cursor->position, 4);
+                cursor->position += 4;
+                unsigned long code_point = strtoul(hex, NULL, 16);
+                character = (code_point < 0x80) ? (char)code_point : '?';
+            } else if (character == 'n') {
+                character = '\n';
+            } else if (character == 't') {
+                character = '\t';
+            } else if (character == 'r') {
+                character = '\r';
+            } else if (character == 'b') {
+                character = '\b';
+            } else if (character == 'f') {
+                character = '\f';
+            }
+        }
+        if (buffer != NULL && length + 1 < buffer_size) {
+            buffer[length] = character;
+        }
+        length++;
+    }
+    return false;
+}
+
+/* null, which the writer uses for NaN and infinity, reads back as NaN */
+static bool _CompareJsonParseNumber(compare_json_cursor *cursor, double *value) {
+    _CompareJsonSkipWhitespace(cursor);
+    if (cursor->end - cursor->position >= 4 && strncmp(cursor->position, "null", 4) == 0) {
+        cursor->position += 4;
+        *value = NAN;
+        return true;
+    }
+    char *number_end = NULL;
+    *value = strtod(cursor->position, &number_end);
+    if (number_end == cursor->position || number_end > cursor->end) {
+        return false;
+    }
+    cursor->position = number_end;
+    return true;
+}
+
+static bool _CompareJsonSkipValue(compare_json_cursor *cursor) {
+    _CompareJsonSkipWhitespace(cursor);
+    if (cursor->position >= cursor->end) {
+        return false;
+    }
+    char opening = *cursor->position;
+    if (opening == '"') {
+        return _CompareJsonParseString(cursor, NULL, 0);
+    }
+    if (opening == '{' || opening == '[') {
+        char closing = (opening == '{') ? '}' : ']';
+        cursor->position++;
+        if (_CompareJsonExpect(cursor, closing)) {
+            return true;
+        }
+        do {
+            if (opening == '{' && (!_CompareJsonParseString(cursor, NULL, 0) || !_CompareJsonExpect(cursor, ':'))) {
+                return false;
+            }
+            if (!_CompareJsonSkipValue(cursor)) {
+                return false;
+            }
+        } while (_CompareJsonExpect(cursor, ','));
+        return _CompareJsonExpect(cursor, closing);
+    }
+    if (cursor->end - cursor->position >= 4 && strncmp(cursor->position, "true", 4) == 0) {
+        cursor->position += 4;
+        return true;
+    }
+    if (cursor->end - cursor->position >= 5 && strncmp(cursor->position, "false", 5) == 0) {
+        cursor->position += 5;
+        return true;
+    }
+    double ignored;
+    return _CompareJsonParseNumber(cursor, &ignored);
+}
+
+static bool _CompareJsonParseUUID(compare_json_cursor *cursor, uint8_t *uuid) {
+    char text[RESULTS_UUID_SIZE * 2 + 8];
+    if (!_CompareJsonParseString(cursor, text, sizeof(text))) {
+        return false;
+    }
+    uint32_t digits = 0;
+    memset(uuid, 0, RESULTS_UUID_SIZE);
+    for (const char *character = text; *character != '\0' && digits < RESULTS_UUID_SIZE * 2; character++) {
+        char hex[2] = {*character, '\0'};
+        if (*character == '-') {
+            continue;
+        }
+        uuid[digits / 2] |= (uint8_t)(strtoul(hex, NULL, 16) << ((digits % 2 == 0) ? 4 : 0));
+        digits++;
+    }
+    return true;
+}
+
+static bool _CompareJsonParseDevice(compare_json_cursor *cursor, compare_measurement *measurement) {
+    if (!_CompareJsonExpect(cursor, '{')) {
+        return false;
+    }
+    if (_CompareJsonExpect(cursor, '}')) {
+        return true;
+    }
+    do {
+        char name[RESULTS_MAXIMUM_NAME_LENGTH];
+        bool parsed;
+        if (!_CompareJsonParseString(cursor, name, sizeof(name)) || !_CompareJsonExpect(cursor, ':')) {
+            return false;
+        }
+        if (strcmp(name, "uuid") == 0) {
+            parsed = _CompareJsonParseUUID(cursor, measurement->uuid);
+        } else if (strcmp(name, "name") == 0) {
+            parsed = _CompareJsonParseString(cursor, measurement->device_name, sizeof(measurement->device_name));
+        } else {
+            parsed = _CompareJsonSkipValue(cursor);
+        }
+        if (!parsed) {
+            return false;
+        }
+    } while (_CompareJsonExpect(cursor, ','));
+    return _CompareJsonExpect(cursor, '}');
+}
+
+static bool _CompareJsonParseSamples(compare_json_cursor *cursor, statistics_samples *samples) {
+    if (!_CompareJsonExpect(cursor, '[')) {
+        return false;
+    }
+    if (_CompareJsonExpect(cursor, ']')) {
+        return true;
+    }
+    do {
+        double value;
+        if (!_CompareJsonParseNumber(cursor, &value)) {
+            return false;
+        }
+        if (!isnan(value) && !TEST_SUCCESS(StatisticsAddSample(samples, value))) {
+            return false;
+        }
+    } while (_CompareJsonExpect(cursor, ','));
+    return _CompareJsonExpect(cursor, ']');
+}
+
+/* Records written while the test was still running have final set to false, the final ones repeat their samples */
+static bool _CompareJsonParseRecord(compare_json_cursor *cursor, compare_measurement *measurement) {
+    bool has_test = false;
+    bool has_key = false;
+    bool final = true;
+    if (!_CompareJsonExpect(cursor, '{') || _CompareJsonExpect(cursor, '}')) {
+        return false;
+    }
+    do {
+        char name[RESULTS_MAXIMUM_NAME_LENGTH];
+        bool parsed;
+        if (!_CompareJsonParseString(cursor, name, sizeof(name)) || !_CompareJsonExpect(cursor, ':')) {
+            return false;
+        }
+        if (strcmp(name, "test") == 0) {
+            parsed = has_test = _CompareJsonParseString(cursor, measurement->test_name, sizeof(measurement->test_name));
+        } else if (strcmp(name, "key") == 0) {
+            parsed = has_key = _CompareJsonParseString(cursor, measurement->key, sizeof(measurement->key));
+        } else if (strcmp(name, "unit") == 0) {
+            parsed = _CompareJsonParseString(cursor, measurement->unit, sizeof(measurement->unit));
+        } else if (strcmp(name, "value") == 0) {
+            parsed = _CompareJsonParseNumber(cursor, &(measurement->median));
+        } else if (strcmp(name, "device") == 0) {
+            parsed = _CompareJsonParseDevice(cursor, measurement);
+        } else if (strcmp(name, "samples") == 0) {
+            parsed = _CompareJsonParseSamples(cursor, &(measurement->samples));
+        } else if (strcmp(name, "final") == 0) {
+            _CompareJsonSkipWhitespace(cursor);
+            final = !(cursor->end - cursor->position >= 5 && strncmp(cursor->position, "false", 5) == 0);
+            parsed = _CompareJsonSkipValue(cursor);
+        } else {
+            parsed = _CompareJsonSkipValue(cursor);
+        }
+        if (!parsed) {
+            return false;
+        }
+    } while (_CompareJsonExpect(cursor, ','));
+    return _CompareJsonExpect(cursor, '}') && has_test && has_key && final;
+}
\ No newline at end of file
@@ -0,0 +1,144 @@
+// Copyright (c) 2021 - 2022, Nemes <nemes@nemez.net>
+// SPDX-License-Identifier: MIT
+// 
+// MIT License
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software andassociated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, andto permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+// 
+// The above copyright notice andthis permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "main.h"
+#include "logger.h"
+#include "helper.h"
+#include "statistics.h"
+#include "convergence.h"
+#include "planner.h"
+#include <math.h>
+
+test_status ConvergenceInitialize(uint64_t target_time_us, uint64_t maximum_iterations, convergence_controller *controller) {
+    if (controller == NULL || maximum_iterations == 0) {
+        return TEST_INVALID_PARAMETER;
+    }
+    memset(controller, 0, sizeof(convergence_controller));
+    test_status status = StatisticsInitialize(&(controller->samples));
+    TEST_RETFAIL(status);
+    status = StatisticsInitialize(&(controller->timings));
+    if (!TEST_SUCCESS(status)) {
+        StatisticsCleanUp(&(controller->samples));
+        return status;
+    }
+    controller->state = convergence_state_finished;
+    controller->target_time_us = target_time_us;
+    controller->maximum_iterations = maximum_iterations;
+    controller->budget_us = MainGetConvergenceBudget() * 1000;
+    controller->minimum_samples = MainGetTrialCount();
+    controller->maximum_samples = max(controller->minimum_samples, STATISTICS_MAXIMUM_TRIAL_COUNT);
+    controller->tolerance = MainGetConvergenceTolerance() / 100.0;
+    return TEST_OK;
+}
+
+test_status ConvergenceCleanUp(convergence_controller *controller) {
+    if (controller == NULL) {
+        return TEST_INVALID_PARAMETER;
+    }
+    StatisticsCleanUp(&(controller->timings));
+    return StatisticsCleanUp(&(controller->samples));
+}
+
+void ConvergenceStart(convergence_controller *controller, uint64_t starting_iterations) {
+    StatisticsReset(&(controller->samples));
+    StatisticsReset(&(controller->timings));
+    controller->state = convergence_state_calibrating;
+    controller->iterations = max(1, min(starting_iterations, controller->maximum_iterations));
+    controller->relative_error = 0.0;
+    controller->converged = false;
+    /* A --time-budget schedule decides each measurement's budget when it starts */
+    controller->budget_us = PlannerGetStepBudget(MainGetConvergenceBudget() * 1000);
+    HelperTimerReset(&(controller->budget_timer));
+}
+
+void ConvergenceStartSampling(convergence_controller *controller, uint64_t iterations) {
+    ConvergenceStart(controller, iterations);
+    controller->state = convergence_state_sampling;
+}
+
+test_status ConvergenceAddRun(convergence_controller *controller, uint64_t time_us, double value) {
+    test_status status = TEST_OK;
+    switch (controller->state) {
+    case convergence_state_calibrating:
+        if (time_us < controller->target_time_us && controller->iterations < controller->maximum_iterations) {
+            /* Jump most of the way to the target instead of doubling, short runs are too noisy to trust fully */
+            uint64_t growth = CONVERGENCE_MAXIMUM_GROWTH;
+            if (time_us > 0) {
+                growth = (uint64_t)ceil(((double)controller->target_time_us * CONVERGENCE_CALIBRATION_MARGIN) / (double)time_us);
+                growth = max(2, min(growth, CONVERGENCE_MAXIMUM_GROWTH));
+            }
+            if (controller->iterations > controller->maximum_iterations / growth) {
+                controller->iterations = controller->maximum_iterations;
+            } else {
+                controller->iterations *= growth;
+            }
+            return TEST_OK;
+        }
+        /* This run is already at the calibrated length, so it counts as the first sample */
+        controller->state = convergence_state_sampling;
+        // fallthrough
+    case convergence_state_sampling:
+        status = StatisticsAddSample(&(controller->samples), value);
+        TEST_RETFAIL(status);
+        status = StatisticsAddSample(&(controller->timings), (double)time_us);
+        TEST_RETFAIL(status);
+        size_t sample_count = StatisticsGetSampleCount(&(controller->samples));
+        if (sample_count < controller->minimum_samples) {
+            return TEST_OK;
+        }
+        statistics_summary summary;
+        status = StatisticsSummarize(&(controller->samples), &summary);
+        TEST_RETFAIL(status);
+        double center = fabs(summary.mean);
+        controller->relative_error = (center > 0.0) ? ((summary.confidence_high - summary.confidence_low) / 2.0) / center : 0.0;
+        if (controller->relative_error <= controller->tolerance) {
+            controller->converged = true;
+            controller->state = convergence_state_finished;
+        } else if (sample_count >= controller->maximum_samples || HelperTimerGet(&(controller->budget_timer)) >= controller->budget_us) {
+            controller->state = convergence_state_finished;
+        }
+        if (controller->state == convergence_state_finished) {
+            PlannerEndStep(HelperTimerGet(&(controller->budget_timer)));
+        }
+        break;
+    default:
+        break;
+    }
+    return status;
+}
+
+test_status ConvergenceSummarize(convergence_controller *controller, statistics_summary *summary) {
+    if (controller == NULL) {
+        return TEST_INVALID_PARAMETER;
+    }
+    return StatisticsSummarize(&(controller->samples), summary);
+}
+
+uint64_t ConvergenceGetIterations(convergence_controller *controller) {
+    return controller->iterations;
+}
+
+convergence_state ConvergenceGetState(convergence_controller *controller) {
+    return controller->state;
+}
\ No newline at end of file
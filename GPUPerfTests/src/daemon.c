@@ -0,0 +1,440 @@
+// Copyright (c) 2021 - 2022, Nemes <nemes@nemez.net>
+// SPDX-License-Identifier: MIT
+// 
+// MIT License
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software andassociated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, andto permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+// 
+// The above copyright notice andthis permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "main.h"
+#include "logger.h"
+#include "helper.h"
+#include "runner.h"
+#include "manifest.h"
+#include "vulkan_helper.h"
+#include "planner.h"
+#include "vulkan_runner.h"
+#include "daemon.h"
+#include "sanitize_windows_h.h"
+#ifdef _WIN32
+#include <winsock2.h>
+#include <afunix.h>
+#pragma comment(lib, "Ws2_32.lib")
+typedef SOCKET daemon_socket;
+#define DAEMON_INVALID_SOCKET   INVALID_SOCKET
+#else
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <signal.h>
+#include <unistd.h>
+#include <errno.h>
+typedef int daemon_socket;
+#define DAEMON_INVALID_SOCKET   (-1)
+#endif
+
+static test_status _DaemonStartUp();
+static void _DaemonShutDown();
+static test_status _DaemonCreateSocket(const char *socket_path, struct sockaddr_un *address, daemon_socket *created_socket);
+static void _DaemonCloseSocket(daemon_socket closed_socket);
+static test_status _DaemonBindSocket(daemon_socket listener, struct sockaddr_un *address);
+static void _DaemonSetClientTimeouts(daemon_socket client);
+static test_status _DaemonRemoveStaleSocket(const char *socket_path, struct sockaddr_un *address);
+static bool _DaemonReadExact(daemon_socket source, void *buffer, size_t size);
+static bool _DaemonWriteExact(daemon_socket destination, const void *buffer, size_t size);
+static test_status _DaemonServeClient(daemon_socket client, bool *shutdown);
+static test_status _DaemonParseRequest(char *payload, size_t size, manifest_entry *request, bool *shutdown);
+static bool _DaemonAppendSetting(char *payload, size_t *size, size_t capacity, const char *key, const char *value);
+
+/*
+ * Serves one client at a time so measurements never overlap. The batch stays open between requests, so the
+ * instance, the logical devices and their pipeline caches are only created by the first request that needs them.
+ * The pipelines of every test are compiled before the first request, with the default parameters.
+ * A request is the same set of settings a manifest entry takes and is undone once it finished.
+ */
+test_status DaemonRun(const char *socket_path) {
+    if (socket_path == NULL) {
+        return TEST_INVALID_PARAMETER;
+    }
+    test_status status = _DaemonStartUp();
+    TEST_RETFAIL(status);
+    struct sockaddr_un address;
+    daemon_socket listener = DAEMON_INVALID_SOCKET;
+    status = _DaemonCreateSocket(socket_path, &address, &listener);
+    if (!TEST_SUCCESS(status)) {
+        goto cleanup_startup;
+    }
+    status = _DaemonRemoveStaleSocket(socket_path, &address);
+    if (!TEST_SUCCESS(status)) {
+        goto cleanup_socket;
+    }
+    status = _DaemonBindSocket(listener, &address);
+    if (!TEST_SUCCESS(status)) {
+        goto cleanup_socket;
+    }
+    if (listen(listener, DAEMON_LISTEN_BACKLOG) != 0) {
+        status = TEST_DAEMON_CONNECTION_ERROR;
+        goto cleanup_file;
+    }
+    status = VulkanRunnerBeginBatch();
+    if (!TEST_SUCCESS(status)) {
+        goto cleanup_file;
+    }
+    /* Before the first request arrives, so a probe's first measurement doesn't wait for the shader compiler */
+    test_status prepare_status = RunnerPrepareTests("*", -1);
+    if (!TEST_SUCCESS(prepare_status)) {
+        WARNING("Failed to build pipelines ahead of time: 0x%08lx %s\n", prepare_status, LoggerLookUpError(prepare_status));
+    }
+    INFO("Daemon listening on %s\n", socket_path);
+    bool shutdown = false;
+    while (!shutdown) {
+        daemon_socket client = accept(listener, NULL, NULL);
+        if (client == DAEMON_INVALID_SOCKET) {
+            status = TEST_DAEMON_CONNECTION_ERROR;
+            break;
+        }
+        _DaemonSetClientTimeouts(client);
+        test_status request_status = _DaemonServeClient(client, &shutdown);
+        if (!TEST_SUCCESS(request_status)) {
+            WARNING("Request failed: 0x%08lx %s\n", request_status, LoggerLookUpError(request_status));
+        }
+        _DaemonCloseSocket(client);
+    }
+    INFO("Daemon shutting down\n");
+    test_status end_status = VulkanRunnerEndBatch();
+    if (TEST_SUCCESS(status)) {
+        status = end_status;
+    }
+cleanup_file:
+    remove(socket_path);
+cleanup_socket:
+    _DaemonCloseSocket(listener);
+cleanup_startup:
+    _DaemonShutDown();
+    return status;
+}
+
+/* Logs the results the daemon streams back like a local run would and returns the status of the whole request */
+test_status DaemonRequest(const char *socket_path, manifest_entry *request, bool shutdown) {
+    if (socket_path == NULL || request == NULL) {
+        return TEST_INVALID_PARAMETER;
+    }
+    char record[LOGGER_CHANNEL_MAXIMUM_RECORD_SIZE];
+    char *payload = record + sizeof(logger_channel_header);
+    size_t capacity = sizeof(record) - sizeof(logger_channel_header);
+    size_t size = 0;
+    char device[16];
+    snprintf(device, sizeof(device), "%ld", (long)request->device_id);
+    bool fits = _DaemonAppendSetting(payload, &size, capacity, DAEMON_DEVICE_KEY, device);
+    if (request->tests[0] != '\0') {
+        fits = fits && _DaemonAppendSetting(payload, &size, capacity, DAEMON_TESTS_KEY, request->tests);
+    }
+    if (shutdown) {
+        fits = fits && _DaemonAppendSetting(payload, &size, capacity, DAEMON_SHUTDOWN_KEY, "true");
+    }
+    size_t setting_count = HelperArrayListSize(&(request->settings));
+    for (size_t i = 0; i < setting_count && fits; i++) {
+        manifest_setting *setting = (manifest_setting *)HelperArrayListGet(&(request->settings), i);
+        fits = _DaemonAppendSetting(payload, &size, capacity, setting->key, setting->value);
+    }
+    if (!fits) {
+        return TEST_OUT_OF_RANGE;
+    }
+    logger_channel_header *header = (logger_channel_header *)record;
+    header->type = LOGGER_CHANNEL_RECORD_REQUEST;
+    header->size = (uint32_t)size;
+
+    test_status status = _DaemonStartUp();
+    TEST_RETFAIL(status);
+    struct sockaddr_un address;
+    daemon_socket server = DAEMON_INVALID_SOCKET;
+    status = _DaemonCreateSocket(socket_path, &address, &server);
+    if (!TEST_SUCCESS(status)) {
+        goto cleanup_startup;
+    }
+    if (connect(server, (struct sockaddr *)&address, sizeof(address)) != 0) {
+        FATAL("No daemon listening on %s\n", socket_path);
+        status = TEST_DAEMON_CONNECTION_ERROR;
+        goto cleanup_socket;
+    }
+    if (!_DaemonWriteExact(server, record, sizeof(logger_channel_header) + size)) {
+        status = TEST_DAEMON_CONNECTION_ERROR;
+        goto cleanup_socket;
+    }
+    /* Reuses the request buffer, it was sent as a whole */
+    status = TEST_DAEMON_PROTOCOL_ERROR;
+    logger_channel_header response;
+    while (_DaemonReadExact(server, &response, sizeof(response))) {
+        if (response.size > capacity || !_DaemonReadExact(server, payload, response.size)) {
+            break;
+        }
+        if (response.type == LOGGER_CHANNEL_RECORD_RESULT && response.size >= sizeof(logger_channel_result)) {
+            logger_channel_result *result = (logger_channel_result *)payload;
+            if (result->key_length <= response.size - sizeof(logger_channel_result)) {
+                LOG("RESLT", "%lu: %.*s = %llu\n", result->id, (int)result->key_length, payload + sizeof(logger_channel_result), result->value);
+            }
+        } else if (response.type == LOGGER_CHANNEL_RECORD_PROGRESS && response.size >= sizeof(logger_channel_progress)) {
+            logger_channel_progress *progress = (logger_channel_progress *)payload;
+            DEBUG("Progress %lu of %lu\n", progress->completed, progress->total);
+        } else if (response.type == LOGGER_CHANNEL_RECORD_ERROR && response.size >= sizeof(logger_channel_error)) {
+            logger_channel_error *error = (logger_channel_error *)payload;
+            WARNING("Daemon reported 0x%08lx %s\n", error->code, LoggerLookUpError(error->code));
+        } else if (response.type == LOGGER_CHANNEL_RECORD_FINISHED && response.size >= sizeof(logger_channel_error)) {
+            status = ((logger_channel_error *)payload)->code;
+            break;
+        }
+    }
+cleanup_socket:
+    _DaemonCloseSocket(server);
+cleanup_startup:
+    _DaemonShutDown();
+    return status;
+}
+
+static test_status _DaemonStartUp() {
+#ifdef _WIN32
+    WSADATA wsa_data;
+    if (WSAStartup(MAKEWORD(2, 2), &wsa_data) != 0) {
+        return TEST_DAEMON_CONNECTION_ERROR;
+    }
+#else
+    /* A client that goes away mid request has to fail the write, not end the daemon */
+    signal(SIGPIPE, SIG_IGN);
+#endif
+    return TEST_OK;
+}
+
+static void _DaemonShutDown() {
+#ifdef _WIN32
+    WSACleanup();
+#endif
+}
+
+static test_status _DaemonCreateSocket(const char *socket_path, struct sockaddr_un *address, daemon_socket *created_socket) {
+    memset(address, 0, sizeof(struct sockaddr_un));
+    if (strlen(socket_path) >= sizeof(address->sun_path)) {
+        FATAL("Socket path %s is too long\n", socket_path);
+        return TEST_INVALID_PARAMETER;
+    }
+    address->sun_family = AF_UNIX;
+    strcpy(address->sun_path, socket_path);
+    *created_socket = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (*created_socket == DAEMON_INVALID_SOCKET) {
+        return TEST_DAEMON_CONNECTION_ERROR;
+    }
+    return TEST_OK;
+}
+
+static void _DaemonCloseSocket(daemon_socket closed_socket) {
+    if (closed_socket == DAEMON_INVALID_SOCKET) {
+        return;
+    }
+#ifdef _WIN32
+    closesocket(closed_socket);
+#else
+    close(closed_socket);
+#endif
+}
+
+/* Only the user running the daemon may connect, anyone else could queue GPU runs. Windows sockets get the directory's ACL */
+static test_status _DaemonBindSocket(daemon_socket listener, struct sockaddr_un *address) {
+#ifndef _WIN32
+    mode_t previous_mask = umask(0077);
+#endif
+    bool bound = bind(listener, (struct sockaddr *)address, sizeof(struct sockaddr_un)) == 0;
+#ifndef _WIN32
+    umask(previous_mask);
+#endif
+    return bound ? TEST_OK : TEST_DAEMON_CONNECTION_ERROR;
+}
+
+/* The daemon serves one client at a time, so one that connects and goes quiet must not hold up everyone after it */
+static void _DaemonSetClientTimeouts(daemon_socket client) {
+#ifdef _WIN32
+    DWORD timeout = DAEMON_CLIENT_TIMEOUT_MS;
+#else
+    struct timeval timeout;
+    timeout.tv_sec = DAEMON_CLIENT_TIMEOUT_MS / 1000;
+    timeout.tv_usec = (DAEMON_CLIENT_TIMEOUT_MS % 1000) * 1000;
+#endif
+    if (setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, (const char *)&timeout, sizeof(timeout)) != 0 ||
+        setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, (const char *)&timeout, sizeof(timeout)) != 0) {
+        WARNING("Failed to set the timeouts of a client connection\n");
+    }
+}
+
+/*
+ * A daemon that was killed leaves its socket file behind, which would make bind fail. Only a socket nobody
+ * accepts connections on is removed, any other file and the socket of a running daemon are left alone.
+ */
+static test_status _DaemonRemoveStaleSocket(const char *socket_path, struct sockaddr_un *address) {
+#ifdef _WIN32
+    DWORD attributes = GetFileAttributesA(socket_path);
+    if (attributes == INVALID_FILE_ATTRIBUTES) {
+        return TEST_OK;
+    }
+    /* Windows represents Unix sockets as reparse points */
+    bool is_socket = (attributes & FILE_ATTRIBUTE_REPARSE_POINT) != 0;
+#else
+    struct stat file_stat;
+    if (lstat(socket_path, &file_stat) != 0) {
+        return (errno == ENOENT) ? TEST_OK : TEST_DAEMON_CONNECTION_ERROR;
+    }
+    bool is_socket = S_ISSOCK(file_stat.st_mode);
+#endif
+    if (!is_socket) {
+        FATAL("%s exists and isn't a socket\n", socket_path);
+        return TEST_DAEMON_CONNECTION_ERROR;
+    }
+    daemon_socket probe = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (probe == DAEMON_INVALID_SOCKET) {
+        return TEST_DAEMON_CONNECTION_ERROR;
+    }
+    bool connected = connect(probe, (struct sockaddr *)address, sizeof(struct sockaddr_un)) == 0;
+#ifdef _WIN32
+    bool refused = !connected && WSAGetLastError() == WSAECONNREFUSED;
+#else
+    bool refused = !connected && errno == ECONNREFUSED;
+#endif
+    _DaemonCloseSocket(probe);
+    if (!refused) {
+        FATAL("%s is in use, another daemon may already be running\n", socket_path);
+        return TEST_DAEMON_CONNECTION_ERROR;
+    }
+    if (remove(socket_path) != 0) {
+        return TEST_DAEMON_CONNECTION_ERROR;
+    }
+    return TEST_OK;
+}
+
+static bool _DaemonReadExact(daemon_socket source, void *buffer, size_t size) {
+    size_t total_read = 0;
+    while (total_read < size) {
+        int read_data = (int)recv(source, (char *)buffer + total_read, (int)(size - total_read), 0);
+        if (read_data <= 0) {
+            return false;
+        }
+        total_read += (size_t)read_data;
+    }
+    return true;
+}
+
+static bool _DaemonWriteExact(daemon_socket destination, const void *buffer, size_t size) {
+    size_t total_written = 0;
+    while (total_written < size) {
+        int written_data = (int)send(destination, (const char *)buffer + total_written, (int)(size - total_written), 0);
+        if (written_data <= 0) {
+            return false;
+        }
+        total_written += (size_t)written_data;
+    }
+    return true;
+}
+
+/* The channel points at the client while its request runs, so everything the tests report goes straight back */
+static test_status _DaemonServeClient(daemon_socket client, bool *shutdown) {
+    char payload[LOGGER_CHANNEL_MAXIMUM_RECORD_SIZE];
+    logger_channel_header header;
+    if (!_DaemonReadExact(client, &header, sizeof(header))) {
+        return TEST_DAEMON_CONNECTION_ERROR;
+    }
+    if (header.type != LOGGER_CHANNEL_RECORD_REQUEST || header.size >= sizeof(payload)) {
+        return TEST_DAEMON_PROTOCOL_ERROR;
+    }
+    if (!_DaemonReadExact(client, payload, header.size)) {
+        return TEST_DAEMON_CONNECTION_ERROR;
+    }
+    payload[header.size] = '\0';
+    test_status status = LoggerChannelAttach((uintptr_t)client);
+    TEST_RETFAIL(status);
+    manifest_entry request;
+    memset(&request, 0, sizeof(request));
+    request.device_id = -1;
+    request.repeat = 1;
+    status = _DaemonParseRequest(payload, header.size, &request, shutdown);
+    if (TEST_SUCCESS(status)) {
+        manifest_saved_state saved_state;
+        status = ManifestApplyEntry(&request, &saved_state);
+        if (TEST_SUCCESS(status)) {
+            if (request.tests[0] == '\0' && MainGetTestFilter() != NULL) {
+                strcpy(request.tests, "*");
+            }
+            /* The watchdog ends a process whose test is stuck past its timeout, that would take the daemon down with it */
+            if (MainGetTestTimeout() != 0) {
+                FATAL("--timeout can't be used with a daemon, --step-timeout still fails a hung submission\n");
+                status = TEST_INVALID_PARAMETER;
+            } else if (request.tests[0] != '\0') {
+                SEPARATOR();
+                INFO("Request for %s on device %ld\n", request.tests, request.device_id);
+                status = RunnerExecuteTests(request.tests, request.device_id);
+            } else if (!*shutdown) {
+                status = TEST_NO_TEST_SPECIFIED;
+            }
+            ManifestRestoreEntry(&saved_state);
+        }
+    }
+    LoggerChannelSendFinished(status);
+    LoggerChannelDetach();
+    if (HelperArrayListRawData(&(request.settings)) != NULL) {
+        HelperArrayListClean(&(request.settings));
+    }
+    return status;
+}
+
+static test_status _DaemonParseRequest(char *payload, size_t size, manifest_entry *request, bool *shutdown) {
+    size_t offset = 0;
+    while (offset < size) {
+        char *key = payload + offset;
+        offset += strlen(key) + 1;
+        char *separator = strchr(key, '=');
+        if (separator == NULL) {
+            return TEST_DAEMON_PROTOCOL_ERROR;
+        }
+        *separator = '\0';
+        const char *value = separator + 1;
+        if (*key == '\0' || strlen(key) >= MANIFEST_MAXIMUM_KEY_LENGTH || strlen(value) >= MANIFEST_MAXIMUM_VALUE_LENGTH) {
+            return TEST_DAEMON_PROTOCOL_ERROR;
+        }
+        if (strcmp(key, DAEMON_TESTS_KEY) == 0) {
+            strcpy(request->tests, value);
+        } else if (strcmp(key, DAEMON_DEVICE_KEY) == 0) {
+            request->device_id = strtol(value, NULL, 10);
+        } else if (strcmp(key, DAEMON_SHUTDOWN_KEY) == 0) {
+            *shutdown = true;
+        } else {
+            manifest_setting setting;
+            memset(&setting, 0, sizeof(setting));
+            strcpy(setting.key, key);
+            strcpy(setting.value, value);
+            test_status status = HelperArrayListAdd(&(request->settings), &setting, sizeof(setting), NULL);
+            TEST_RETFAIL(status);
+        }
+    }
+    return TEST_OK;
+}
+
+/* Each setting goes out as 'key=value' followed by a terminator */
+static bool _DaemonAppendSetting(char *payload, size_t *size, size_t capacity, const char *key, const char *value) {
+    int length = snprintf(payload + *size, capacity - *size, "%s=%s", key, value);
+    if (length < 0 || (size_t)length + 1 > capacity - *size) {
+        return false;
+    }
+    *size += (size_t)length + 1;
+    return true;
+}
\ No newline at end of file
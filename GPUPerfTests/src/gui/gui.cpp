@@ -24,7 +24,11 @@
 #include "main.h"
 #include "helper.h"
 #include "process_runner.h"
+#include "manifest.h"
 #include "logger.h"
+#include "statistics.h"
+#include "results.h"
+#include "history.h"
 #include "resources.h"
 #include "gui/gui.h"
 #include "gui/gui_benchmarks.h"
@@ -48,10 +52,15 @@
 
 static helper_arraylist gui_gpus;
 static helper_linkedlist gui_queue;
+static helper_arraylist gui_manifests;
 static gui_benchmark *gui_current_benchmark;
 static bool gui_benchmark_running;
 static bool gui_exporting;
 static bool gui_about;
+static bool gui_history;
+static bool gui_history_loaded;
+static size_t gui_history_gpu_index;
+static helper_arraylist gui_history_entries;
 static GLuint gui_font_atlas_texture = 0;
 static ImGuiStyle gui_default_style;
 static uint32_t gui_queue_dispatch_counter;
@@ -68,6 +77,7 @@ GUI_IMGUI_STRING(gui_string_title_controls, "gui.title.controls", "Controls");
 GUI_IMGUI_STRING(gui_string_title_benchmarks, "gui.title.benchmarks", "Benchmarks");
 GUI_IMGUI_STRING(gui_string_title_export, "gui.title.export", "Export");
 GUI_IMGUI_STRING(gui_string_title_about, "gui.title.about", "About");
+GUI_IMGUI_STRING(gui_string_title_history, "gui.title.history", "History");
 // Controls section strings
 static gui_localization_string gui_string_controls_current = {"gui.section.controls.current", NULL};
 static gui_localization_string gui_string_controls_none = {"gui.section.controls.none", NULL};
@@ -75,6 +85,8 @@ GUI_IMGUI_STRING(gui_string_controls_list, "gui.section.controls.list", "Control
 GUI_IMGUI_STRING(gui_string_controls_console, "gui.section.controls.button.console", "Controls");
 GUI_IMGUI_STRING(gui_string_controls_about, "gui.section.controls.button.about", "Controls");
 GUI_IMGUI_STRING(gui_string_controls_export, "gui.section.controls.button.export", "Controls");
+GUI_IMGUI_STRING(gui_string_controls_manifest, "gui.section.controls.button.manifest", "Controls");
+GUI_IMGUI_STRING(gui_string_controls_history, "gui.section.controls.button.history", "Controls");
 GUI_IMGUI_STRING(gui_string_controls_cancel, "gui.section.controls.list.button.cancel", "Controls");
 // Benchmarks section strings
 GUI_IMGUI_STRING(gui_string_benchmarks_list, "gui.section.benchmarks.list", "Benchmarks");
@@ -105,11 +117,22 @@ static gui_localization_string gui_string_about_buildinfo_source_local = {"gui.p
 static gui_localization_string gui_string_about_buildinfo_branch = {"gui.popup.about.buildinfo.branch", NULL};
 static gui_localization_string gui_string_about_buildinfo_branch_local = {"gui.popup.about.buildinfo.branch.local", NULL};
 
+GUI_IMGUI_STRING(gui_string_history_gpu, "gui.popup.history.gpu", "History");
+GUI_IMGUI_STRING(gui_string_history_refresh, "gui.popup.history.button.refresh", "History");
+GUI_IMGUI_STRING(gui_string_history_close, "gui.popup.history.button.close", "History");
+static gui_localization_string gui_string_history_empty = {"gui.popup.history.empty", NULL};
+static gui_localization_string gui_string_history_column_time = {"gui.popup.history.column.time", NULL};
+static gui_localization_string gui_string_history_column_test = {"gui.popup.history.column.test", NULL};
+static gui_localization_string gui_string_history_column_driver = {"gui.popup.history.column.driver", NULL};
+static gui_localization_string gui_string_history_column_result = {"gui.popup.history.column.result", NULL};
+
 static void _GuiInitializeStyle();
 static const char *_GuiTranslateImGuiStringUpdate(gui_translated_imgui_string *string, bool force_update);
 static const char *_GuiTranslateImGuiString(gui_translated_imgui_string *string);
 static const char *_GuiTranslateImGuiStringTestSuffix(gui_translated_benchmark_result_string *string, const char *test_name, uint32_t result_index, uint32_t gpu_index);
 static const char *_GuiGetStringWithTestSuffix(gui_cached_benchmark_result_string *string, const char *test_name, uint32_t result_index, uint32_t gpu_index);
+static size_t _GuiGetSectionRowCount(gui_section *section, gui_benchmark *benchmark);
+static size_t _GuiGetSectionResultIndex(gui_section *section, gui_benchmark *benchmark, size_t row);
 
 static ImFont *_GuiLoadFont(ImGuiIO &io, const char *filename, float font_size) {
     const char *font_file = NULL;
@@ -153,36 +176,36 @@ static void _GuiScaleAndApplyStyle(ImGuiIO &io, float scale_factor) {
 
 static test_status _GuiGetGPUList() {
     helper_arraylist results;
-    test_status status = HelperArrayListInitialize(&results, sizeof(process_runner_keypair));
+    test_status status = HelperArrayListInitialize(&results, sizeof(process_runner_result));
     TEST_RETFAIL(status);
     status = ProcessRunnerRunTest(TESTS_VULKAN_LIST_NAME, 0, &results);
     if (!TEST_SUCCESS(status)) {
-        HelperArrayListClean(&results);
+        ProcessRunnerCleanUpResults(&results);
         return status;
     }
     status = HelperArrayListInitialize(&gui_gpus, sizeof(gui_gpu));
     if (!TEST_SUCCESS(status)) {
-        HelperArrayListClean(&results);
+        ProcessRunnerCleanUpResults(&results);
         return status;
     }
     for (size_t i = 0; i < HelperArrayListSize(&results); i++) {
-        char *gpu_name = ((process_runner_keypair *)HelperArrayListGet(&results, i))->key;
+        char *gpu_name = ((process_runner_result *)HelperArrayListGet(&results, i))->key;
         helper_unit_pair vram;
-        uint64_t vram_capacity = strtoull(((process_runner_keypair *)HelperArrayListGet(&results, i))->result, NULL, 10);
+        uint64_t vram_capacity = ((process_runner_result *)HelperArrayListGet(&results, i))->value;
         HelperConvertUnitsBytes1024(vram_capacity, &vram);
         // Yeah, this isn't accurate for VRAM since AMD and NVIDIA exclude/include the host visible region differently.
         INFO("Detected \"%s\" (%.3f %s) as GPU #%llu\n", gpu_name, vram.value, vram.units, i);
         gui_gpu gpu;
         status = HelperPrintToBuffer(&gpu.name, NULL, gpu_name);
         if (!TEST_SUCCESS(status)) {
-            HelperArrayListClean(&results);
+            ProcessRunnerCleanUpResults(&results);
             HelperArrayListClean(&gui_gpus);
             return status;
         }
         status = HelperPrintToBuffer(&gpu.display_name, NULL, "%llu: %s", i, gpu_name);
         if (!TEST_SUCCESS(status)) {
             free((void *)gpu.name);
-            HelperArrayListClean(&results);
+            ProcessRunnerCleanUpResults(&results);
             HelperArrayListClean(&gui_gpus);
             return status;
         }
@@ -191,27 +214,27 @@ static test_status _GuiGetGPUList() {
         if (!TEST_SUCCESS(status)) {
             free((void *)gpu.name);
             free((void *)gpu.display_name);
-            HelperArrayListClean(&results);
+            ProcessRunnerCleanUpResults(&results);
             HelperArrayListClean(&gui_gpus);
             return status;
         }
     }
 
-    HelperArrayListClean(&results);
+    ProcessRunnerCleanUpResults(&results);
     return TEST_OK;
 }
 
-static test_status _GuiConvertResult(process_runner_keypair *raw_result, const char **final_result, size_t result_buffer_size, gui_result_type result_type) {
+static test_status _GuiConvertResult(process_runner_result *raw_result, const char **final_result, size_t result_buffer_size, gui_result_type result_type) {
     if (result_type == gui_result_type_byterate) {
         helper_unit_pair unit_pair;
-        HelperConvertUnitsBytes1024(strtoull(raw_result->result, NULL, 10), &unit_pair);
+        HelperConvertUnitsBytes1024(raw_result->value, &unit_pair);
         return HelperPrintToBuffer(final_result, NULL, "%.3f %s/s", unit_pair.value, unit_pair.units);
     } else if (result_type == gui_result_type_bitrate) {
         helper_unit_pair unit_pair;
-        HelperConvertUnitsBits1000(strtoull(raw_result->result, NULL, 10), &unit_pair);
+        HelperConvertUnitsBits1000(raw_result->value, &unit_pair);
         return HelperPrintToBuffer(final_result, NULL, "%.3f %sps", unit_pair.value, unit_pair.units);
     } else if (result_type == gui_result_type_picoseconds) {
-        return HelperPrintToBuffer(final_result, NULL, "%.3f ns", ((float)strtoull(raw_result->result, NULL, 10)) / 1000.0f);
+        return HelperPrintToBuffer(final_result, NULL, "%.3f ns", ((float)raw_result->value) / 1000.0f);
     } else if (result_type == gui_result_type_ops || result_type == gui_result_type_flops || result_type == gui_result_type_iops) {
         const char *op_type = "OPS";
         if (result_type == gui_result_type_flops) {
@@ -220,7 +243,7 @@ static test_status _GuiConvertResult(process_runner_keypair *raw_result, const c
             op_type = "IOPS";
         }
         helper_unit_pair unit_pair;
-        HelperConvertUnitsPlain1000(strtoull(raw_result->result, NULL, 10), &unit_pair);
+        HelperConvertUnitsPlain1000(raw_result->value, &unit_pair);
         return HelperPrintToBuffer(final_result, NULL, "%.3f %s%s", unit_pair.value, unit_pair.units, op_type);
     } else if (result_type == gui_result_type_error) {
         return HelperPrintToBuffer(final_result, NULL, GuiLocalizationTranslate(&gui_string_main_result_error));
@@ -240,7 +263,7 @@ static gui_benchmark *_GuiDequeueBenchmark() {
     }
     HelperLinkedListRemove(&gui_queue, 0);
     if (benchmark->benchmark->has_been_run) {
-        HelperArrayListClean(&(benchmark->benchmark->raw_results));
+        ProcessRunnerCleanUpResults(&(benchmark->benchmark->raw_results));
         size_t result_count = HelperArrayListSize(&(benchmark->benchmark->results));
         for (size_t i = 0; i < result_count; i++) {
             gui_cached_benchmark_result_string *result_string = (gui_cached_benchmark_result_string *)HelperArrayListGet(&(benchmark->benchmark->results), i);
@@ -251,8 +274,10 @@ static gui_benchmark *_GuiDequeueBenchmark() {
         }
         HelperArrayListClean(&(benchmark->benchmark->results));
         benchmark->benchmark->has_been_run = false;
+        benchmark->benchmark->results_labelled = false;
+        benchmark->benchmark->results_keyed = false;
     }
-    test_status status = HelperArrayListInitialize(&(benchmark->benchmark->raw_results), sizeof(process_runner_keypair));
+    test_status status = HelperArrayListInitialize(&(benchmark->benchmark->raw_results), sizeof(process_runner_result));
     if (!TEST_SUCCESS(status)) {
         return NULL;
     }
@@ -261,7 +286,7 @@ static gui_benchmark *_GuiDequeueBenchmark() {
         return NULL;
     }
     INFO("Running benchmark %s on GPU #%lu\n", benchmark->benchmark->test_name, benchmark->benchmark->gpu_index);
-    status = ProcessRunnerRunTestAsync(benchmark->benchmark->test_name, benchmark->benchmark->gpu_index, &(benchmark->benchmark->raw_results), &(benchmark->benchmark->completion_code), &(benchmark->benchmark->process_handle));
+    status = ProcessRunnerRunTestAsync(benchmark->benchmark->test_name, benchmark->benchmark->gpu_index, benchmark->manifest_path, benchmark->manifest_entry, &(benchmark->benchmark->raw_results), &(benchmark->benchmark->completion_code), &(benchmark->benchmark->process_handle));
     if (!TEST_SUCCESS(status)) {
         return NULL;
     }
@@ -276,11 +301,13 @@ static gui_benchmark *_GuiDequeueBenchmark() {
     return bench;
 }
 
-static void _GuiQueueBenchmark(gui_benchmark *benchmark) {
+static void _GuiQueueBenchmark(gui_benchmark *benchmark, const char *manifest_path, int32_t manifest_entry) {
     gui_queued_benchmark *queued_bench = (gui_queued_benchmark *)malloc(sizeof(gui_queued_benchmark));
     if (queued_bench != NULL) {
         memset(queued_bench, 0, sizeof(gui_queued_benchmark));
         queued_bench->benchmark = benchmark;
+        queued_bench->manifest_path = manifest_path;
+        queued_bench->manifest_entry = manifest_entry;
         queued_bench->sequential_queue_id = gui_queue_dispatch_counter;
         queued_bench->cancel_button.imgui_string.localized_string.key = "gui.section.controls.list.button.remove";
         HelperLinkedListAdd(&gui_queue, queued_bench, NULL);
@@ -289,6 +316,94 @@ static void _GuiQueueBenchmark(gui_benchmark *benchmark) {
     }
 }
 
+// Loaded plans stay alive until the GUI closes, queued benchmarks refer to their path and entries
+/* Runs are stored by the test child processes, the GUI only knows its GPUs by name so that is what it filters on */
+static void _GuiLoadHistory(gui_gpu *gpu) {
+    HistoryCleanUpEntries(&gui_history_entries);
+    gui_history_loaded = true;
+    if (gpu == NULL) {
+        return;
+    }
+    history_filter filter;
+    memset(&filter, 0, sizeof(filter));
+    filter.device_name = gpu->name;
+    test_status status = HistoryQuery(&filter, &gui_history_entries);
+    if (!TEST_SUCCESS(status)) {
+        WARNING("Failed to load the result history: 0x%08lx %s\n", status, LoggerLookUpError(status));
+    }
+}
+
+static void _GuiFormatHistoryValue(history_measurement *measurement, char *buffer, size_t buffer_size) {
+    helper_unit_pair unit_pair;
+    if (strcmp(measurement->unit, "B/s") == 0) {
+        HelperConvertUnitsBytes1024((uint64_t)measurement->median, &unit_pair);
+        snprintf(buffer, buffer_size, "%s: %.3f %s/s", measurement->key, unit_pair.value, unit_pair.units);
+    } else if (strcmp(measurement->unit, "ns") == 0) {
+        snprintf(buffer, buffer_size, "%s: %.3f ns", measurement->key, measurement->median);
+    } else {
+        HelperConvertUnitsPlain1000((uint64_t)measurement->median, &unit_pair);
+        snprintf(buffer, buffer_size, "%s: %.3f %s%s", measurement->key, unit_pair.value, unit_pair.units, measurement->unit);
+    }
+}
+
+static void _GuiQueueManifest(helper_arraylist *benchmark_panels, uint32_t gpu_count) {
+    nfdchar_t *filename;
+    const nfdfilteritem_t filter_item[1] = {{"Test Plan", "ini"}};
+    if (NFD_OpenDialog(&filename, filter_item, 1, NULL) != NFD_OKAY) {
+        return;
+    }
+    const char *filepath = NULL;
+    HelperPrintToBuffer(&filepath, NULL, "%s", filename);
+    NFD_FreePath(filename);
+    if (filepath == NULL) {
+        return;
+    }
+    manifest test_plan;
+    test_status status = ManifestLoad(filepath, &test_plan);
+    if (TEST_SUCCESS(status)) {
+        status = HelperArrayListAdd(&gui_manifests, &test_plan, sizeof(test_plan), NULL);
+        if (!TEST_SUCCESS(status)) {
+            ManifestCleanUp(&test_plan);
+        }
+    }
+    if (!TEST_SUCCESS(status)) {
+        free((void *)filepath);
+        return;
+    }
+    INFO("Queueing test plan \"%s\"\n", filepath);
+    size_t panel_count = HelperArrayListSize(benchmark_panels);
+    size_t entry_count = ManifestGetEntryCount(&test_plan);
+    for (size_t e = 0; e < entry_count; e++) {
+        manifest_entry *entry = ManifestGetEntry(&test_plan, e);
+        bool matched = false;
+        for (uint32_t r = 0; r < entry->repeat; r++) {
+            for (uint32_t g = 0; g < gpu_count; g++) {
+                if (entry->device_id != -1 && (uint32_t)entry->device_id != g) {
+                    continue;
+                }
+                for (size_t p = 0; p < panel_count; p++) {
+                    gui_panel *panel = (gui_panel *)HelperArrayListGet(benchmark_panels, p);
+                    size_t section_count = HelperArrayListSize(&(panel->sections));
+                    for (size_t s = 0; s < section_count; s++) {
+                        gui_section *section = (gui_section *)HelperArrayListGet(&(panel->sections), s);
+                        size_t test_count = HelperArrayListSize(&(section->benchmarks[g]));
+                        for (size_t j = 0; j < test_count; j++) {
+                            gui_benchmark *benchmark = (gui_benchmark *)HelperArrayListGet(&(section->benchmarks[g]), j);
+                            if (HelperMatchPatternList(entry->tests, benchmark->test_name)) {
+                                _GuiQueueBenchmark(benchmark, filepath, (int32_t)e);
+                                matched = true;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+        if (!matched && entry->repeat > 0) {
+            WARNING("Test plan entry [%s] doesn't match any benchmark on the selected GPUs\n", entry->tests);
+        }
+    }
+}
+
 static void _GuiRenderSection(uint32_t gpu_count, gui_section *section) {
     float gpu_column_width = 0;
 
@@ -330,7 +445,7 @@ static void _GuiRenderSection(uint32_t gpu_count, gui_section *section) {
                     button_label = _GuiTranslateImGuiStringTestSuffix(&(benchmark->button_blank), benchmark->test_name, 0, i);
                 }
                 if (ImGui::Button(button_label, ImVec2(-1, 0))) {
-                    _GuiQueueBenchmark(benchmark);
+                    _GuiQueueBenchmark(benchmark, NULL, MANIFEST_ALL_ENTRIES);
                 }
             }
         }
@@ -342,7 +457,7 @@ static void _GuiRenderSection(uint32_t gpu_count, gui_section *section) {
             if (ImGui::Button(_GuiTranslateImGuiStringTestSuffix(runall_button_text, "all", 0, i), ImVec2(0, 0))) {
                 for (size_t j = 0; j < test_count; j++) {
                     gui_benchmark *benchmark = (gui_benchmark *)HelperArrayListGet(&(section->benchmarks[i]), j);
-                    _GuiQueueBenchmark(benchmark);
+                    _GuiQueueBenchmark(benchmark, NULL, MANIFEST_ALL_ENTRIES);
                 }
             }
         }
@@ -351,11 +466,9 @@ static void _GuiRenderSection(uint32_t gpu_count, gui_section *section) {
         size_t max_result_count = 0;
         for (uint32_t i = 0; i < gpu_count; i++) {
             gui_benchmark *benchmark = (gui_benchmark *)HelperArrayListGet(&(section->benchmarks[i]), 0);
-            if (benchmark->has_been_run) {
-                size_t count = HelperArrayListSize(&(benchmark->raw_results));
-                if (count > max_result_count) {
-                    max_result_count = count;
-                }
+            size_t count = _GuiGetSectionRowCount(section, benchmark);
+            if (count > max_result_count) {
+                max_result_count = count;
             }
         }
         if (max_result_count < GUI_DEFAULT_MULTI_TABLE_SIZE) {
@@ -385,7 +498,8 @@ static void _GuiRenderSection(uint32_t gpu_count, gui_section *section) {
                 ImGui::TableNextColumn();
                 const char *button_label = NULL;
                 if (benchmark->has_been_run) {
-                    button_label = _GuiGetStringWithTestSuffix((gui_cached_benchmark_result_string *)HelperArrayListGet(&(benchmark->results), j), benchmark->test_name, (uint32_t)j, i);
+                    size_t result_index = _GuiGetSectionResultIndex(section, benchmark, j);
+                    button_label = _GuiGetStringWithTestSuffix((gui_cached_benchmark_result_string *)HelperArrayListGet(&(benchmark->results), result_index), benchmark->test_name, (uint32_t)j, i);
                 } else if (benchmark->completion_code == TEST_ASYNC_PROCESS_RUNNING) {
                     button_label = _GuiTranslateImGuiStringTestSuffix(&(benchmark->button_running), benchmark->test_name, (uint32_t)j, i);
                 }
@@ -393,7 +507,7 @@ static void _GuiRenderSection(uint32_t gpu_count, gui_section *section) {
                     button_label = _GuiTranslateImGuiStringTestSuffix(&(benchmark->button_blank), benchmark->test_name, (uint32_t)j, i);
                 }
                 if (ImGui::Button(button_label, ImVec2(-1, 0))) {
-                    _GuiQueueBenchmark(benchmark);
+                    _GuiQueueBenchmark(benchmark, NULL, MANIFEST_ALL_ENTRIES);
                 }
             }
         }
@@ -443,6 +557,7 @@ test_status GuiRun() {
     gui_benchmark_running = false;
     gui_exporting = false;
     gui_about = false;
+    gui_history = false;
     gui_queue_dispatch_counter = 0;
     test_status status = HelperLinkedListInitialize(&gui_queue);
     TEST_RETFAIL(status);
@@ -585,8 +700,8 @@ test_status GuiRun() {
 
                 if (result_count > 0) {
                     for (size_t i = 0; i < result_count; i++) {
-                        process_runner_keypair *keypair = (process_runner_keypair *)HelperArrayListGet(&(gui_current_benchmark->raw_results), i);
-                        _GuiConvertResult(keypair, &result_buffer, sizeof(result_buffer), gui_current_benchmark->result_type);
+                        process_runner_result *raw_result = (process_runner_result *)HelperArrayListGet(&(gui_current_benchmark->raw_results), i);
+                        _GuiConvertResult(raw_result, &result_buffer, sizeof(result_buffer), gui_current_benchmark->result_type);
                         result_string.string = result_buffer;
                         HelperArrayListAdd(&(gui_current_benchmark->results), &result_string, sizeof(result_string), NULL);
                     }
@@ -629,8 +744,14 @@ test_status GuiRun() {
                 if (ImGui::Button(_GuiTranslateImGuiString(&gui_string_controls_cancel), ImVec2(queue_button_width, 0))) {
                     ProcessRunnerTerminateAsync(gui_current_benchmark->process_handle);
                 }
+                uint32_t completed = 0;
+                uint32_t total = 0;
+                ProcessRunnerGetProgress(gui_current_benchmark->process_handle, &completed, &total);
+                if (total > 0) {
+                    ImGui::ProgressBar((float)completed / (float)total, ImVec2(-1, 0));
+                }
             }
-            ImGui::BeginListBox(_GuiTranslateImGuiString(&gui_string_controls_list), ImVec2(-1, ImGui::GetFrameHeight() - 3 * ImGui::GetTextLineHeightWithSpacing()));
+            ImGui::BeginListBox(_GuiTranslateImGuiString(&gui_string_controls_list), ImVec2(-1, ImGui::GetFrameHeight() - 3 * ImGui::GetTextLineHeightWithSpacing() - ImGui::GetFrameHeightWithSpacing()));
             void *iterator = NULL;
             for (size_t queue_index = 0; queue_index < HelperLinkedListSize(&gui_queue); queue_index++) {
                 gui_queued_benchmark *benchmark = (gui_queued_benchmark *)HelperLinkedListGet(&gui_queue, queue_index);
@@ -663,6 +784,14 @@ test_status GuiRun() {
             if (ImGui::Button(_GuiTranslateImGuiString(&gui_string_controls_export), ImVec2(button_width, 0))) {
                 gui_exporting = true;
             }
+            if (ImGui::Button(_GuiTranslateImGuiString(&gui_string_controls_manifest), ImVec2(2 * button_width + style.ItemSpacing.x, 0))) {
+                _GuiQueueManifest(benchmark_panels, (uint32_t)gpu_count);
+            }
+            ImGui::SameLine();
+            if (ImGui::Button(_GuiTranslateImGuiString(&gui_string_controls_history), ImVec2(-1, 0))) {
+                gui_history = true;
+                gui_history_loaded = false;
+            }
             ImGui::End();
             ImGui::SetNextWindowPos(ImVec2(0, 0));
             ImGui::SetNextWindowSize(ImVec2(sidebar_width, (float)height - info_corner_height));
@@ -801,11 +930,17 @@ test_status GuiRun() {
 
                                                 for (size_t j = 0; j < test_count; j++) {
                                                     gui_benchmark *benchmark = (gui_benchmark *)HelperArrayListGet(&(section->benchmarks[i]), j);
-                                                    process_runner_keypair *result = NULL;
+                                                    process_runner_result *result = NULL;
                                                     if (benchmark->has_been_run) {
-                                                        result = (process_runner_keypair *)HelperArrayListGet(&(benchmark->raw_results), 0);
+                                                        result = (process_runner_result *)HelperArrayListGet(&(benchmark->raw_results), 0);
+                                                    }
+                                                    if (result == NULL) {
+                                                        HelperWriteFile(file, ",");
+                                                    } else if (strcmp(result->key, "") == 0) {
+                                                        HelperWriteFile(file, "N/A,");
+                                                    } else {
+                                                        HelperWriteFile(file, "%llu,", result->value);
                                                     }
-                                                    HelperWriteFile(file, "%s,", (result == NULL) ? "" : ((strcmp(result->key, "") == 0) ? "N/A" : result->result));
                                                 }
                                                 HelperWriteFile(file, "\n");
                                             }
@@ -814,11 +949,9 @@ test_status GuiRun() {
                                             size_t max_result_count = 0;
                                             for (uint32_t i = 0; i < gpu_count; i++) {
                                                 gui_benchmark *benchmark = (gui_benchmark *)HelperArrayListGet(&(section->benchmarks[i]), 0);
-                                                if (benchmark->has_been_run) {
-                                                    size_t count = HelperArrayListSize(&(benchmark->raw_results));
-                                                    if (count > max_result_count) {
-                                                        max_result_count = count;
-                                                    }
+                                                size_t count = _GuiGetSectionRowCount(section, benchmark);
+                                                if (count > max_result_count) {
+                                                    max_result_count = count;
                                                 }
                                             }
                                             HelperWriteFile(file, "GPU,");
@@ -833,11 +966,17 @@ test_status GuiRun() {
                                                 gui_benchmark *benchmark = (gui_benchmark *)HelperArrayListGet(&(section->benchmarks[i]), 0);
 
                                                 for (size_t j = 0; j < max_result_count; j++) {
-                                                    process_runner_keypair *result = NULL;
+                                                    process_runner_result *result = NULL;
                                                     if (benchmark->has_been_run) {
-                                                        result = (process_runner_keypair *)HelperArrayListGet(&(benchmark->raw_results), j);
+                                                        result = (process_runner_result *)HelperArrayListGet(&(benchmark->raw_results), _GuiGetSectionResultIndex(section, benchmark, j));
+                                                    }
+                                                    if (result == NULL) {
+                                                        HelperWriteFile(file, ",");
+                                                    } else if (strcmp(result->key, "") == 0) {
+                                                        HelperWriteFile(file, "N/A,");
+                                                    } else {
+                                                        HelperWriteFile(file, "%llu,", result->value);
                                                     }
-                                                    HelperWriteFile(file, "%s,", (result == NULL) ? "" : ((strcmp(result->key, "") == 0) ? "N/A" : result->result));
                                                 }
                                                 HelperWriteFile(file, "\n");
                                             }
@@ -923,6 +1062,74 @@ test_status GuiRun() {
                 }
                 ImGui::End();
             }
+            if (gui_history) {
+                const float window_width = 700 * scaling_x;
+                const float window_height = height * 0.8f;
+                const float button_width = (window_width - 2 * style.WindowPadding.x - style.ItemSpacing.x) / 2;
+                ImGui::SetNextWindowPos(ImVec2((width - window_width) / 2, (height - window_height) / 2));
+                ImGui::SetNextWindowSize(ImVec2(window_width, window_height));
+                ImGui::Begin(_GuiTranslateImGuiString(&gui_string_title_history), &gui_history, ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_NoNav | ImGuiWindowFlags_NoResize);
+                ImGui::SetWindowFocus();
+
+                gui_gpu *history_gpu = (gui_gpu *)HelperArrayListGet(&gui_gpus, gui_history_gpu_index);
+                if (ImGui::BeginCombo(_GuiTranslateImGuiString(&gui_string_history_gpu), (history_gpu != NULL) ? history_gpu->display_name : "")) {
+                    for (size_t i = 0; i < gpu_count; i++) {
+                        gui_gpu *gpu = (gui_gpu *)HelperArrayListGet(&gui_gpus, i);
+                        if (ImGui::Selectable(gpu->display_name, i == gui_history_gpu_index)) {
+                            gui_history_gpu_index = i;
+                            gui_history_loaded = false;
+                        }
+                    }
+                    ImGui::EndCombo();
+                }
+                if (!gui_history_loaded) {
+                    _GuiLoadHistory((gui_gpu *)HelperArrayListGet(&gui_gpus, gui_history_gpu_index));
+                }
+                size_t entry_count = HelperArrayListSize(&gui_history_entries);
+                float button_height = ImGui::GetFrameHeightWithSpacing();
+                if (entry_count == 0) {
+                    ImGui::Text("%s", GuiLocalizationTranslate(&gui_string_history_empty));
+                    ImGui::SetCursorPosY(ImGui::GetWindowHeight() - style.WindowPadding.y - button_height);
+                } else if (ImGui::BeginTable("##HistoryTable", 4, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY, ImVec2(-1, -button_height))) {
+                    ImGui::TableSetupScrollFreeze(0, 1);
+                    ImGui::TableSetupColumn(GuiLocalizationTranslate(&gui_string_history_column_time));
+                    ImGui::TableSetupColumn(GuiLocalizationTranslate(&gui_string_history_column_test));
+                    ImGui::TableSetupColumn(GuiLocalizationTranslate(&gui_string_history_column_driver));
+                    ImGui::TableSetupColumn(GuiLocalizationTranslate(&gui_string_history_column_result));
+                    ImGui::TableHeadersRow();
+                    // Newest first, the store keeps them in the order they were recorded
+                    for (size_t i = entry_count; i-- > 0;) {
+                        history_entry *entry = (history_entry *)HelperArrayListGet(&gui_history_entries, i);
+                        size_t measurement_count = HelperArrayListSize(&(entry->measurements));
+                        for (size_t j = 0; j < measurement_count; j++) {
+                            char value_buffer[128];
+                            _GuiFormatHistoryValue((history_measurement *)HelperArrayListGet(&(entry->measurements), j), value_buffer, sizeof(value_buffer));
+                            ImGui::TableNextRow();
+                            if (j == 0) {
+                                char time_buffer[32];
+                                HistoryFormatTimestamp(entry->header.timestamp, time_buffer, sizeof(time_buffer));
+                                ImGui::TableSetColumnIndex(0);
+                                ImGui::Text("%s", time_buffer);
+                                ImGui::TableSetColumnIndex(1);
+                                ImGui::Text("%s %u.%u.%u", entry->header.test_name, TEST_VER_MAJOR(entry->header.test_version), TEST_VER_MINOR(entry->header.test_version), TEST_VER_PATCH(entry->header.test_version));
+                                ImGui::TableSetColumnIndex(2);
+                                ImGui::Text("%s", entry->header.driver_info);
+                            }
+                            ImGui::TableSetColumnIndex(3);
+                            ImGui::Text("%s", value_buffer);
+                        }
+                    }
+                    ImGui::EndTable();
+                }
+                if (ImGui::Button(_GuiTranslateImGuiString(&gui_string_history_refresh), ImVec2(button_width, 0))) {
+                    gui_history_loaded = false;
+                }
+                ImGui::SameLine();
+                if (ImGui::Button(_GuiTranslateImGuiString(&gui_string_history_close), ImVec2(-1, 0))) {
+                    gui_history = false;
+                }
+                ImGui::End();
+            }
 
             ImGui::Render();
             ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
@@ -946,6 +1153,16 @@ test_status GuiRun() {
         ProcessRunnerTerminateAsync(gui_current_benchmark->process_handle);
         free((void *)gui_current_benchmark->process_handle);
     }
+    size_t manifest_count = HelperArrayListSize(&gui_manifests);
+    for (size_t i = 0; i < manifest_count; i++) {
+        manifest *test_plan = (manifest *)HelperArrayListGet(&gui_manifests, i);
+        free((void *)test_plan->filepath);
+        ManifestCleanUp(test_plan);
+    }
+    if (HelperArrayListRawData(&gui_manifests) != NULL) {
+        HelperArrayListClean(&gui_manifests);
+    }
+    HistoryCleanUpEntries(&gui_history_entries);
     free((void *)about_section_version_string);
     free((void *)window_title);
     return status;
@@ -1132,4 +1349,43 @@ static const char *_GuiGetStringWithTestSuffix(gui_cached_benchmark_result_strin
         string->cached_test_name = test_name;
     }
     return string->string_with_suffix;
+}
+
+// Rows follow the section's sizes, results that aren't keyed by a size (such as a failed run) are shown in order
+static size_t _GuiGetSectionRowCount(gui_section *section, gui_benchmark *benchmark) {
+    benchmark->results_keyed = false;
+    if (!benchmark->has_been_run) {
+        return 0;
+    }
+    if (!benchmark->results_labelled) {
+        test_status status = GuiBenchmarksAddResultLabels(section, benchmark);
+        if (!TEST_SUCCESS(status)) {
+            WARNING("Failed to add result labels of \"%s\"\n", benchmark->test_name);
+        }
+        benchmark->results_labelled = true;
+    }
+    size_t row_count = 0;
+    size_t label_count = HelperArrayListSize(&(section->capacities));
+    for (size_t j = 0; j < label_count; j++) {
+        size_t result_index = 0;
+        if (GuiBenchmarksFindResult(section, benchmark, j, &result_index)) {
+            row_count = j + 1;
+        }
+    }
+    if (row_count == 0) {
+        return HelperArrayListSize(&(benchmark->results));
+    }
+    benchmark->results_keyed = true;
+    return row_count;
+}
+
+static size_t _GuiGetSectionResultIndex(gui_section *section, gui_benchmark *benchmark, size_t row) {
+    if (!benchmark->results_keyed) {
+        return row;
+    }
+    size_t result_index = 0;
+    if (!GuiBenchmarksFindResult(section, benchmark, row, &result_index)) {
+        return SIZE_MAX;
+    }
+    return result_index;
 }
\ No newline at end of file
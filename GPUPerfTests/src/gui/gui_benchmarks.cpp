@@ -23,6 +23,7 @@
 
 #include "main.h"
 #include "helper.h"
+#include "process_runner.h"
 #include "gui/gui.h"
 #include "gui/gui_benchmarks.h"
 #include "tests/test_vk_bandwidth.h"
@@ -30,6 +31,10 @@
 
 static helper_arraylist gui_panels;
 
+static test_status _GuiBenchmarksCreateLabelsFromCapacities(helper_arraylist *labels, const uint64_t *data, size_t element_count);
+static bool _GuiBenchmarksParseCapacity(process_runner_result *result, uint64_t *capacity);
+static int _GuiBenchmarksCompareCapacities(const void *a, const void *b);
+
 static gui_panel *_GuiBenchmarksNewPanel(uint32_t gpu_count, const char *display_name, const char* panel_tooltip) {
     if (display_name == NULL) {
         return NULL;
@@ -62,7 +67,7 @@ static gui_panel *_GuiBenchmarksNewPanel(uint32_t gpu_count, const char *display
     return (gui_panel *)HelperArrayListGet(&gui_panels, index);
 }
 
-static gui_section *_GuiBenchmarksNewSectionMultiResult(uint32_t gpu_count, gui_panel *panel, const char *display_name, helper_arraylist *labels, const char* section_tooltip) {
+static gui_section *_GuiBenchmarksNewSectionMultiResult(uint32_t gpu_count, gui_panel *panel, const char *display_name, const uint64_t *capacities, size_t capacity_count, const char* section_tooltip) {
     if (display_name == NULL || panel == NULL) {
         return NULL;
     }
@@ -87,10 +92,20 @@ static gui_section *_GuiBenchmarksNewSectionMultiResult(uint32_t gpu_count, gui_
     memset(&(section->section_tooltip_description), 0, sizeof(section->section_tooltip_description));
     section->section_tooltip_description.key = section_tooltip;
     section->benchmark_type = gui_benchmarks_type_multiple_result;
-    test_status status = HelperArrayListCopy(&(section->labels), labels);
+    test_status status = _GuiBenchmarksCreateLabelsFromCapacities(&(section->labels), capacities, capacity_count);
+    if (!TEST_SUCCESS(status)) {
+        return NULL;
+    }
+    status = HelperArrayListInitialize(&(section->capacities), sizeof(uint64_t));
     if (!TEST_SUCCESS(status)) {
         return NULL;
     }
+    for (size_t i = 0; i < capacity_count; i++) {
+        status = HelperArrayListAdd(&(section->capacities), &(capacities[i]), sizeof(uint64_t), NULL);
+        if (!TEST_SUCCESS(status)) {
+            return NULL;
+        }
+    }
 
     size_t index = 0;
     status = HelperArrayListAdd(&(panel->sections), section, sizeof(gui_section) + gpu_count * sizeof(helper_arraylist), &index);
@@ -171,12 +186,13 @@ static test_status _GuiBenchmarksAddBenchmark(uint32_t gpu_count, gui_section *s
     return TEST_OK;
 }
 
+// Labels are stored by value, sizes from a geometric sweep don't fit into a pointer's worth of characters
 static test_status _GuiBenchmarksCreateLabelsFromCapacities(helper_arraylist *labels, const uint64_t *data, size_t element_count) {
-    test_status status = HelperArrayListInitialize(labels, sizeof(const char *));
+    test_status status = HelperArrayListInitialize(labels, GUI_BENCHMARKS_MAXIMUM_LABEL_LENGTH);
     TEST_RETFAIL(status);
 
     for (size_t i = 0; i < element_count; i++) {
-        const char *label = NULL;
+        char label[GUI_BENCHMARKS_MAXIMUM_LABEL_LENGTH];
 
         helper_unit_pair unit_pair;
         HelperConvertUnitsBytes1024(data[i], &unit_pair);
@@ -193,11 +209,7 @@ static test_status _GuiBenchmarksCreateLabelsFromCapacities(helper_arraylist *la
                 format = "%.3f %s";
             }
         }
-        status = HelperPrintToBuffer(&label, NULL, format, unit_pair.value, unit_pair.units);
-        if (!TEST_SUCCESS(status)) {
-            HelperArrayListClean(labels);
-            return status;
-        }
+        snprintf(label, sizeof(label), format, unit_pair.value, unit_pair.units);
         status = HelperArrayListAdd(labels, label, sizeof(label), NULL);
         if (!TEST_SUCCESS(status)) {
             HelperArrayListClean(labels);
@@ -212,7 +224,6 @@ test_status GuiBenchmarksRegister(helper_arraylist **list, uint32_t gpu_count) {
     TEST_RETFAIL(status);
     gui_panel *panel = NULL;
     gui_section *section = NULL;
-    helper_arraylist labels;
 
     panel = _GuiBenchmarksNewPanel(gpu_count, "bench.insnrate.panel", "bench.insnrate.tooltip");
     section = _GuiBenchmarksNewSectionSingleResult(gpu_count, panel, "bench.insnrate.section.madd", "bench.insnrate.tooltip.madd");
@@ -272,20 +283,17 @@ test_status GuiBenchmarksRegister(helper_arraylist **list, uint32_t gpu_count) {
     TEST_RETFAIL(_GuiBenchmarksAddBenchmark(gpu_count, section, "bench.insnrate.format.fp32", "vk_rate_fp32_isqrt", gui_result_type_ops));
     TEST_RETFAIL(_GuiBenchmarksAddBenchmark(gpu_count, section, "bench.insnrate.format.fp64", "vk_rate_fp64_isqrt", gui_result_type_ops));
 
-    TEST_RETFAIL(_GuiBenchmarksCreateLabelsFromCapacities(&labels, VulkanBandwidthGetRegionSizes(), VulkanBandwidthGetRegionCount()));
+    // The base sweeps of the current parameters, refined sizes are added once a run reports them
     panel = _GuiBenchmarksNewPanel(gpu_count, "bench.membandwidth.panel", "bench.membandwidth.tooltip");
-    section = _GuiBenchmarksNewSectionMultiResult(gpu_count, panel, "bench.membandwidth.panel", &labels, "bench.membandwidth.tooltip");
+    section = _GuiBenchmarksNewSectionMultiResult(gpu_count, panel, "bench.membandwidth.panel", VulkanBandwidthGetRegionSizes(), VulkanBandwidthGetRegionCount(), "bench.membandwidth.tooltip");
     TEST_RETFAIL(_GuiBenchmarksAddBenchmark(gpu_count, section, "bench.membandwidth.panel", "vk_bandwidth", gui_result_type_byterate));
-    HelperArrayListClean(&labels);
 
-    TEST_RETFAIL(_GuiBenchmarksCreateLabelsFromCapacities(&labels, VulkanLatencyGetRegionSizes(), VulkanLatencyGetRegionCount()));
     panel = _GuiBenchmarksNewPanel(gpu_count, "bench.memlatency.panel", "bench.memlatency.tooltip");
-    section = _GuiBenchmarksNewSectionMultiResult(gpu_count, panel, "bench.memlatency.section.vector", &labels, "bench.memlatency.tooltip.vector");
+    section = _GuiBenchmarksNewSectionMultiResult(gpu_count, panel, "bench.memlatency.section.vector", VulkanLatencyGetRegionSizes(), VulkanLatencyGetRegionCount(), "bench.memlatency.tooltip.vector");
     TEST_RETFAIL(_GuiBenchmarksAddBenchmark(gpu_count, section, "bench.memlatency.section.vector", "vk_latency_vector", gui_result_type_picoseconds));
-    section = _GuiBenchmarksNewSectionMultiResult(gpu_count, panel, "bench.memlatency.section.scalar", &labels, "bench.memlatency.tooltip.scalar");
+    section = _GuiBenchmarksNewSectionMultiResult(gpu_count, panel, "bench.memlatency.section.scalar", VulkanLatencyGetRegionSizes(), VulkanLatencyGetRegionCount(), "bench.memlatency.tooltip.scalar");
     TEST_RETFAIL(_GuiBenchmarksAddBenchmark(gpu_count, section, "bench.memlatency.section.scalar", "vk_latency_scalar", gui_result_type_picoseconds));
-    HelperArrayListClean(&labels);
-    
+
     panel = _GuiBenchmarksNewPanel(gpu_count, "bench.uplink.panel", "bench.uplink.tooltip");
     section = _GuiBenchmarksNewSectionSingleResult(gpu_count, panel, "bench.uplink.panel", "bench.uplink.tooltip");
     TEST_RETFAIL(_GuiBenchmarksAddBenchmark(gpu_count, section, "bench.uplink.gpu_to_cpu.copy", "vk_uplink_copy_read", gui_result_type_byterate));
@@ -296,8 +304,69 @@ test_status GuiBenchmarksRegister(helper_arraylist **list, uint32_t gpu_count) {
     TEST_RETFAIL(_GuiBenchmarksAddBenchmark(gpu_count, section, "bench.uplink.cpu_to_gpu.mapped", "vk_uplink_mapped_write", gui_result_type_byterate));
     TEST_RETFAIL(_GuiBenchmarksAddBenchmark(gpu_count, section, "bench.uplink.latency.short", "vk_uplink_latency", gui_result_type_picoseconds));
     TEST_RETFAIL(_GuiBenchmarksAddBenchmark(gpu_count, section, "bench.uplink.latency.long", "vk_uplink_latency_long", gui_result_type_picoseconds));
-    HelperArrayListClean(&labels);
 
     *list = &gui_panels;
     return TEST_OK;
+}
+
+// Refined sweeps report sizes the labels were created without, those are added in size order
+test_status GuiBenchmarksAddResultLabels(gui_section *section, gui_benchmark *benchmark) {
+    if (section->benchmark_type != gui_benchmarks_type_multiple_result) {
+        return TEST_OK;
+    }
+    size_t result_count = HelperArrayListSize(&(benchmark->raw_results));
+    size_t capacity_count = HelperArrayListSize(&(section->capacities));
+    for (size_t i = 0; i < result_count; i++) {
+        uint64_t capacity = 0;
+        if (!_GuiBenchmarksParseCapacity((process_runner_result *)HelperArrayListGet(&(benchmark->raw_results), i), &capacity)) {
+            continue;
+        }
+        bool known = false;
+        for (size_t j = 0; j < HelperArrayListSize(&(section->capacities)) && !known; j++) {
+            known = *(uint64_t *)HelperArrayListGet(&(section->capacities), j) == capacity;
+        }
+        if (!known) {
+            test_status status = HelperArrayListAdd(&(section->capacities), &capacity, sizeof(capacity), NULL);
+            TEST_RETFAIL(status);
+        }
+    }
+    if (HelperArrayListSize(&(section->capacities)) == capacity_count) {
+        return TEST_OK;
+    }
+    uint64_t *capacities = (uint64_t *)HelperArrayListRawData(&(section->capacities));
+    qsort(capacities, HelperArrayListSize(&(section->capacities)), sizeof(uint64_t), &_GuiBenchmarksCompareCapacities);
+    HelperArrayListClean(&(section->labels));
+    return _GuiBenchmarksCreateLabelsFromCapacities(&(section->labels), capacities, HelperArrayListSize(&(section->capacities)));
+}
+
+bool GuiBenchmarksFindResult(gui_section *section, gui_benchmark *benchmark, size_t label_index, size_t *result_index) {
+    uint64_t *label_capacity = (uint64_t *)HelperArrayListGet(&(section->capacities), label_index);
+    if (label_capacity == NULL) {
+        return false;
+    }
+    size_t result_count = HelperArrayListSize(&(benchmark->raw_results));
+    for (size_t i = 0; i < result_count; i++) {
+        uint64_t capacity = 0;
+        if (_GuiBenchmarksParseCapacity((process_runner_result *)HelperArrayListGet(&(benchmark->raw_results), i), &capacity) && capacity == *label_capacity) {
+            *result_index = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Sweep results are keyed by their region size in bytes
+static bool _GuiBenchmarksParseCapacity(process_runner_result *result, uint64_t *capacity) {
+    if (result == NULL || result->key == NULL) {
+        return false;
+    }
+    char *end = NULL;
+    *capacity = strtoull(result->key, &end, 10);
+    return end != result->key && *end == '\0' && *capacity != 0;
+}
+
+static int _GuiBenchmarksCompareCapacities(const void *a, const void *b) {
+    uint64_t capacity_a = *(const uint64_t *)a;
+    uint64_t capacity_b = *(const uint64_t *)b;
+    return (capacity_a > capacity_b) - (capacity_a < capacity_b);
 }
\ No newline at end of file
@@ -25,6 +25,7 @@
 #include "main.h"
 #include "logger.h"
 #include "helper.h"
+#include "timeline.h"
 #include <stdarg.h>
 #ifdef _WIN32
 #include "sanitize_windows_h.h"
@@ -32,8 +33,11 @@
 #else
 #include <pthread.h>
 #include <sys/time.h>
+#include <time.h>
 #include <sched.h>
 #include <unistd.h>
+#include <sys/stat.h>
+#include <errno.h>
 #endif
 #ifdef __linux
 #include <sys/sysinfo.h>
@@ -76,13 +80,22 @@ typedef struct helper_thread_data_t {
     helper_thread_func thread_func;
     uint32_t thread_id;
     void *input_data;
+    uint32_t first_processor;
+    uint32_t processor_count;
 } helper_thread_data;
 
-static uint64_t timer_start;
-static uint64_t timer_us_in_ticks;
+/* Processors the calling thread was pinned to, handed down to every thread it creates */
+typedef struct helper_thread_affinity_t {
+    uint32_t first_processor;
+    uint32_t processor_count;
+} helper_thread_affinity;
+
+static helper_timer legacy_timer;
+static HELPER_THREAD_LOCAL helper_thread_affinity thread_affinity;
 
 static void _HelperConvertUnits1024(uint64_t number, helper_unit_pair *unit_pair);
 static void _HelperConvertUnits1000(uint64_t number, helper_unit_pair *unit_pair);
+static test_status _HelperGetUserDirectory(const char *xdg_variable, const char *home_fallback, const char *subdirectory, const char **path);
 #ifdef _WIN32
 static DWORD WINAPI _HelperInternalThreadFunc(void *thread_data_ptr);
 #else
@@ -137,6 +150,116 @@ void HelperCloseFile(void *file_handle) {
     }
 }
 
+/* Written to a uniquely named file next to the target and renamed over it, so readers never see a partial file */
+test_status HelperWriteFileAtomic(const char *filepath, const void *data, size_t size) {
+    static helper_atomic_uint32 temporary_counter = 0;
+    const char *temporary_path = NULL;
+#ifdef _WIN32
+    uint32_t process_id = (uint32_t)GetCurrentProcessId();
+#else
+    uint32_t process_id = (uint32_t)getpid();
+#endif
+    test_status status = HelperPrintToBuffer(&temporary_path, NULL, "%s.%lu.%lu.tmp", filepath, process_id, HelperAtomicIncrementUint32(&temporary_counter));
+    TEST_RETFAIL(status);
+    FILE *file = fopen(temporary_path, "wb");
+    if (file == NULL) {
+        free((void *)temporary_path);
+        return TEST_FILE_IO_ERROR;
+    }
+    size_t written = fwrite(data, 1, size, file);
+    bool closed = fclose(file) == 0;
+    if (written != size || !closed) {
+        remove(temporary_path);
+        free((void *)temporary_path);
+        return TEST_FILE_IO_ERROR;
+    }
+#ifdef _WIN32
+    bool renamed = MoveFileExA(temporary_path, filepath, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    bool renamed = rename(temporary_path, filepath) == 0;
+#endif
+    if (!renamed) {
+        remove(temporary_path);
+        status = TEST_FILE_IO_ERROR;
+    }
+    free((void *)temporary_path);
+    return status;
+}
+
+/* %LOCALAPPDATA%\GPUPerfTests\<subdirectory> on Windows, $XDG_CACHE_HOME/gpuperftests/<subdirectory> (or ~/.cache) elsewhere */
+test_status HelperGetUserCacheDirectory(const char *subdirectory, const char **path) {
+    return _HelperGetUserDirectory("XDG_CACHE_HOME", ".cache", subdirectory, path);
+}
+
+/* Same as the cache directory on Windows, $XDG_DATA_HOME/gpuperftests/<subdirectory> (or ~/.local/share) elsewhere */
+test_status HelperGetUserDataDirectory(const char *subdirectory, const char **path) {
+    return _HelperGetUserDirectory("XDG_DATA_HOME", ".local/share", subdirectory, path);
+}
+
+static test_status _HelperGetUserDirectory(const char *xdg_variable, const char *home_fallback, const char *subdirectory, const char **path) {
+    if (subdirectory == NULL || path == NULL) {
+        return TEST_INVALID_PARAMETER;
+    }
+    const char *base_path = NULL;
+    test_status status = TEST_OK;
+#ifdef _WIN32
+    const char *local_app_data = getenv("LOCALAPPDATA");
+    if (local_app_data == NULL) {
+        return TEST_FILE_NOT_FOUND;
+    }
+    status = HelperPrintToBuffer(&base_path, NULL, "%s\\GPUPerfTests", local_app_data);
+    TEST_RETFAIL(status);
+    if (CreateDirectoryA(base_path, NULL) == 0 && GetLastError() != ERROR_ALREADY_EXISTS) {
+        free((void *)base_path);
+        return TEST_FILE_IO_ERROR;
+    }
+    status = HelperPrintToBuffer(path, NULL, "%s\\%s", base_path, subdirectory);
+    free((void *)base_path);
+    TEST_RETFAIL(status);
+    if (CreateDirectoryA(*path, NULL) == 0 && GetLastError() != ERROR_ALREADY_EXISTS) {
+        free((void *)*path);
+        *path = NULL;
+        return TEST_FILE_IO_ERROR;
+    }
+#else
+    const char *xdg_home = getenv(xdg_variable);
+    if (xdg_home != NULL && xdg_home[0] != '\0') {
+        status = HelperPrintToBuffer(&base_path, NULL, "%s/gpuperftests", xdg_home);
+    } else {
+        const char *home = getenv("HOME");
+        if (home == NULL) {
+            return TEST_FILE_NOT_FOUND;
+        }
+        char *fallback_path = NULL;
+        status = HelperPrintToBuffer((const char **)&fallback_path, NULL, "%s/%s", home, home_fallback);
+        TEST_RETFAIL(status);
+        /* Create every component below HOME, ~/.local may not exist yet either */
+        for (char *separator = fallback_path + strlen(home) + 1; (separator = strchr(separator, '/')) != NULL; separator++) {
+            *separator = '\0';
+            mkdir(fallback_path, 0755);
+            *separator = '/';
+        }
+        mkdir(fallback_path, 0755);
+        status = HelperPrintToBuffer(&base_path, NULL, "%s/gpuperftests", fallback_path);
+        free(fallback_path);
+    }
+    TEST_RETFAIL(status);
+    if (mkdir(base_path, 0755) != 0 && errno != EEXIST) {
+        free((void *)base_path);
+        return TEST_FILE_IO_ERROR;
+    }
+    status = HelperPrintToBuffer(path, NULL, "%s/%s", base_path, subdirectory);
+    free((void *)base_path);
+    TEST_RETFAIL(status);
+    if (mkdir(*path, 0755) != 0 && errno != EEXIST) {
+        free((void *)*path);
+        *path = NULL;
+        return TEST_FILE_IO_ERROR;
+    }
+#endif
+    return status;
+}
+
 #ifndef _CLI
 const char *HelperDecodePng(const char *data, size_t size, int spng_format, uint32_t *image_width, uint32_t *image_height) {
     spng_ctx *ctx = spng_ctx_new(0);
@@ -167,58 +290,65 @@ const char *HelperDecodePng(const char *data, size_t size, int spng_format, uint
 }
 #endif
 
-void HelperResetTimestamp() {
+static uint64_t _HelperGetMonotonicNanoseconds() {
 #ifdef _WIN32
-    LARGE_INTEGER li;
-    QueryPerformanceFrequency(&li);
-    timer_us_in_ticks = li.QuadPart / 1000000ULL;
-    QueryPerformanceCounter(&li);
-    timer_start = li.QuadPart;
+    LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    /* Split the conversion to avoid overflowing 64 bits on long uptimes */
+    uint64_t seconds = (uint64_t)counter.QuadPart / (uint64_t)frequency.QuadPart;
+    uint64_t remainder = (uint64_t)counter.QuadPart % (uint64_t)frequency.QuadPart;
+    return seconds * 1000000000ULL + (remainder * 1000000000ULL) / (uint64_t)frequency.QuadPart;
 #else
-    struct timeval tv;
-    if (gettimeofday(&tv, NULL) == -1) {
-        timer_start = 0;
-    } else {
-        uint64_t time = (uint64_t)tv.tv_sec * 1000000 + (uint64_t)tv.tv_usec;
-        timer_start = time;
+    struct timespec ts;
+#ifdef CLOCK_MONOTONIC_RAW
+    if (clock_gettime(CLOCK_MONOTONIC_RAW, &ts) == -1) {
+        return 0;
     }
-#endif
-}
-
-uint64_t HelperGetTimestamp() {
-#ifdef _WIN32
-    LARGE_INTEGER li;
-    QueryPerformanceCounter(&li);
-    return (li.QuadPart - timer_start) / timer_us_in_ticks;
 #else
-    struct timeval tv;
-    if (gettimeofday(&tv, NULL) == -1) {
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) == -1) {
         return 0;
-    } else {
-        uint64_t time = (uint64_t)tv.tv_sec * 1000000 + (uint64_t)tv.tv_usec;
-        return time - timer_start;
     }
 #endif
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+void HelperTimerReset(helper_timer *timer) {
+    timer->start = _HelperGetMonotonicNanoseconds();
+}
+
+uint64_t HelperTimerGetNanoseconds(helper_timer *timer) {
+    return _HelperGetMonotonicNanoseconds() - timer->start;
+}
+
+uint64_t HelperTimerMarkNanoseconds(helper_timer *timer) {
+    uint64_t now = _HelperGetMonotonicNanoseconds();
+    uint64_t nanos = now - timer->start;
+    timer->start = now;
+    return nanos;
+}
+
+uint64_t HelperTimerGet(helper_timer *timer) {
+    return HelperTimerGetNanoseconds(timer) / 1000;
+}
+
+uint64_t HelperTimerMark(helper_timer *timer) {
+    return HelperTimerMarkNanoseconds(timer) / 1000;
+}
+
+/* Legacy single-timer API, not thread safe. Prefer a helper_timer per caller. */
+void HelperResetTimestamp() {
+    HelperTimerReset(&legacy_timer);
+}
+
+uint64_t HelperGetTimestamp() {
+    return HelperTimerGet(&legacy_timer);
 }
 
 uint64_t HelperMarkTimestamp() {
-#ifdef _WIN32
-    LARGE_INTEGER li;
-    QueryPerformanceCounter(&li);
-    uint64_t micros = (li.QuadPart - timer_start) / timer_us_in_ticks;
-    timer_start = li.QuadPart;
-    return micros;
-#else
-    struct timeval tv;
-    if (gettimeofday(&tv, NULL) == -1) {
-        return 0;
-    } else {
-        uint64_t time = (uint64_t)tv.tv_sec * 1000000 + (uint64_t)tv.tv_usec;
-        uint64_t micros = time - timer_start;
-        timer_start = time;
-        return micros;
-    }
-#endif
+    return HelperTimerMark(&legacy_timer);
 }
 
 void HelperSleep(uint64_t milliseconds) {
@@ -341,6 +471,13 @@ size_t HelperArrayListSize(helper_arraylist *arraylist) {
     return arraylist->size;
 }
 
+/* Drops the elements past size, the capacity is kept */
+void HelperArrayListTruncate(helper_arraylist *arraylist, size_t size) {
+    if (arraylist->size > size) {
+        arraylist->size = size;
+    }
+}
+
 void *HelperArrayListRawData(helper_arraylist *arraylist) {
     return arraylist->data;
 }
@@ -485,6 +622,71 @@ bool HelperStringPresent(const char *string, const char **strings, uint32_t stri
     return false;
 }
 
+/* Shell-style wildcards, '*' matches any run of characters and '?' a single one */
+bool HelperMatchPattern(const char *pattern, size_t pattern_length, const char *string) {
+    if (pattern == NULL || string == NULL) {
+        return false;
+    }
+    size_t p = 0;
+    size_t star_p = SIZE_MAX;
+    const char *star_s = NULL;
+    while (*string != '\0') {
+        if (p < pattern_length && (pattern[p] == '?' || pattern[p] == *string)) {
+            p++;
+            string++;
+        } else if (p < pattern_length && pattern[p] == '*') {
+            star_p = p++;
+            star_s = string;
+        } else if (star_p != SIZE_MAX) {
+            /* Let the last '*' swallow one more character and retry */
+            p = star_p + 1;
+            string = ++star_s;
+        } else {
+            return false;
+        }
+    }
+    while (p < pattern_length && pattern[p] == '*') {
+        p++;
+    }
+    return p == pattern_length;
+}
+
+/* Patterns are comma separated and may contain wildcards, returns NULL once the list is exhausted */
+const char *HelperNextPattern(const char *patterns, size_t *pattern_length) {
+    while (*patterns == ' ' || *patterns == ',') {
+        patterns++;
+    }
+    size_t length = strcspn(patterns, ",");
+    while (length > 0 && patterns[length - 1] == ' ') {
+        length--;
+    }
+    *pattern_length = length;
+    return (length > 0) ? patterns : NULL;
+}
+
+bool HelperMatchPatternList(const char *patterns, const char *string) {
+    if (patterns == NULL) {
+        return false;
+    }
+    size_t pattern_length = 0;
+    for (const char *pattern = HelperNextPattern(patterns, &pattern_length); pattern != NULL; pattern = HelperNextPattern(pattern + pattern_length, &pattern_length)) {
+        if (HelperMatchPattern(pattern, pattern_length, string)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* FNV-1a, start with HELPER_HASH_SEED and pass the result along to hash several pieces */
+uint64_t HelperHash(uint64_t hash, const void *data, size_t size) {
+    const uint8_t *bytes = (const uint8_t *)data;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
 void HelperConvertUnitsBytes1024(uint64_t number, helper_unit_pair *unit_pair) {
     _HelperConvertUnits1024(number, unit_pair);
     strcat(unit_pair->units, _HELPER_BYTE_SUFFIX);
@@ -602,6 +804,9 @@ uint64_t HelperGetFreeSystemMemory() {
 }
 
 uint32_t HelperGetProcessorCount() {
+    if (thread_affinity.processor_count > 0) {
+        return thread_affinity.processor_count;
+    }
 #ifdef _WIN32
     SYSTEM_INFO system_info;
     
@@ -644,6 +849,8 @@ helper_thread HelperCreateThread(helper_thread_func thread_func, void *data) {
     thread_data->thread_func = thread_func;
     thread_data->thread_id = 0;
     thread_data->input_data = data;
+    thread_data->first_processor = thread_affinity.first_processor;
+    thread_data->processor_count = thread_affinity.processor_count;
 
 #ifdef _WIN32
     HANDLE handle = CreateThread(NULL, 0, _HelperInternalThreadFunc, thread_data, 0, NULL);
@@ -686,6 +893,8 @@ helper_thread *HelperCreateThreads(uint32_t thread_count, helper_thread_func thr
         thread_data->thread_func = thread_func;
         thread_data->thread_id = i;
         thread_data->input_data = data[i];
+        thread_data->first_processor = thread_affinity.first_processor;
+        thread_data->processor_count = thread_affinity.processor_count;
 
 #ifdef _WIN32
         HANDLE handle = CreateThread(NULL, 0, _HelperInternalThreadFunc, thread_data, 0, NULL);
@@ -731,6 +940,81 @@ void HelperCleanUpThreads(helper_thread *threads, uint32_t thread_count) {
     }
 }
 
+test_status HelperPinThread(uint32_t first_processor, uint32_t processor_count) {
+    if (processor_count == 0) {
+        return TEST_INVALID_PARAMETER;
+    }
+    thread_affinity.first_processor = first_processor;
+    thread_affinity.processor_count = processor_count;
+#ifdef _WIN32
+    DWORD_PTR mask = 0;
+    for (uint32_t i = first_processor; i < first_processor + processor_count && i < sizeof(DWORD_PTR) * 8; i++) {
+        mask |= (DWORD_PTR)1 << i;
+    }
+    if (mask == 0 || SetThreadAffinityMask(GetCurrentThread(), mask) == 0) {
+        return TEST_OUT_OF_RANGE;
+    }
+#elif __linux
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    for (uint32_t i = first_processor; i < first_processor + processor_count && i < CPU_SETSIZE; i++) {
+        CPU_SET(i, &cpu_set);
+    }
+    if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) != 0) {
+        return TEST_OUT_OF_RANGE;
+    }
+#endif
+    /* macOS has no hard affinity, the processor count still limits how many helper threads get spawned */
+    return TEST_OK;
+}
+
+helper_mutex HelperCreateMutex() {
+#ifdef _WIN32
+    CRITICAL_SECTION *mutex = malloc(sizeof(CRITICAL_SECTION));
+    if (mutex != NULL) {
+        InitializeCriticalSection(mutex);
+    }
+#else
+    pthread_mutex_t *mutex = malloc(sizeof(pthread_mutex_t));
+    if (mutex != NULL && pthread_mutex_init(mutex, NULL) != 0) {
+        free(mutex);
+        mutex = NULL;
+    }
+#endif
+    return (helper_mutex)mutex;
+}
+
+void HelperLockMutex(helper_mutex mutex) {
+    if (mutex != NULL) {
+#ifdef _WIN32
+        EnterCriticalSection((CRITICAL_SECTION *)mutex);
+#else
+        pthread_mutex_lock((pthread_mutex_t *)mutex);
+#endif
+    }
+}
+
+void HelperUnlockMutex(helper_mutex mutex) {
+    if (mutex != NULL) {
+#ifdef _WIN32
+        LeaveCriticalSection((CRITICAL_SECTION *)mutex);
+#else
+        pthread_mutex_unlock((pthread_mutex_t *)mutex);
+#endif
+    }
+}
+
+void HelperCleanUpMutex(helper_mutex mutex) {
+    if (mutex != NULL) {
+#ifdef _WIN32
+        DeleteCriticalSection((CRITICAL_SECTION *)mutex);
+#else
+        pthread_mutex_destroy((pthread_mutex_t *)mutex);
+#endif
+        free(mutex);
+    }
+}
+
 #ifdef _WIN32
 static DWORD WINAPI _HelperInternalThreadFunc(void *thread_data_ptr) {
 #else
@@ -738,9 +1022,14 @@ static void *_HelperInternalThreadFunc(void *thread_data_ptr) {
 #endif
     helper_thread_data *thread_data = (helper_thread_data *)thread_data_ptr;
     if (thread_data != NULL) {
+        /* Windows threads don't inherit their creator's affinity, so always apply it explicitly */
+        if (thread_data->processor_count > 0) {
+            HelperPinThread(thread_data->first_processor, thread_data->processor_count);
+        }
         if (thread_data->thread_func != NULL) {
             thread_data->thread_func(thread_data->thread_id, thread_data->input_data);
         }
+        TimelineReleaseThread();
         free(thread_data);
     }
     return 0;
@@ -0,0 +1,425 @@
+// Copyright (c) 2021 - 2022, Nemes <nemes@nemez.net>
+// SPDX-License-Identifier: MIT
+// 
+// MIT License
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software andassociated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, andto permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+// 
+// The above copyright notice andthis permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "main.h"
+#include "logger.h"
+#include "helper.h"
+#include "statistics.h"
+#include "results.h"
+#include "history.h"
+#include <time.h>
+
+static helper_mutex history_mutex;
+
+static test_status _HistoryGetPath(const char *filename, const char **path);
+static test_status _HistoryReadRecord(FILE *log, uint64_t offset, history_entry *entry);
+static bool _HistoryMatches(const history_filter *filter, const history_record_header *header);
+static void _HistoryCleanUpEntry(history_entry *entry);
+static void _HistoryFormatUUID(const uint8_t *uuid, char *buffer);
+
+/* Creates the lock parallel workers append under, the store records nothing until this is called */
+test_status HistoryInitialize() {
+    if (history_mutex != NULL) {
+        return TEST_OK;
+    }
+    history_mutex = HelperCreateMutex();
+    if (history_mutex == NULL) {
+        return TEST_OUT_OF_MEMORY;
+    }
+    return TEST_OK;
+}
+
+bool HistoryIsEnabled() {
+    return history_mutex != NULL;
+}
+
+void HistoryCleanUp() {
+    if (history_mutex != NULL) {
+        HelperCleanUpMutex(history_mutex);
+        history_mutex = NULL;
+    }
+}
+
+/* The record goes to the log first, a crash in between leaves it unindexed rather than the index pointing at nothing */
+test_status HistoryRecord(const results_context *context) {
+    if (!HistoryIsEnabled() || context == NULL) {
+        return TEST_OK;
+    }
+    size_t measurement_count = HelperArrayListSize((helper_arraylist *)&(context->measurements));
+    size_t parameter_count = HelperArrayListSize((helper_arraylist *)&(context->parameters));
+    size_t sample_count = HelperArrayListSize((helper_arraylist *)&(context->samples));
+    if (measurement_count == 0) {
+        return TEST_OK;
+    }
+    size_t record_size = sizeof(history_record_header) + measurement_count * sizeof(history_measurement) + parameter_count * sizeof(history_parameter) + sample_count * sizeof(history_sample);
+    char *record = malloc(record_size);
+    if (record == NULL) {
+        return TEST_OUT_OF_MEMORY;
+    }
+    memset(record, 0, record_size);
+
+    history_record_header *header = (history_record_header *)record;
+    const results_device *device = &(context->device);
+    header->magic = HISTORY_RECORD_MAGIC;
+    header->format_version = HISTORY_FORMAT_VERSION;
+    header->size = (uint32_t)(record_size - sizeof(history_record_header));
+    header->measurement_count = (uint32_t)measurement_count;
+    header->parameter_count = (uint32_t)parameter_count;
+    header->sample_count = (uint32_t)sample_count;
+    header->vendor_id = device->vendor_id;
+    header->device_id = device->device_id;
+    header->driver_version = device->driver_version;
+    header->api_version = device->api_version;
+    header->tool_version = TEST_TOOL_VERSION;
+    header->test_version = context->test_version;
+    header->timestamp = (uint64_t)time(NULL);
+    memcpy(header->uuid, device->uuid, RESULTS_UUID_SIZE);
+    strncpy(header->test_name, context->test_name, RESULTS_MAXIMUM_NAME_LENGTH - 1);
+    if (device->name != NULL) {
+        strncpy(header->device_name, device->name, HISTORY_MAXIMUM_DEVICE_NAME_LENGTH - 1);
+    }
+    if (device->driver_info != NULL) {
+        strncpy(header->driver_info, device->driver_info, HISTORY_MAXIMUM_DRIVER_INFO_LENGTH - 1);
+    }
+
+    history_measurement *measurements = (history_measurement *)(record + sizeof(history_record_header));
+    for (size_t i = 0; i < measurement_count; i++) {
+        results_measurement *source = (results_measurement *)HelperArrayListGet((helper_arraylist *)&(context->measurements), i);
+        history_measurement *measurement = &(measurements[i]);
+        measurement->id = source->id;
+        measurement->sample_count = source->summary.sample_count;
+        measurement->rejected_outliers = source->summary.rejected_outliers;
+        memcpy(measurement->key, source->key, RESULTS_MAXIMUM_NAME_LENGTH);
+        memcpy(measurement->unit, source->unit, RESULTS_MAXIMUM_UNIT_LENGTH);
+        measurement->median = source->summary.median;
+        measurement->mean = source->summary.mean;
+        measurement->minimum = source->summary.minimum;
+        measurement->maximum = source->summary.maximum;
+        measurement->p5 = source->summary.p5;
+        measurement->p95 = source->summary.p95;
+        measurement->standard_deviation = source->summary.standard_deviation;
+        measurement->confidence_low = source->summary.confidence_low;
+        measurement->confidence_high = source->summary.confidence_high;
+    }
+    history_parameter *parameters = (history_parameter *)(&(measurements[measurement_count]));
+    for (size_t i = 0; i < parameter_count; i++) {
+        results_value *source = (results_value *)HelperArrayListGet((helper_arraylist *)&(context->parameters), i);
+        memcpy(parameters[i].name, source->name, RESULTS_MAXIMUM_NAME_LENGTH);
+        parameters[i].value = source->integer_value;
+    }
+    history_sample *samples = (history_sample *)(&(parameters[parameter_count]));
+    for (size_t i = 0; i < sample_count; i++) {
+        results_sample *source = (results_sample *)HelperArrayListGet((helper_arraylist *)&(context->samples), i);
+        samples[i].id = source->id;
+        samples[i].value = source->value;
+        samples[i].time_us = source->time_us;
+    }
+
+    history_index_entry index_entry;
+    memset(&index_entry, 0, sizeof(index_entry));
+    index_entry.timestamp = header->timestamp;
+    memcpy(index_entry.uuid, header->uuid, RESULTS_UUID_SIZE);
+    index_entry.driver_version = header->driver_version;
+    index_entry.tool_version = header->tool_version;
+    index_entry.test_version = header->test_version;
+    index_entry.record_size = (uint32_t)record_size;
+
+    const char *log_path = NULL;
+    const char *index_path = NULL;
+    test_status status = _HistoryGetPath(HISTORY_LOG_FILENAME, &log_path);
+    if (!TEST_SUCCESS(status)) {
+        goto cleanup_record;
+    }
+    status = _HistoryGetPath(HISTORY_INDEX_FILENAME, &index_path);
+    if (!TEST_SUCCESS(status)) {
+        goto cleanup_log_path;
+    }
+
+    HelperLockMutex(history_mutex);
+    FILE *file = fopen(log_path, "ab");
+    if (file == NULL) {
+        status = TEST_FILE_IO_ERROR;
+        goto cleanup_unlock;
+    }
+    long offset = -1;
+    if (fseek(file, 0, SEEK_END) == 0) {
+        offset = ftell(file);
+    }
+    if (offset < 0 || fwrite(record, 1, record_size, file) != record_size) {
+        fclose(file);
+        status = TEST_FILE_IO_ERROR;
+        goto cleanup_unlock;
+    }
+    if (fclose(file) != 0) {
+        status = TEST_FILE_IO_ERROR;
+        goto cleanup_unlock;
+    }
+    index_entry.offset = (uint64_t)offset;
+    file = fopen(index_path, "ab");
+    if (file == NULL) {
+        status = TEST_FILE_IO_ERROR;
+        goto cleanup_unlock;
+    }
+    if (fwrite(&index_entry, sizeof(index_entry), 1, file) != 1) {
+        status = TEST_FILE_IO_ERROR;
+    }
+    if (fclose(file) != 0) {
+        status = TEST_FILE_IO_ERROR;
+    }
+cleanup_unlock:
+    HelperUnlockMutex(history_mutex);
+    free((void *)index_path);
+cleanup_log_path:
+    free((void *)log_path);
+cleanup_record:
+    free(record);
+    return status;
+}
+
+/* Entries come back oldest first, an empty store is not an error */
+test_status HistoryQuery(const history_filter *filter, helper_arraylist *entries) {
+    if (entries == NULL) {
+        return TEST_INVALID_PARAMETER;
+    }
+    test_status status = HelperArrayListInitialize(entries, sizeof(history_entry));
+    TEST_RETFAIL(status);
+
+    const char *log_path = NULL;
+    const char *index_path = NULL;
+    status = _HistoryGetPath(HISTORY_LOG_FILENAME, &log_path);
+    if (!TEST_SUCCESS(status)) {
+        return status;
+    }
+    status = _HistoryGetPath(HISTORY_INDEX_FILENAME, &index_path);
+    if (!TEST_SUCCESS(status)) {
+        free((void *)log_path);
+        return status;
+    }
+    const char *index_data = NULL;
+    size_t index_size = 0;
+    FILE *log = fopen(log_path, "rb");
+    if (log == NULL || !TEST_SUCCESS(HelperLoadFile(index_path, &index_data, &index_size))) {
+        /* Nothing recorded yet */
+        goto cleanup_log;
+    }
+
+    size_t index_count = index_size / sizeof(history_index_entry);
+    for (size_t i = 0; i < index_count; i++) {
+        history_index_entry index_entry;
+        memcpy(&index_entry, index_data + i * sizeof(history_index_entry), sizeof(index_entry));
+        if (filter != NULL && filter->uuid != NULL && memcmp(filter->uuid, index_entry.uuid, RESULTS_UUID_SIZE) != 0) {
+            continue;
+        }
+        history_entry entry;
+        if (!TEST_SUCCESS(_HistoryReadRecord(log, index_entry.offset, &entry))) {
+            DEBUG("Skipping unreadable history record at offset %llu\n", index_entry.offset);
+            continue;
+        }
+        if (!_HistoryMatches(filter, &(entry.header))) {
+            _HistoryCleanUpEntry(&entry);
+            continue;
+        }
+        status = HelperArrayListAdd(entries, &entry, sizeof(entry), NULL);
+        if (!TEST_SUCCESS(status)) {
+            _HistoryCleanUpEntry(&entry);
+            HistoryCleanUpEntries(entries);
+            break;
+        }
+    }
+    free((void *)index_data);
+cleanup_log:
+    if (log != NULL) {
+        fclose(log);
+    }
+    free((void *)index_path);
+    free((void *)log_path);
+    return status;
+}
+
+test_status HistoryPrint(const history_filter *filter) {
+    helper_arraylist entries;
+    test_status status = HistoryQuery(filter, &entries);
+    TEST_RETFAIL(status);
+    size_t entry_count = HelperArrayListSize(&entries);
+    if (MainGetTestResultFormat() == test_result_csv) {
+        LOG_PLAIN("time,device,uuid,driver,driver_version,test,test_version,tool_version,id,key,unit,median,mean,p5,p95,stddev,samples\n");
+    } else if (entry_count == 0) {
+        INFO("No recorded runs match\n");
+    }
+    for (size_t i = 0; i < entry_count; i++) {
+        history_entry *entry = (history_entry *)HelperArrayListGet(&entries, i);
+        history_record_header *header = &(entry->header);
+        char uuid[RESULTS_UUID_SIZE * 2 + 5];
+        char timestamp[32];
+        _HistoryFormatUUID(header->uuid, uuid);
+        HistoryFormatTimestamp(header->timestamp, timestamp, sizeof(timestamp));
+        if (MainGetTestResultFormat() != test_result_csv) {
+            INFO("%s %s v%u.%u.%u on %s (%s), driver %s (0x%08lx)\n", timestamp, header->test_name, TEST_VER_MAJOR(header->test_version), TEST_VER_MINOR(header->test_version), TEST_VER_PATCH(header->test_version), header->device_name, uuid, header->driver_info, header->driver_version);
+        }
+        for (size_t j = 0; j < HelperArrayListSize(&(entry->measurements)); j++) {
+            history_measurement *measurement = (history_measurement *)HelperArrayListGet(&(entry->measurements), j);
+            if (MainGetTestResultFormat() == test_result_csv) {
+                LOG_PLAIN("%s,\"%s\",%s,\"%s\",%lu,%s,%u.%u.%u,%u.%u.%u,%lu,%s,%s,%.10g,%.10g,%.10g,%.10g,%.10g,%lu\n", timestamp, header->device_name, uuid, header->driver_info, header->driver_version, header->test_name,
+                          TEST_VER_MAJOR(header->test_version), TEST_VER_MINOR(header->test_version), TEST_VER_PATCH(header->test_version), TEST_VER_MAJOR(header->tool_version), TEST_VER_MINOR(header->tool_version), TEST_VER_PATCH(header->tool_version),
+                          measurement->id, measurement->key, measurement->unit, measurement->median, measurement->mean, measurement->p5, measurement->p95, measurement->standard_deviation, measurement->sample_count);
+            } else if (strcmp(measurement->unit, "B/s") == 0) {
+                helper_unit_pair median;
+                HelperConvertUnitsBytes1024((uint64_t)measurement->median, &median);
+                INFO("    %s: %.3f %s/s (%lu samples)\n", measurement->key, median.value, median.units, measurement->sample_count);
+            } else {
+                INFO("    %s: %.3f %s (p5 %.3f, p95 %.3f, %lu samples)\n", measurement->key, measurement->median, measurement->unit, measurement->p5, measurement->p95, measurement->sample_count);
+            }
+        }
+    }
+    HistoryCleanUpEntries(&entries);
+    return TEST_OK;
+}
+
+void HistoryCleanUpEntries(helper_arraylist *entries) {
+    if (entries == NULL || HelperArrayListRawData(entries) == NULL) {
+        return;
+    }
+    for (size_t i = 0; i < HelperArrayListSize(entries); i++) {
+        _HistoryCleanUpEntry((history_entry *)HelperArrayListGet(entries, i));
+    }
+    HelperArrayListClean(entries);
+}
+
+/* Local time, falls back to the raw seconds if the platform can't convert them */
+void HistoryFormatTimestamp(uint64_t timestamp, char *buffer, size_t buffer_size) {
+    time_t time_value = (time_t)timestamp;
+    struct tm *local_time = localtime(&time_value);
+    if (local_time == NULL || strftime(buffer, buffer_size, "%Y-%m-%d %H:%M:%S", local_time) == 0) {
+        snprintf(buffer, buffer_size, "%llu", (unsigned long long)timestamp);
+    }
+}
+
+static test_status _HistoryGetPath(const char *filename, const char **path) {
+    const char *directory = NULL;
+    test_status status = HelperGetUserDataDirectory(HISTORY_DIRECTORY, &directory);
+    TEST_RETFAIL(status);
+#ifdef _WIN32
+    status = HelperPrintToBuffer(path, NULL, "%s\\%s", directory, filename);
+#else
+    status = HelperPrintToBuffer(path, NULL, "%s/%s", directory, filename);
+#endif
+    free((void *)directory);
+    return status;
+}
+
+static test_status _HistoryReadRecord(FILE *log, uint64_t offset, history_entry *entry) {
+    memset(entry, 0, sizeof(history_entry));
+    if (fseek(log, (long)offset, SEEK_SET) != 0 || fread(&(entry->header), sizeof(history_record_header), 1, log) != 1) {
+        return TEST_FILE_IO_ERROR;
+    }
+    history_record_header *header = &(entry->header);
+    if (header->magic != HISTORY_RECORD_MAGIC || header->format_version == 0 || header->format_version > HISTORY_FORMAT_VERSION) {
+        return TEST_FILE_IO_ERROR;
+    }
+    if (header->format_version < 2) {
+        header->sample_count = 0;
+    }
+    if ((uint64_t)header->measurement_count * sizeof(history_measurement) + (uint64_t)header->parameter_count * sizeof(history_parameter) + (uint64_t)header->sample_count * sizeof(history_sample) != header->size) {
+        return TEST_FILE_IO_ERROR;
+    }
+    header->test_name[RESULTS_MAXIMUM_NAME_LENGTH - 1] = '\0';
+    header->device_name[HISTORY_MAXIMUM_DEVICE_NAME_LENGTH - 1] = '\0';
+    header->driver_info[HISTORY_MAXIMUM_DRIVER_INFO_LENGTH - 1] = '\0';
+
+    test_status status = HelperArrayListInitialize(&(entry->measurements), sizeof(history_measurement));
+    TEST_RETFAIL(status);
+    status = HelperArrayListInitialize(&(entry->parameters), sizeof(history_parameter));
+    if (TEST_SUCCESS(status)) {
+        status = HelperArrayListInitialize(&(entry->samples), sizeof(history_sample));
+    }
+    if (!TEST_SUCCESS(status)) {
+        _HistoryCleanUpEntry(entry);
+        return status;
+    }
+    for (uint32_t i = 0; i < header->measurement_count && TEST_SUCCESS(status); i++) {
+        history_measurement measurement;
+        if (fread(&measurement, sizeof(measurement), 1, log) != 1) {
+            status = TEST_FILE_IO_ERROR;
+            break;
+        }
+        measurement.key[RESULTS_MAXIMUM_NAME_LENGTH - 1] = '\0';
+        measurement.unit[RESULTS_MAXIMUM_UNIT_LENGTH - 1] = '\0';
+        status = HelperArrayListAdd(&(entry->measurements), &measurement, sizeof(measurement), NULL);
+    }
+    for (uint32_t i = 0; i < header->parameter_count && TEST_SUCCESS(status); i++) {
+        history_parameter parameter;
+        if (fread(&parameter, sizeof(parameter), 1, log) != 1) {
+            status = TEST_FILE_IO_ERROR;
+            break;
+        }
+        parameter.name[RESULTS_MAXIMUM_NAME_LENGTH - 1] = '\0';
+        status = HelperArrayListAdd(&(entry->parameters), &parameter, sizeof(parameter), NULL);
+    }
+    for (uint32_t i = 0; i < header->sample_count && TEST_SUCCESS(status); i++) {
+        history_sample sample;
+        if (fread(&sample, sizeof(sample), 1, log) != 1) {
+            status = TEST_FILE_IO_ERROR;
+            break;
+        }
+        status = HelperArrayListAdd(&(entry->samples), &sample, sizeof(sample), NULL);
+    }
+    if (!TEST_SUCCESS(status)) {
+        _HistoryCleanUpEntry(entry);
+    }
+    return status;
+}
+
+static void _HistoryCleanUpEntry(history_entry *entry) {
+    if (HelperArrayListRawData(&(entry->measurements)) != NULL) {
+        HelperArrayListClean(&(entry->measurements));
+    }
+    if (HelperArrayListRawData(&(entry->parameters)) != NULL) {
+        HelperArrayListClean(&(entry->parameters));
+    }
+    if (HelperArrayListRawData(&(entry->samples)) != NULL) {
+        HelperArrayListClean(&(entry->samples));
+    }
+}
+
+static bool _HistoryMatches(const history_filter *filter, const history_record_header *header) {
+    if (filter == NULL) {
+        return true;
+    }
+    if (filter->device_name != NULL && strcmp(filter->device_name, header->device_name) != 0) {
+        return false;
+    }
+    return filter->test_patterns == NULL || HelperMatchPatternList(filter->test_patterns, header->test_name);
+}
+
+/* Canonical 8-4-4-4-12 form, buffer holds at least 37 characters */
+static void _HistoryFormatUUID(const uint8_t *uuid, char *buffer) {
+    size_t position = 0;
+    for (uint32_t i = 0; i < RESULTS_UUID_SIZE; i++) {
+        if (i == 4 || i == 6 || i == 8 || i == 10) {
+            buffer[position++] = '-';
+        }
+        snprintf(&(buffer[position]), 3, "%02x", uuid[i]);
+        position += 2;
+    }
+    buffer[position] = '\0';
+}
\ No newline at end of file
@@ -23,19 +23,229 @@
 
 #include "main.h"
 #include "logger.h"
+#include "helper.h"
 #include <stdarg.h>
+#include "sanitize_windows_h.h"
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <unistd.h>
+#endif
 
 #define DEFINE_STATUS_CASE(status)  case status: return #status
 
+/* Output of a thread running tests next to others, held back so it appears as one uninterrupted block */
+typedef struct logger_capture_t {
+    bool active;
+    char *data;
+    size_t size;
+    size_t capacity;
+} logger_capture;
+
+static HELPER_THREAD_LOCAL logger_capture logger_local_capture;
+
+/* Inherited from the parent process, records from parallel workers are serialized by the mutex */
+static bool logger_channel_open = false;
+static uintptr_t logger_channel_handle;
+static helper_mutex logger_channel_mutex;
+
+static bool _LoggerCaptureMessage(const char *format, va_list list);
+static void _LoggerChannelWrite(uint32_t type, const void *payload, uint32_t payload_size);
+
 test_status LoggerLogMessage(const char *format, ...) {
     va_list list;
     va_start(list, format);
+    if (logger_local_capture.active && _LoggerCaptureMessage(format, list)) {
+        va_end(list);
+        return TEST_OK;
+    }
+    va_end(list);
+    va_start(list, format);
     vprintf(format, list);
     va_end(list);
     fflush(stdout);
     return TEST_OK;
 }
 
+void LoggerBeginCapture() {
+    logger_local_capture.active = true;
+    logger_local_capture.size = 0;
+}
+
+void LoggerEndCapture() {
+    if (logger_local_capture.size > 0) {
+        /* A single write keeps the block intact even while other threads are printing */
+        fwrite(logger_local_capture.data, 1, logger_local_capture.size, stdout);
+        fflush(stdout);
+    }
+    free(logger_local_capture.data);
+    memset(&logger_local_capture, 0, sizeof(logger_local_capture));
+}
+
+/* Writes out what a test logged so far, so a crash only loses the region being measured */
+void LoggerFlushCapture() {
+    if (logger_local_capture.size > 0) {
+        fwrite(logger_local_capture.data, 1, logger_local_capture.size, stdout);
+        fflush(stdout);
+        logger_local_capture.size = 0;
+    }
+}
+
+/* Returns false if the message couldn't be buffered, it is then printed directly instead of being lost */
+static bool _LoggerCaptureMessage(const char *format, va_list list) {
+    va_list measure_list;
+    va_copy(measure_list, list);
+    int length = vsnprintf(NULL, 0, format, measure_list);
+    va_end(measure_list);
+    if (length < 0) {
+        return false;
+    }
+    size_t required = logger_local_capture.size + (size_t)length + 1;
+    if (required > logger_local_capture.capacity) {
+        size_t capacity = max(required, logger_local_capture.capacity * 2);
+        char *data = realloc(logger_local_capture.data, capacity);
+        if (data == NULL) {
+            return false;
+        }
+        logger_local_capture.data = data;
+        logger_local_capture.capacity = capacity;
+    }
+    vsnprintf(&(logger_local_capture.data[logger_local_capture.size]), (size_t)length + 1, format, list);
+    logger_local_capture.size += (size_t)length;
+    return true;
+}
+
+/* handle is the write end of a pipe the parent created, as a decimal file descriptor or HANDLE value */
+test_status LoggerChannelOpen(const char *handle) {
+    if (handle == NULL) {
+        return TEST_INVALID_PARAMETER;
+    }
+    char *end = NULL;
+    unsigned long long value = strtoull(handle, &end, 10);
+    if (end == handle || *end != '\0') {
+        return TEST_INVALID_PARAMETER;
+    }
+    return LoggerChannelAttach((uintptr_t)value);
+}
+
+void LoggerChannelClose() {
+    if (!logger_channel_open) {
+        return;
+    }
+#ifdef _WIN32
+    CloseHandle((HANDLE)logger_channel_handle);
+#else
+    close((int)logger_channel_handle);
+#endif
+    LoggerChannelDetach();
+}
+
+/* The caller keeps owning handle, the daemon points the channel at one client connection after another */
+test_status LoggerChannelAttach(uintptr_t handle) {
+    if (logger_channel_open) {
+        return TEST_INVALID_PARAMETER;
+    }
+    logger_channel_mutex = HelperCreateMutex();
+    if (logger_channel_mutex == NULL) {
+        return TEST_OUT_OF_MEMORY;
+    }
+    logger_channel_handle = handle;
+    logger_channel_open = true;
+    return TEST_OK;
+}
+
+void LoggerChannelDetach() {
+    if (!logger_channel_open) {
+        return;
+    }
+    logger_channel_open = false;
+    HelperCleanUpMutex(logger_channel_mutex);
+}
+
+bool LoggerChannelIsOpen() {
+    return logger_channel_open;
+}
+
+void LoggerChannelSendResult(uint32_t id, uint64_t value, const char *key_format, ...) {
+    if (!logger_channel_open) {
+        return;
+    }
+    char payload[LOGGER_CHANNEL_MAXIMUM_RECORD_SIZE - sizeof(logger_channel_header)];
+    logger_channel_result *result = (logger_channel_result *)payload;
+    char *key = payload + sizeof(logger_channel_result);
+    size_t key_capacity = sizeof(payload) - sizeof(logger_channel_result);
+    va_list list;
+    va_start(list, key_format);
+    int length = vsnprintf(key, key_capacity, key_format, list);
+    va_end(list);
+    if (length < 0) {
+        return;
+    }
+    /* A key that doesn't fit is cut short rather than dropping the result */
+    result->value = value;
+    result->id = id;
+    result->key_length = (uint32_t)min((size_t)length, key_capacity - 1);
+    _LoggerChannelWrite(LOGGER_CHANNEL_RECORD_RESULT, payload, (uint32_t)sizeof(logger_channel_result) + result->key_length);
+}
+
+void LoggerChannelSendProgress(uint32_t completed, uint32_t total) {
+    if (!logger_channel_open) {
+        return;
+    }
+    logger_channel_progress progress;
+    progress.completed = completed;
+    progress.total = total;
+    _LoggerChannelWrite(LOGGER_CHANNEL_RECORD_PROGRESS, &progress, sizeof(progress));
+}
+
+void LoggerChannelSendError(test_status code) {
+    if (!logger_channel_open) {
+        return;
+    }
+    logger_channel_error error;
+    error.code = code;
+    _LoggerChannelWrite(LOGGER_CHANNEL_RECORD_ERROR, &error, sizeof(error));
+}
+
+void LoggerChannelSendFinished(test_status code) {
+    if (!logger_channel_open) {
+        return;
+    }
+    logger_channel_error finished;
+    finished.code = code;
+    _LoggerChannelWrite(LOGGER_CHANNEL_RECORD_FINISHED, &finished, sizeof(finished));
+}
+
+/* Header and payload go out in one write so a reader never sees half a record from another thread */
+static void _LoggerChannelWrite(uint32_t type, const void *payload, uint32_t payload_size) {
+    char record[LOGGER_CHANNEL_MAXIMUM_RECORD_SIZE];
+    if (sizeof(logger_channel_header) + payload_size > sizeof(record)) {
+        return;
+    }
+    logger_channel_header *header = (logger_channel_header *)record;
+    header->type = type;
+    header->size = payload_size;
+    memcpy(record + sizeof(logger_channel_header), payload, payload_size);
+    size_t total = sizeof(logger_channel_header) + payload_size;
+    HelperLockMutex(logger_channel_mutex);
+    size_t written = 0;
+    while (written < total) {
+#ifdef _WIN32
+        DWORD chunk = 0;
+        if (!WriteFile((HANDLE)logger_channel_handle, record + written, (DWORD)(total - written), &chunk, NULL) || chunk == 0) {
+            break;
+        }
+#else
+        ssize_t chunk = write((int)logger_channel_handle, record + written, total - written);
+        if (chunk <= 0) {
+            break;
+        }
+#endif
+        written += (size_t)chunk;
+    }
+    HelperUnlockMutex(logger_channel_mutex);
+}
+
 const char *LoggerLookUpError(test_status status) {
     switch (status) {
         DEFINE_STATUS_CASE(TEST_OK);
@@ -61,6 +271,13 @@ const char *LoggerLookUpError(test_status status) {
         DEFINE_STATUS_CASE(TEST_EMBEDDED_RESOURCE_NOT_FOUND);
         DEFINE_STATUS_CASE(TEST_FAILED_TO_LOAD_WINDOW_ICON);
         DEFINE_STATUS_CASE(TEST_FAILED_TO_DECODE_WINDOW_ICON);
+        DEFINE_STATUS_CASE(TEST_MANIFEST_SYNTAX_ERROR);
+        DEFINE_STATUS_CASE(TEST_UNKNOWN_OPTION);
+        DEFINE_STATUS_CASE(TEST_REGRESSION_DETECTED);
+        DEFINE_STATUS_CASE(TEST_TIMEOUT);
+        DEFINE_STATUS_CASE(TEST_SKIPPED);
+        DEFINE_STATUS_CASE(TEST_DAEMON_CONNECTION_ERROR);
+        DEFINE_STATUS_CASE(TEST_DAEMON_PROTOCOL_ERROR);
 
         DEFINE_STATUS_CASE(TEST_VK_CREATE_INSTANCE_ERROR);
         DEFINE_STATUS_CASE(TEST_VK_LAYER_ENUMERATION_ERROR);
@@ -118,6 +335,10 @@ const char *LoggerLookUpError(test_status status) {
         DEFINE_STATUS_CASE(TEST_VK_INVALID_QUEUE_INDEX);
         DEFINE_STATUS_CASE(TEST_VK_COMMAND_SEQUENCE_NOT_MULTI_QUEUE);
         DEFINE_STATUS_CASE(TEST_VK_WAIT_FOR_FENCES_NOT_READY);
+        DEFINE_STATUS_CASE(TEST_VK_TIMESTAMPS_UNSUPPORTED);
+        DEFINE_STATUS_CASE(TEST_VK_QUERY_POOL_CREATION_ERROR);
+        DEFINE_STATUS_CASE(TEST_VK_QUERY_RESULTS_ERROR);
+        DEFINE_STATUS_CASE(TEST_VK_PIPELINE_CACHE_ERROR);
     default:
         return "- MISSING LOOKUP TRANSLATION -";
     }
@@ -29,13 +29,34 @@
 #include "logger.h"
 #include "helper.h"
 #include "runner.h"
+#include "statistics.h"
+#include "convergence.h"
+#include "timeline.h"
+#include "soak.h"
+#include "parameters.h"
+#include "results.h"
+#include "history.h"
+#include "compare.h"
+#include "watchdog.h"
+#include "manifest.h"
+#include "checkpoint.h"
+#include "planner.h"
+#include "daemon.h"
 #include "gui/gui.h"
 #include "build_info.h"
 
 static test_result_output result_format;
+static main_options options;
+static const char *trace_filepath;
 static test_ui_mode ui_mode;
 static const char *binary_path;
 static bool console_visible;
+static manifest_entry forwarded_settings;
+
+static void _MainSetForwardedOption(const char *name, const char *value);
+static void _MainSetForwardedParameter(const char *assignment);
+static test_status _MainExecuteTests(const char *manifest_filepath, int32_t manifest_entry, const char *test_identifier, int32_t gpu_identifier);
+static test_status _MainPlanTests(const char *manifest_filepath, int32_t manifest_entry, const char *test_identifier, int32_t gpu_identifier, uint64_t budget_us, bool schedule);
 
 int main(int argc, const char **argv) {
     SEPARATOR();
@@ -45,8 +66,30 @@ int main(int argc, const char **argv) {
 
     int32_t gpu_identifier = -1;
     const char *test_identifier = NULL;
+    const char *manifest_filepath = NULL;
+    int32_t manifest_entry = MANIFEST_ALL_ENTRIES;
+    const char *channel_handle = NULL;
+    const char *checkpoint_filepath = NULL;
+    bool resume_checkpoint = false;
+    const char *daemon_socket_path = NULL;
+    const char *connect_socket_path = NULL;
+    bool stop_daemon = false;
+    bool plan_tests = false;
+    uint64_t time_budget_minutes = 0;
     bool print_help = false;
+    bool print_history = false;
+    bool record_history = true;
+    const char *compare_baseline = NULL;
+    const char *compare_candidate = COMPARE_DEFAULT_CANDIDATE;
+    double compare_threshold = COMPARE_DEFAULT_THRESHOLD;
     result_format = test_result_readable;
+    memset(&options, 0, sizeof(options));
+    options.trial_count = STATISTICS_DEFAULT_TRIAL_COUNT;
+    options.convergence_tolerance = CONVERGENCE_DEFAULT_TOLERANCE;
+    options.convergence_budget = CONVERGENCE_DEFAULT_BUDGET_MS;
+    options.step_timeout_ms = WATCHDOG_DEFAULT_STEP_TIMEOUT_MS;
+    memset(&forwarded_settings, 0, sizeof(forwarded_settings));
+    trace_filepath = NULL;
 #ifndef _CLI
     ui_mode = test_ui_mode_gui;
 #else
@@ -66,6 +109,33 @@ int main(int argc, const char **argv) {
             } else if (strcmp(current_key, "--raw") == 0 || strcmp(current_key, "-r") == 0) {
                 result_format = test_result_raw;
                 current_key = NULL;
+            } else if (strcmp(current_key, "--json") == 0 || strcmp(current_key, "-j") == 0) {
+                result_format = test_result_json;
+                current_key = NULL;
+            } else if (strcmp(current_key, "--host-timer") == 0 || strcmp(current_key, "-w") == 0) {
+                _MainSetForwardedOption("host-timer", "true");
+                current_key = NULL;
+            } else if (strcmp(current_key, "--subtract-overhead") == 0 || strcmp(current_key, "-o") == 0) {
+                _MainSetForwardedOption("subtract-overhead", "true");
+                current_key = NULL;
+            } else if (strcmp(current_key, "--validate-invocations") == 0 || strcmp(current_key, "-v") == 0) {
+                _MainSetForwardedOption("validate-invocations", "true");
+                current_key = NULL;
+            } else if (strcmp(current_key, "--parallel-devices") == 0 || strcmp(current_key, "-p") == 0) {
+                _MainSetForwardedOption("parallel-devices", "true");
+                current_key = NULL;
+            } else if (strcmp(current_key, "--history") == 0 || strcmp(current_key, "-q") == 0) {
+                print_history = true;
+                current_key = NULL;
+            } else if (strcmp(current_key, "--no-history") == 0 || strcmp(current_key, "-y") == 0) {
+                record_history = false;
+                current_key = NULL;
+            } else if (strcmp(current_key, "--stop-daemon") == 0 || strcmp(current_key, "-K") == 0) {
+                stop_daemon = true;
+                current_key = NULL;
+            } else if (strcmp(current_key, "--plan") == 0 || strcmp(current_key, "-E") == 0) {
+                plan_tests = true;
+                current_key = NULL;
 #ifndef _CLI
             } else if (strcmp(current_key, "--cli") == 0 || strcmp(current_key, "-c") == 0) {
                 ui_mode = test_ui_mode_cli;
@@ -78,6 +148,50 @@ int main(int argc, const char **argv) {
                 gpu_identifier = strtol(current_value, NULL, 10);
             } else if (strcmp(current_key, "--test") == 0 || strcmp(current_key, "-t") == 0) {
                 test_identifier = current_value;
+            } else if (strcmp(current_key, "--trials") == 0 || strcmp(current_key, "-n") == 0) {
+                _MainSetForwardedOption("trials", current_value);
+            } else if (strcmp(current_key, "--tolerance") == 0 || strcmp(current_key, "-e") == 0) {
+                _MainSetForwardedOption("tolerance", current_value);
+            } else if (strcmp(current_key, "--budget") == 0 || strcmp(current_key, "-b") == 0) {
+                _MainSetForwardedOption("budget", current_value);
+            } else if (strcmp(current_key, "--time-budget") == 0 || strcmp(current_key, "-B") == 0) {
+                time_budget_minutes = strtoull(current_value, NULL, 10);
+            } else if (strcmp(current_key, "--trace") == 0 || strcmp(current_key, "-x") == 0) {
+                trace_filepath = current_value;
+            } else if (strcmp(current_key, "--soak") == 0 || strcmp(current_key, "-k") == 0) {
+                _MainSetForwardedOption("soak", current_value);
+            } else if (strcmp(current_key, "--serialize") == 0 || strcmp(current_key, "-z") == 0) {
+                _MainSetForwardedOption("serialize", current_value);
+            } else if (strcmp(current_key, "--filter") == 0 || strcmp(current_key, "-F") == 0) {
+                _MainSetForwardedOption("filter", current_value);
+            } else if (strcmp(current_key, "--timeout") == 0 || strcmp(current_key, "-W") == 0) {
+                _MainSetForwardedOption("timeout", current_value);
+            } else if (strcmp(current_key, "--step-timeout") == 0 || strcmp(current_key, "-S") == 0) {
+                _MainSetForwardedOption("step-timeout", current_value);
+            } else if (strcmp(current_key, "--param") == 0 || strcmp(current_key, "-a") == 0) {
+                _MainSetForwardedParameter(current_value);
+            } else if (strcmp(current_key, "--manifest") == 0 || strcmp(current_key, "-f") == 0) {
+                manifest_filepath = current_value;
+            } else if (strcmp(current_key, "--manifest-entry") == 0 || strcmp(current_key, "-i") == 0) {
+                manifest_entry = strtol(current_value, NULL, 10);
+            } else if (strcmp(current_key, "--channel") == 0 || strcmp(current_key, "-l") == 0) {
+                channel_handle = current_value;
+            } else if (strcmp(current_key, "--checkpoint") == 0 || strcmp(current_key, "-P") == 0) {
+                checkpoint_filepath = current_value;
+                resume_checkpoint = false;
+            } else if (strcmp(current_key, "--resume") == 0 || strcmp(current_key, "-R") == 0) {
+                checkpoint_filepath = current_value;
+                resume_checkpoint = true;
+            } else if (strcmp(current_key, "--daemon") == 0 || strcmp(current_key, "-D") == 0) {
+                daemon_socket_path = current_value;
+            } else if (strcmp(current_key, "--connect") == 0 || strcmp(current_key, "-C") == 0) {
+                connect_socket_path = current_value;
+            } else if (strcmp(current_key, "--compare") == 0 || strcmp(current_key, "-g") == 0) {
+                compare_baseline = current_value;
+            } else if (strcmp(current_key, "--candidate") == 0 || strcmp(current_key, "-u") == 0) {
+                compare_candidate = current_value;
+            } else if (strcmp(current_key, "--threshold") == 0 || strcmp(current_key, "-T") == 0) {
+                compare_threshold = max(0.0, strtod(current_value, NULL));
 #ifndef _CLI
             } else if (strcmp(current_key, "--mode") == 0 || strcmp(current_key, "-m") == 0) {
                 if (strcmp(current_value, "cli") == 0) {
@@ -109,6 +223,9 @@ int main(int argc, const char **argv) {
         }
 #endif
     } else {
+        if (channel_handle != NULL && !TEST_SUCCESS(LoggerChannelOpen(channel_handle))) {
+            WARNING("Invalid result channel \"%s\", results are only logged\n", channel_handle);
+        }
         test_status status = RunnerRegisterTests();
         if (!TEST_SUCCESS(status)) {
             ABORT(status);
@@ -123,15 +240,144 @@ int main(int argc, const char **argv) {
             INFO("    --cli/-c: Shorthand for '--mode cli'\n");
 #endif
             INFO("    --device/-d <device id>: Specifies which device to run tests on. Default: -1\n");
-            INFO("    --test/-t <test id>: Specifies which test to run. Required\n");
+            INFO("    --test/-t <test ids>: Specifies which tests to run, as a comma separated list that may use * and ? wildcards. Required unless --manifest is given\n");
             INFO("    --csv/-s: Print final results in CSV format. Optional\n");
             INFO("    --raw/-r: Print final results in raw format. Optional\n");
+            INFO("    --json/-j: Print one JSON object per line for every measurement, with device, parameters, statistics and samples. Each is printed as soon as it is measured and again with \"final\":true when its test ends. Optional\n");
+            INFO("    --filter/-F <expression>: Only run tests matching the expression, on top of --test. Comma separated alternatives of terms joined by '+', a term is a name or '@tag' pattern and may start with '!' to exclude. Example: '@rate+@fp*+!@fp64,@latency'. Makes --test optional\n");
+            INFO("    --trials/-n <count>: Minimum number of repeated measurements used for result statistics. Default: %lu\n", STATISTICS_DEFAULT_TRIAL_COUNT);
+            INFO("    --tolerance/-e <percent>: Keep sampling until the 95%% confidence interval is within this percentage of the mean. Default: %.1f\n", CONVERGENCE_DEFAULT_TOLERANCE);
+            INFO("    --budget/-b <ms>: Maximum time spent on a single measurement before giving up on convergence. Default: %lu\n", CONVERGENCE_DEFAULT_BUDGET_MS);
+            INFO("    --time-budget/-B <minutes>: Fit the whole run into this much time. Measurements get budgets from the estimate of every selected test instead of --budget, noisy ones more than stable ones. Default: 0 (off)\n");
+            INFO("    --plan/-E: Print the predicted time of every selected test on every device instead of running anything, and which of them fit into --time-budget. Honors --manifest and --csv\n");
+            INFO("    --host-timer/-w: Time kernels with the host clock instead of GPU timestamps. Optional\n");
+            INFO("    --subtract-overhead/-o: Subtract the calibrated per-submit overhead from kernel timings. Optional\n");
+            INFO("    --validate-invocations/-v: Count compute shader invocations and flag results where they don't match the assumed work. Optional\n");
+            INFO("    --soak/-k <minutes>: Hold the heaviest configuration of bandwidth and rate tests for this long and report throttling. Default: 0 (off)\n");
+            INFO("    --parallel-devices/-p: With '--device -1', run the tests on every device at once, one worker pinned to its own processors per device. Optional\n");
+            INFO("    --serialize/-z <test ids>: Tests that never run next to each other with '--parallel-devices', in addition to the uplink tests. Same syntax as --test. Optional\n");
+            INFO("    --timeout/-W <seconds>: Fail a test that runs longer than this, the process is ended if the test doesn't stop within %lus after that, once the other devices of a parallel run are done. Not available with --daemon. Default: 0 (off)\n", WATCHDOG_GRACE_MS / 1000);
+            INFO("    --step-timeout/-S <ms>: Fail a test when the GPU doesn't finish a single submission within this time. Default: %lu, 0 waits forever\n", WATCHDOG_DEFAULT_STEP_TIMEOUT_MS);
+            INFO("    --param/-a <name>=<value>: Override a test parameter listed below, may be given more than once. Optional\n");
+            INFO("    --manifest/-f <file>: Run the test plan in <file>. Each [tests] section takes 'device', 'repeat', the options filter, trials, tolerance, budget, soak, timeout, step-timeout, serialize, host-timer, subtract-overhead, validate-invocations and parallel-devices, and test parameters as 'key = value'. Makes --test optional\n");
+            INFO("    --manifest-entry/-i <index>: Run only this entry of the manifest, once. Default: -1 (all)\n");
+            INFO("    --trace/-x <file>: Write a Chrome trace of command buffer, transfer and GPU activity to <file>. Optional\n");
+            INFO("    --checkpoint/-P <file>: Record finished tests, sweep regions and calibrated loop counts in <file> as they complete. Optional\n");
+            INFO("    --resume/-R <file>: Continue the run a --checkpoint or --resume <file> was recording. Finished regions and tests are replayed instead of measured, give the same arguments as the interrupted run\n");
+            INFO("    --channel/-l <handle>: Also send results, progress and errors as binary records to this inherited pipe. Used by the GUI. Optional\n");
+            INFO("    --daemon/-D <socket>: Keep the instance and devices warm and serve requests from --connect on this local socket until one asks it to stop. Results are streamed back as they are measured\n");
+            INFO("    --connect/-C <socket>: Send --test, --device, --filter, --param and the other test options to the daemon on this socket instead of running locally\n");
+            INFO("    --stop-daemon/-K: With --connect, ask the daemon to exit after the request. Makes --test optional\n");
+            INFO("    --history/-q: Print the recorded runs of the tests given by --test (all if omitted) on the device given by --device (all if -1) instead of running anything. Honors --csv\n");
+            INFO("    --no-history/-y: Don't record this run in the local result history. Optional\n");
+            INFO("    --compare/-g <set>: Compare --candidate against this baseline instead of running anything, exits with 2 on a regression. A set is a file of --json output, 'history' (latest runs), 'history@previous' or 'history@driver=<version>'. Honors --test, --device and --csv\n");
+            INFO("    --candidate/-u <set>: The set checked against --compare. Default: %s\n", COMPARE_DEFAULT_CANDIDATE);
+            INFO("    --threshold/-T <percent>: How far a median has to move, on top of being statistically significant, to count as a change. Default: %.1f\n", COMPARE_DEFAULT_THRESHOLD);
             INFO("TESTS:\n");
             RunnerPrintTests();
+            INFO("PARAMETERS:\n");
+            ParametersPrint();
+            SEPARATOR();
+        } else if (compare_baseline != NULL) {
+            status = RunnerCompareResults(compare_baseline, compare_candidate, test_identifier, gpu_identifier, compare_threshold);
+            SEPARATOR();
+            /* Tells a failed gate apart from a comparison that couldn't run */
+            if (status == TEST_REGRESSION_DETECTED) {
+                return 2;
+            } else if (!TEST_SUCCESS(status)) {
+                ABORT(status);
+                return 1;
+            }
+        } else if (connect_socket_path != NULL) {
+            strncpy(forwarded_settings.tests, (test_identifier != NULL) ? test_identifier : "", sizeof(forwarded_settings.tests) - 1);
+            forwarded_settings.device_id = gpu_identifier;
+            status = DaemonRequest(connect_socket_path, &forwarded_settings, stop_daemon);
+            SEPARATOR();
+            if (!TEST_SUCCESS(status)) {
+                ABORT(status);
+                return 1;
+            }
+        } else if (daemon_socket_path != NULL) {
+            if (record_history && !TEST_SUCCESS(HistoryInitialize())) {
+                WARNING("Failed to set up the result history, requests won't be recorded\n");
+            }
+            if (options.test_timeout_seconds != 0) {
+                FATAL("--timeout can't be used with --daemon, a stuck test would end the daemon\n");
+                return 1;
+            }
+            /* Only raw results are sent over the channel */
+            result_format = test_result_raw;
+            status = DaemonRun(daemon_socket_path);
+            SEPARATOR();
+            if (!TEST_SUCCESS(status)) {
+                ABORT(status);
+                return 1;
+            }
+        } else if (plan_tests) {
+            if (!TEST_SUCCESS(HistoryInitialize())) {
+                WARNING("Failed to open the result history, every step is estimated at the trial count\n");
+            }
+            if (test_identifier == NULL && manifest_filepath == NULL && MainGetTestFilter() != NULL) {
+                test_identifier = "*";
+            }
+            if (test_identifier == NULL && manifest_filepath == NULL) {
+                status = TEST_NO_TEST_SPECIFIED;
+            } else {
+                status = _MainPlanTests(manifest_filepath, manifest_entry, test_identifier, gpu_identifier, time_budget_minutes * 60000000ULL, false);
+            }
+            SEPARATOR();
+            if (!TEST_SUCCESS(status)) {
+                ABORT(status);
+                return 1;
+            }
+        } else if (print_history) {
+            status = RunnerPrintHistory(test_identifier, gpu_identifier);
+            if (!TEST_SUCCESS(status)) {
+                ABORT(status);
+                SEPARATOR();
+                return 1;
+            }
             SEPARATOR();
         } else {
-            if (test_identifier != NULL) {
-                status = RunnerExecuteTests(test_identifier, gpu_identifier);
+            if (record_history && !TEST_SUCCESS(HistoryInitialize())) {
+                WARNING("Failed to set up the result history, this run won't be recorded\n");
+            }
+            if (test_identifier == NULL && manifest_filepath == NULL && MainGetTestFilter() != NULL) {
+                test_identifier = "*";
+            }
+            if (test_identifier != NULL || manifest_filepath != NULL) {
+                if (time_budget_minutes > 0) {
+                    status = _MainPlanTests(manifest_filepath, manifest_entry, test_identifier, gpu_identifier, time_budget_minutes * 60000000ULL, true);
+                    if (!TEST_SUCCESS(status)) {
+                        ABORT(status);
+                        SEPARATOR();
+                        return 1;
+                    }
+                    SEPARATOR();
+                }
+                if (checkpoint_filepath != NULL) {
+                    status = CheckpointInitialize(checkpoint_filepath, resume_checkpoint);
+                    if (!TEST_SUCCESS(status)) {
+                        FATAL("Failed to open the checkpoint %s\n", checkpoint_filepath);
+                        ABORT(status);
+                        SEPARATOR();
+                        return 1;
+                    }
+                }
+                if (trace_filepath != NULL) {
+                    status = TimelineInitialize(trace_filepath);
+                    if (!TEST_SUCCESS(status)) {
+                        ABORT(status);
+                        SEPARATOR();
+                        return 1;
+                    }
+                }
+                status = _MainExecuteTests(manifest_filepath, manifest_entry, test_identifier, gpu_identifier);
+                /* Write the trace even if a test failed, it is most useful exactly then */
+                test_status trace_status = TimelineFinish();
+                if (TEST_SUCCESS(status)) {
+                    status = trace_status;
+                }
                 if (!TEST_SUCCESS(status)) {
                     ABORT(status);
                     SEPARATOR();
@@ -145,6 +391,15 @@ int main(int argc, const char **argv) {
             SEPARATOR();
         }
         RunnerCleanUp();
+        ParametersCleanUp();
+        ResultsCleanUp();
+        HistoryCleanUp();
+        CheckpointCleanUp();
+        PlannerCleanUp();
+        LoggerChannelClose();
+    }
+    if (HelperArrayListRawData(&(forwarded_settings.settings)) != NULL) {
+        HelperArrayListClean(&(forwarded_settings.settings));
     }
     return 0;
 }
@@ -153,6 +408,101 @@ test_result_output MainGetTestResultFormat() {
     return result_format;
 }
 
+bool MainGetUseHostTimer() {
+    return options.use_host_timer;
+}
+
+bool MainGetSubtractOverhead() {
+    return options.subtract_overhead;
+}
+
+bool MainGetValidateInvocations() {
+    return options.validate_invocations;
+}
+
+uint32_t MainGetSoakMinutes() {
+    return options.soak_minutes;
+}
+
+bool MainGetParallelDevices() {
+    return options.parallel_devices;
+}
+
+const char *MainGetSerializedTests() {
+    return options.serialized_tests;
+}
+
+const char *MainGetTestFilter() {
+    return options.test_filter;
+}
+
+uint32_t MainGetTrialCount() {
+    return options.trial_count;
+}
+
+double MainGetConvergenceTolerance() {
+    return options.convergence_tolerance;
+}
+
+uint64_t MainGetConvergenceBudget() {
+    return options.convergence_budget;
+}
+
+uint32_t MainGetStepTimeout() {
+    return options.step_timeout_ms;
+}
+
+uint32_t MainGetTestTimeout() {
+    return options.test_timeout_seconds;
+}
+
+void MainGetOptions(main_options *saved_options) {
+    *saved_options = options;
+}
+
+void MainSetOptions(const main_options *saved_options) {
+    options = *saved_options;
+}
+
+/* Names are the long command line options without the dashes, flags take true/false */
+test_status MainSetOption(const char *name, const char *value) {
+    if (name == NULL || value == NULL) {
+        return TEST_INVALID_PARAMETER;
+    }
+    bool flag = (strcmp(value, "true") == 0 || strcmp(value, "yes") == 0 || strcmp(value, "on") == 0 || strcmp(value, "1") == 0);
+    if (strcmp(name, "host-timer") == 0) {
+        options.use_host_timer = flag;
+    } else if (strcmp(name, "subtract-overhead") == 0) {
+        options.subtract_overhead = flag;
+    } else if (strcmp(name, "validate-invocations") == 0) {
+        options.validate_invocations = flag;
+    } else if (strcmp(name, "parallel-devices") == 0) {
+        options.parallel_devices = flag;
+    } else if (strcmp(name, "trials") == 0) {
+        options.trial_count = (uint32_t)strtoul(value, NULL, 10);
+        options.trial_count = max(1, min(options.trial_count, STATISTICS_MAXIMUM_TRIAL_COUNT));
+    } else if (strcmp(name, "tolerance") == 0) {
+        options.convergence_tolerance = strtod(value, NULL);
+        options.convergence_tolerance = max(0.0, options.convergence_tolerance);
+    } else if (strcmp(name, "budget") == 0) {
+        options.convergence_budget = strtoull(value, NULL, 10);
+    } else if (strcmp(name, "soak") == 0) {
+        options.soak_minutes = (uint32_t)strtoul(value, NULL, 10);
+        options.soak_minutes = min(options.soak_minutes, SOAK_MAXIMUM_MINUTES);
+    } else if (strcmp(name, "timeout") == 0) {
+        options.test_timeout_seconds = (uint32_t)strtoul(value, NULL, 10);
+    } else if (strcmp(name, "step-timeout") == 0) {
+        options.step_timeout_ms = (uint32_t)strtoul(value, NULL, 10);
+    } else if (strcmp(name, "serialize") == 0) {
+        options.serialized_tests = value;
+    } else if (strcmp(name, "filter") == 0) {
+        options.test_filter = value;
+    } else {
+        return TEST_UNKNOWN_OPTION;
+    }
+    return TEST_OK;
+}
+
 const char *MainGetBinaryPath() {
     return binary_path;
 }
@@ -168,4 +518,55 @@ void MainToggleConsoleWindow() {
     ShowWindow(GetConsoleWindow(), console_visible ? SW_HIDE : SW_SHOW);
 #endif
     console_visible = !console_visible;
+}
+
+/* Everything the command line sets is also kept as manifest style settings, --connect hands them to the daemon */
+static void _MainSetForwardedOption(const char *name, const char *value) {
+    MainSetOption(name, value);
+    if (strlen(value) >= MANIFEST_MAXIMUM_VALUE_LENGTH) {
+        WARNING("Value of %s is too long to forward to a daemon\n", name);
+        return;
+    }
+    manifest_setting setting;
+    memset(&setting, 0, sizeof(setting));
+    strcpy(setting.key, name);
+    strcpy(setting.value, value);
+    HelperArrayListAdd(&(forwarded_settings.settings), &setting, sizeof(setting), NULL);
+}
+
+static void _MainSetForwardedParameter(const char *assignment) {
+    ParametersSetAssignment(assignment);
+    const char *separator = strchr(assignment, '=');
+    if (separator == NULL || (size_t)(separator - assignment) >= MANIFEST_MAXIMUM_KEY_LENGTH || strlen(separator + 1) >= MANIFEST_MAXIMUM_VALUE_LENGTH) {
+        return;
+    }
+    manifest_setting setting;
+    memset(&setting, 0, sizeof(setting));
+    memcpy(setting.key, assignment, (size_t)(separator - assignment));
+    strcpy(setting.value, separator + 1);
+    HelperArrayListAdd(&(forwarded_settings.settings), &setting, sizeof(setting), NULL);
+}
+
+static test_status _MainExecuteTests(const char *manifest_filepath, int32_t manifest_entry, const char *test_identifier, int32_t gpu_identifier) {
+    if (manifest_filepath == NULL) {
+        return RunnerExecuteTests(test_identifier, gpu_identifier);
+    }
+    manifest test_plan;
+    test_status status = ManifestLoad(manifest_filepath, &test_plan);
+    TEST_RETFAIL(status);
+    status = ManifestExecute(&test_plan, manifest_entry, test_identifier, gpu_identifier);
+    ManifestCleanUp(&test_plan);
+    return status;
+}
+
+/* The same selection the run makes goes through the estimators, a --time-budget run is scheduled from what they predict */
+static test_status _MainPlanTests(const char *manifest_filepath, int32_t manifest_entry, const char *test_identifier, int32_t gpu_identifier, uint64_t budget_us, bool schedule) {
+    test_status status = PlannerInitialize();
+    TEST_RETFAIL(status);
+    status = _MainExecuteTests(manifest_filepath, manifest_entry, test_identifier, gpu_identifier);
+    TEST_RETFAIL(status);
+    SEPARATOR();
+    INFO("Plan:\n");
+    PlannerPrint(budget_us);
+    return schedule ? PlannerStartSchedule(budget_us) : TEST_OK;
 }
\ No newline at end of file
@@ -0,0 +1,289 @@
+// Copyright (c) 2021 - 2022, Nemes <nemes@nemez.net>
+// SPDX-License-Identifier: MIT
+// 
+// MIT License
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software andassociated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, andto permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+// 
+// The above copyright notice andthis permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "main.h"
+#include "logger.h"
+#include "helper.h"
+#include "runner.h"
+#include "parameters.h"
+#include "manifest.h"
+#include "planner.h"
+#include <ctype.h>
+
+#define MANIFEST_SYNTAX_ERROR(manifest, line, format, ...)  FATAL("%s:%lu: " format, (manifest)->filepath, line, ##__VA_ARGS__)
+
+static char *_ManifestTrim(char *string);
+static test_status _ManifestParseLine(manifest *manifest, char *line, uint32_t line_number, manifest_entry *defaults, manifest_entry **current);
+static test_status _ManifestCleanUpEntry(manifest_entry *entry);
+
+/*
+ * INI style: every [section] names tests the way --test does and becomes one entry, run in file order.
+ * device and repeat are handled here, command line options are given by their long name and anything
+ * else is a test parameter. Keys set under [defaults] apply to every entry that follows it.
+ */
+test_status ManifestLoad(const char *filepath, manifest *manifest) {
+    if (filepath == NULL || manifest == NULL) {
+        return TEST_INVALID_PARAMETER;
+    }
+    memset(manifest, 0, sizeof(*manifest));
+    manifest->filepath = filepath;
+    const char *data = NULL;
+    size_t size = 0;
+    test_status status = HelperLoadFile(filepath, &data, &size);
+    if (!TEST_SUCCESS(status)) {
+        FATAL("Failed to read manifest %s\n", filepath);
+        return status;
+    }
+
+    manifest_entry defaults;
+    memset(&defaults, 0, sizeof(defaults));
+    defaults.device_id = -1;
+    defaults.repeat = 1;
+    manifest_entry *current = &defaults;
+    const char *line_start = data;
+    /* Editors on Windows like to start files with a byte order mark */
+    if (size >= 3 && memcmp(line_start, "\xEF\xBB\xBF", 3) == 0) {
+        line_start += 3;
+    }
+    uint32_t line_number = 0;
+    while (TEST_SUCCESS(status) && line_start < data + size) {
+        line_number++;
+        size_t line_length = strcspn(line_start, "\n");
+        if (line_length >= MANIFEST_MAXIMUM_LINE_LENGTH) {
+            MANIFEST_SYNTAX_ERROR(manifest, line_number, "Line is longer than %lu characters\n", MANIFEST_MAXIMUM_LINE_LENGTH - 1);
+            status = TEST_MANIFEST_SYNTAX_ERROR;
+            break;
+        }
+        char line[MANIFEST_MAXIMUM_LINE_LENGTH];
+        memcpy(line, line_start, line_length);
+        line[line_length] = '\0';
+        status = _ManifestParseLine(manifest, line, line_number, &defaults, &current);
+        line_start += line_length + 1;
+    }
+    free((void *)data);
+    _ManifestCleanUpEntry(&defaults);
+    if (TEST_SUCCESS(status) && ManifestGetEntryCount(manifest) == 0) {
+        FATAL("Manifest %s doesn't list any tests\n", filepath);
+        status = TEST_NO_TEST_SPECIFIED;
+    }
+    if (!TEST_SUCCESS(status)) {
+        ManifestCleanUp(manifest);
+    }
+    return status;
+}
+
+size_t ManifestGetEntryCount(manifest *manifest) {
+    return HelperArrayListSize(&(manifest->entries));
+}
+
+manifest_entry *ManifestGetEntry(manifest *manifest, size_t index) {
+    return (manifest_entry *)HelperArrayListGet(&(manifest->entries), index);
+}
+
+/* ManifestRestoreEntry undoes everything, entries never leak into each other */
+test_status ManifestApplyEntry(manifest_entry *entry, manifest_saved_state *saved_state) {
+    MainGetOptions(&(saved_state->options));
+    saved_state->parameter_count = ParametersGetOverrideCount();
+    size_t setting_count = HelperArrayListSize(&(entry->settings));
+    for (size_t i = 0; i < setting_count; i++) {
+        manifest_setting *setting = (manifest_setting *)HelperArrayListGet(&(entry->settings), i);
+        test_status status = MainSetOption(setting->key, setting->value);
+        if (status == TEST_UNKNOWN_OPTION) {
+            status = ParametersSet(setting->key, setting->value);
+        }
+        if (!TEST_SUCCESS(status)) {
+            ManifestRestoreEntry(saved_state);
+            return status;
+        }
+    }
+    return TEST_OK;
+}
+
+void ManifestRestoreEntry(const manifest_saved_state *saved_state) {
+    MainSetOptions(&(saved_state->options));
+    ParametersRestore(saved_state->parameter_count);
+}
+
+/*
+ * test_names and device_id override what the entries say unless they are NULL and -1.
+ * A single entry only runs once, whoever picked it is expected to take care of repetitions.
+ */
+test_status ManifestExecute(manifest *manifest, int32_t entry_index, const char *test_names, int32_t device_id) {
+    size_t entry_count = ManifestGetEntryCount(manifest);
+    if (entry_index != MANIFEST_ALL_ENTRIES && (entry_index < 0 || (size_t)entry_index >= entry_count)) {
+        FATAL("Manifest %s has no entry %ld\n", manifest->filepath, entry_index);
+        return TEST_OUT_OF_RANGE;
+    }
+    size_t first_entry = (entry_index == MANIFEST_ALL_ENTRIES) ? 0 : (size_t)entry_index;
+    size_t last_entry = (entry_index == MANIFEST_ALL_ENTRIES) ? entry_count : first_entry + 1;
+    /* Catch typos before the first test runs rather than hours into the plan */
+    for (size_t i = first_entry; i < last_entry; i++) {
+        manifest_entry *entry = ManifestGetEntry(manifest, i);
+        test_status status = RunnerValidateTests((test_names != NULL) ? test_names : entry->tests);
+        if (!TEST_SUCCESS(status)) {
+            MANIFEST_SYNTAX_ERROR(manifest, entry->line, "Section [%s] doesn't select any test\n", entry->tests);
+            return status;
+        }
+    }
+
+    test_status status = TEST_OK;
+    uint32_t *failures = malloc(entry_count * sizeof(uint32_t));
+    if (failures == NULL) {
+        return TEST_OUT_OF_MEMORY;
+    }
+    memset(failures, 0, entry_count * sizeof(uint32_t));
+    for (size_t i = first_entry; i < last_entry; i++) {
+        manifest_entry *entry = ManifestGetEntry(manifest, i);
+        uint32_t repeat = (entry_index == MANIFEST_ALL_ENTRIES) ? entry->repeat : 1;
+        for (uint32_t j = 0; j < repeat; j++) {
+            SEPARATOR();
+            INFO("Manifest entry [%s], run %lu of %lu\n", entry->tests, j + 1, repeat);
+            manifest_saved_state saved_state;
+            test_status run_status = ManifestApplyEntry(entry, &saved_state);
+            if (TEST_SUCCESS(run_status)) {
+                run_status = RunnerExecuteTests((test_names != NULL) ? test_names : entry->tests, (device_id != -1) ? device_id : entry->device_id);
+                ManifestRestoreEntry(&saved_state);
+            }
+            if (!TEST_SUCCESS(run_status)) {
+                WARNING("Manifest entry [%s] failed: 0x%08lx %s\n", entry->tests, run_status, LoggerLookUpError(run_status));
+                failures[i]++;
+                if (TEST_SUCCESS(status)) {
+                    status = run_status;
+                }
+            }
+        }
+    }
+    /* Nothing ran while the plan was being estimated */
+    if (entry_index == MANIFEST_ALL_ENTRIES && !PlannerIsEstimating()) {
+        SEPARATOR();
+        INFO("Manifest results:\n");
+        for (size_t i = 0; i < entry_count; i++) {
+            manifest_entry *entry = ManifestGetEntry(manifest, i);
+            INFO("    [%s]: %lu of %lu runs succeeded\n", entry->tests, entry->repeat - failures[i], entry->repeat);
+        }
+    }
+    free(failures);
+    return status;
+}
+
+void ManifestCleanUp(manifest *manifest) {
+    size_t entry_count = ManifestGetEntryCount(manifest);
+    for (size_t i = 0; i < entry_count; i++) {
+        _ManifestCleanUpEntry(ManifestGetEntry(manifest, i));
+    }
+    if (HelperArrayListRawData(&(manifest->entries)) != NULL) {
+        HelperArrayListClean(&(manifest->entries));
+    }
+}
+
+static char *_ManifestTrim(char *string) {
+    while (isspace((unsigned char)*string)) {
+        string++;
+    }
+    size_t length = strlen(string);
+    while (length > 0 && isspace((unsigned char)string[length - 1])) {
+        string[--length] = '\0';
+    }
+    return string;
+}
+
+static test_status _ManifestParseLine(manifest *manifest, char *line, uint32_t line_number, manifest_entry *defaults, manifest_entry **current) {
+    char *content = _ManifestTrim(line);
+    if (*content == '\0' || *content == ';' || *content == '#') {
+        return TEST_OK;
+    }
+    size_t content_length = strlen(content);
+    if (*content == '[') {
+        if (content[content_length - 1] != ']') {
+            MANIFEST_SYNTAX_ERROR(manifest, line_number, "Unterminated section header\n");
+            return TEST_MANIFEST_SYNTAX_ERROR;
+        }
+        content[content_length - 1] = '\0';
+        char *name = _ManifestTrim(content + 1);
+        if (*name == '\0' || strlen(name) >= MANIFEST_MAXIMUM_VALUE_LENGTH) {
+            MANIFEST_SYNTAX_ERROR(manifest, line_number, "Section name is empty or too long\n");
+            return TEST_MANIFEST_SYNTAX_ERROR;
+        }
+        if (strcmp(name, MANIFEST_DEFAULTS_SECTION) == 0) {
+            *current = defaults;
+            return TEST_OK;
+        }
+        manifest_entry entry;
+        memset(&entry, 0, sizeof(entry));
+        strcpy(entry.tests, name);
+        entry.device_id = defaults->device_id;
+        entry.repeat = defaults->repeat;
+        entry.line = line_number;
+        if (HelperArrayListRawData(&(defaults->settings)) != NULL) {
+            test_status status = HelperArrayListCopy(&(entry.settings), &(defaults->settings));
+            TEST_RETFAIL(status);
+        }
+        size_t index = 0;
+        test_status status = HelperArrayListAdd(&(manifest->entries), &entry, sizeof(entry), &index);
+        if (!TEST_SUCCESS(status)) {
+            _ManifestCleanUpEntry(&entry);
+            return status;
+        }
+        *current = ManifestGetEntry(manifest, index);
+        return TEST_OK;
+    }
+
+    char *separator = strchr(content, '=');
+    if (separator == NULL) {
+        MANIFEST_SYNTAX_ERROR(manifest, line_number, "Expected a [section] or key = value\n");
+        return TEST_MANIFEST_SYNTAX_ERROR;
+    }
+    *separator = '\0';
+    char *key = _ManifestTrim(content);
+    char *value = _ManifestTrim(separator + 1);
+    size_t value_length = strlen(value);
+    if (value_length >= 2 && value[0] == '"' && value[value_length - 1] == '"') {
+        value[value_length - 1] = '\0';
+        value++;
+    }
+    if (*key == '\0' || strlen(key) >= MANIFEST_MAXIMUM_KEY_LENGTH || strlen(value) >= MANIFEST_MAXIMUM_VALUE_LENGTH) {
+        MANIFEST_SYNTAX_ERROR(manifest, line_number, "Key is empty or key or value are too long\n");
+        return TEST_MANIFEST_SYNTAX_ERROR;
+    }
+    if (strcmp(key, "device") == 0) {
+        (*current)->device_id = strtol(value, NULL, 10);
+        return TEST_OK;
+    }
+    if (strcmp(key, "repeat") == 0) {
+        /* 0 keeps an entry in the plan without running it */
+        (*current)->repeat = min((uint32_t)strtoul(value, NULL, 10), MANIFEST_MAXIMUM_REPEAT);
+        return TEST_OK;
+    }
+    manifest_setting setting;
+    memset(&setting, 0, sizeof(setting));
+    strcpy(setting.key, key);
+    strcpy(setting.value, value);
+    return HelperArrayListAdd(&((*current)->settings), &setting, sizeof(setting), NULL);
+}
+
+static test_status _ManifestCleanUpEntry(manifest_entry *entry) {
+    if (HelperArrayListRawData(&(entry->settings)) != NULL) {
+        return HelperArrayListClean(&(entry->settings));
+    }
+    return TEST_OK;
+}
\ No newline at end of file
@@ -0,0 +1,218 @@
+// Copyright (c) 2021 - 2022, Nemes <nemes@nemez.net>
+// SPDX-License-Identifier: MIT
+// 
+// MIT License
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software andassociated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, andto permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+// 
+// The above copyright notice andthis permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "main.h"
+#include "logger.h"
+#include "helper.h"
+#include "parameters.h"
+#include "statistics.h"
+#include "results.h"
+#include <ctype.h>
+
+/* Both are filled before any test starts and only read while tests run, so workers on other devices can share them */
+static helper_arraylist parameter_declarations;
+static helper_arraylist parameter_overrides;
+
+static parameters_override *_ParametersFind(const char *name);
+static bool _ParametersIsDeclared(const char *name);
+
+test_status ParametersDeclare(const char *test_pattern, const parameters_definition *definitions, uint32_t definition_count) {
+    if (test_pattern == NULL || definitions == NULL || definition_count == 0) {
+        return TEST_INVALID_PARAMETER;
+    }
+    parameters_declaration declaration;
+    declaration.test_pattern = test_pattern;
+    declaration.definitions = definitions;
+    declaration.definition_count = definition_count;
+    return HelperArrayListAdd(&parameter_declarations, &declaration, sizeof(declaration), NULL);
+}
+
+/* Overrides are only ever appended, the latest one for a name wins and ParametersRestore drops everything after a point */
+test_status ParametersSet(const char *name, const char *value) {
+    if (name == NULL || value == NULL || strlen(name) >= PARAMETERS_MAXIMUM_NAME_LENGTH || strlen(value) >= PARAMETERS_MAXIMUM_VALUE_LENGTH) {
+        return TEST_INVALID_PARAMETER;
+    }
+    parameters_override entry;
+    memset(&entry, 0, sizeof(entry));
+    strcpy(entry.name, name);
+    strcpy(entry.value, value);
+    return HelperArrayListAdd(&parameter_overrides, &entry, sizeof(entry), NULL);
+}
+
+/* name=value, as given to --param */
+test_status ParametersSetAssignment(const char *assignment) {
+    const char *separator = strchr(assignment, '=');
+    size_t name_length = (separator != NULL) ? (size_t)(separator - assignment) : 0;
+    if (name_length == 0 || name_length >= PARAMETERS_MAXIMUM_NAME_LENGTH) {
+        WARNING("Ignoring parameter \"%s\", expected name=value\n", assignment);
+        return TEST_INVALID_PARAMETER;
+    }
+    char name[PARAMETERS_MAXIMUM_NAME_LENGTH];
+    memcpy(name, assignment, name_length);
+    name[name_length] = '\0';
+    return ParametersSet(name, separator + 1);
+}
+
+size_t ParametersGetOverrideCount() {
+    return HelperArrayListSize(&parameter_overrides);
+}
+
+void ParametersRestore(size_t override_count) {
+    HelperArrayListTruncate(&parameter_overrides, override_count);
+}
+
+/* A typo in a name would otherwise silently measure the defaults */
+test_status ParametersValidate() {
+    size_t count = HelperArrayListSize(&parameter_overrides);
+    for (size_t i = 0; i < count; i++) {
+        parameters_override *entry = (parameters_override *)HelperArrayListGet(&parameter_overrides, i);
+        if (!_ParametersIsDeclared(entry->name)) {
+            FATAL("No test takes a parameter called \"%s\", see --help\n", entry->name);
+            return TEST_UNKNOWN_OPTION;
+        }
+    }
+    return TEST_OK;
+}
+
+/* Decimal or 0x hexadecimal, out of range values are clamped */
+uint64_t ParametersGet(const parameters_definition *definition) {
+    parameters_override *entry = _ParametersFind(definition->name);
+    if (entry == NULL) {
+        return definition->default_value;
+    }
+    char *end = NULL;
+    uint64_t value = strtoull(entry->value, &end, 0);
+    const char *suffixes = "KMGT";
+    const char *suffix = (*end != '\0' && definition->type != parameters_type_integer) ? strchr(suffixes, toupper(*end)) : NULL;
+    if (suffix != NULL) {
+        value <<= 10 * (suffix - suffixes + 1);
+        end++;
+    }
+    if (end == entry->value || *end != '\0') {
+        WARNING("Parameter %s = \"%s\" is not a valid number, using %llu\n", definition->name, entry->value, definition->default_value);
+        return definition->default_value;
+    }
+    if (value < definition->minimum || value > definition->maximum) {
+        uint64_t clamped = max(definition->minimum, min(value, definition->maximum));
+        WARNING("Parameter %s = %llu is outside of [%llu, %llu], using %llu\n", definition->name, value, definition->minimum, definition->maximum, clamped);
+        value = clamped;
+    }
+    if (definition->type == parameters_type_power_of_two && value != 0 && (value & (value - 1)) != 0) {
+        uint64_t rounded = HelperFindLargestPowerOfTwo(value);
+        WARNING("Parameter %s = %llu is not a power of two, using %llu\n", definition->name, value, rounded);
+        value = rounded;
+    }
+    return value;
+}
+
+void ParametersGetAll(const parameters_definition *definitions, uint32_t definition_count, uint64_t *values) {
+    for (uint32_t i = 0; i < definition_count; i++) {
+        values[i] = ParametersGet(&(definitions[i]));
+    }
+}
+
+/* values are what the test ended up using, device limits may have lowered what was asked for */
+void ParametersLogResult(const parameters_definition *definitions, const uint64_t *values, uint32_t definition_count) {
+    for (uint32_t i = 0; i < definition_count; i++) {
+        uint64_t value = values[i];
+        if (MainGetTestResultFormat() == test_result_csv) {
+            LOG_PLAIN("Parameter %s,%llu\n", definitions[i].name, value);
+        } else if (MainGetTestResultFormat() == test_result_raw) {
+            LOG("RMETA", "param.%s = %llu\n", definitions[i].name, value);
+        } else if (MainGetTestResultFormat() == test_result_json) {
+            ResultsAddParameter(definitions[i].name, value);
+        } else {
+            INFO("Parameter %s: %llu%s\n", definitions[i].name, value, (value == definitions[i].default_value) ? "" : " (overridden)");
+        }
+    }
+}
+
+/*
+ * Folds what every parameter the test reads is set to into hash. An override is hashed as written, so only
+ * respelling the same value tells two runs apart where they didn't need to be.
+ */
+uint64_t ParametersHash(const char *test_name, uint64_t hash) {
+    size_t count = HelperArrayListSize(&parameter_declarations);
+    for (size_t i = 0; i < count; i++) {
+        parameters_declaration *declaration = (parameters_declaration *)HelperArrayListGet(&parameter_declarations, i);
+        if (!HelperMatchPatternList(declaration->test_pattern, test_name)) {
+            continue;
+        }
+        for (uint32_t j = 0; j < declaration->definition_count; j++) {
+            const parameters_definition *definition = &(declaration->definitions[j]);
+            hash = HelperHash(hash, definition->name, strlen(definition->name) + 1);
+            parameters_override *entry = _ParametersFind(definition->name);
+            if (entry != NULL) {
+                hash = HelperHash(hash, entry->value, strlen(entry->value) + 1);
+            } else {
+                hash = HelperHash(hash, &(definition->default_value), sizeof(definition->default_value));
+            }
+        }
+    }
+    return hash;
+}
+
+void ParametersPrint() {
+    size_t count = HelperArrayListSize(&parameter_declarations);
+    for (size_t i = 0; i < count; i++) {
+        parameters_declaration *declaration = (parameters_declaration *)HelperArrayListGet(&parameter_declarations, i);
+        INFO("    %s:\n", declaration->test_pattern);
+        for (uint32_t j = 0; j < declaration->definition_count; j++) {
+            const parameters_definition *definition = &(declaration->definitions[j]);
+            INFO("        %s: %s. Default: %llu, range: [%llu, %llu]\n", definition->name, definition->description, definition->default_value, definition->minimum, definition->maximum);
+        }
+    }
+}
+
+void ParametersCleanUp() {
+    if (HelperArrayListRawData(&parameter_overrides) != NULL) {
+        HelperArrayListClean(&parameter_overrides);
+    }
+    if (HelperArrayListRawData(&parameter_declarations) != NULL) {
+        HelperArrayListClean(&parameter_declarations);
+    }
+}
+
+static parameters_override *_ParametersFind(const char *name) {
+    size_t count = HelperArrayListSize(&parameter_overrides);
+    for (size_t i = count; i > 0; i--) {
+        parameters_override *entry = (parameters_override *)HelperArrayListGet(&parameter_overrides, i - 1);
+        if (strcmp(entry->name, name) == 0) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+static bool _ParametersIsDeclared(const char *name) {
+    size_t count = HelperArrayListSize(&parameter_declarations);
+    for (size_t i = 0; i < count; i++) {
+        parameters_declaration *declaration = (parameters_declaration *)HelperArrayListGet(&parameter_declarations, i);
+        for (uint32_t j = 0; j < declaration->definition_count; j++) {
+            if (strcmp(declaration->definitions[j].name, name) == 0) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
\ No newline at end of file
@@ -0,0 +1,303 @@
+// Copyright (c) 2021 - 2022, Nemes <nemes@nemez.net>
+// SPDX-License-Identifier: MIT
+// 
+// MIT License
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software andassociated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, andto permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+// 
+// The above copyright notice andthis permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "main.h"
+#include "logger.h"
+#include "helper.h"
+#include "statistics.h"
+#include "results.h"
+#include "history.h"
+#include "planner.h"
+#include <math.h>
+
+/* One test on one device, in the order the run will reach them */
+typedef struct planner_entry_t {
+    char test_name[RESULTS_MAXIMUM_NAME_LENGTH];
+    char device_name[HISTORY_MAXIMUM_DEVICE_NAME_LENGTH];
+    uint8_t uuid[RESULTS_UUID_SIZE];
+    planner_estimate estimate;
+    double samples_per_step;                                /* The trial count, or what the last recorded run needed to converge */
+    uint64_t minimum_us;                                    /* Every step stopped at the trial count */
+    uint64_t predicted_us;
+    bool started;
+} planner_entry;
+
+/* The scheduled test the calling thread is running, parallel workers each have their own */
+typedef struct planner_test_t {
+    bool active;
+    uint32_t steps_left;
+    uint64_t step_time_left_us;
+} planner_test;
+
+static bool planner_estimating;
+static bool planner_scheduling;
+static uint64_t planner_budget_us;
+static helper_timer planner_timer;
+static helper_mutex planner_mutex;
+static helper_arraylist planner_entries;
+static HELPER_THREAD_LOCAL planner_test planner_local_test;
+
+static double _PlannerGetSamplesPerStep(const char *test_name, const uint8_t *uuid);
+static void _PlannerFormatTime(uint64_t time_us, char *buffer, size_t buffer_size);
+
+/* Everything RunnerExecuteTests selects from here on is estimated instead of run, until PlannerStartSchedule */
+test_status PlannerInitialize() {
+    memset(&planner_entries, 0, sizeof(planner_entries));
+    test_status status = HelperArrayListInitialize(&planner_entries, sizeof(planner_entry));
+    TEST_RETFAIL(status);
+    planner_mutex = HelperCreateMutex();
+    if (planner_mutex == NULL) {
+        HelperArrayListClean(&planner_entries);
+        return TEST_OUT_OF_MEMORY;
+    }
+    planner_estimating = true;
+    planner_scheduling = false;
+    return TEST_OK;
+}
+
+bool PlannerIsEstimating() {
+    return planner_estimating;
+}
+
+/*
+ * Called while the options and parameters of the run are in effect, so a manifest entry is estimated with its own.
+ * A step samples at least the trial count and stops at the budget, whatever converging would take beyond that.
+ */
+test_status PlannerAddEstimate(const char *test_name, const char *device_name, const uint8_t *uuid, const planner_estimate *estimate) {
+    if (!planner_estimating || test_name == NULL || estimate == NULL) {
+        return TEST_INVALID_PARAMETER;
+    }
+    planner_entry entry;
+    memset(&entry, 0, sizeof(entry));
+    strncpy(entry.test_name, test_name, RESULTS_MAXIMUM_NAME_LENGTH - 1);
+    strncpy(entry.device_name, (device_name != NULL) ? device_name : "-", HISTORY_MAXIMUM_DEVICE_NAME_LENGTH - 1);
+    if (uuid != NULL) {
+        memcpy(entry.uuid, uuid, RESULTS_UUID_SIZE);
+    }
+    entry.estimate = *estimate;
+    entry.samples_per_step = _PlannerGetSamplesPerStep(test_name, uuid);
+
+    double trials = (double)max(1, MainGetTrialCount());
+    double sample_time_us = (double)estimate->sample_time_us;
+    double minimum_step_us = (trials + PLANNER_CALIBRATION_RUNS) * sample_time_us;
+    double converged_step_us = (entry.samples_per_step + PLANNER_CALIBRATION_RUNS) * sample_time_us;
+    double predicted_step_us = max(minimum_step_us, min(converged_step_us, (double)MainGetConvergenceBudget() * 1000.0));
+    entry.minimum_us = estimate->fixed_time_us + (uint64_t)(estimate->step_count * minimum_step_us);
+    entry.predicted_us = estimate->fixed_time_us + (uint64_t)(estimate->step_count * predicted_step_us);
+    return HelperArrayListAdd(&planner_entries, &entry, sizeof(entry), NULL);
+}
+
+/* Tests are listed in run order, the running total shows where a budget that can't hold all of them runs out */
+void PlannerPrint(uint64_t budget_us) {
+    size_t entry_count = HelperArrayListSize(&planner_entries);
+    bool csv = MainGetTestResultFormat() == test_result_csv;
+    if (csv) {
+        LOG_PLAIN("test,device,steps,minimum_s,predicted_s,cumulative_minimum_s,fits\n");
+    }
+    uint64_t minimum_total_us = 0;
+    uint64_t predicted_total_us = 0;
+    uint32_t fitting_count = 0;
+    char minimum[32];
+    char predicted[32];
+    for (size_t i = 0; i < entry_count; i++) {
+        planner_entry *entry = (planner_entry *)HelperArrayListGet(&planner_entries, i);
+        minimum_total_us += entry->minimum_us;
+        predicted_total_us += entry->predicted_us;
+        bool fits = budget_us == 0 || minimum_total_us <= budget_us;
+        if (fits) {
+            fitting_count++;
+        }
+        if (csv) {
+            LOG_PLAIN("%s,\"%s\",%lu,%.3f,%.3f,%.3f,%s\n", entry->test_name, entry->device_name, entry->estimate.step_count, entry->minimum_us / 1000000.0, entry->predicted_us / 1000000.0, minimum_total_us / 1000000.0, fits ? "yes" : "no");
+            continue;
+        }
+        _PlannerFormatTime(entry->minimum_us, minimum, sizeof(minimum));
+        _PlannerFormatTime(entry->predicted_us, predicted, sizeof(predicted));
+        INFO("%s on %s: %lu steps, %s (at least %s, %.1f samples per step)%s\n", entry->test_name, entry->device_name, entry->estimate.step_count, predicted, minimum, entry->samples_per_step, fits ? "" : ", over budget");
+    }
+    if (csv) {
+        return;
+    }
+    _PlannerFormatTime(minimum_total_us, minimum, sizeof(minimum));
+    _PlannerFormatTime(predicted_total_us, predicted, sizeof(predicted));
+    INFO("Predicted %s for %lu tests, at least %s%s\n", predicted, entry_count, minimum, MainGetParallelDevices() ? " (devices running in parallel overlap, this is the sequential time)" : "");
+    if (budget_us == 0) {
+        return;
+    }
+    char budget[32];
+    _PlannerFormatTime(budget_us, budget, sizeof(budget));
+    if (minimum_total_us > budget_us) {
+        WARNING("Only the first %lu tests fit into %s, the rest would still run past it at the trial count\n", fitting_count, budget);
+    } else if (predicted_total_us > budget_us) {
+        INFO("Fits into %s with shorter convergence budgets\n", budget);
+    } else {
+        INFO("Fits into %s, steps get more time to converge\n", budget);
+    }
+}
+
+/* Estimating ends here, the budget clock starts with the first test */
+test_status PlannerStartSchedule(uint64_t budget_us) {
+    if (!planner_estimating || budget_us == 0) {
+        return TEST_INVALID_PARAMETER;
+    }
+    planner_estimating = false;
+    planner_scheduling = true;
+    planner_budget_us = budget_us;
+    HelperTimerReset(&planner_timer);
+    return TEST_OK;
+}
+
+void PlannerCleanUp() {
+    if (planner_mutex == NULL) {
+        return;
+    }
+    planner_estimating = false;
+    planner_scheduling = false;
+    HelperCleanUpMutex(planner_mutex);
+    planner_mutex = NULL;
+    HelperArrayListClean(&planner_entries);
+}
+
+/*
+ * The test gets the share of what is left of the budget that its prediction has of what is left to run.
+ * Time a test doesn't use, because its steps converged early or it was skipped, goes to the tests after it.
+ * Devices running in parallel each spend the whole budget, so they only share it with their own tests.
+ */
+void PlannerBeginTest(const char *test_name, const uint8_t *uuid) {
+    planner_test *test = &planner_local_test;
+    memset(test, 0, sizeof(planner_test));
+    if (!planner_scheduling || test_name == NULL || uuid == NULL) {
+        return;
+    }
+    bool per_device = MainGetParallelDevices();
+    planner_entry *current = NULL;
+    uint64_t remaining_predicted_us = 0;
+    HelperLockMutex(planner_mutex);
+    size_t entry_count = HelperArrayListSize(&planner_entries);
+    for (size_t i = 0; i < entry_count; i++) {
+        planner_entry *entry = (planner_entry *)HelperArrayListGet(&planner_entries, i);
+        bool same_device = memcmp(entry->uuid, uuid, RESULTS_UUID_SIZE) == 0;
+        if (current == NULL && !entry->started && same_device && strcmp(entry->test_name, test_name) == 0) {
+            current = entry;
+            current->started = true;
+            remaining_predicted_us += entry->predicted_us;
+        } else if (!entry->started && (same_device || !per_device)) {
+            remaining_predicted_us += entry->predicted_us;
+        }
+    }
+    HelperUnlockMutex(planner_mutex);
+    if (current == NULL || current->estimate.step_count == 0) {
+        return;
+    }
+    uint64_t elapsed_us = HelperTimerGet(&planner_timer);
+    uint64_t remaining_us = (elapsed_us < planner_budget_us) ? planner_budget_us - elapsed_us : 0;
+    double share = (remaining_predicted_us > 0) ? (double)current->predicted_us / (double)remaining_predicted_us : 1.0;
+    uint64_t allocation_us = (uint64_t)(remaining_us * share);
+    test->active = true;
+    test->steps_left = current->estimate.step_count;
+    test->step_time_left_us = (allocation_us > current->estimate.fixed_time_us) ? allocation_us - current->estimate.fixed_time_us : 0;
+    char allocation[32];
+    _PlannerFormatTime(allocation_us, allocation, sizeof(allocation));
+    INFO("Scheduled %s for %s, %.3fs per step\n", test_name, allocation, test->step_time_left_us / (test->steps_left * 1000000.0));
+}
+
+void PlannerEndTest() {
+    planner_local_test.active = false;
+}
+
+/* Spread over the steps still to come, so a step that converged early leaves its time to the noisier ones after it */
+uint64_t PlannerGetStepBudget(uint64_t default_budget_us) {
+    planner_test *test = &planner_local_test;
+    if (!test->active) {
+        return default_budget_us;
+    }
+    return max(PLANNER_MINIMUM_STEP_BUDGET_MS * 1000, test->step_time_left_us / max(1, test->steps_left));
+}
+
+void PlannerEndStep(uint64_t time_us) {
+    planner_test *test = &planner_local_test;
+    if (!test->active) {
+        return;
+    }
+    test->step_time_left_us -= min(time_us, test->step_time_left_us);
+    if (test->steps_left > 1) {
+        test->steps_left--;
+    }
+}
+
+/*
+ * The half-width of a confidence interval shrinks with the square root of the sample count,
+ * so a step that reached relative error e with n samples needs about n * (e / tolerance)^2 to reach the tolerance.
+ * Averaged over the measurements of the last recorded run of the test on the device, the trial count without one.
+ */
+static double _PlannerGetSamplesPerStep(const char *test_name, const uint8_t *uuid) {
+    double trials = (double)max(1, MainGetTrialCount());
+    double maximum_samples = (double)max(MainGetTrialCount(), STATISTICS_MAXIMUM_TRIAL_COUNT);
+    if (!HistoryIsEnabled() || uuid == NULL) {
+        return trials;
+    }
+    history_filter filter;
+    memset(&filter, 0, sizeof(filter));
+    filter.uuid = uuid;
+    filter.test_patterns = test_name;
+    helper_arraylist entries;
+    if (!TEST_SUCCESS(HistoryQuery(&filter, &entries))) {
+        return trials;
+    }
+    double samples = trials;
+    size_t entry_count = HelperArrayListSize(&entries);
+    if (entry_count > 0) {
+        history_entry *latest = (history_entry *)HelperArrayListGet(&entries, entry_count - 1);
+        double tolerance = MainGetConvergenceTolerance() / 100.0;
+        double sum = 0.0;
+        size_t counted = 0;
+        size_t measurement_count = HelperArrayListSize(&(latest->measurements));
+        for (size_t i = 0; i < measurement_count; i++) {
+            history_measurement *measurement = (history_measurement *)HelperArrayListGet(&(latest->measurements), i);
+            double center = fabs(measurement->mean);
+            if (measurement->sample_count == 0 || center == 0.0) {
+                continue;
+            }
+            double relative_error = ((measurement->confidence_high - measurement->confidence_low) / 2.0) / center;
+            double needed = (tolerance > 0.0) ? measurement->sample_count * pow(relative_error / tolerance, 2.0) : maximum_samples;
+            sum += max(trials, min(needed, maximum_samples));
+            counted++;
+        }
+        if (counted > 0) {
+            samples = sum / counted;
+        }
+    }
+    HistoryCleanUpEntries(&entries);
+    return samples;
+}
+
+static void _PlannerFormatTime(uint64_t time_us, char *buffer, size_t buffer_size) {
+    uint64_t seconds = time_us / 1000000;
+    if (seconds >= 3600) {
+        snprintf(buffer, buffer_size, "%lluh %02llum", (unsigned long long)(seconds / 3600), (unsigned long long)((seconds / 60) % 60));
+    } else if (seconds >= 60) {
+        snprintf(buffer, buffer_size, "%llum %02llus", (unsigned long long)(seconds / 60), (unsigned long long)(seconds % 60));
+    } else {
+        snprintf(buffer, buffer_size, "%.1fs", time_us / 1000000.0);
+    }
+}
\ No newline at end of file
@@ -24,6 +24,7 @@
 #include "main.h"
 #include "logger.h"
 #include "helper.h"
+#include "manifest.h"
 #include "process_runner.h"
 #include "sanitize_windows_h.h"
 #ifdef _WIN32
@@ -42,13 +43,30 @@
 typedef struct process_runner_thread_data_t {
     const char *test_name;
     uint32_t device_index;
+    const char *manifest_path;
+    int32_t manifest_entry;
     helper_arraylist *results;
     test_status *completion_code;
+    process_runner_progress progress;
     bool has_kill_handle;
     bool kill_process;
 } process_runner_thread_data;
 
+typedef struct process_runner_channel_reader_t {
+#ifdef _WIN32
+    HANDLE file;
+#else
+    int file;
+#endif
+    helper_arraylist *results;
+    process_runner_progress *progress;
+    test_status status;             /* Failure while storing results */
+    test_status error_code;         /* Code of the child's last ABORT */
+    bool has_error;
+} process_runner_channel_reader;
+
 static void ProcessRunnerAsyncThreadFunction(uint32_t thread_id, void *input_data);
+static void _ProcessRunnerChannelThread(uint32_t thread_id, void *input_data);
 
 #ifdef _WIN32
 static const char *_ProcessRunnerReadLine(char *buffer, int max_count, HANDLE file, size_t *context) {
@@ -115,41 +133,161 @@ static const char *_ProcessRunnerReadLine(char *buffer, int max_count, int file,
     }
 }
 
-test_status ProcessRunnerRunTestKillable(const char *test_name, uint32_t device_index, helper_arraylist *results, bool *kill_process) {
+#ifdef _WIN32
+static bool _ProcessRunnerReadExact(HANDLE file, void *buffer, size_t size) {
+#else
+static bool _ProcessRunnerReadExact(int file, void *buffer, size_t size) {
+#endif
+    size_t total_read = 0;
+    while (total_read < size) {
+#ifdef _WIN32
+        DWORD read_data = 0;
+        BOOL success = ReadFile(file, (char *)buffer + total_read, (DWORD)(size - total_read), &read_data, NULL);
+        if (success == FALSE || read_data == 0) {
+            return false;
+        }
+#else
+        ssize_t read_data = read(file, (char *)buffer + total_read, size - total_read);
+        if (read_data <= 0) {
+            return false;
+        }
+#endif
+        total_read += (size_t)read_data;
+    }
+    return true;
+}
+
+/* Decodes records until the child closes its end of the channel (exit or kill) */
+static void _ProcessRunnerChannelThread(uint32_t thread_id, void *input_data) {
+    process_runner_channel_reader *reader = (process_runner_channel_reader *)input_data;
+    char payload[LOGGER_CHANNEL_MAXIMUM_RECORD_SIZE];
+    logger_channel_header header;
+    while (_ProcessRunnerReadExact(reader->file, &header, sizeof(header))) {
+        if (header.size > LOGGER_CHANNEL_MAXIMUM_RECORD_SIZE - sizeof(header)) {
+            break;
+        }
+        if (!_ProcessRunnerReadExact(reader->file, payload, header.size)) {
+            break;
+        }
+        if (header.type == LOGGER_CHANNEL_RECORD_RESULT && header.size >= sizeof(logger_channel_result)) {
+            logger_channel_result *record = (logger_channel_result *)payload;
+            if (TEST_SUCCESS(reader->status) && record->key_length <= header.size - sizeof(logger_channel_result)) {
+                process_runner_result result;
+                result.id = record->id;
+                result.value = record->value;
+                result.key = malloc(record->key_length + 1);
+                if (result.key == NULL) {
+                    reader->status = TEST_OUT_OF_MEMORY;
+                    continue;
+                }
+                memcpy(result.key, payload + sizeof(logger_channel_result), record->key_length);
+                result.key[record->key_length] = '\0';
+                reader->status = HelperArrayListAdd(reader->results, &result, sizeof(result), NULL);
+                if (!TEST_SUCCESS(reader->status)) {
+                    free(result.key);
+                }
+            }
+        } else if (header.type == LOGGER_CHANNEL_RECORD_PROGRESS && header.size >= sizeof(logger_channel_progress)) {
+            if (reader->progress != NULL) {
+                logger_channel_progress *record = (logger_channel_progress *)payload;
+                reader->progress->total = record->total;
+                reader->progress->completed = record->completed;
+            }
+        } else if (header.type == LOGGER_CHANNEL_RECORD_ERROR && header.size >= sizeof(logger_channel_error)) {
+            reader->error_code = ((logger_channel_error *)payload)->code;
+            reader->has_error = true;
+        }
+    }
+}
+
+/* With a manifest the child applies that entry's settings before running test_name once */
+test_status ProcessRunnerRunTestKillable(const char *test_name, uint32_t device_index, const char *manifest_path, int32_t manifest_entry, helper_arraylist *results, process_runner_progress *progress, bool *kill_process) {
     if (test_name == NULL || results == NULL) {
         return TEST_INVALID_PARAMETER;
     }
+    // Results, progress and the abort code come back over a dedicated pipe, stdout is only drained
+    process_runner_channel_reader channel_reader;
+    memset(&channel_reader, 0, sizeof(channel_reader));
+    channel_reader.results = results;
+    channel_reader.progress = progress;
+    channel_reader.status = TEST_OK;
+    channel_reader.error_code = TEST_OK;
+    if (progress != NULL) {
+        progress->completed = 0;
+        progress->total = 0;
+    }
+#ifdef _WIN32
+    SECURITY_ATTRIBUTES security_attributes;
+    security_attributes.nLength = sizeof(security_attributes);
+    security_attributes.bInheritHandle = TRUE;
+    security_attributes.lpSecurityDescriptor = NULL;
+
+    HANDLE channel_write;
+    if (!CreatePipe(&(channel_reader.file), &channel_write, &security_attributes, 0)) {
+        return TEST_FAILED_TO_SPAWN_TEST_PROCESS;
+    }
+    if (!SetHandleInformation(channel_reader.file, HANDLE_FLAG_INHERIT, 0)) {
+        CloseHandle(channel_reader.file);
+        CloseHandle(channel_write);
+        return TEST_FAILED_TO_SPAWN_TEST_PROCESS;
+    }
+#else
+    int channel_pipe[2];
+    if (pipe(channel_pipe)) {
+        return TEST_FAILED_TO_SPAWN_TEST_PROCESS;
+    }
+    channel_reader.file = channel_pipe[0];
+#endif
+
     const char *command = NULL;
 #ifdef _WIN32
-    test_status status = HelperPrintToBuffer(&command, NULL, "\"%s\" --cli --raw --test %s --device %lu", MainGetBinaryPath(), test_name, device_index);
+    test_status status;
+    if (manifest_path != NULL) {
+        status = HelperPrintToBuffer(&command, NULL, "\"%s\" --cli --raw --test %s --device %lu --channel %llu --manifest \"%s\" --manifest-entry %ld", MainGetBinaryPath(), test_name, device_index, (unsigned long long)(uintptr_t)channel_write, manifest_path, manifest_entry);
+    } else {
+        status = HelperPrintToBuffer(&command, NULL, "\"%s\" --cli --raw --test %s --device %lu --channel %llu", MainGetBinaryPath(), test_name, device_index, (unsigned long long)(uintptr_t)channel_write);
+    }
 #else
     // In Linux we just use this to get a stringified device_index as the args have to be separate strings
     test_status status = HelperPrintToBuffer(&command, NULL, "%lu", device_index);
 #endif
     if (command == NULL) {
+#ifdef _WIN32
+        CloseHandle(channel_reader.file);
+        CloseHandle(channel_write);
+#else
+        close(channel_pipe[0]);
+        close(channel_pipe[1]);
+#endif
         return status;
     }
     char *line_buffer = malloc(PROCESS_RUNNER_STDOUT_BUFFER_SIZE * sizeof(char));
     if (line_buffer == NULL) {
+#ifdef _WIN32
+        CloseHandle(channel_reader.file);
+        CloseHandle(channel_write);
+#else
+        close(channel_pipe[0]);
+        close(channel_pipe[1]);
+#endif
         free((void *)command);
         return TEST_OUT_OF_MEMORY;
     }
     memset(line_buffer, 0, PROCESS_RUNNER_STDOUT_BUFFER_SIZE * sizeof(char));
 
 #ifdef _WIN32
-    SECURITY_ATTRIBUTES security_attributes;
-    security_attributes.nLength = sizeof(security_attributes);
-    security_attributes.bInheritHandle = TRUE;
-    security_attributes.lpSecurityDescriptor = NULL;
-
     HANDLE stdout_read;
     HANDLE stdout_write;
     if (!CreatePipe(&stdout_read, &stdout_write, &security_attributes, 0)) {
+        CloseHandle(channel_reader.file);
+        CloseHandle(channel_write);
         free((void *)command);
         free(line_buffer);
         return TEST_FAILED_TO_SPAWN_TEST_PROCESS;
     }
     if (!SetHandleInformation(stdout_read, HANDLE_FLAG_INHERIT, 0)) {
+        CloseHandle(channel_reader.file);
+        CloseHandle(channel_write);
         free((void *)command);
         free(line_buffer);
         return TEST_FAILED_TO_SPAWN_TEST_PROCESS;
@@ -169,17 +307,22 @@ test_status ProcessRunnerRunTestKillable(const char *test_name, uint32_t device_
         CloseHandle(process_info.hThread);
         CloseHandle(stdout_write);
         CloseHandle(stdout_read);
+        CloseHandle(channel_reader.file);
+        CloseHandle(channel_write);
         free((void *)command);
         free(line_buffer);
         return TEST_FAILED_TO_SPAWN_TEST_PROCESS;
     }
-    // Close the write handle, we are only reading
+    // Close the write handles, we are only reading
     CloseHandle(stdout_write);
+    CloseHandle(channel_write);
 #else
     int cout_pipe[2];
     int cerr_pipe[2];
 
     if (pipe(cout_pipe) || pipe(cerr_pipe)) {
+        close(channel_pipe[0]);
+        close(channel_pipe[1]);
         free((void *)command);
         free(line_buffer);
         return TEST_FAILED_TO_SPAWN_TEST_PROCESS;
@@ -192,22 +335,47 @@ test_status ProcessRunnerRunTestKillable(const char *test_name, uint32_t device_
     posix_spawn_file_actions_adddup2(&file_actions, cout_pipe[1], 2);
     posix_spawn_file_actions_addclose(&file_actions, cout_pipe[1]);
     posix_spawn_file_actions_addclose(&file_actions, cerr_pipe[1]);
+    posix_spawn_file_actions_addclose(&file_actions, channel_pipe[0]);
 
     pid_t pid;
-    const char *argv[] = {MainGetBinaryPath(), "--cli", "--raw", "--test", test_name, "--device", command, NULL};
+    char manifest_entry_string[16];
+    char channel_string[16];
+    snprintf(manifest_entry_string, sizeof(manifest_entry_string), "%ld", (long)manifest_entry);
+    snprintf(channel_string, sizeof(channel_string), "%d", channel_pipe[1]);
+    const char *argv[] = {MainGetBinaryPath(), "--cli", "--raw", "--test", test_name, "--device", command, "--channel", channel_string, NULL, NULL, NULL, NULL, NULL};
+    if (manifest_path != NULL) {
+        argv[9] = "--manifest";
+        argv[10] = manifest_path;
+        argv[11] = "--manifest-entry";
+        argv[12] = manifest_entry_string;
+    }
     char *env[] = {NULL};
     int spawn_status = posix_spawn(&pid, MainGetBinaryPath(), &file_actions, NULL, (char **)argv, env);
     if (spawn_status != 0) {
         posix_spawn_file_actions_destroy(&file_actions);
+        close(channel_pipe[0]);
+        close(channel_pipe[1]);
         free((void *)command);
         free(line_buffer);
         return TEST_FAILED_TO_SPAWN_TEST_PROCESS;
     }
     close(cout_pipe[1]);
     close(cerr_pipe[1]);
+    close(channel_pipe[1]);
 #endif
 
+    // Without a reader the child would block once the pipe fills, so treat this as a kill request
     bool process_terminated = false;
+    helper_thread channel_thread = HelperCreateThread(&_ProcessRunnerChannelThread, &channel_reader);
+    if (channel_thread == NULL) {
+        status = TEST_FAILED_TO_SPAWN_THREAD;
+#ifdef _WIN32
+        TerminateProcess(process_info.hProcess, 0);
+#else
+        kill(pid, SIGKILL);
+#endif
+    }
+
     size_t reader_context = 0;
     const char *line = NULL;
 #ifdef _WIN32
@@ -215,31 +383,6 @@ test_status ProcessRunnerRunTestKillable(const char *test_name, uint32_t device_
 #else
     while ((line = _ProcessRunnerReadLine(line_buffer, PROCESS_RUNNER_STDOUT_BUFFER_SIZE, cout_pipe[0], &reader_context)) != NULL) {
 #endif
-        if (TEST_SUCCESS(status)) {
-            if (strstr(line, "[RESLT] ") == line) {
-                const char *key_start = strstr(line + 8, ": ");
-                if (key_start != NULL) {
-                    key_start += 2;
-                    const char *key_end = strstr(key_start, " = ");
-                    if (key_end != NULL) {
-                        const char *value_start = key_end + 3;
-                        process_runner_keypair result;
-                        memset(&result, 0, sizeof(result));
-                        strncpy(result.key, key_start, min(key_end - key_start, PROCESS_RUNNER_MAXIMUM_RESULT_LENGTH));
-                        strncpy(result.result, value_start, PROCESS_RUNNER_MAXIMUM_RESULT_LENGTH);
-                        size_t result_len = strlen(result.result);
-                        if (result_len > 1 && result.result[result_len - 1] == '\n') {
-                            result.result[result_len - 1] = '\0';
-                        }
-                        status = HelperArrayListAdd(results, &result, sizeof(result), NULL);
-                    }
-                }
-            } else if (strstr(line, "[ABORT] ") == line) {
-                if (strlen(line) >= 20) {
-                    status = (test_status)strtoull((const char *)line + 10, NULL, 16);
-                }
-            }
-        }
         if (!process_terminated && kill_process != NULL && *kill_process == true) {
 #ifdef _WIN32
             TerminateProcess(process_info.hProcess, 0);
@@ -253,15 +396,29 @@ test_status ProcessRunnerRunTestKillable(const char *test_name, uint32_t device_
         printf("> %s\n", line);
 #endif
     }
+#ifdef _WIN32
+    WaitForSingleObject(process_info.hProcess, INFINITE);
+#else
+    waitpid(pid, NULL, 0);
+#endif
+    if (channel_thread != NULL) {
+        HelperWaitForThread(channel_thread);
+        HelperCleanUpThread(channel_thread);
+    }
     if (process_terminated) {
         status = TEST_PROCESS_KILLED;
+    } else if (TEST_SUCCESS(status)) {
+        status = channel_reader.has_error ? channel_reader.error_code : channel_reader.status;
     }
 #ifdef _WIN32
     CloseHandle(process_info.hProcess);
     CloseHandle(process_info.hThread);
     CloseHandle(stdout_read);
+    CloseHandle(channel_reader.file);
 #else
-    waitpid(pid, NULL, 0);
+    close(cout_pipe[0]);
+    close(cerr_pipe[0]);
+    close(channel_pipe[0]);
     posix_spawn_file_actions_destroy(&file_actions);
 #endif
     free((void *)command);
@@ -270,10 +427,10 @@ test_status ProcessRunnerRunTestKillable(const char *test_name, uint32_t device_
 }
 
 test_status ProcessRunnerRunTest(const char *test_name, uint32_t device_index, helper_arraylist *results) {
-    return ProcessRunnerRunTestKillable(test_name, device_index, results, NULL);
+    return ProcessRunnerRunTestKillable(test_name, device_index, NULL, MANIFEST_ALL_ENTRIES, results, NULL, NULL);
 }
 
-test_status ProcessRunnerRunTestAsync(const char *test_name, uint32_t device_index, helper_arraylist *results, test_status *completion_code, void **kill_handle) {
+test_status ProcessRunnerRunTestAsync(const char *test_name, uint32_t device_index, const char *manifest_path, int32_t manifest_entry, helper_arraylist *results, test_status *completion_code, void **kill_handle) {
     if (completion_code == NULL) {
         return TEST_INVALID_PARAMETER;
     }
@@ -283,8 +440,12 @@ test_status ProcessRunnerRunTestAsync(const char *test_name, uint32_t device_ind
     }
     thread_data->test_name = test_name;
     thread_data->device_index = device_index;
+    thread_data->manifest_path = manifest_path;
+    thread_data->manifest_entry = manifest_entry;
     thread_data->results = results;
     thread_data->completion_code = completion_code;
+    thread_data->progress.completed = 0;
+    thread_data->progress.total = 0;
     thread_data->kill_process = false;
     thread_data->has_kill_handle = kill_handle != NULL;
 
@@ -303,7 +464,7 @@ test_status ProcessRunnerRunTestAsync(const char *test_name, uint32_t device_ind
 static void ProcessRunnerAsyncThreadFunction(uint32_t thread_id, void *input_data) {
     process_runner_thread_data *thread_data = (process_runner_thread_data *)input_data;
 
-    *(thread_data->completion_code) = ProcessRunnerRunTestKillable(thread_data->test_name, thread_data->device_index, thread_data->results, &(thread_data->kill_process));
+    *(thread_data->completion_code) = ProcessRunnerRunTestKillable(thread_data->test_name, thread_data->device_index, thread_data->manifest_path, thread_data->manifest_entry, thread_data->results, &(thread_data->progress), &(thread_data->kill_process));
 
     if (!thread_data->has_kill_handle) {
         free(thread_data);
@@ -320,4 +481,24 @@ test_status ProcessRunnerTerminateAsync(void *kill_handle) {
         HelperSleep(PROCESS_RUNNER_ALIVE_CHECKER_INTERVAL_MS);
     }
     return TEST_OK;
+}
+
+test_status ProcessRunnerGetProgress(void *kill_handle, uint32_t *completed, uint32_t *total) {
+    if (kill_handle == NULL || completed == NULL || total == NULL) {
+        return TEST_INVALID_PARAMETER;
+    }
+    process_runner_thread_data *thread_data = (process_runner_thread_data *)kill_handle;
+    *total = thread_data->progress.total;
+    *completed = min(thread_data->progress.completed, *total);
+    return TEST_OK;
+}
+
+void ProcessRunnerCleanUpResults(helper_arraylist *results) {
+    if (results == NULL || results->data == NULL) {
+        return;
+    }
+    for (size_t i = 0; i < results->size; i++) {
+        free(((process_runner_result *)HelperArrayListGet(results, i))->key);
+    }
+    HelperArrayListClean(results);
 }
\ No newline at end of file
@@ -0,0 +1,181 @@
+// Copyright (c) 2021 - 2022, Nemes <nemes@nemez.net>
+// SPDX-License-Identifier: MIT
+// 
+// MIT License
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software andassociated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, andto permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+// 
+// The above copyright notice andthis permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "main.h"
+#include "helper.h"
+#include "statistics.h"
+#include "region_sweep.h"
+#include <math.h>
+
+static uint64_t _RegionSweepAlign(region_sweep *sweep, double size);
+static bool _RegionSweepContains(region_sweep *sweep, uint64_t size);
+
+test_status RegionSweepInitialize(uint64_t minimum_size, uint64_t maximum_size, uint32_t points_per_octave, uint64_t granularity, region_sweep *sweep) {
+    if (sweep == NULL || granularity == 0 || points_per_octave == 0 || points_per_octave > REGION_SWEEP_MAXIMUM_POINTS_PER_OCTAVE || minimum_size > maximum_size) {
+        return TEST_INVALID_PARAMETER;
+    }
+    memset(sweep, 0, sizeof(region_sweep));
+    sweep->granularity = granularity;
+    test_status status = HelperArrayListInitialize(&(sweep->sizes), sizeof(uint64_t));
+    TEST_RETFAIL(status);
+
+    /* Sizes that round onto the same multiple of the granularity collapse into one, which is what thins out the small end */
+    uint64_t first_size = ((minimum_size + granularity - 1) / granularity) * granularity;
+    uint64_t last_size = 0;
+    for (uint32_t point = 0; ; point++) {
+        double ideal_size = ldexp((double)minimum_size, (int)(point / points_per_octave)) * pow(2.0, (double)(point % points_per_octave) / (double)points_per_octave);
+        if (ideal_size > (double)maximum_size) {
+            break;
+        }
+        uint64_t size = max(_RegionSweepAlign(sweep, ideal_size), first_size);
+        if (size > maximum_size || size <= last_size) {
+            continue;
+        }
+        status = HelperArrayListAdd(&(sweep->sizes), &size, sizeof(size), NULL);
+        if (!TEST_SUCCESS(status)) {
+            goto error;
+        }
+        last_size = size;
+    }
+    sweep->base_count = HelperArrayListSize(&(sweep->sizes));
+    if (sweep->base_count == 0) {
+        status = TEST_INVALID_PARAMETER;
+        goto error;
+    }
+    return TEST_OK;
+error:
+    HelperArrayListClean(&(sweep->sizes));
+    return status;
+}
+
+test_status RegionSweepCleanUp(region_sweep *sweep) {
+    if (sweep == NULL) {
+        return TEST_INVALID_PARAMETER;
+    }
+    HelperArrayListClean(&(sweep->sizes));
+    sweep->base_count = 0;
+    return TEST_OK;
+}
+
+size_t RegionSweepGetCount(region_sweep *sweep) {
+    return HelperArrayListSize(&(sweep->sizes));
+}
+
+/* Every pass adds at most one point between each pair of measured neighbours, so the sweep at most doubles */
+size_t RegionSweepGetMaximumCount(region_sweep *sweep) {
+    return RegionSweepGetCount(sweep) << (REGION_SWEEP_MAXIMUM_REFINE_PASSES - sweep->refine_passes);
+}
+
+uint64_t RegionSweepGetSize(region_sweep *sweep, size_t index) {
+    uint64_t *size = (uint64_t *)HelperArrayListGet(&(sweep->sizes), index);
+    if (size == NULL) {
+        return 0;
+    }
+    return *size;
+}
+
+const uint64_t *RegionSweepGetSizes(region_sweep *sweep) {
+    return (const uint64_t *)HelperArrayListRawData(&(sweep->sizes));
+}
+
+/* Refinement points are ignored, they never go past the largest measured size anyway */
+size_t RegionSweepFindLargest(region_sweep *sweep, uint64_t maximum_size) {
+    size_t largest = 0;
+    for (size_t i = 1; i < sweep->base_count; i++) {
+        if (RegionSweepGetSize(sweep, i) > maximum_size) {
+            break;
+        }
+        largest = i;
+    }
+    return largest;
+}
+
+/* Adds the aligned geometric midpoint of every pair of measured neighbours whose results differ by more than the threshold
+ * Results are indexed like the sweep, a result without samples wasn't measured and doesn't take part */
+test_status RegionSweepRefine(region_sweep *sweep, const statistics_summary *results, uint32_t threshold_percent, size_t *added_count) {
+    if (sweep == NULL || results == NULL || added_count == NULL) {
+        return TEST_INVALID_PARAMETER;
+    }
+    *added_count = 0;
+    if (threshold_percent == 0 || sweep->refine_passes >= REGION_SWEEP_MAXIMUM_REFINE_PASSES) {
+        return TEST_OK;
+    }
+    sweep->refine_passes++;
+    size_t count = RegionSweepGetCount(sweep);
+    size_t *measured = malloc(count * sizeof(size_t));
+    if (measured == NULL) {
+        return TEST_OUT_OF_MEMORY;
+    }
+    /* Refinement points sit after the base sweep, so the measured ones are put back into size order first */
+    size_t measured_count = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (results[i].sample_count == 0) {
+            continue;
+        }
+        size_t position = measured_count++;
+        while (position > 0 && RegionSweepGetSize(sweep, measured[position - 1]) > RegionSweepGetSize(sweep, i)) {
+            measured[position] = measured[position - 1];
+            position--;
+        }
+        measured[position] = i;
+    }
+    test_status status = TEST_OK;
+    for (size_t i = 1; i < measured_count; i++) {
+        double lower_value = results[measured[i - 1]].median;
+        double upper_value = results[measured[i]].median;
+        double smaller_value = min(lower_value, upper_value);
+        if (smaller_value <= 0.0 || fabs(upper_value - lower_value) * 100.0 <= smaller_value * threshold_percent) {
+            continue;
+        }
+        uint64_t lower_size = RegionSweepGetSize(sweep, measured[i - 1]);
+        uint64_t upper_size = RegionSweepGetSize(sweep, measured[i]);
+        uint64_t size = _RegionSweepAlign(sweep, sqrt((double)lower_size * (double)upper_size));
+        /* Neighbours a granule apart can't be split any further */
+        if (size <= lower_size || size >= upper_size || _RegionSweepContains(sweep, size)) {
+            continue;
+        }
+        status = HelperArrayListAdd(&(sweep->sizes), &size, sizeof(size), NULL);
+        if (!TEST_SUCCESS(status)) {
+            break;
+        }
+        (*added_count)++;
+    }
+    free(measured);
+    return status;
+}
+
+static uint64_t _RegionSweepAlign(region_sweep *sweep, double size) {
+    uint64_t granules = (uint64_t)(size / (double)sweep->granularity + 0.5);
+    return max(granules, 1) * sweep->granularity;
+}
+
+static bool _RegionSweepContains(region_sweep *sweep, uint64_t size) {
+    size_t count = RegionSweepGetCount(sweep);
+    for (size_t i = 0; i < count; i++) {
+        if (RegionSweepGetSize(sweep, i) == size) {
+            return true;
+        }
+    }
+    return false;
+}
\ No newline at end of file
@@ -0,0 +1,364 @@
+// Copyright (c) 2021 - 2022, Nemes <nemes@nemez.net>
+// SPDX-License-Identifier: MIT
+// 
+// MIT License
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software andassociated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, andto permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+// 
+// The above copyright notice andthis permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "main.h"
+#include "logger.h"
+#include "helper.h"
+#include "statistics.h"
+#include "results.h"
+#include "history.h"
+#include <math.h>
+#include <stdarg.h>
+
+/* A record being assembled, written with a single log call so parallel workers can't interleave it */
+typedef struct results_buffer_t {
+    char *data;
+    size_t size;
+    size_t capacity;
+    bool failed;
+} results_buffer;
+
+static HELPER_THREAD_LOCAL results_context results_local_context;
+
+static void _ResultsAppend(results_buffer *buffer, const char *format, ...);
+static void _ResultsAppendString(results_buffer *buffer, const char *string);
+static void _ResultsAppendNumber(results_buffer *buffer, double value);
+static void _ResultsAppendValues(results_buffer *buffer, helper_arraylist *values);
+static test_status _ResultsWriteMeasurement(results_context *context, results_measurement *measurement, bool complete, bool final);
+static void _ResultsClear(results_context *context);
+
+/* Each worker thread has its own context, this frees the one of the calling thread */
+void ResultsCleanUp() {
+    results_context *context = &results_local_context;
+    if (HelperArrayListRawData(&(context->measurements)) != NULL) {
+        HelperArrayListClean(&(context->measurements));
+    }
+    if (HelperArrayListRawData(&(context->samples)) != NULL) {
+        HelperArrayListClean(&(context->samples));
+    }
+    if (HelperArrayListRawData(&(context->parameters)) != NULL) {
+        HelperArrayListClean(&(context->parameters));
+    }
+    if (HelperArrayListRawData(&(context->metadata)) != NULL) {
+        HelperArrayListClean(&(context->metadata));
+    }
+    memset(context, 0, sizeof(results_context));
+}
+
+/* Measurements are gathered for the JSON lines and for the history store, whichever is on */
+bool ResultsIsEnabled() {
+    return MainGetTestResultFormat() == test_result_json || HistoryIsEnabled();
+}
+
+void ResultsBeginTest(const char *test_name, uint32_t test_version, const results_device *device) {
+    if (!ResultsIsEnabled()) {
+        return;
+    }
+    _ResultsClear(&results_local_context);
+    results_local_context.active = true;
+    results_local_context.test_name = test_name;
+    results_local_context.test_version = test_version;
+    results_local_context.device = *device;
+}
+
+/*
+ * Every measurement is written again with the parameters and metadata of the whole test, these final records
+ * supersede the ones written as it was measured. A failed test's are marked incomplete.
+ * They stay out of the history, a partial run there would look like a complete one to the comparisons.
+ */
+test_status ResultsEndTest(bool complete) {
+    results_context *context = &results_local_context;
+    if (!context->active) {
+        return TEST_OK;
+    }
+    test_status status = TEST_OK;
+    if (MainGetTestResultFormat() == test_result_json) {
+        size_t count = HelperArrayListSize(&(context->measurements));
+        for (size_t i = 0; i < count; i++) {
+            status = _ResultsWriteMeasurement(context, (results_measurement *)HelperArrayListGet(&(context->measurements), i), complete, true);
+            if (!TEST_SUCCESS(status)) {
+                break;
+            }
+        }
+    }
+    /* Losing the history entry is not worth failing a run that measured fine */
+    if (complete && !context->replayed) {
+        test_status history_status = HistoryRecord(context);
+        if (!TEST_SUCCESS(history_status)) {
+            WARNING("Failed to record %s in the result history: 0x%08lx %s\n", context->test_name, history_status, LoggerLookUpError(history_status));
+        }
+    }
+    _ResultsClear(context);
+    return status;
+}
+
+void ResultsSetReplayed() {
+    results_local_context.replayed = true;
+}
+
+test_status ResultsAddMeasurement(uint32_t id, const char *key, const char *unit, const statistics_summary *summary) {
+    if (!results_local_context.active) {
+        return TEST_OK;
+    }
+    if (key == NULL || unit == NULL || summary == NULL || strlen(key) >= RESULTS_MAXIMUM_NAME_LENGTH || strlen(unit) >= RESULTS_MAXIMUM_UNIT_LENGTH) {
+        return TEST_INVALID_PARAMETER;
+    }
+    results_measurement measurement;
+    memset(&measurement, 0, sizeof(measurement));
+    measurement.id = id;
+    strcpy(measurement.key, key);
+    strcpy(measurement.unit, unit);
+    measurement.summary = *summary;
+    test_status status = HelperArrayListAdd(&(results_local_context.measurements), &measurement, sizeof(measurement), NULL);
+    TEST_RETFAIL(status);
+    /* Written right away as well, so a sweep cut short by a crash or the watchdog keeps what it got */
+    if (MainGetTestResultFormat() == test_result_json) {
+        status = _ResultsWriteMeasurement(&results_local_context, &measurement, false, false);
+    }
+    return status;
+}
+
+/* Has to be called before the samples are reset, scale converts them to the unit of the measurement */
+test_status ResultsRecordSamples(uint32_t id, statistics_samples *values, statistics_samples *timings, double scale) {
+    if (!results_local_context.active) {
+        return TEST_OK;
+    }
+    if (values == NULL || timings == NULL) {
+        return TEST_INVALID_PARAMETER;
+    }
+    size_t count = StatisticsGetSampleCount(values);
+    size_t timing_count = StatisticsGetSampleCount(timings);
+    const double *value_data = (const double *)HelperArrayListRawData(&(values->samples));
+    const double *timing_data = (const double *)HelperArrayListRawData(&(timings->samples));
+    for (size_t i = 0; i < count; i++) {
+        results_sample sample;
+        sample.id = id;
+        sample.value = value_data[i] * scale;
+        sample.time_us = (i < timing_count) ? timing_data[i] : NAN;
+        test_status status = HelperArrayListAdd(&(results_local_context.samples), &sample, sizeof(sample), NULL);
+        TEST_RETFAIL(status);
+    }
+    return TEST_OK;
+}
+
+test_status ResultsAddParameter(const char *name, uint64_t value) {
+    if (!results_local_context.active) {
+        return TEST_OK;
+    }
+    if (name == NULL || strlen(name) >= RESULTS_MAXIMUM_NAME_LENGTH) {
+        return TEST_INVALID_PARAMETER;
+    }
+    results_value entry;
+    memset(&entry, 0, sizeof(entry));
+    strcpy(entry.name, name);
+    entry.integer = true;
+    entry.integer_value = value;
+    return HelperArrayListAdd(&(results_local_context.parameters), &entry, sizeof(entry), NULL);
+}
+
+test_status ResultsAddMetadata(const char *name, double value) {
+    if (!results_local_context.active) {
+        return TEST_OK;
+    }
+    if (name == NULL || strlen(name) >= RESULTS_MAXIMUM_NAME_LENGTH) {
+        return TEST_INVALID_PARAMETER;
+    }
+    results_value entry;
+    memset(&entry, 0, sizeof(entry));
+    strcpy(entry.name, name);
+    entry.real_value = value;
+    return HelperArrayListAdd(&(results_local_context.metadata), &entry, sizeof(entry), NULL);
+}
+
+static test_status _ResultsWriteMeasurement(results_context *context, results_measurement *measurement, bool complete, bool final) {
+    results_buffer buffer;
+    memset(&buffer, 0, sizeof(buffer));
+    results_device *device = &(context->device);
+    statistics_summary *summary = &(measurement->summary);
+
+    _ResultsAppend(&buffer, "{\"tool_version\":\"%u.%u.%u\",\"test\":", TEST_VER_MAJOR(TEST_TOOL_VERSION), TEST_VER_MINOR(TEST_TOOL_VERSION), TEST_VER_PATCH(TEST_TOOL_VERSION));
+    _ResultsAppendString(&buffer, context->test_name);
+    _ResultsAppend(&buffer, ",\"test_version\":\"%u.%u.%u\",\"device\":{\"index\":%lu,\"name\":", TEST_VER_MAJOR(context->test_version), TEST_VER_MINOR(context->test_version), TEST_VER_PATCH(context->test_version), device->index);
+    _ResultsAppendString(&buffer, device->name);
+    _ResultsAppend(&buffer, ",\"uuid\":\"");
+    for (uint32_t i = 0; i < RESULTS_UUID_SIZE; i++) {
+        /* Canonical 8-4-4-4-12 form */
+        _ResultsAppend(&buffer, (i == 4 || i == 6 || i == 8 || i == 10) ? "-%02x" : "%02x", device->uuid[i]);
+    }
+    _ResultsAppend(&buffer, "\",\"vendor_id\":%lu,\"device_id\":%lu,\"api_version\":\"%u.%u.%u\",\"driver_version\":%lu,\"driver_name\":", device->vendor_id, device->device_id, RESULTS_API_VERSION_MAJOR(device->api_version), RESULTS_API_VERSION_MINOR(device->api_version), RESULTS_API_VERSION_PATCH(device->api_version), device->driver_version);
+    _ResultsAppendString(&buffer, device->driver_name);
+    _ResultsAppend(&buffer, ",\"driver_info\":");
+    _ResultsAppendString(&buffer, device->driver_info);
+    _ResultsAppend(&buffer, "},\"parameters\":");
+    _ResultsAppendValues(&buffer, &(context->parameters));
+    _ResultsAppend(&buffer, ",\"metadata\":");
+    _ResultsAppendValues(&buffer, &(context->metadata));
+
+    _ResultsAppend(&buffer, ",\"id\":%lu,\"key\":", measurement->id);
+    _ResultsAppendString(&buffer, measurement->key);
+    _ResultsAppend(&buffer, ",\"unit\":");
+    _ResultsAppendString(&buffer, measurement->unit);
+    _ResultsAppend(&buffer, ",\"value\":");
+    _ResultsAppendNumber(&buffer, summary->median);
+    _ResultsAppend(&buffer, ",\"statistics\":{\"median\":");
+    _ResultsAppendNumber(&buffer, summary->median);
+    _ResultsAppend(&buffer, ",\"mean\":");
+    _ResultsAppendNumber(&buffer, summary->mean);
+    _ResultsAppend(&buffer, ",\"minimum\":");
+    _ResultsAppendNumber(&buffer, summary->minimum);
+    _ResultsAppend(&buffer, ",\"maximum\":");
+    _ResultsAppendNumber(&buffer, summary->maximum);
+    _ResultsAppend(&buffer, ",\"p5\":");
+    _ResultsAppendNumber(&buffer, summary->p5);
+    _ResultsAppend(&buffer, ",\"p95\":");
+    _ResultsAppendNumber(&buffer, summary->p95);
+    _ResultsAppend(&buffer, ",\"stddev\":");
+    _ResultsAppendNumber(&buffer, summary->standard_deviation);
+    _ResultsAppend(&buffer, ",\"ci95_low\":");
+    _ResultsAppendNumber(&buffer, summary->confidence_low);
+    _ResultsAppend(&buffer, ",\"ci95_high\":");
+    _ResultsAppendNumber(&buffer, summary->confidence_high);
+    _ResultsAppend(&buffer, ",\"sample_count\":%lu,\"outliers\":%lu}", summary->sample_count, summary->rejected_outliers);
+
+    /* Samples are in the order they were taken, before outlier rejection */
+    size_t sample_count = HelperArrayListSize(&(context->samples));
+    bool first = true;
+    _ResultsAppend(&buffer, ",\"samples\":[");
+    for (size_t i = 0; i < sample_count; i++) {
+        results_sample *sample = (results_sample *)HelperArrayListGet(&(context->samples), i);
+        if (sample->id == measurement->id) {
+            _ResultsAppend(&buffer, first ? "" : ",");
+            _ResultsAppendNumber(&buffer, sample->value);
+            first = false;
+        }
+    }
+    first = true;
+    _ResultsAppend(&buffer, "],\"timings_us\":[");
+    for (size_t i = 0; i < sample_count; i++) {
+        results_sample *sample = (results_sample *)HelperArrayListGet(&(context->samples), i);
+        if (sample->id == measurement->id) {
+            _ResultsAppend(&buffer, first ? "" : ",");
+            _ResultsAppendNumber(&buffer, sample->time_us);
+            first = false;
+        }
+    }
+    _ResultsAppend(&buffer, "],\"complete\":%s,\"final\":%s}\n", complete ? "true" : "false", final ? "true" : "false");
+
+    test_status status = TEST_OK;
+    if (buffer.failed) {
+        status = TEST_OUT_OF_MEMORY;
+    } else {
+        LOG_PLAIN("%s", buffer.data);
+        LoggerFlushCapture();
+    }
+    free(buffer.data);
+    return status;
+}
+
+static void _ResultsAppend(results_buffer *buffer, const char *format, ...) {
+    if (buffer->failed) {
+        return;
+    }
+    va_list list;
+    va_start(list, format);
+    va_list measure_list;
+    va_copy(measure_list, list);
+    int length = vsnprintf(NULL, 0, format, measure_list);
+    va_end(measure_list);
+    if (length < 0) {
+        buffer->failed = true;
+        va_end(list);
+        return;
+    }
+    size_t required = buffer->size + (size_t)length + 1;
+    if (required > buffer->capacity) {
+        size_t capacity = max(required, buffer->capacity * 2);
+        char *data = realloc(buffer->data, capacity);
+        if (data == NULL) {
+            buffer->failed = true;
+            va_end(list);
+            return;
+        }
+        buffer->data = data;
+        buffer->capacity = capacity;
+    }
+    vsnprintf(&(buffer->data[buffer->size]), (size_t)length + 1, format, list);
+    buffer->size += (size_t)length;
+    va_end(list);
+}
+
+static void _ResultsAppendString(results_buffer *buffer, const char *string) {
+    if (string == NULL) {
+        _ResultsAppend(buffer, "null");
+        return;
+    }
+    _ResultsAppend(buffer, "\"");
+    for (const char *character = string; *character != '\0'; character++) {
+        unsigned char value = (unsigned char)*character;
+        if (value == '"' || value == '\\') {
+            _ResultsAppend(buffer, "\\%c", value);
+        } else if (value < 0x20) {
+            _ResultsAppend(buffer, "\\u%04x", value);
+        } else {
+            _ResultsAppend(buffer, "%c", value);
+        }
+    }
+    _ResultsAppend(buffer, "\"");
+}
+
+/* JSON has no NaN or infinity, an empty statistic (no samples) still has to parse */
+static void _ResultsAppendNumber(results_buffer *buffer, double value) {
+    if (isnan(value) || isinf(value)) {
+        _ResultsAppend(buffer, "null");
+    } else {
+        _ResultsAppend(buffer, "%.10g", value);
+    }
+}
+
+static void _ResultsAppendValues(results_buffer *buffer, helper_arraylist *values) {
+    size_t count = HelperArrayListSize(values);
+    _ResultsAppend(buffer, "{");
+    for (size_t i = 0; i < count; i++) {
+        results_value *entry = (results_value *)HelperArrayListGet(values, i);
+        _ResultsAppend(buffer, (i == 0) ? "" : ",");
+        _ResultsAppendString(buffer, entry->name);
+        _ResultsAppend(buffer, ":");
+        if (entry->integer) {
+            _ResultsAppend(buffer, "%llu", entry->integer_value);
+        } else {
+            _ResultsAppendNumber(buffer, entry->real_value);
+        }
+    }
+    _ResultsAppend(buffer, "}");
+}
+
+/* The lists keep their allocations, the next test on this thread reuses them */
+static void _ResultsClear(results_context *context) {
+    context->active = false;
+    context->replayed = false;
+    context->test_name = NULL;
+    HelperArrayListTruncate(&(context->measurements), 0);
+    HelperArrayListTruncate(&(context->samples), 0);
+    HelperArrayListTruncate(&(context->parameters), 0);
+    HelperArrayListTruncate(&(context->metadata), 0);
+}
\ No newline at end of file
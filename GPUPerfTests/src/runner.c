@@ -25,35 +25,113 @@
 #include "logger.h"
 #include "helper.h"
 #include "runner.h"
+#include "parameters.h"
+#include "statistics.h"
+#include "results.h"
+#include "history.h"
+#include "compare.h"
+#include "watchdog.h"
+#include "planner.h"
 #include "vulkan_helper.h"
 #include "vulkan_runner.h"
 #include "tests/test_vk_list.h"
 
 static helper_arraylist test_list;
+/* Open addressing over test_list, a slot holds the test's index plus one so that 0 marks it empty */
+static uint32_t *test_index;
+static uint32_t test_index_size;
 
-test_status RunnerRegisterTest(test_main *test_entry, void *config_data, const char *const test_name, uint32_t test_version) {
-    if (test_entry == NULL) {
+/* One per device when devices run in parallel, results are indexed like the selected tests */
+typedef struct runner_worker_t {
+    helper_arraylist *selected_tests;
+    test_status *results;
+    uint32_t device_index;
+    uint32_t first_processor;
+    uint32_t processor_count;
+    helper_mutex host_mutex;
+    uint32_t current_test;
+    helper_atomic_bool finished;
+    helper_atomic_bool abandoned;
+} runner_worker;
+
+static test_status _RunnerSelectTests(const char *test_names, helper_arraylist *selected_tests);
+static uint32_t _RunnerHashName(const char *name, size_t name_length);
+static test_status _RunnerBuildIndex();
+static bool _RunnerMatchesFilter(runner_test *test_entry, const char *filter);
+static bool _RunnerMatchesTerm(runner_test *test_entry, const char *term, size_t term_length);
+static bool _RunnerIsFailure(test_status status);
+static bool _RunnerIsHostExclusive(runner_test *test_entry);
+static test_status _RunnerExecuteSequential(helper_arraylist *selected_tests, int32_t device_id);
+static test_status _RunnerExecuteParallel(helper_arraylist *selected_tests, uint32_t device_count);
+static void _RunnerWorkerThread(uint32_t thread_id, void *data);
+static test_status _RunnerExecuteTest(runner_test *test_entry, int32_t device_id, helper_atomic_bool *abandoned);
+static test_status _RunnerEstimateTests(helper_arraylist *selected_tests, int32_t device_id);
+static test_status _RunnerPrepareTests(helper_arraylist *selected_tests, int32_t device_id);
+
+test_status RunnerRegisterTest(test_main *test_entry, test_estimate *estimate_entry, test_prepare *prepare_entry, void *config_data, const char *const test_name, uint32_t test_version, uint32_t flags, const char *tags) {
+    if (test_entry == NULL || test_name == NULL || strlen(test_name) >= RUNNER_MAXIMUM_NAME_LENGTH) {
         return TEST_INVALID_PARAMETER;
     }
     runner_test entry;
     entry.entry = test_entry;
+    entry.estimate = estimate_entry;
+    entry.prepare = prepare_entry;
     entry.config_data = config_data;
     entry.name = test_name;
+    entry.tags = (tags != NULL) ? tags : "";
     entry.version = test_version;
+    entry.flags = flags;
     return HelperArrayListAdd(&test_list, &entry, sizeof(runner_test), NULL);
 }
 
-test_status RunnerExecuteTests(const char *test_name, int32_t device_id) {
-    size_t size = HelperArrayListSize(&test_list);
-    for (uint32_t i = 0; i < size; i++) {
-        runner_test *test_entry = (runner_test *)HelperArrayListGet(&test_list, i);
-        if (strcmp(test_name, test_entry->name) == 0) {
-            LOG("TESTV", "%s %u.%u.%u\n", test_entry->name, TEST_VER_MAJOR(test_entry->version), TEST_VER_MINOR(test_entry->version), TEST_VER_PATCH(test_entry->version));
-            SEPARATOR();
-            return test_entry->entry(device_id, test_entry->config_data);
+test_status RunnerExecuteTests(const char *test_names, int32_t device_id) {
+    if (test_names == NULL) {
+        return TEST_INVALID_PARAMETER;
+    }
+    test_status status = ParametersValidate();
+    TEST_RETFAIL(status);
+    helper_arraylist selected_tests = {0};
+    status = _RunnerSelectTests(test_names, &selected_tests);
+    if (!TEST_SUCCESS(status)) {
+        HelperArrayListClean(&selected_tests);
+        return status;
+    }
+    if (PlannerIsEstimating()) {
+        status = _RunnerEstimateTests(&selected_tests, device_id);
+        HelperArrayListClean(&selected_tests);
+        return status;
+    }
+    bool parallel = MainGetParallelDevices() && device_id == -1;
+    if (HelperArrayListSize(&selected_tests) == 1 && !parallel) {
+        status = _RunnerExecuteTest(*(runner_test **)HelperArrayListGet(&selected_tests, 0), device_id, NULL);
+        HelperArrayListClean(&selected_tests);
+        return _RunnerIsFailure(status) ? status : TEST_OK;
+    }
+    status = VulkanRunnerBeginBatch();
+    if (TEST_SUCCESS(status)) {
+        uint32_t device_count = 0;
+        if (parallel) {
+            status = VulkanRunnerBeginParallelBatch(&device_count);
+        }
+        if (TEST_SUCCESS(status)) {
+            /* Compiling up front only saves time, a test whose pipelines weren't built compiles them itself */
+            test_status prepare_status = _RunnerPrepareTests(&selected_tests, device_id);
+            if (!TEST_SUCCESS(prepare_status)) {
+                WARNING("Failed to build pipelines ahead of time: 0x%08lx %s\n", prepare_status, LoggerLookUpError(prepare_status));
+            }
+            if (device_count > 1) {
+                status = _RunnerExecuteParallel(&selected_tests, device_count);
+            } else {
+                status = _RunnerExecuteSequential(&selected_tests, device_id);
+            }
+        }
+        test_status end_status = VulkanRunnerEndBatch();
+        if (TEST_SUCCESS(status)) {
+            status = end_status;
         }
     }
-    return TEST_UNKNOWN_TESTCASE;
+    HelperArrayListClean(&selected_tests);
+    return status;
 }
 
 test_status RunnerRegisterTests() {
@@ -63,18 +141,452 @@ test_status RunnerRegisterTests() {
     TEST_RETFAIL(status);
     status = VulkanRunnerRegisterTests();
     TEST_RETFAIL(status);
-    return status;
+    return _RunnerBuildIndex();
 }
 
 test_status RunnerCleanUp() {
+    free(test_index);
+    test_index = NULL;
+    test_index_size = 0;
     return HelperArrayListClean(&test_list);
 }
 
+/* Same selection as RunnerExecuteTests without running anything */
+test_status RunnerValidateTests(const char *test_names) {
+    if (test_names == NULL) {
+        return TEST_INVALID_PARAMETER;
+    }
+    helper_arraylist selected_tests = {0};
+    test_status status = _RunnerSelectTests(test_names, &selected_tests);
+    if (HelperArrayListRawData(&selected_tests) != NULL) {
+        HelperArrayListClean(&selected_tests);
+    }
+    return status;
+}
+
+/* Needs an open batch, the pipelines are compiled into the batch's devices. Later batches nested in it skip the compilation */
+test_status RunnerPrepareTests(const char *test_names, int32_t device_id) {
+    if (test_names == NULL) {
+        return TEST_INVALID_PARAMETER;
+    }
+    helper_arraylist selected_tests = {0};
+    test_status status = _RunnerSelectTests(test_names, &selected_tests);
+    if (TEST_SUCCESS(status)) {
+        status = _RunnerPrepareTests(&selected_tests, device_id);
+    }
+    if (HelperArrayListRawData(&selected_tests) != NULL) {
+        HelperArrayListClean(&selected_tests);
+    }
+    return status;
+}
+
 test_status RunnerPrintTests() {
     size_t size = HelperArrayListSize(&test_list);
     for (uint32_t i = 0; i < size; i++) {
         runner_test *test_entry = (runner_test *)HelperArrayListGet(&test_list, i);
-        INFO("    %s (Version %u.%u.%u)\n", test_entry->name, TEST_VER_MAJOR(test_entry->version), TEST_VER_MINOR(test_entry->version), TEST_VER_PATCH(test_entry->version));
+        INFO("    %s (Version %u.%u.%u, tags: %s)\n", test_entry->name, TEST_VER_MAJOR(test_entry->version), TEST_VER_MINOR(test_entry->version), TEST_VER_PATCH(test_entry->version), test_entry->tags);
     }
     return TEST_OK;
+}
+
+/* Exact name lookup, name doesn't have to be terminated */
+runner_test *RunnerFindTest(const char *test_name, size_t name_length) {
+    if (test_index == NULL || test_name == NULL) {
+        return NULL;
+    }
+    for (uint32_t slot = _RunnerHashName(test_name, name_length) & (test_index_size - 1); test_index[slot] != 0; slot = (slot + 1) & (test_index_size - 1)) {
+        runner_test *test_entry = (runner_test *)HelperArrayListGet(&test_list, test_index[slot] - 1);
+        if (strncmp(test_entry->name, test_name, name_length) == 0 && test_entry->name[name_length] == '\0') {
+            return test_entry;
+        }
+    }
+    return NULL;
+}
+
+/* Limited to the device currently at device_id if one is given, uuid has to outlive the filter */
+static test_status _RunnerGetHistoryFilter(const char *test_names, int32_t device_id, uint8_t *uuid, history_filter *filter) {
+    memset(filter, 0, sizeof(history_filter));
+    filter->test_patterns = test_names;
+    if (device_id >= 0) {
+        test_status status = VulkanRunnerGetDeviceUUID((uint32_t)device_id, uuid);
+        TEST_RETFAIL(status);
+        filter->uuid = uuid;
+    }
+    return TEST_OK;
+}
+
+test_status RunnerPrintHistory(const char *test_names, int32_t device_id) {
+    history_filter filter;
+    uint8_t uuid[RESULTS_UUID_SIZE];
+    test_status status = _RunnerGetHistoryFilter(test_names, device_id, uuid, &filter);
+    TEST_RETFAIL(status);
+    return HistoryPrint(&filter);
+}
+
+test_status RunnerCompareResults(const char *baseline, const char *candidate, const char *test_names, int32_t device_id, double threshold) {
+    history_filter filter;
+    uint8_t uuid[RESULTS_UUID_SIZE];
+    test_status status = _RunnerGetHistoryFilter(test_names, device_id, uuid, &filter);
+    TEST_RETFAIL(status);
+    return CompareRun(baseline, candidate, &filter, threshold);
+}
+
+/* Tests run in the order they are listed, --filter only drops tests and never adds any */
+static test_status _RunnerSelectTests(const char *test_names, helper_arraylist *selected_tests) {
+    size_t size = HelperArrayListSize(&test_list);
+    const char *filter = MainGetTestFilter();
+    size_t pattern_length = 0;
+    for (const char *pattern = HelperNextPattern(test_names, &pattern_length); pattern != NULL; pattern = HelperNextPattern(pattern + pattern_length, &pattern_length)) {
+        bool matched = false;
+        bool wildcard = memchr(pattern, '*', pattern_length) != NULL || memchr(pattern, '?', pattern_length) != NULL;
+        for (uint32_t i = 0; i < (wildcard ? size : 1); i++) {
+            runner_test *test_entry = wildcard ? (runner_test *)HelperArrayListGet(&test_list, i) : RunnerFindTest(pattern, pattern_length);
+            if (test_entry == NULL || (wildcard && !HelperMatchPattern(pattern, pattern_length, test_entry->name))) {
+                continue;
+            }
+            matched = true;
+            if (_RunnerMatchesFilter(test_entry, filter)) {
+                test_status status = HelperArrayListAdd(selected_tests, &test_entry, sizeof(runner_test *), NULL);
+                TEST_RETFAIL(status);
+            }
+        }
+        if (!matched) {
+            FATAL("No test matches \"%.*s\"\n", (int)pattern_length, pattern);
+            return TEST_UNKNOWN_TESTCASE;
+        }
+    }
+    if (HelperArrayListSize(selected_tests) == 0) {
+        if (filter != NULL) {
+            FATAL("No test matches the filter \"%s\"\n", filter);
+        }
+        return TEST_UNKNOWN_TESTCASE;
+    }
+    return TEST_OK;
+}
+
+/* FNV-1a */
+static uint32_t _RunnerHashName(const char *name, size_t name_length) {
+    uint32_t hash = 2166136261U;
+    for (size_t i = 0; i < name_length; i++) {
+        hash ^= (uint8_t)name[i];
+        hash *= 16777619U;
+    }
+    return hash;
+}
+
+/* Built once everything is registered, the test list doesn't change after that */
+static test_status _RunnerBuildIndex() {
+    uint32_t test_count = (uint32_t)HelperArrayListSize(&test_list);
+    test_index_size = 1;
+    while (test_index_size < test_count * RUNNER_INDEX_LOAD_FACTOR) {
+        test_index_size *= 2;
+    }
+    test_index = malloc(test_index_size * sizeof(uint32_t));
+    if (test_index == NULL) {
+        test_index_size = 0;
+        return TEST_OUT_OF_MEMORY;
+    }
+    memset(test_index, 0, test_index_size * sizeof(uint32_t));
+    for (uint32_t i = 0; i < test_count; i++) {
+        runner_test *test_entry = (runner_test *)HelperArrayListGet(&test_list, i);
+        size_t name_length = strlen(test_entry->name);
+        if (RunnerFindTest(test_entry->name, name_length) != NULL) {
+            FATAL("%s is registered twice\n", test_entry->name);
+            return TEST_PROGRAMMING_ERROR;
+        }
+        uint32_t slot = _RunnerHashName(test_entry->name, name_length) & (test_index_size - 1);
+        while (test_index[slot] != 0) {
+            slot = (slot + 1) & (test_index_size - 1);
+        }
+        test_index[slot] = i + 1;
+    }
+    return TEST_OK;
+}
+
+/* Alternatives are comma separated, the terms of one are joined by '+' and all of them have to hold */
+static bool _RunnerMatchesFilter(runner_test *test_entry, const char *filter) {
+    if (filter == NULL) {
+        return true;
+    }
+    size_t alternative_length = 0;
+    for (const char *alternative = HelperNextPattern(filter, &alternative_length); alternative != NULL; alternative = HelperNextPattern(alternative + alternative_length, &alternative_length)) {
+        bool matched = true;
+        size_t position = 0;
+        while (matched && position < alternative_length) {
+            const char *term = alternative + position;
+            const char *separator = memchr(term, '+', alternative_length - position);
+            size_t term_length = (separator != NULL) ? (size_t)(separator - term) : (alternative_length - position);
+            position += term_length + 1;
+            while (term_length > 0 && term[0] == ' ') {
+                term++;
+                term_length--;
+            }
+            while (term_length > 0 && term[term_length - 1] == ' ') {
+                term_length--;
+            }
+            bool negated = term_length > 0 && term[0] == '!';
+            if (negated) {
+                term++;
+                term_length--;
+            }
+            matched = _RunnerMatchesTerm(test_entry, term, term_length) != negated;
+        }
+        if (matched) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* '@' matches the pattern against the tags instead of the name */
+static bool _RunnerMatchesTerm(runner_test *test_entry, const char *term, size_t term_length) {
+    if (term_length == 0 || term[0] != '@') {
+        return HelperMatchPattern(term, term_length, test_entry->name);
+    }
+    size_t tag_length = 0;
+    for (const char *tag = HelperNextPattern(test_entry->tags, &tag_length); tag != NULL; tag = HelperNextPattern(tag + tag_length, &tag_length)) {
+        char tag_name[RUNNER_MAXIMUM_NAME_LENGTH];
+        snprintf(tag_name, sizeof(tag_name), "%.*s", (int)tag_length, tag);
+        if (HelperMatchPattern(term + 1, term_length - 1, tag_name)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* A test skipped for missing device features doesn't fail the batch */
+static bool _RunnerIsFailure(test_status status) {
+    return !TEST_SUCCESS(status) && status != TEST_SKIPPED;
+}
+
+static bool _RunnerIsHostExclusive(runner_test *test_entry) {
+    if ((test_entry->flags & RUNNER_TEST_FLAG_HOST_EXCLUSIVE) != 0) {
+        return true;
+    }
+    return HelperMatchPatternList(MainGetSerializedTests(), test_entry->name);
+}
+
+/* Every test still runs if an earlier one fails, the first failure is what gets returned */
+static test_status _RunnerExecuteSequential(helper_arraylist *selected_tests, int32_t device_id) {
+    size_t selected_count = HelperArrayListSize(selected_tests);
+    test_status *results = malloc(selected_count * sizeof(test_status));
+    if (results == NULL) {
+        return TEST_OUT_OF_MEMORY;
+    }
+    test_status status = TEST_OK;
+    for (uint32_t i = 0; i < selected_count; i++) {
+        if (i > 0) {
+            SEPARATOR();
+        }
+        runner_test *test_entry = *(runner_test **)HelperArrayListGet(selected_tests, i);
+        results[i] = _RunnerExecuteTest(test_entry, device_id, NULL);
+        if (_RunnerIsFailure(results[i])) {
+            WARNING("%s failed: 0x%08lx %s\n", test_entry->name, results[i], LoggerLookUpError(results[i]));
+            if (TEST_SUCCESS(status)) {
+                status = results[i];
+            }
+        }
+    }
+    SEPARATOR();
+    INFO("Batch results:\n");
+    for (uint32_t i = 0; i < selected_count; i++) {
+        runner_test *test_entry = *(runner_test **)HelperArrayListGet(selected_tests, i);
+        if (TEST_SUCCESS(results[i])) {
+            INFO("    %s: OK\n", test_entry->name);
+        } else if (results[i] == TEST_SKIPPED) {
+            INFO("    %s: Skipped\n", test_entry->name);
+        } else {
+            INFO("    %s: 0x%08lx %s\n", test_entry->name, results[i], LoggerLookUpError(results[i]));
+        }
+    }
+    free(results);
+    return status;
+}
+
+/*
+ * One worker per device works through the whole list on its own, so different devices are usually busy with different tests.
+ * Each worker is pinned to its share of the processors, buffer fills and memcpy threads it spawns stay there too.
+ * A worker's output is held back until its test finishes so results of one device are never interleaved with another's.
+ */
+static test_status _RunnerExecuteParallel(helper_arraylist *selected_tests, uint32_t device_count) {
+    size_t selected_count = HelperArrayListSize(selected_tests);
+    test_status status = TEST_OK;
+    runner_worker *workers = NULL;
+    void **worker_data = NULL;
+    helper_thread *threads = NULL;
+    test_status *results = malloc(selected_count * (device_count + 1) * sizeof(test_status));
+    if (results == NULL) {
+        return TEST_OUT_OF_MEMORY;
+    }
+    for (uint32_t i = 0; i < selected_count * (device_count + 1); i++) {
+        results[i] = TEST_OK;
+    }
+    workers = malloc(device_count * sizeof(runner_worker));
+    worker_data = malloc(device_count * sizeof(void *));
+    helper_mutex host_mutex = HelperCreateMutex();
+    if (workers == NULL || worker_data == NULL || host_mutex == NULL) {
+        status = TEST_OUT_OF_MEMORY;
+        goto cleanup;
+    }
+
+    /* Tests that cover every device by themselves run once, up front */
+    for (uint32_t i = 0; i < selected_count; i++) {
+        runner_test *test_entry = *(runner_test **)HelperArrayListGet(selected_tests, i);
+        if ((test_entry->flags & RUNNER_TEST_FLAG_ALL_DEVICES) != 0) {
+            results[i] = _RunnerExecuteTest(test_entry, -1, NULL);
+            SEPARATOR();
+        }
+    }
+
+    uint32_t processor_count = HelperGetProcessorCount();
+    uint32_t processors_per_device = max(1, processor_count / device_count);
+    INFO("Running on %lu devices in parallel, %lu processors each\n", device_count, processors_per_device);
+    for (uint32_t i = 0; i < device_count; i++) {
+        workers[i].selected_tests = selected_tests;
+        workers[i].results = &(results[selected_count * (i + 1)]);
+        workers[i].device_index = i;
+        workers[i].first_processor = (i * processors_per_device) % max(1, processor_count);
+        workers[i].processor_count = processors_per_device;
+        workers[i].host_mutex = host_mutex;
+        workers[i].current_test = 0;
+        workers[i].finished = 0;
+        workers[i].abandoned = 0;
+        worker_data[i] = &(workers[i]);
+    }
+    threads = HelperCreateThreads(device_count, _RunnerWorkerThread, worker_data);
+    if (threads == NULL) {
+        status = TEST_FAILED_TO_SPAWN_THREAD;
+        goto cleanup;
+    }
+    /* A worker stuck past its timeout is left behind so the other devices still finish their tests */
+    bool any_abandoned = false;
+    for (uint32_t i = 0; i < device_count; i++) {
+        while (!HelperAtomicBoolRead(&(workers[i].finished)) && !HelperAtomicBoolRead(&(workers[i].abandoned))) {
+            HelperSleep(WATCHDOG_POLL_MS);
+        }
+        if (HelperAtomicBoolRead(&(workers[i].finished))) {
+            HelperWaitForThread(threads[i]);
+            HelperCleanUpThread(threads[i]);
+            continue;
+        }
+        any_abandoned = true;
+        workers[i].results[workers[i].current_test] = TEST_TIMEOUT;
+        for (uint32_t j = workers[i].current_test + 1; j < selected_count; j++) {
+            workers[i].results[j] = TEST_SKIPPED;
+        }
+    }
+    free(threads);
+
+    SEPARATOR();
+    INFO("Batch results:\n");
+    for (uint32_t i = 0; i < selected_count; i++) {
+        runner_test *test_entry = *(runner_test **)HelperArrayListGet(selected_tests, i);
+        bool all_devices = (test_entry->flags & RUNNER_TEST_FLAG_ALL_DEVICES) != 0;
+        for (uint32_t j = 0; j < (all_devices ? 1 : device_count); j++) {
+            test_status result = all_devices ? results[i] : results[selected_count * (j + 1) + i];
+            if (TEST_SUCCESS(status) && _RunnerIsFailure(result)) {
+                status = result;
+            }
+            if (all_devices && TEST_SUCCESS(result)) {
+                INFO("    %s: OK\n", test_entry->name);
+            } else if (all_devices) {
+                INFO("    %s: 0x%08lx %s\n", test_entry->name, result, LoggerLookUpError(result));
+            } else if (TEST_SUCCESS(result)) {
+                INFO("    %s on device %lu: OK\n", test_entry->name, j);
+            } else if (result == TEST_SKIPPED) {
+                INFO("    %s on device %lu: Skipped\n", test_entry->name, j);
+            } else {
+                INFO("    %s on device %lu: 0x%08lx %s\n", test_entry->name, j, result, LoggerLookUpError(result));
+            }
+        }
+    }
+    /* The stuck thread still references the workers and its device, tearing those down under it isn't safe */
+    if (any_abandoned) {
+        FATAL("A test is still stuck after its timeout, ending the process\n");
+        LoggerChannelSendError(TEST_TIMEOUT);
+        fflush(stdout);
+        _Exit(WATCHDOG_EXIT_CODE);
+    }
+
+cleanup:
+    HelperCleanUpMutex(host_mutex);
+    free(worker_data);
+    free(workers);
+    free(results);
+    return status;
+}
+
+static void _RunnerWorkerThread(uint32_t thread_id, void *data) {
+    runner_worker *worker = (runner_worker *)data;
+    /* An unpinned worker still measures correctly, it is just more exposed to its neighbours */
+    HelperPinThread(worker->first_processor, worker->processor_count);
+    size_t selected_count = HelperArrayListSize(worker->selected_tests);
+    for (uint32_t i = 0; i < selected_count; i++) {
+        runner_test *test_entry = *(runner_test **)HelperArrayListGet(worker->selected_tests, i);
+        if ((test_entry->flags & RUNNER_TEST_FLAG_ALL_DEVICES) != 0) {
+            continue;
+        }
+        bool host_exclusive = _RunnerIsHostExclusive(test_entry);
+        if (host_exclusive) {
+            HelperLockMutex(worker->host_mutex);
+        }
+        LoggerBeginCapture();
+        SEPARATOR();
+        INFO("Device %lu\n", worker->device_index);
+        worker->current_test = i;
+        /* The other workers wait on a host exclusive test's mutex, so one that hangs still ends the process */
+        worker->results[i] = _RunnerExecuteTest(test_entry, (int32_t)worker->device_index, host_exclusive ? NULL : &(worker->abandoned));
+        if (_RunnerIsFailure(worker->results[i])) {
+            WARNING("%s failed on device %lu: 0x%08lx %s\n", test_entry->name, worker->device_index, worker->results[i], LoggerLookUpError(worker->results[i]));
+        }
+        LoggerEndCapture();
+        if (host_exclusive) {
+            HelperUnlockMutex(worker->host_mutex);
+        }
+    }
+    ResultsCleanUp();
+    HelperAtomicBoolSet(&(worker->finished));
+}
+
+static test_status _RunnerExecuteTest(runner_test *test_entry, int32_t device_id, helper_atomic_bool *abandoned) {
+    LOG("TESTV", "%s %u.%u.%u\n", test_entry->name, TEST_VER_MAJOR(test_entry->version), TEST_VER_MINOR(test_entry->version), TEST_VER_PATCH(test_entry->version));
+    SEPARATOR();
+    test_status status = WatchdogArm(test_entry->name, MainGetTestTimeout(), abandoned);
+    TEST_RETFAIL(status);
+    status = test_entry->entry(device_id, test_entry->config_data);
+    WatchdogDisarm();
+    return status;
+}
+
+/* The devices of every test are enumerated once for the whole selection, like in a batch */
+static test_status _RunnerEstimateTests(helper_arraylist *selected_tests, int32_t device_id) {
+    test_status status = VulkanRunnerBeginBatch();
+    TEST_RETFAIL(status);
+    size_t selected_count = HelperArrayListSize(selected_tests);
+    for (uint32_t i = 0; i < selected_count && TEST_SUCCESS(status); i++) {
+        runner_test *test_entry = *(runner_test **)HelperArrayListGet(selected_tests, i);
+        if (test_entry->estimate != NULL) {
+            status = test_entry->estimate(device_id, test_entry->config_data);
+        }
+    }
+    test_status end_status = VulkanRunnerEndBatch();
+    return TEST_SUCCESS(status) ? end_status : status;
+}
+
+/* A test that fails to queue its pipelines only loses the head start, the others are still built */
+static test_status _RunnerPrepareTests(helper_arraylist *selected_tests, int32_t device_id) {
+    test_status status = VulkanRunnerBeginPipelineBuild(device_id);
+    TEST_RETFAIL(status);
+    size_t selected_count = HelperArrayListSize(selected_tests);
+    for (uint32_t i = 0; i < selected_count; i++) {
+        runner_test *test_entry = *(runner_test **)HelperArrayListGet(selected_tests, i);
+        if (test_entry->prepare == NULL) {
+            continue;
+        }
+        status = test_entry->prepare(device_id, test_entry->config_data);
+        if (!TEST_SUCCESS(status)) {
+            WARNING("Failed to queue the pipelines of %s: 0x%08lx %s\n", test_entry->name, status, LoggerLookUpError(status));
+        }
+    }
+    return VulkanRunnerEndPipelineBuild();
 }
\ No newline at end of file
@@ -0,0 +1,143 @@
+// Copyright (c) 2021 - 2022, Nemes <nemes@nemez.net>
+// SPDX-License-Identifier: MIT
+// 
+// MIT License
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software andassociated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, andto permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+// 
+// The above copyright notice andthis permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "main.h"
+#include "logger.h"
+#include "helper.h"
+#include "soak.h"
+#include "statistics.h"
+#include "results.h"
+
+test_status SoakInitialize(uint32_t minutes, soak_series *series) {
+    if (series == NULL || minutes == 0 || minutes > SOAK_MAXIMUM_MINUTES) {
+        return TEST_INVALID_PARAMETER;
+    }
+    memset(series, 0, sizeof(soak_series));
+    series->duration_us = (uint64_t)minutes * 60 * 1000000;
+    series->bucket_us = max(SOAK_MINIMUM_BUCKET_MS * 1000ULL, (series->duration_us + SOAK_MAXIMUM_BUCKETS - 1) / SOAK_MAXIMUM_BUCKETS);
+    /* One spare bucket for the run that finishes after the duration is up */
+    series->bucket_count = (uint32_t)((series->duration_us + series->bucket_us - 1) / series->bucket_us) + 1;
+    series->buckets = malloc(series->bucket_count * sizeof(soak_bucket));
+    if (series->buckets == NULL) {
+        return TEST_OUT_OF_MEMORY;
+    }
+    memset(series->buckets, 0, series->bucket_count * sizeof(soak_bucket));
+    HelperTimerReset(&(series->timer));
+    return TEST_OK;
+}
+
+test_status SoakCleanUp(soak_series *series) {
+    if (series == NULL) {
+        return TEST_INVALID_PARAMETER;
+    }
+    free(series->buckets);
+    series->buckets = NULL;
+    return TEST_OK;
+}
+
+/* A run is accounted to the bucket it finished in, buckets are much wider than a single run */
+void SoakAddRun(soak_series *series, uint64_t time_us, double work) {
+    series->elapsed_us = HelperTimerGet(&(series->timer));
+    uint32_t bucket_index = (uint32_t)min(series->elapsed_us / series->bucket_us, (uint64_t)series->bucket_count - 1);
+    series->buckets[bucket_index].work += work;
+    series->buckets[bucket_index].busy_us += time_us;
+}
+
+bool SoakIsFinished(soak_series *series) {
+    return series->elapsed_us >= series->duration_us;
+}
+
+double SoakGetBucketRate(soak_series *series, uint32_t bucket_index) {
+    soak_bucket *bucket = &(series->buckets[bucket_index]);
+    if (bucket->busy_us == 0) {
+        return 0.0;
+    }
+    return bucket->work * 1000000.0 / (double)bucket->busy_us;
+}
+
+void SoakSummarize(soak_series *series, soak_summary *summary) {
+    memset(summary, 0, sizeof(soak_summary));
+    uint32_t used_buckets = (uint32_t)min(series->elapsed_us / series->bucket_us + 1, (uint64_t)series->bucket_count);
+    for (uint32_t i = 0; i < used_buckets; i++) {
+        summary->peak = max(summary->peak, SoakGetBucketRate(series, i));
+    }
+    uint32_t sustained_start = used_buckets - max(1, used_buckets / SOAK_SUSTAINED_FRACTION);
+    double sustained_work = 0.0;
+    uint64_t sustained_busy_us = 0;
+    for (uint32_t i = sustained_start; i < used_buckets; i++) {
+        sustained_work += series->buckets[i].work;
+        sustained_busy_us += series->buckets[i].busy_us;
+    }
+    summary->sustained = (sustained_busy_us > 0) ? (sustained_work * 1000000.0 / (double)sustained_busy_us) : 0.0;
+
+    /* Throttling starts at the first bucket after which the rate never recovers to near the peak */
+    double threshold = summary->peak * SOAK_THROTTLE_THRESHOLD;
+    if (summary->sustained < threshold) {
+        summary->throttled = true;
+        uint32_t start = used_buckets;
+        while (start > 0 && (series->buckets[start - 1].busy_us == 0 || SoakGetBucketRate(series, start - 1) < threshold)) {
+            start--;
+        }
+        summary->throttle_start_us = (uint64_t)start * series->bucket_us;
+    }
+}
+
+void SoakLogResult(soak_series *series, const char *unit_name, double unit_scale) {
+    soak_summary summary;
+    SoakSummarize(series, &summary);
+    uint32_t used_buckets = (uint32_t)min(series->elapsed_us / series->bucket_us + 1, (uint64_t)series->bucket_count);
+    if (MainGetTestResultFormat() == test_result_csv) {
+        LOG_PLAIN("Soak time (s),Rate (%s)\n", unit_name);
+        for (uint32_t i = 0; i < used_buckets; i++) {
+            LOG_PLAIN("%.1f,%.3f\n", (double)i * series->bucket_us / 1000000.0, SoakGetBucketRate(series, i) * unit_scale);
+        }
+        LOG_PLAIN("Soak sustained (%s),%.3f\n", unit_name, summary.sustained * unit_scale);
+        LOG_PLAIN("Soak peak (%s),%.3f\n", unit_name, summary.peak * unit_scale);
+        if (summary.throttled) {
+            LOG_PLAIN("Throttling start (s),%.1f\n", summary.throttle_start_us / 1000000.0);
+        } else {
+            LOG_PLAIN("Throttling start (s),\n");
+        }
+    } else if (MainGetTestResultFormat() == test_result_raw) {
+        for (uint32_t i = 0; i < used_buckets; i++) {
+            LOG_RESULT_SERIES(i, (uint64_t)i * series->bucket_us / 1000, SoakGetBucketRate(series, i));
+        }
+        LOG_RESULT_METADATA("soak_sustained", "%.3f", summary.sustained);
+        LOG_RESULT_METADATA("soak_peak", "%.3f", summary.peak);
+        LOG_RESULT_METADATA("soak_throttle_start_ms", "%lld", summary.throttled ? (int64_t)(summary.throttle_start_us / 1000) : -1LL);
+    } else if (MainGetTestResultFormat() == test_result_json) {
+        ResultsAddMetadata("soak_sustained", summary.sustained);
+        ResultsAddMetadata("soak_peak", summary.peak);
+        ResultsAddMetadata("soak_throttle_start_ms", summary.throttled ? (double)(summary.throttle_start_us / 1000) : -1.0);
+    } else {
+        for (uint32_t i = 0; i < used_buckets; i++) {
+            INFO("Soak %.1fs: %.3f %s\n", (double)i * series->bucket_us / 1000000.0, SoakGetBucketRate(series, i) * unit_scale, unit_name);
+        }
+        INFO("Soak over %.1f minutes: sustained %.3f %s, peak %.3f %s (%.1f%%)\n", series->elapsed_us / 60000000.0, summary.sustained * unit_scale, unit_name, summary.peak * unit_scale, unit_name, (summary.peak > 0.0) ? (100.0 * summary.sustained / summary.peak) : 0.0);
+        if (summary.throttled) {
+            INFO("Throttling started after %.1fs\n", summary.throttle_start_us / 1000000.0);
+        } else {
+            INFO("No throttling detected\n");
+        }
+    }
+}
\ No newline at end of file
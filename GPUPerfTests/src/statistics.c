@@ -0,0 +1,274 @@
+// Copyright (c) 2021 - 2022, Nemes <nemes@nemez.net>
+// SPDX-License-Identifier: MIT
+// 
+// MIT License
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software andassociated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, andto permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+// 
+// The above copyright notice andthis permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "main.h"
+#include "logger.h"
+#include "helper.h"
+#include "statistics.h"
+#include <math.h>
+
+/* Two-sided 95% critical values of Student's t distribution for 1-30 degrees of freedom */
+static const double _statistics_t_table[] = {
+    12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+    2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+    2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+};
+#define _STATISTICS_T_TABLE_SIZE    (sizeof(_statistics_t_table) / sizeof(_statistics_t_table[0]))
+#define _STATISTICS_Z_95            (1.960)
+
+static int _StatisticsCompareDoubles(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/* Linearly interpolated percentile of an already sorted array */
+static double _StatisticsPercentile(const double *sorted, size_t count, double percentile) {
+    if (count == 1) {
+        return sorted[0];
+    }
+    double position = percentile * (double)(count - 1);
+    size_t lower = (size_t)position;
+    if (lower + 1 >= count) {
+        return sorted[count - 1];
+    }
+    double fraction = position - (double)lower;
+    return sorted[lower] + (sorted[lower + 1] - sorted[lower]) * fraction;
+}
+
+test_status StatisticsInitialize(statistics_samples *samples) {
+    if (samples == NULL) {
+        return TEST_INVALID_PARAMETER;
+    }
+    return HelperArrayListInitialize(&(samples->samples), sizeof(double));
+}
+
+test_status StatisticsCleanUp(statistics_samples *samples) {
+    if (samples == NULL) {
+        return TEST_INVALID_PARAMETER;
+    }
+    return HelperArrayListClean(&(samples->samples));
+}
+
+test_status StatisticsAddSample(statistics_samples *samples, double value) {
+    if (samples == NULL) {
+        return TEST_INVALID_PARAMETER;
+    }
+    return HelperArrayListAdd(&(samples->samples), &value, sizeof(value), NULL);
+}
+
+void StatisticsReset(statistics_samples *samples) {
+    samples->samples.size = 0;
+}
+
+size_t StatisticsGetSampleCount(statistics_samples *samples) {
+    return HelperArrayListSize(&(samples->samples));
+}
+
+test_status StatisticsSummarize(statistics_samples *samples, statistics_summary *summary) {
+    if (samples == NULL || summary == NULL) {
+        return TEST_INVALID_PARAMETER;
+    }
+    memset(summary, 0, sizeof(statistics_summary));
+    size_t count = HelperArrayListSize(&(samples->samples));
+    if (count == 0) {
+        return TEST_OK;
+    }
+    double *sorted = malloc(count * sizeof(double));
+    if (sorted == NULL) {
+        return TEST_OUT_OF_MEMORY;
+    }
+    memcpy(sorted, HelperArrayListRawData(&(samples->samples)), count * sizeof(double));
+    qsort(sorted, count, sizeof(double), &_StatisticsCompareDoubles);
+
+    /* Tukey's fences, only meaningful with a handful of samples */
+    size_t first = 0;
+    size_t last = count;
+    if (count >= STATISTICS_OUTLIER_MINIMUM_SAMPLES) {
+        double q1 = _StatisticsPercentile(sorted, count, 0.25);
+        double q3 = _StatisticsPercentile(sorted, count, 0.75);
+        double fence = (q3 - q1) * STATISTICS_OUTLIER_IQR_FACTOR;
+        while (first < last && sorted[first] < q1 - fence) {
+            first++;
+        }
+        while (last > first && sorted[last - 1] > q3 + fence) {
+            last--;
+        }
+    }
+    const double *kept = sorted + first;
+    size_t kept_count = last - first;
+
+    double sum = 0.0;
+    for (size_t i = 0; i < kept_count; i++) {
+        sum += kept[i];
+    }
+    double mean = sum / (double)kept_count;
+    double squared_deviations = 0.0;
+    for (size_t i = 0; i < kept_count; i++) {
+        squared_deviations += (kept[i] - mean) * (kept[i] - mean);
+    }
+    double standard_deviation = (kept_count > 1) ? sqrt(squared_deviations / (double)(kept_count - 1)) : 0.0;
+    double margin = 0.0;
+    if (kept_count > 1) {
+        size_t degrees_of_freedom = kept_count - 1;
+        double t = (degrees_of_freedom <= _STATISTICS_T_TABLE_SIZE) ? _statistics_t_table[degrees_of_freedom - 1] : _STATISTICS_Z_95;
+        margin = t * standard_deviation / sqrt((double)kept_count);
+    }
+
+    summary->sample_count = (uint32_t)kept_count;
+    summary->rejected_outliers = (uint32_t)(count - kept_count);
+    summary->minimum = kept[0];
+    summary->maximum = kept[kept_count - 1];
+    summary->mean = mean;
+    summary->median = _StatisticsPercentile(kept, kept_count, 0.5);
+    summary->p5 = _StatisticsPercentile(kept, kept_count, 0.05);
+    summary->p95 = _StatisticsPercentile(kept, kept_count, 0.95);
+    summary->standard_deviation = standard_deviation;
+    summary->confidence_low = mean - margin;
+    summary->confidence_high = mean + margin;
+
+    free(sorted);
+    return TEST_OK;
+}
+
+void StatisticsScaleSummary(statistics_summary *summary, double factor) {
+    summary->minimum *= factor;
+    summary->maximum *= factor;
+    summary->mean *= factor;
+    summary->median *= factor;
+    summary->p5 *= factor;
+    summary->p95 *= factor;
+    summary->standard_deviation *= factor;
+    summary->confidence_low *= factor;
+    summary->confidence_high *= factor;
+}
+
+typedef struct statistics_ranked_sample_t {
+    double value;
+    bool first;
+} statistics_ranked_sample;
+
+static int _StatisticsCompareRanked(const void *a, const void *b) {
+    return _StatisticsCompareDoubles(&(((const statistics_ranked_sample *)a)->value), &(((const statistics_ranked_sample *)b)->value));
+}
+
+/*
+ * P(U <= u) for samples of m and n without ties. The counts of each U are the coefficients of the Gaussian
+ * binomial [m + n choose m], built one factor (1 - q^(n + i)) / (1 - q^i) at a time.
+ */
+static test_status _StatisticsMannWhitneyExact(size_t m, size_t n, double u, double *probability) {
+    size_t degree = m * n;
+    double *counts = malloc((degree + 1) * sizeof(double));
+    if (counts == NULL) {
+        return TEST_OUT_OF_MEMORY;
+    }
+    memset(counts, 0, (degree + 1) * sizeof(double));
+    counts[0] = 1.0;
+    for (size_t i = 1; i <= m; i++) {
+        for (size_t k = degree; k >= n + i; k--) {
+            counts[k] -= counts[k - n - i];
+        }
+        for (size_t k = i; k <= degree; k++) {
+            counts[k] += counts[k - i];
+        }
+    }
+    double total = 0.0;
+    double below = 0.0;
+    for (size_t k = 0; k <= degree; k++) {
+        total += counts[k];
+        if ((double)k <= u) {
+            below += counts[k];
+        }
+    }
+    free(counts);
+    *probability = below / total;
+    return TEST_OK;
+}
+
+/* Two-sided p-value of the rank-sum test, exact for small samples without ties, normal approximation with tie correction otherwise */
+test_status StatisticsMannWhitney(statistics_samples *a, statistics_samples *b, double *p_value) {
+    if (a == NULL || b == NULL || p_value == NULL) {
+        return TEST_INVALID_PARAMETER;
+    }
+    size_t m = HelperArrayListSize(&(a->samples));
+    size_t n = HelperArrayListSize(&(b->samples));
+    *p_value = 1.0;
+    if (m == 0 || n == 0) {
+        return TEST_OK;
+    }
+    size_t count = m + n;
+    statistics_ranked_sample *ranked = malloc(count * sizeof(statistics_ranked_sample));
+    if (ranked == NULL) {
+        return TEST_OUT_OF_MEMORY;
+    }
+    const double *a_data = (const double *)HelperArrayListRawData(&(a->samples));
+    const double *b_data = (const double *)HelperArrayListRawData(&(b->samples));
+    for (size_t i = 0; i < m; i++) {
+        ranked[i].value = a_data[i];
+        ranked[i].first = true;
+    }
+    for (size_t i = 0; i < n; i++) {
+        ranked[m + i].value = b_data[i];
+        ranked[m + i].first = false;
+    }
+    qsort(ranked, count, sizeof(statistics_ranked_sample), &_StatisticsCompareRanked);
+
+    /* Tied values share the average of the ranks they span */
+    double rank_sum = 0.0;
+    double tie_correction = 0.0;
+    for (size_t i = 0; i < count;) {
+        size_t j = i + 1;
+        while (j < count && ranked[j].value == ranked[i].value) {
+            j++;
+        }
+        double rank = (double)(i + 1 + j) / 2.0;
+        for (size_t k = i; k < j; k++) {
+            if (ranked[k].first) {
+                rank_sum += rank;
+            }
+        }
+        double tied = (double)(j - i);
+        tie_correction += tied * tied * tied - tied;
+        i = j;
+    }
+    free(ranked);
+
+    double u_a = rank_sum - (double)m * (double)(m + 1) / 2.0;
+    double u = min(u_a, (double)m * (double)n - u_a);
+    if (tie_correction == 0.0 && count <= STATISTICS_EXACT_RANK_TEST_SAMPLES) {
+        double probability = 0.0;
+        test_status status = _StatisticsMannWhitneyExact(m, n, u, &probability);
+        TEST_RETFAIL(status);
+        *p_value = min(1.0, 2.0 * probability);
+        return TEST_OK;
+    }
+    double mean = (double)m * (double)n / 2.0;
+    double variance = (double)m * (double)n / 12.0 * (((double)count + 1.0) - tie_correction / ((double)count * ((double)count - 1.0)));
+    if (variance <= 0.0) {
+        /* Every sample is the same value */
+        return TEST_OK;
+    }
+    double z = max(0.0, fabs(u_a - mean) - 0.5) / sqrt(variance);
+    *p_value = min(1.0, erfc(z / sqrt(2.0)));
+    return TEST_OK;
+}
\ No newline at end of file
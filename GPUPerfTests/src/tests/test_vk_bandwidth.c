@@ -24,14 +24,27 @@
 #include "main.h"
 #include "logger.h"
 #include "vulkan_helper.h"
+#include "runner.h"
+#include "planner.h"
 #include "vulkan_runner.h"
 #include "vulkan_memory.h"
 #include "vulkan_shader.h"
 #include "vulkan_compute_pipeline.h"
+#include "vulkan_pipeline_builder.h"
 #include "vulkan_command_buffer.h"
+#include "vulkan_query.h"
+#include "vulkan_overhead.h"
 #include "vulkan_texture.h"
 #include "buffer_filler.h"
 #include "vulkan_staging.h"
+#include "statistics.h"
+#include "convergence.h"
+#include "warmup.h"
+#include "soak.h"
+#include "parameters.h"
+#include "results.h"
+#include "checkpoint.h"
+#include "region_sweep.h"
 #include "tests/test_vk_bandwidth.h"
 
 #define VULKAN_BANDWIDTH_BYTES_PER_FETCH            (16)
@@ -39,7 +52,35 @@
 #define VULKAN_BANDWIDTH_WORKGROUP_SIZE             (256)
 #define VULKAN_BANDWIDTH_TARGET_TIME_US             (250000)
 #define VULKAN_BANDWIDTH_STARTING_LOOP_COUNT        (4)
+#define VULKAN_BANDWIDTH_MAXIMUM_LOOP_COUNT(wg)     (UINT32_MAX / (2 * (wg) * VULKAN_BANDWIDTH_FETCHES_PER_CYCLE))
 #define VULKAN_BANDWIDTH_RNG_SEED                   (332487265)
+#define VULKAN_BANDWIDTH_SMALLEST_REGION            (4096)
+#define VULKAN_BANDWIDTH_LARGEST_REGION             (4294967296)
+#define VULKAN_BANDWIDTH_REGION_GRANULARITY         (4096)
+#define VULKAN_BANDWIDTH_POINTS_PER_OCTAVE          (2)
+#define VULKAN_BANDWIDTH_REFINE_THRESHOLD           (10)
+
+typedef enum vulkan_bandwidth_parameter_t {
+    vulkan_bandwidth_parameter_workgroup_size,
+    vulkan_bandwidth_parameter_target_time_us,
+    vulkan_bandwidth_parameter_starting_loop_count,
+    vulkan_bandwidth_parameter_seed,
+    vulkan_bandwidth_parameter_region_min,
+    vulkan_bandwidth_parameter_region_max,
+    vulkan_bandwidth_parameter_points_per_octave,
+    vulkan_bandwidth_parameter_refine_threshold
+} vulkan_bandwidth_parameter;
+
+static const parameters_definition vulkan_bandwidth_parameters[] = {
+    {"workgroup_size", parameters_type_power_of_two, VULKAN_BANDWIDTH_WORKGROUP_SIZE, 32, 1024, "Threads per workgroup, specialized into the shader"},
+    {"target_time_us", parameters_type_integer, VULKAN_BANDWIDTH_TARGET_TIME_US, PARAMETERS_TARGET_TIME_MINIMUM_US, PARAMETERS_TARGET_TIME_MAXIMUM_US, "Kernel run time the loop count is calibrated towards"},
+    {"starting_loop_count", parameters_type_integer, VULKAN_BANDWIDTH_STARTING_LOOP_COUNT, 1, 65536, "Loop count the calibration starts from"},
+    {"seed", parameters_type_integer, VULKAN_BANDWIDTH_RNG_SEED, 0, UINT64_MAX, "Seed of the random buffer contents"},
+    {"region_min", parameters_type_size, VULKAN_BANDWIDTH_SMALLEST_REGION, VULKAN_BANDWIDTH_SMALLEST_REGION, VULKAN_BANDWIDTH_LARGEST_REGION, "Smallest region size measured"},
+    {"region_max", parameters_type_size, VULKAN_BANDWIDTH_LARGEST_REGION, VULKAN_BANDWIDTH_SMALLEST_REGION, VULKAN_BANDWIDTH_LARGEST_REGION, "Largest region size measured"},
+    {"points_per_octave", parameters_type_integer, VULKAN_BANDWIDTH_POINTS_PER_OCTAVE, 1, REGION_SWEEP_MAXIMUM_POINTS_PER_OCTAVE, "Region sizes measured per doubling of the region"},
+    {"refine_threshold", parameters_type_integer, VULKAN_BANDWIDTH_REFINE_THRESHOLD, 0, REGION_SWEEP_MAXIMUM_THRESHOLD, "Percent difference between neighbouring regions that adds a region in between, 0 disables"}
+};
 
 typedef struct vulkan_bandwidth_uniform_buffer_t {
     uint32_t loop_count;
@@ -49,76 +90,79 @@ typedef struct vulkan_bandwidth_uniform_buffer_t {
     uint32_t texture_height;
 } vulkan_bandwidth_uniform_buffer;
 
-/* Check sizes of:
- * 4K, 8K, 12K, 16K, 20K, 24K, 28K, 32K, 40K, 48K, 56K, 64K, 80K, 96K, 112K, 128K,
- * 192K, 256K, 384K, 448K, 512K, 768K, 1M, 1.5M, 2M, 3M, 4M, 6M, 8M, 12M, 16M,
- * 24M, 32M, 40M, 48M, 56M, 64M, 96M, 128M, 192M, 256M, 384M, 512M, 768M,
- * 1G, 1.5G, 2G, 3G, 4G
- *
- * NOTE: Current WG size of 256 means we need to go in 4KB increments (VULKAN_BANDWIDTH_WORKGROUP_SIZE * VULKAN_BANDWIDTH_FETCHES_PER_CYCLE * VULKAN_BANDWIDTH_BYTES_PER_FETCH)
+/* Region sizes have to be a multiple of workgroup_size * VULKAN_BANDWIDTH_BYTES_PER_FETCH, the sweep is aligned to it
+ * The getters hand out the base sweep of the current parameters, refinement points depend on the results of a run
  */
-const uint64_t vulkan_bandwidth_region_sizes[] = {
-    4096, 8192, 12288, 16384, 20480, 24576, 28672, 32768, 40960, 49152, 57344, 65536, 81920, 98304, 114688, 131072,
-    196608, 262144, 393216, 458752, 524288, 786432, 1048576, 1572864, 2097152, 3145728, 4194304, 6291456, 8388608, 12582912, 16777216,
-    25165824, 33554432, 41943040, 50331648, 58720256, 67108864, 100663296, 134217728, 201326592, 268435456, 402653184, 536870912, 805306368,
-    1073741824, 1610612736, 2147483648, 3221225472, 4294967296
-};
-const uint32_t vulkan_bandwidth_region_count = (uint32_t)(sizeof(vulkan_bandwidth_region_sizes) / sizeof(vulkan_bandwidth_region_sizes[0]));
+static region_sweep vulkan_bandwidth_sweep;
+static bool vulkan_bandwidth_sweep_created = false;
 
 static test_status _VulkanBandwidthEntry(vulkan_physical_device *device, void *config_data);
+static test_status _VulkanBandwidthEstimate(vulkan_physical_device *physical_device, void *config_data, planner_estimate *estimate);
+static test_status _VulkanBandwidthPrepare(vulkan_physical_device *physical_device, void *config_data);
+static test_status _VulkanBandwidthCreateDevice(vulkan_physical_device *physical_device, bool validate_invocations, vulkan_device *device);
+static test_status _VulkanBandwidthCreateShader(vulkan_device *device, bool use_texture, vulkan_shader *shader);
+static test_status _VulkanBandwidthExecuteKernel(vulkan_command_sequence *command_sequence, vulkan_compute_pipeline *pipeline, uint32_t workgroup_size, uint32_t groups_x, uint32_t groups_y, uint32_t groups_z, vulkan_query_pool *query_pool, vulkan_overhead *overhead, vulkan_query_pool *invocation_pool, bool *invocations_valid, uint64_t *time_taken);
+static test_status _VulkanBandwidthWriteUniforms(vulkan_region *uniform_region, uint64_t region_size, uint32_t loop_count, uint32_t workgroup_size, bool use_texture, uint32_t texture_width, uint32_t *region_width, uint32_t *region_height);
+static test_status _VulkanBandwidthCreateSweep(const uint64_t *parameters, uint32_t workgroup_size, region_sweep *sweep);
+static bool _VulkanBandwidthIsRegionSelected(uint64_t region_size, uint64_t region_min, uint32_t workgroup_size);
+static test_status _VulkanBandwidthLogRegionResult(uint32_t region_size_index, uint64_t region_size, statistics_summary *result);
+static void _VulkanBandwidthLogCsvHeader(vulkan_physical_device *physical_device);
+static test_status _VulkanBandwidthReplayCheckpoint(vulkan_physical_device *physical_device, uint64_t *parameters, uint32_t workgroup_size);
 
 test_status TestsVulkanBandwidthRegister() {
-    return VulkanRunnerRegisterTest(&_VulkanBandwidthEntry, NULL, TESTS_VULKAN_BANDWIDTH_NAME, TESTS_VULKAN_BANDWIDTH_VERSION, false);
+    test_status status = ParametersDeclare(TESTS_VULKAN_BANDWIDTH_NAME, vulkan_bandwidth_parameters, PARAMETERS_COUNT(vulkan_bandwidth_parameters));
+    TEST_RETFAIL(status);
+    return VulkanRunnerRegisterTest(&_VulkanBandwidthEntry, &_VulkanBandwidthEstimate, &_VulkanBandwidthPrepare, NULL, TESTS_VULKAN_BANDWIDTH_NAME, TESTS_VULKAN_BANDWIDTH_VERSION, false, RUNNER_TEST_FLAG_RESUMABLE, "memory,bandwidth", VULKAN_RUNNER_FEATURE_NONE);
 }
 
 static test_status _VulkanBandwidthEntry(vulkan_physical_device *physical_device, void *config_data) {
     test_status status = TEST_OK;
     VkResult res = VK_SUCCESS;
+    uint64_t parameters[PARAMETERS_COUNT(vulkan_bandwidth_parameters)];
+    ParametersGetAll(vulkan_bandwidth_parameters, PARAMETERS_COUNT(vulkan_bandwidth_parameters), parameters);
 
     bool use_texture = false;
 
     INFO("Device Name: %s\n", physical_device->physical_properties.properties.deviceName);
-
-    VkQueueFamilyProperties *queue_family_properties = NULL;
-    uint32_t queue_family_count = 0;
-    status = VulkanGetPhysicalQueueFamilyProperties(physical_device, &queue_family_properties, &queue_family_count);
+    VkPhysicalDeviceLimits *limits = &(physical_device->physical_properties.properties.limits);
+    uint64_t workgroup_limit = HelperFindLargestPowerOfTwo(min(limits->maxComputeWorkGroupSize[0], limits->maxComputeWorkGroupInvocations));
+    if (parameters[vulkan_bandwidth_parameter_workgroup_size] > workgroup_limit) {
+        WARNING("Workgroup size %llu is above what the device supports, using %llu\n", parameters[vulkan_bandwidth_parameter_workgroup_size], workgroup_limit);
+        parameters[vulkan_bandwidth_parameter_workgroup_size] = workgroup_limit;
+    }
+    uint32_t workgroup_size = (uint32_t)parameters[vulkan_bandwidth_parameter_workgroup_size];
+    uint64_t region_min = parameters[vulkan_bandwidth_parameter_region_min];
+    /* Nothing is left to measure, so nothing is set up either */
+    if (CheckpointIsTestComplete()) {
+        return _VulkanBandwidthReplayCheckpoint(physical_device, parameters, workgroup_size);
+    }
+    uint32_t refine_threshold = (uint32_t)parameters[vulkan_bandwidth_parameter_refine_threshold];
+    region_sweep sweep;
+    status = _VulkanBandwidthCreateSweep(parameters, workgroup_size, &sweep);
     if (!TEST_SUCCESS(status)) {
         goto error;
     }
 
+    bool validate_invocations = MainGetValidateInvocations() && VulkanQueryInvocationsSupported(physical_device);
+    if (!validate_invocations && MainGetValidateInvocations()) {
+        WARNING("Pipeline statistics queries are unsupported, compute shader invocations won't be validated\n");
+    }
+
     vulkan_device device;
-    status = VulkanCreateDevice(physical_device, queue_family_properties, queue_family_count, VK_QUEUE_COMPUTE_BIT | VK_QUEUE_TRANSFER_BIT, &device, NULL);
+    status = _VulkanBandwidthCreateDevice(physical_device, validate_invocations, &device);
     if (!TEST_SUCCESS(status)) {
-        goto cleanup_queue_properties;
+        goto cleanup_sweep;
     }
 
     vulkan_shader shader;
-    status = VulkanShaderInitializeFromFile(&device, use_texture ? "vulkan_bandwidth_texture.spv" : "vulkan_bandwidth.spv", VK_SHADER_STAGE_COMPUTE_BIT, &shader);
+    status = _VulkanBandwidthCreateShader(&device, use_texture, &shader);
     if (!TEST_SUCCESS(status)) {
         goto cleanup_device;
     }
-    if (use_texture) {
-        status = VulkanShaderAddDescriptor(&shader, "data texture 1", VULKAN_BINDING_SAMPLER, 0, 0);
-    } else {
-        status = VulkanShaderAddDescriptor(&shader, "data buffer 1", VULKAN_BINDING_STORAGE, 0, 0);
-    }
-    if (!TEST_SUCCESS(status)) {
-        goto cleanup_shader;
-    }
-    status = VulkanShaderAddDescriptor(&shader, "data buffer 2", VULKAN_BINDING_STORAGE, 0, 1);
-    if (!TEST_SUCCESS(status)) {
-        goto cleanup_shader;
-    }
-    status = VulkanShaderAddFixedSizeDescriptor(&shader, sizeof(vulkan_bandwidth_uniform_buffer), "uniform buffer", VULKAN_BINDING_UNIFORM, 0, 2);
-    if (!TEST_SUCCESS(status)) {
-        goto cleanup_shader;
-    }
-    status = VulkanShaderCreateDescriptorSets(&shader);
-    if (!TEST_SUCCESS(status)) {
-        goto cleanup_shader;
-    }
     vulkan_compute_pipeline pipeline;
-    status = VulkanComputePipelineInitialize(&shader, "main", &pipeline);
+    /* constant_id 0 is the workgroup size */
+    uint32_t specialization_constants[] = {workgroup_size};
+    status = VulkanComputePipelineInitializeSpecialized(&shader, "main", specialization_constants, 1, &pipeline);
     if (!TEST_SUCCESS(status)) {
         goto cleanup_shader;
     }
@@ -141,20 +185,9 @@ static test_status _VulkanBandwidthEntry(vulkan_physical_device *physical_device
     uint64_t vram_capacity = VulkanMemoryGetPhysicalPoolSize(&memory);
     HelperConvertUnitsBytes1024(vram_capacity, &unit_conversion);
     INFO("Device local memory capacity: %.3f %s\n", unit_conversion.value, unit_conversion.units);
-    uint64_t maximum_region_size = min(maximum_allocation, vram_capacity);
-    uint32_t max_usable_region_size = 0;
-    if (vulkan_bandwidth_region_sizes[vulkan_bandwidth_region_count - 1] <= maximum_region_size) {
-        max_usable_region_size = vulkan_bandwidth_region_count - 1;
-    } else {
-        for (uint32_t i = 1; i < vulkan_bandwidth_region_count; i++) {
-            uint64_t region_size = vulkan_bandwidth_region_sizes[i];
-            if (region_size > maximum_region_size) {
-                max_usable_region_size = i - 1;
-                break;
-            }
-        }
-    }
-    maximum_region_size = vulkan_bandwidth_region_sizes[max_usable_region_size];
+    uint64_t maximum_region_size = min(min(maximum_allocation, vram_capacity), parameters[vulkan_bandwidth_parameter_region_max]);
+    uint32_t max_usable_region_size = (uint32_t)RegionSweepFindLargest(&sweep, maximum_region_size);
+    maximum_region_size = RegionSweepGetSize(&sweep, max_usable_region_size);
     HelperConvertUnitsBytes1024(maximum_region_size, &unit_conversion);
     INFO("Maximum region size: %.0f%s\n", unit_conversion.value, unit_conversion.units);
 
@@ -167,7 +200,7 @@ static test_status _VulkanBandwidthEntry(vulkan_physical_device *physical_device
         uint32_t height = 0;
         if (use_texture) {
             size_t texels = maximum_region_size / VULKAN_BANDWIDTH_BYTES_PER_FETCH;
-            width = (maximum_texture_size / (VULKAN_BANDWIDTH_FETCHES_PER_CYCLE * VULKAN_BANDWIDTH_WORKGROUP_SIZE)) * (VULKAN_BANDWIDTH_FETCHES_PER_CYCLE * VULKAN_BANDWIDTH_WORKGROUP_SIZE);
+            width = (maximum_texture_size / (VULKAN_BANDWIDTH_FETCHES_PER_CYCLE * workgroup_size)) * (VULKAN_BANDWIDTH_FETCHES_PER_CYCLE * workgroup_size);
             height = (uint32_t)(texels / width);
             if (height == 0) {
                 width = (uint32_t)texels;
@@ -183,7 +216,7 @@ static test_status _VulkanBandwidthEntry(vulkan_physical_device *physical_device
             failure = true;
         }
         if (!failure) {
-            status = VulkanMemoryAddRegion(&memory, VULKAN_BANDWIDTH_WORKGROUP_SIZE * VULKAN_BANDWIDTH_BYTES_PER_FETCH, "data buffer 2", VULKAN_REGION_STORAGE, VULKAN_REGION_NORMAL);
+            status = VulkanMemoryAddRegion(&memory, workgroup_size * VULKAN_BANDWIDTH_BYTES_PER_FETCH, "data buffer 2", VULKAN_REGION_STORAGE, VULKAN_REGION_NORMAL);
             if (!TEST_SUCCESS(status)) {
                 failure = true;
             }
@@ -209,7 +242,7 @@ static test_status _VulkanBandwidthEntry(vulkan_physical_device *physical_device
                 FATAL("Failed to allocate memory!\n");
                 goto cleanup_memory;
             }
-            maximum_region_size = vulkan_bandwidth_region_sizes[max_usable_region_size];
+            maximum_region_size = RegionSweepGetSize(&sweep, max_usable_region_size);
         } else {
             final_texture_width = width;
             final_texture_height = height;
@@ -222,8 +255,10 @@ static test_status _VulkanBandwidthEntry(vulkan_physical_device *physical_device
     } else {
         INFO("Final region size: %.0f%s\n", unit_conversion.value, unit_conversion.units);
     }
+    /* The base regions above the final size are left out, refinement only adds sizes between measured ones so it never needs more memory */
+    uint32_t skipped_regions = (uint32_t)(sweep.base_count - (max_usable_region_size + 1));
 
-    uint64_t total_groups = maximum_region_size / (VULKAN_BANDWIDTH_BYTES_PER_FETCH * VULKAN_BANDWIDTH_WORKGROUP_SIZE);
+    uint64_t total_groups = maximum_region_size / (VULKAN_BANDWIDTH_BYTES_PER_FETCH * workgroup_size);
     INFO("Ideal workgroup count: %llu\n", total_groups);
     uint32_t *group_size_limits = device.physical_device->physical_properties.properties.limits.maxComputeWorkGroupCount;
     INFO("Workgroup dispatch limits: %lux%lux%lu\n", group_size_limits[0], group_size_limits[1], group_size_limits[2]);
@@ -285,7 +320,7 @@ static test_status _VulkanBandwidthEntry(vulkan_physical_device *physical_device
         }
     } else {
         vulkan_region *data_region_1 = VulkanMemoryGetRegion(&memory, "data buffer 1");
-        status = BufferFillerRandomFloats(data_region_1, VULKAN_BANDWIDTH_RNG_SEED);
+        status = BufferFillerRandomFloats(data_region_1, parameters[vulkan_bandwidth_parameter_seed]);
         if (!TEST_SUCCESS(status)) {
             goto free_memory2;
         }
@@ -316,98 +351,169 @@ static test_status _VulkanBandwidthEntry(vulkan_physical_device *physical_device
     if (!TEST_SUCCESS(status)) {
         goto cleanup_command_buffer;
     }
-    uint64_t *results = malloc((max_usable_region_size + 1) * sizeof(uint64_t));
+    bool use_gpu_timestamps = !MainGetUseHostTimer() && VulkanQueryTimestampsSupported(&command_buffer);
+    vulkan_query_pool query_pool;
+    if (use_gpu_timestamps) {
+        status = VulkanQueryPoolInitializeTimestamps(&command_buffer, VULKAN_QUERY_TIMESTAMP_PAIR, &query_pool);
+        if (!TEST_SUCCESS(status)) {
+            goto cleanup_command_buffer;
+        }
+    }
+    INFO("Timing source: %s\n", use_gpu_timestamps ? "GPU timestamps" : "host timer");
+    vulkan_query_pool invocation_pool;
+    bool invocations_valid = true;
+    if (validate_invocations) {
+        status = VulkanQueryPoolInitializeInvocations(&command_buffer, VULKAN_QUERY_INVOCATIONS_COUNT, &invocation_pool);
+        if (!TEST_SUCCESS(status)) {
+            goto cleanup_query_pool;
+        }
+    }
+    vulkan_overhead overhead;
+    status = VulkanOverheadCalibrate(&command_sequence, use_gpu_timestamps ? &query_pool : NULL, &overhead);
+    if (!TEST_SUCCESS(status)) {
+        goto cleanup_invocation_pool;
+    }
+    size_t result_capacity = RegionSweepGetMaximumCount(&sweep);
+    statistics_summary *results = malloc(result_capacity * sizeof(statistics_summary));
     if (results == NULL) {
         status = TEST_OUT_OF_MEMORY;
-        goto cleanup_command_buffer;
+        goto cleanup_invocation_pool;
+    }
+    memset(results, 0, result_capacity * sizeof(statistics_summary));
+    convergence_controller controller;
+    status = ConvergenceInitialize(parameters[vulkan_bandwidth_parameter_target_time_us], VULKAN_BANDWIDTH_MAXIMUM_LOOP_COUNT(workgroup_size), &controller);
+    if (!TEST_SUCCESS(status)) {
+        goto free_results;
     }
     vulkan_region *uniform_region = VulkanMemoryGetRegion(&uniform_memory, "uniform buffer");
     bool warmup = true;
+    warmup_detector warmup_state;
+    WarmupStart(&warmup_state);
 
+    /* Regions are reported as soon as they are measured, a sweep that times out still leaves everything before it */
+    _VulkanBandwidthLogCsvHeader(physical_device);
     uint32_t region_size_index = 0;
-    while (region_size_index <= max_usable_region_size) {
-        uint64_t region_size = vulkan_bandwidth_region_sizes[region_size_index];
-        uint32_t loop_count = VULKAN_BANDWIDTH_STARTING_LOOP_COUNT;
-        if (warmup) {
-            INFO("Warming up...\n");
-        }
-        while (true) {
-            volatile vulkan_bandwidth_uniform_buffer *uniform_buffer_memory = VulkanMemoryMap(uniform_region);
-            if (uniform_buffer_memory == NULL) {
-                goto free_results;
-            }
-            uint32_t current_region_steps = (uint32_t)(region_size / (VULKAN_BANDWIDTH_WORKGROUP_SIZE * VULKAN_BANDWIDTH_BYTES_PER_FETCH));
-            uniform_buffer_memory->loop_count = loop_count;
-            uniform_buffer_memory->region_size = (uint32_t)(region_size / VULKAN_BANDWIDTH_BYTES_PER_FETCH);
-            uniform_buffer_memory->skip_amount = (uint32_t)((loop_count + current_region_steps + 1) * VULKAN_BANDWIDTH_WORKGROUP_SIZE * VULKAN_BANDWIDTH_FETCHES_PER_CYCLE);
-            if (use_texture) {
-                size_t texels = region_size / VULKAN_BANDWIDTH_BYTES_PER_FETCH;
-                uniform_buffer_memory->texture_width = (final_texture_width / (VULKAN_BANDWIDTH_FETCHES_PER_CYCLE * VULKAN_BANDWIDTH_WORKGROUP_SIZE)) * (VULKAN_BANDWIDTH_FETCHES_PER_CYCLE * VULKAN_BANDWIDTH_WORKGROUP_SIZE);
-                uniform_buffer_memory->texture_height = (uint32_t)(texels / uniform_buffer_memory->texture_width);
-                if (uniform_buffer_memory->texture_height == 0) {
-                    uniform_buffer_memory->texture_width = (uint32_t)texels;
-                    uniform_buffer_memory->texture_height = 1;
-                } else if (((size_t)uniform_buffer_memory->texture_height * uniform_buffer_memory->texture_width) != texels) {
-                    uniform_buffer_memory->texture_height++;
-                    uniform_buffer_memory->texture_width = (uint32_t)(texels / (size_t)uniform_buffer_memory->texture_height);
-                }
-            } else {
-                uniform_buffer_memory->texture_width = 0;
-                uniform_buffer_memory->texture_height = 0;
-            }
-
-            VulkanMemoryUnmap(uniform_region);
-
-            status = VulkanCommandBufferStart(&command_sequence);
+    uint64_t soak_region_size = 0;
+    uint32_t soak_loop_count = 0;
+    while (true) {
+        if (region_size_index == RegionSweepGetCount(&sweep)) {
+            /* Knees between the sizes measured so far get a size in between, which is measured like the rest */
+            size_t added_count = 0;
+            status = RegionSweepRefine(&sweep, results, refine_threshold, &added_count);
             if (!TEST_SUCCESS(status)) {
-                goto free_results;
+                goto cleanup_controller;
             }
-            status = VulkanCommandBufferBindComputePipeline(&command_sequence, &pipeline);
-            if (!TEST_SUCCESS(status)) {
-                goto cleanup_command_sequence;
+            if (added_count == 0) {
+                break;
             }
-            status = VulkanCommandBufferDispatch(&command_sequence, groups_x, groups_y, groups_z);
-            if (!TEST_SUCCESS(status)) {
-                goto cleanup_command_sequence;
+            INFO("Refining %llu region sizes\n", (uint64_t)added_count);
+        }
+        uint64_t region_size = RegionSweepGetSize(&sweep, region_size_index);
+        if (region_size > maximum_region_size || !_VulkanBandwidthIsRegionSelected(region_size, region_min, workgroup_size)) {
+            region_size_index++;
+            continue;
+        }
+        uint64_t checkpoint_loop_count = 0;
+        if (CheckpointGetUnit(region_size_index, region_size, &checkpoint_loop_count, &(results[region_size_index]))) {
+            /* Measured before the run was interrupted, the loop count is kept for the soak */
+            if (region_size > soak_region_size) {
+                soak_region_size = region_size;
+                soak_loop_count = (uint32_t)checkpoint_loop_count;
             }
-            status = VulkanCommandBufferEnd(&command_sequence);
+            status = _VulkanBandwidthLogRegionResult(region_size_index, region_size, &(results[region_size_index]));
             if (!TEST_SUCCESS(status)) {
-                goto cleanup_command_sequence;
+                goto cleanup_controller;
             }
-            HelperResetTimestamp();
-            status = VulkanCommandBufferSubmit(&command_sequence);
+            region_size_index++;
+            continue;
+        }
+        uint64_t starting_loop_count = parameters[vulkan_bandwidth_parameter_starting_loop_count];
+        CheckpointGetCalibration(region_size_index, region_size, &starting_loop_count, NULL);
+        ConvergenceStart(&controller, starting_loop_count);
+        LoggerChannelSendProgress(region_size_index - ((region_size_index > max_usable_region_size) ? skipped_regions : 0), (uint32_t)RegionSweepGetCount(&sweep) - skipped_regions);
+        if (warmup) {
+            INFO("Warming up...\n");
+        }
+        while (true) {
+            uint32_t loop_count = (uint32_t)ConvergenceGetIterations(&controller);
+            uint32_t region_width = 0;
+            uint32_t region_height = 0;
+            status = _VulkanBandwidthWriteUniforms(uniform_region, region_size, loop_count, workgroup_size, use_texture, final_texture_width, &region_width, &region_height);
             if (!TEST_SUCCESS(status)) {
-                goto cleanup_command_sequence;
+                goto cleanup_controller;
             }
-            status = VulkanCommandBufferWait(&command_sequence, VULKAN_COMMAND_SEQUENCE_WAIT_INFINITE);
+
+            uint64_t time = 0;
+            status = _VulkanBandwidthExecuteKernel(&command_sequence, &pipeline, workgroup_size, groups_x, groups_y, groups_z, use_gpu_timestamps ? &query_pool : NULL, &overhead, (validate_invocations && !warmup) ? &invocation_pool : NULL, &invocations_valid, &time);
             if (!TEST_SUCCESS(status)) {
-                goto cleanup_command_sequence;
+                goto cleanup_controller;
             }
-            uint64_t time = HelperMarkTimestamp();
+            uint64_t throughput_per_second = 0;
             if (!warmup) {
                 if (time == 0) {
                     INFO("Loop count %lu took %.3fms (bandwidth: N/A)\n", loop_count, time / 1000.0f);
                 } else {
-                    uint64_t total_data_read = (uint64_t)groups_x * (uint64_t)groups_y * (uint64_t)groups_z * VULKAN_BANDWIDTH_WORKGROUP_SIZE * loop_count * VULKAN_BANDWIDTH_FETCHES_PER_CYCLE * VULKAN_BANDWIDTH_BYTES_PER_FETCH;
-                    uint64_t throughput_per_second = (total_data_read * 1000000) / time;
+                    uint64_t total_data_read = (uint64_t)groups_x * (uint64_t)groups_y * (uint64_t)groups_z * workgroup_size * loop_count * VULKAN_BANDWIDTH_FETCHES_PER_CYCLE * VULKAN_BANDWIDTH_BYTES_PER_FETCH;
+                    throughput_per_second = (total_data_read * 1000000) / time;
                     HelperConvertUnitsBytes1024(throughput_per_second, &unit_conversion);
                     INFO("Loop count %lu took %.3fms (bandwidth: %.3f %s/s)\n", loop_count, time / 1000.0f, unit_conversion.value, unit_conversion.units);
-                    results[region_size_index] = throughput_per_second;
                 }
             }
 
-            loop_count *= 2;
-            if (time >= VULKAN_BANDWIDTH_TARGET_TIME_US) {
-                if (warmup) {
-                    INFO("Warmup finished\n");
-                } else {
-                    helper_unit_pair region_conversion;
-                    HelperConvertUnitsBytes1024(region_size, &region_conversion);
-                    if (use_texture) {
-                        INFO("%.1f %s (%lux%lu) bandwidth: %.3f %s/s\n", region_conversion.value, region_conversion.units, uniform_buffer_memory->texture_width, uniform_buffer_memory->texture_height, unit_conversion.value, unit_conversion.units);
-                    } else {
-                        INFO("%.1f %s bandwidth: %.3f %s/s\n", region_conversion.value, region_conversion.units, unit_conversion.value, unit_conversion.units);
+            if (warmup) {
+                /* Let the controller find the target length first, then repeat it until the timings settle */
+                if (ConvergenceGetState(&controller) == convergence_state_calibrating) {
+                    status = ConvergenceAddRun(&controller, time, 0.0);
+                    if (!TEST_SUCCESS(status)) {
+                        goto cleanup_command_sequence;
                     }
+                    continue;
+                }
+                WarmupAddRun(&warmup_state, time, loop_count);
+                if (WarmupIsFinished(&warmup_state)) {
+                    break;
+                }
+                continue;
+            }
+            bool calibrating = ConvergenceGetState(&controller) == convergence_state_calibrating;
+            status = ConvergenceAddRun(&controller, time, (double)throughput_per_second);
+            if (!TEST_SUCCESS(status)) {
+                goto cleanup_command_sequence;
+            }
+            if (calibrating && ConvergenceGetState(&controller) != convergence_state_calibrating) {
+                status = CheckpointRecordCalibration(region_size_index, region_size, loop_count, 0);
+                if (!TEST_SUCCESS(status)) {
+                    goto cleanup_command_sequence;
+                }
+            }
+            if (ConvergenceGetState(&controller) == convergence_state_finished) {
+                status = ConvergenceSummarize(&controller, &(results[region_size_index]));
+                if (!TEST_SUCCESS(status)) {
+                    goto cleanup_command_sequence;
+                }
+                status = ResultsRecordSamples(region_size_index, &(controller.samples), &(controller.timings), 1.0);
+                if (!TEST_SUCCESS(status)) {
+                    goto cleanup_command_sequence;
+                }
+                helper_unit_pair region_conversion;
+                HelperConvertUnitsBytes1024(region_size, &region_conversion);
+                HelperConvertUnitsBytes1024((uint64_t)results[region_size_index].median, &unit_conversion);
+                if (use_texture) {
+                    INFO("%.1f %s (%lux%lu) bandwidth: %.3f %s/s (median of %lu, %lu outliers, CI +-%.2f%%%s)\n", region_conversion.value, region_conversion.units, region_width, region_height, unit_conversion.value, unit_conversion.units, results[region_size_index].sample_count, results[region_size_index].rejected_outliers, controller.relative_error * 100.0, controller.converged ? "" : ", not converged");
+                } else {
+                    INFO("%.1f %s bandwidth: %.3f %s/s (median of %lu, %lu outliers, CI +-%.2f%%%s)\n", region_conversion.value, region_conversion.units, unit_conversion.value, unit_conversion.units, results[region_size_index].sample_count, results[region_size_index].rejected_outliers, controller.relative_error * 100.0, controller.converged ? "" : ", not converged");
+                }
+                status = _VulkanBandwidthLogRegionResult(region_size_index, region_size, &(results[region_size_index]));
+                if (!TEST_SUCCESS(status)) {
+                    goto cleanup_command_sequence;
+                }
+                if (region_size > soak_region_size) {
+                    soak_region_size = region_size;
+                    soak_loop_count = loop_count;
+                }
+                status = CheckpointRecordUnit(region_size_index, region_size, loop_count, &(results[region_size_index]));
+                if (!TEST_SUCCESS(status)) {
+                    goto cleanup_command_sequence;
                 }
                 break;
             }
@@ -419,32 +525,63 @@ static test_status _VulkanBandwidthEntry(vulkan_physical_device *physical_device
         }
     }
 
-    INFO("Final results for %s:\n", physical_device->physical_properties.properties.deviceName);
-    if (MainGetTestResultFormat() == test_result_csv) {
-        LOG_PLAIN("%s,\n", physical_device->physical_properties.properties.deviceName);
-        LOG_PLAIN("Region size,Bandwidth (GiB/s)\n");
+    /* Refinement may have measured smaller regions since, so the largest measured one is set up again with its loop count */
+    bool soak_enabled = MainGetSoakMinutes() > 0;
+    if (soak_enabled && soak_loop_count == 0) {
+        WARNING("No region was measured, skipping the soak\n");
+        soak_enabled = false;
     }
-    for (uint32_t i = 0; i <= max_usable_region_size; i++) {
-        uint64_t region_size = vulkan_bandwidth_region_sizes[i];
-        uint64_t result = results[i];
-
-        helper_unit_pair region_conversion;
-        HelperConvertUnitsBytes1024(region_size, &region_conversion);
-
-        if (MainGetTestResultFormat() == test_result_csv) {
-            LOG_PLAIN("%.1f%s,%.3f\n", region_conversion.value, region_conversion.units, (float)(result / (1024*1024)) / 1024.0f);
-        } else if (MainGetTestResultFormat() == test_result_raw) {
-            LOG_RESULT(i, "%llu", "%llu", region_size, result);
-        } else {
-            HelperConvertUnitsBytes1024(result, &unit_conversion);
-            INFO("Bandwidth for %.1f %s: %.3f %s/s\n", region_conversion.value, region_conversion.units, unit_conversion.value, unit_conversion.units);
+    soak_series soak;
+    if (soak_enabled) {
+        uint32_t loop_count = soak_loop_count;
+        status = _VulkanBandwidthWriteUniforms(uniform_region, soak_region_size, loop_count, workgroup_size, use_texture, final_texture_width, NULL, NULL);
+        if (!TEST_SUCCESS(status)) {
+            goto cleanup_controller;
+        }
+        status = SoakInitialize(MainGetSoakMinutes(), &soak);
+        if (!TEST_SUCCESS(status)) {
+            goto cleanup_controller;
+        }
+        uint64_t total_data_read = (uint64_t)groups_x * (uint64_t)groups_y * (uint64_t)groups_z * workgroup_size * loop_count * VULKAN_BANDWIDTH_FETCHES_PER_CYCLE * VULKAN_BANDWIDTH_BYTES_PER_FETCH;
+        HelperConvertUnitsBytes1024(soak_region_size, &unit_conversion);
+        INFO("Soaking %.0f%s with loop count %lu for %lu minutes...\n", unit_conversion.value, unit_conversion.units, loop_count, MainGetSoakMinutes());
+        while (!SoakIsFinished(&soak)) {
+            uint64_t time = 0;
+            status = _VulkanBandwidthExecuteKernel(&command_sequence, &pipeline, workgroup_size, groups_x, groups_y, groups_z, use_gpu_timestamps ? &query_pool : NULL, &overhead, NULL, NULL, &time);
+            if (!TEST_SUCCESS(status)) {
+                goto cleanup_soak;
+            }
+            SoakAddRun(&soak, time, (double)total_data_read);
         }
     }
 
+    LoggerChannelSendProgress((uint32_t)RegionSweepGetCount(&sweep) - skipped_regions, (uint32_t)RegionSweepGetCount(&sweep) - skipped_regions);
+    VulkanOverheadLogResult(&overhead);
+    WarmupLogResult(&warmup_state);
+    ParametersLogResult(vulkan_bandwidth_parameters, parameters, PARAMETERS_COUNT(vulkan_bandwidth_parameters));
+    if (soak_enabled) {
+        SoakLogResult(&soak, "GiB/s", 1.0 / (1024.0 * 1024.0 * 1024.0));
+    }
+    VulkanQueryLogInvocationResult(validate_invocations ? &invocation_pool : NULL, invocations_valid);
+
+cleanup_soak:
+    if (soak_enabled) {
+        SoakCleanUp(&soak);
+    }
 cleanup_command_sequence:
     VulkanCommandBufferReset(&command_sequence);
+cleanup_controller:
+    ConvergenceCleanUp(&controller);
 free_results:
     free(results);
+cleanup_invocation_pool:
+    if (validate_invocations) {
+        VulkanQueryPoolCleanUp(&invocation_pool);
+    }
+cleanup_query_pool:
+    if (use_gpu_timestamps) {
+        VulkanQueryPoolCleanUp(&query_pool);
+    }
 cleanup_command_buffer:
     VulkanCommandBufferCleanUp(&command_buffer);
 free_memory2:
@@ -461,16 +598,325 @@ cleanup_shader:
     VulkanShaderCleanUp(&shader);
 cleanup_device:
     VulkanDestroyDevice(&device);
-cleanup_queue_properties:
-    free(queue_family_properties);
+cleanup_sweep:
+    RegionSweepCleanUp(&sweep);
 error:
     return status;
 }
 
 const uint64_t *VulkanBandwidthGetRegionSizes() {
-    return vulkan_bandwidth_region_sizes;
+    if (!vulkan_bandwidth_sweep_created) {
+        uint64_t parameters[PARAMETERS_COUNT(vulkan_bandwidth_parameters)];
+        ParametersGetAll(vulkan_bandwidth_parameters, PARAMETERS_COUNT(vulkan_bandwidth_parameters), parameters);
+        if (!TEST_SUCCESS(_VulkanBandwidthCreateSweep(parameters, (uint32_t)parameters[vulkan_bandwidth_parameter_workgroup_size], &vulkan_bandwidth_sweep))) {
+            return NULL;
+        }
+        vulkan_bandwidth_sweep_created = true;
+    }
+    return RegionSweepGetSizes(&vulkan_bandwidth_sweep);
 }
 
 size_t VulkanBandwidthGetRegionCount() {
-    return vulkan_bandwidth_region_count;
+    if (VulkanBandwidthGetRegionSizes() == NULL) {
+        return 0;
+    }
+    return RegionSweepGetCount(&vulkan_bandwidth_sweep);
+}
+
+static test_status _VulkanBandwidthWriteUniforms(vulkan_region *uniform_region, uint64_t region_size, uint32_t loop_count, uint32_t workgroup_size, bool use_texture, uint32_t texture_width, uint32_t *region_width, uint32_t *region_height) {
+    volatile vulkan_bandwidth_uniform_buffer *uniform_buffer_memory = VulkanMemoryMap(uniform_region);
+    if (uniform_buffer_memory == NULL) {
+        return TEST_VK_MEMORY_MAPPING_ERROR;
+    }
+    uint32_t current_region_steps = (uint32_t)(region_size / (workgroup_size * VULKAN_BANDWIDTH_BYTES_PER_FETCH));
+    uniform_buffer_memory->loop_count = loop_count;
+    uniform_buffer_memory->region_size = (uint32_t)(region_size / VULKAN_BANDWIDTH_BYTES_PER_FETCH);
+    uniform_buffer_memory->skip_amount = (uint32_t)((loop_count + current_region_steps + 1) * workgroup_size * VULKAN_BANDWIDTH_FETCHES_PER_CYCLE);
+    if (use_texture) {
+        size_t texels = region_size / VULKAN_BANDWIDTH_BYTES_PER_FETCH;
+        uniform_buffer_memory->texture_width = (texture_width / (VULKAN_BANDWIDTH_FETCHES_PER_CYCLE * workgroup_size)) * (VULKAN_BANDWIDTH_FETCHES_PER_CYCLE * workgroup_size);
+        uniform_buffer_memory->texture_height = (uint32_t)(texels / uniform_buffer_memory->texture_width);
+        if (uniform_buffer_memory->texture_height == 0) {
+            uniform_buffer_memory->texture_width = (uint32_t)texels;
+            uniform_buffer_memory->texture_height = 1;
+        } else if (((size_t)uniform_buffer_memory->texture_height * uniform_buffer_memory->texture_width) != texels) {
+            uniform_buffer_memory->texture_height++;
+            uniform_buffer_memory->texture_width = (uint32_t)(texels / (size_t)uniform_buffer_memory->texture_height);
+        }
+    } else {
+        uniform_buffer_memory->texture_width = 0;
+        uniform_buffer_memory->texture_height = 0;
+    }
+    if (region_width != NULL) {
+        *region_width = uniform_buffer_memory->texture_width;
+        *region_height = uniform_buffer_memory->texture_height;
+    }
+    VulkanMemoryUnmap(uniform_region);
+    return TEST_OK;
+}
+
+static test_status _VulkanBandwidthExecuteKernel(vulkan_command_sequence *command_sequence, vulkan_compute_pipeline *pipeline, uint32_t workgroup_size, uint32_t groups_x, uint32_t groups_y, uint32_t groups_z, vulkan_query_pool *query_pool, vulkan_overhead *overhead, vulkan_query_pool *invocation_pool, bool *invocations_valid, uint64_t *time_taken) {
+    test_status status = VulkanCommandBufferStart(command_sequence);
+    if (!TEST_SUCCESS(status)) {
+        goto error;
+    }
+    status = VulkanCommandBufferBindComputePipeline(command_sequence, pipeline);
+    if (!TEST_SUCCESS(status)) {
+        goto cleanup_command_sequence;
+    }
+    if (query_pool != NULL) {
+        status = VulkanQueryPoolReset(command_sequence, query_pool);
+        if (!TEST_SUCCESS(status)) {
+            goto cleanup_command_sequence;
+        }
+        status = VulkanQueryWriteTimestamp(command_sequence, query_pool, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VULKAN_QUERY_TIMESTAMP_START);
+        if (!TEST_SUCCESS(status)) {
+            goto cleanup_command_sequence;
+        }
+    }
+    if (invocation_pool != NULL) {
+        status = VulkanQueryPoolReset(command_sequence, invocation_pool);
+        if (!TEST_SUCCESS(status)) {
+            goto cleanup_command_sequence;
+        }
+        status = VulkanQueryBegin(command_sequence, invocation_pool, VULKAN_QUERY_INVOCATIONS);
+        if (!TEST_SUCCESS(status)) {
+            goto cleanup_command_sequence;
+        }
+    }
+    status = VulkanCommandBufferDispatch(command_sequence, groups_x, groups_y, groups_z);
+    if (!TEST_SUCCESS(status)) {
+        goto cleanup_command_sequence;
+    }
+    if (invocation_pool != NULL) {
+        status = VulkanQueryEnd(command_sequence, invocation_pool, VULKAN_QUERY_INVOCATIONS);
+        if (!TEST_SUCCESS(status)) {
+            goto cleanup_command_sequence;
+        }
+    }
+    if (query_pool != NULL) {
+        status = VulkanQueryWriteTimestamp(command_sequence, query_pool, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, VULKAN_QUERY_TIMESTAMP_END);
+        if (!TEST_SUCCESS(status)) {
+            goto cleanup_command_sequence;
+        }
+    }
+    status = VulkanCommandBufferEnd(command_sequence);
+    if (!TEST_SUCCESS(status)) {
+        goto cleanup_command_sequence;
+    }
+    helper_timer timer;
+    HelperTimerReset(&timer);
+    status = VulkanCommandBufferSubmit(command_sequence);
+    if (!TEST_SUCCESS(status)) {
+        goto cleanup_command_sequence;
+    }
+    status = VulkanCommandBufferWait(command_sequence, VULKAN_COMMAND_SEQUENCE_WAIT_STEP);
+    if (!TEST_SUCCESS(status)) {
+        goto cleanup_command_sequence;
+    }
+    uint64_t time = HelperTimerMark(&timer);
+    if (query_pool != NULL) {
+        uint64_t time_ns = 0;
+        status = VulkanQueryGetElapsedNanoseconds(query_pool, VULKAN_QUERY_TIMESTAMP_START, VULKAN_QUERY_TIMESTAMP_END, &time_ns);
+        if (!TEST_SUCCESS(status)) {
+            goto cleanup_command_sequence;
+        }
+        time = time_ns / 1000;
+    }
+    if (invocation_pool != NULL) {
+        uint64_t expected_invocations = (uint64_t)groups_x * (uint64_t)groups_y * (uint64_t)groups_z * workgroup_size;
+        status = VulkanQueryCheckInvocations(invocation_pool, VULKAN_QUERY_INVOCATIONS, expected_invocations, invocations_valid);
+        if (!TEST_SUCCESS(status)) {
+            goto cleanup_command_sequence;
+        }
+    }
+    *time_taken = VulkanOverheadSubtract(overhead, time);
+cleanup_command_sequence:
+    VulkanCommandBufferReset(command_sequence);
+error:
+    return status;
+}
+
+/* The shader wraps around the region in steps of one workgroup worth of fetches */
+static test_status _VulkanBandwidthLogRegionResult(uint32_t region_size_index, uint64_t region_size, statistics_summary *result) {
+    helper_unit_pair region_conversion;
+    HelperConvertUnitsBytes1024(region_size, &region_conversion);
+
+    if (MainGetTestResultFormat() == test_result_csv) {
+        statistics_summary result_gib = *result;
+        StatisticsScaleSummary(&result_gib, 1.0 / (1024.0 * 1024.0 * 1024.0));
+        LOG_PLAIN("%.1f%s,%.3f," STATISTICS_CSV_FORMAT "\n", region_conversion.value, region_conversion.units, result_gib.median, STATISTICS_CSV_VALUES(&result_gib));
+    } else if (MainGetTestResultFormat() == test_result_raw) {
+        LOG_RESULT(region_size_index, "%llu", "%llu", region_size, (uint64_t)result->median);
+        LOG_RESULT_STATISTICS(region_size_index, "%llu", region_size, result);
+    } else if (MainGetTestResultFormat() == test_result_json) {
+        char key[RESULTS_MAXIMUM_NAME_LENGTH];
+        snprintf(key, sizeof(key), "%llu", (unsigned long long)region_size);
+        test_status status = ResultsAddMeasurement(region_size_index, key, "B/s", result);
+        TEST_RETFAIL(status);
+    } else {
+        helper_unit_pair unit_conversion;
+        helper_unit_pair p5_conversion;
+        helper_unit_pair p95_conversion;
+        HelperConvertUnitsBytes1024((uint64_t)result->median, &unit_conversion);
+        HelperConvertUnitsBytes1024((uint64_t)result->p5, &p5_conversion);
+        HelperConvertUnitsBytes1024((uint64_t)result->p95, &p95_conversion);
+        INFO("Bandwidth for %.1f %s: %.3f %s/s (p5 %.3f %s/s, p95 %.3f %s/s, stddev %.2f%%)\n", region_conversion.value, region_conversion.units, unit_conversion.value, unit_conversion.units, p5_conversion.value, p5_conversion.units, p95_conversion.value, p95_conversion.units, (result->mean > 0.0) ? (100.0 * result->standard_deviation / result->mean) : 0.0);
+    }
+    LoggerFlushCapture();
+    return TEST_OK;
+}
+
+static void _VulkanBandwidthLogCsvHeader(vulkan_physical_device *physical_device) {
+    if (MainGetTestResultFormat() == test_result_csv) {
+        LOG_PLAIN("%s,\n", physical_device->physical_properties.properties.deviceName);
+        LOG_PLAIN("Region size,Bandwidth (GiB/s)," STATISTICS_CSV_HEADER "\n");
+    }
+}
+
+/* Reports every region the interrupted run measured the same way it did, in sweep order
+ * Refinement runs again on the same results, which adds the sizes the interrupted run refined with */
+static test_status _VulkanBandwidthReplayCheckpoint(vulkan_physical_device *physical_device, uint64_t *parameters, uint32_t workgroup_size) {
+    INFO("Replaying the results of the interrupted run\n");
+    region_sweep sweep;
+    test_status status = _VulkanBandwidthCreateSweep(parameters, workgroup_size, &sweep);
+    TEST_RETFAIL(status);
+    size_t result_capacity = RegionSweepGetMaximumCount(&sweep);
+    statistics_summary *results = malloc(result_capacity * sizeof(statistics_summary));
+    if (results == NULL) {
+        status = TEST_OUT_OF_MEMORY;
+        goto cleanup_sweep;
+    }
+    memset(results, 0, result_capacity * sizeof(statistics_summary));
+
+    _VulkanBandwidthLogCsvHeader(physical_device);
+    size_t region_size_index = 0;
+    while (true) {
+        if (region_size_index == RegionSweepGetCount(&sweep)) {
+            size_t added_count = 0;
+            status = RegionSweepRefine(&sweep, results, (uint32_t)parameters[vulkan_bandwidth_parameter_refine_threshold], &added_count);
+            if (!TEST_SUCCESS(status) || added_count == 0) {
+                break;
+            }
+        }
+        uint64_t region_size = RegionSweepGetSize(&sweep, region_size_index);
+        if (CheckpointGetUnit((uint32_t)region_size_index, region_size, NULL, &(results[region_size_index]))) {
+            status = _VulkanBandwidthLogRegionResult((uint32_t)region_size_index, region_size, &(results[region_size_index]));
+            if (!TEST_SUCCESS(status)) {
+                break;
+            }
+        }
+        region_size_index++;
+    }
+    if (TEST_SUCCESS(status)) {
+        LoggerChannelSendProgress((uint32_t)RegionSweepGetCount(&sweep), (uint32_t)RegionSweepGetCount(&sweep));
+        ParametersLogResult(vulkan_bandwidth_parameters, parameters, PARAMETERS_COUNT(vulkan_bandwidth_parameters));
+    }
+    free(results);
+cleanup_sweep:
+    RegionSweepCleanUp(&sweep);
+    return status;
+}
+
+/* The workgroup size is specialized into the shader, so it is lowered to the device limit like the entry does */
+static test_status _VulkanBandwidthPrepare(vulkan_physical_device *physical_device, void *config_data) {
+    TEST_UNUSED(config_data);
+    vulkan_device device;
+    test_status status = _VulkanBandwidthCreateDevice(physical_device, MainGetValidateInvocations() && VulkanQueryInvocationsSupported(physical_device), &device);
+    TEST_RETFAIL(status);
+    vulkan_pipeline_builder *builder = NULL;
+    status = VulkanRunnerGetPipelineBuilder(&device, &builder);
+    TEST_RETFAIL(status);
+    uint64_t workgroup_size = ParametersGet(&(vulkan_bandwidth_parameters[vulkan_bandwidth_parameter_workgroup_size]));
+    VkPhysicalDeviceLimits *limits = &(builder->device->physical_device->physical_properties.properties.limits);
+    workgroup_size = min(workgroup_size, HelperFindLargestPowerOfTwo(min(limits->maxComputeWorkGroupSize[0], limits->maxComputeWorkGroupInvocations)));
+
+    vulkan_shader shader;
+    status = _VulkanBandwidthCreateShader(builder->device, false, &shader);
+    TEST_RETFAIL(status);
+    vulkan_shader *owned_shader = NULL;
+    status = VulkanPipelineBuilderAddShader(builder, &shader, &owned_shader);
+    TEST_RETFAIL(status);
+    uint32_t specialization_constants[] = {(uint32_t)workgroup_size};
+    return VulkanPipelineBuilderAddPipeline(builder, owned_shader, "main", specialization_constants, 1);
+}
+
+/* Shared with the pipeline build, which has to create the same device for the test to be handed it warm */
+static test_status _VulkanBandwidthCreateDevice(vulkan_physical_device *physical_device, bool validate_invocations, vulkan_device *device) {
+    VkQueueFamilyProperties *queue_family_properties = NULL;
+    uint32_t queue_family_count = 0;
+    test_status status = VulkanGetPhysicalQueueFamilyProperties(physical_device, &queue_family_properties, &queue_family_count);
+    TEST_RETFAIL(status);
+    VkPhysicalDeviceFeatures2 enabled_features = {0};
+    enabled_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    enabled_features.pNext = NULL;
+    enabled_features.features.pipelineStatisticsQuery = VK_TRUE;
+    status = VulkanCreateDevice(physical_device, queue_family_properties, queue_family_count, VK_QUEUE_COMPUTE_BIT | VK_QUEUE_TRANSFER_BIT, device, validate_invocations ? &enabled_features : NULL);
+    free(queue_family_properties);
+    return status;
+}
+
+/* Shared with the pipeline build, the layout has to match for the driver to find the pipeline it compiled */
+static test_status _VulkanBandwidthCreateShader(vulkan_device *device, bool use_texture, vulkan_shader *shader) {
+    test_status status = VulkanShaderInitializeFromFile(device, use_texture ? "vulkan_bandwidth_texture.spv" : "vulkan_bandwidth.spv", VK_SHADER_STAGE_COMPUTE_BIT, shader);
+    TEST_RETFAIL(status);
+    if (use_texture) {
+        status = VulkanShaderAddDescriptor(shader, "data texture 1", VULKAN_BINDING_SAMPLER, 0, 0);
+    } else {
+        status = VulkanShaderAddDescriptor(shader, "data buffer 1", VULKAN_BINDING_STORAGE, 0, 0);
+    }
+    if (!TEST_SUCCESS(status)) {
+        goto cleanup_shader;
+    }
+    status = VulkanShaderAddDescriptor(shader, "data buffer 2", VULKAN_BINDING_STORAGE, 0, 1);
+    if (!TEST_SUCCESS(status)) {
+        goto cleanup_shader;
+    }
+    status = VulkanShaderAddFixedSizeDescriptor(shader, sizeof(vulkan_bandwidth_uniform_buffer), "uniform buffer", VULKAN_BINDING_UNIFORM, 0, 2);
+    if (!TEST_SUCCESS(status)) {
+        goto cleanup_shader;
+    }
+    status = VulkanShaderCreateDescriptorSets(shader);
+    if (!TEST_SUCCESS(status)) {
+        goto cleanup_shader;
+    }
+    return TEST_OK;
+cleanup_shader:
+    VulkanShaderCleanUp(shader);
+    return status;
+}
+
+/* The base sweep clipped the way the test clips it, before allocation failures lower the largest region further
+ * Refinement depends on the results, so it isn't part of the estimate */
+static test_status _VulkanBandwidthEstimate(vulkan_physical_device *physical_device, void *config_data, planner_estimate *estimate) {
+    TEST_UNUSED(config_data);
+    uint64_t parameters[PARAMETERS_COUNT(vulkan_bandwidth_parameters)];
+    ParametersGetAll(vulkan_bandwidth_parameters, PARAMETERS_COUNT(vulkan_bandwidth_parameters), parameters);
+    VkPhysicalDeviceLimits *limits = &(physical_device->physical_properties.properties.limits);
+    uint64_t workgroup_limit = HelperFindLargestPowerOfTwo(min(limits->maxComputeWorkGroupSize[0], limits->maxComputeWorkGroupInvocations));
+    uint32_t workgroup_size = (uint32_t)min(parameters[vulkan_bandwidth_parameter_workgroup_size], workgroup_limit);
+    uint64_t maximum_allocation = min(limits->maxStorageBufferRange, physical_device->physical_maintenance_properties_3.maxMemoryAllocationSize);
+    uint64_t maximum_region_size = min(min(maximum_allocation, VulkanGetDeviceLocalMemorySize(physical_device)), parameters[vulkan_bandwidth_parameter_region_max]);
+    uint64_t target_time_us = parameters[vulkan_bandwidth_parameter_target_time_us];
+    region_sweep sweep;
+    test_status status = _VulkanBandwidthCreateSweep(parameters, workgroup_size, &sweep);
+    TEST_RETFAIL(status);
+    for (size_t i = 0; i < RegionSweepGetCount(&sweep) && RegionSweepGetSize(&sweep, i) <= maximum_region_size; i++) {
+        if (_VulkanBandwidthIsRegionSelected(RegionSweepGetSize(&sweep, i), parameters[vulkan_bandwidth_parameter_region_min], workgroup_size)) {
+            estimate->step_count++;
+        }
+    }
+    RegionSweepCleanUp(&sweep);
+    estimate->sample_time_us = target_time_us;
+    estimate->fixed_time_us = WarmupEstimateTime(target_time_us) + MainGetSoakMinutes() * 60000000ULL;
+    return TEST_OK;
+}
+
+static test_status _VulkanBandwidthCreateSweep(const uint64_t *parameters, uint32_t workgroup_size, region_sweep *sweep) {
+    uint64_t granularity = max(VULKAN_BANDWIDTH_REGION_GRANULARITY, (uint64_t)workgroup_size * VULKAN_BANDWIDTH_BYTES_PER_FETCH);
+    return RegionSweepInitialize(parameters[vulkan_bandwidth_parameter_region_min], parameters[vulkan_bandwidth_parameter_region_max], (uint32_t)parameters[vulkan_bandwidth_parameter_points_per_octave], granularity, sweep);
+}
+
+static bool _VulkanBandwidthIsRegionSelected(uint64_t region_size, uint64_t region_min, uint32_t workgroup_size) {
+    return region_size >= region_min && (region_size % ((uint64_t)workgroup_size * VULKAN_BANDWIDTH_BYTES_PER_FETCH)) == 0;
 }
\ No newline at end of file
@@ -24,6 +24,8 @@
 #include "main.h"
 #include "logger.h"
 #include "vulkan_helper.h"
+#include "runner.h"
+#include "planner.h"
 #include "vulkan_runner.h"
 #include "tests/test_vk_info.h"
 
@@ -118,5 +120,5 @@ static test_status _VulkanInfoEntry(vulkan_physical_device *device, void *config
 }
 
 test_status TestsVulkanInfoRegister() {
-    return VulkanRunnerRegisterTest(&_VulkanInfoEntry, NULL, TESTS_VULKAN_INFO_NAME, TESTS_VULKAN_INFO_VERSION, false);
+    return VulkanRunnerRegisterTest(&_VulkanInfoEntry, NULL, NULL, NULL, TESTS_VULKAN_INFO_NAME, TESTS_VULKAN_INFO_VERSION, false, RUNNER_TEST_FLAG_NONE, "info", VULKAN_RUNNER_FEATURE_NONE);
 }
\ No newline at end of file
@@ -24,22 +24,41 @@
 #include "main.h"
 #include "logger.h"
 #include "vulkan_helper.h"
+#include "runner.h"
+#include "planner.h"
 #include "vulkan_runner.h"
 #include "vulkan_memory.h"
 #include "vulkan_shader.h"
 #include "vulkan_compute_pipeline.h"
+#include "vulkan_pipeline_builder.h"
 #include "vulkan_command_buffer.h"
+#include "vulkan_query.h"
+#include "vulkan_overhead.h"
 #include "buffer_filler.h"
 #include "latency_helper.h"
+#include "statistics.h"
+#include "convergence.h"
+#include "warmup.h"
+#include "parameters.h"
+#include "results.h"
+#include "checkpoint.h"
+#include "region_sweep.h"
 #include "tests/test_vk_latency.h"
 
 #define VULKAN_LATENCY_TARGET_TIME_US               (250000)                                /* Target execution time to get accurate results */
-#define VULKAN_LATENCY_HOP_STRIDE_BYTES             (512)                                   /* Maximum cache line size that can be tricked (region must be a multiple of this) - must match value in shader */
+#define VULKAN_LATENCY_HOP_STRIDE_BYTES             (512)                                   /* Maximum cache line size that can be tricked (region must be a multiple of this) */
+#define VULKAN_LATENCY_MAXIMUM_HOP_STRIDE_BYTES     (512)                                   /* Size of the LRU table in the uniform buffer - must match value in shader */
 #define VULKAN_LATENCY_HOPS_PER_CYCLE               (64)                                    /* Pointer fetches per loop cycle to minimize loop logic overhead */
 #define VULKAN_LATENCY_STARTING_HOPS                (1024 / VULKAN_LATENCY_HOPS_PER_CYCLE)  /* Minimum amount of fetches to execute */
 #define VULKAN_LATENCY_POINTER_SIZE                 (sizeof(uint32_t))                      /* Size of our beloved pointer - must match value in shader */
 #define VULKAN_LATENCY_BACKOFF_THRESHOLD            (1.2f)
 #define VULKAN_LATENCY_COVERAGE_MULTIPLE            (2)
+#define VULKAN_LATENCY_SMALLEST_REGION              (4096)
+#define VULKAN_LATENCY_LARGEST_REGION               (4294967296)
+#define VULKAN_LATENCY_REGION_GRANULARITY           (VULKAN_LATENCY_MAXIMUM_HOP_STRIDE_BYTES) /* Regions must be a multiple of the hop stride */
+#define VULKAN_LATENCY_POINTS_PER_OCTAVE            (2)
+#define VULKAN_LATENCY_REFINE_THRESHOLD             (10)
+#define VULKAN_LATENCY_ESTIMATED_SEARCH_RUNS        (4)                                     /* Target length runs the workgroup search of a region usually takes */
 
 #define VULKAN_LATENCY_TEST_TYPE_VECTOR             (0)
 #define VULKAN_LATENCY_TEST_TYPE_SCALAR             (1)
@@ -48,82 +67,92 @@ typedef struct vulkan_latency_uniform_buffer_t {
     uint32_t hop_count;
     uint32_t region_size;
     uint32_t per_wg_offset;
-    uint32_t lru[VULKAN_LATENCY_HOP_STRIDE_BYTES / VULKAN_LATENCY_POINTER_SIZE];
+    uint32_t lru[VULKAN_LATENCY_MAXIMUM_HOP_STRIDE_BYTES / VULKAN_LATENCY_POINTER_SIZE];
 } vulkan_latency_uniform_buffer;
 
-/* Check sizes of:
- * 4K, 8K, 12K, 16K, 20K, 24K, 28K, 32K, 40K, 48K, 56K, 64K, 80K, 96K, 112K, 128K,
- * 192K, 256K, 384K, 448K, 512K, 768K, 1M, 1.5M, 2M, 3M, 4M, 6M, 8M, 12M, 16M,
- * 24M, 32M, 40M, 48M, 56M, 64M, 96M, 128M, 192M, 256M, 384M, 512M, 768M,
- * 1G, 1.5G, 2G, 3G, 4G
- *
- * NOTE: Current stride size of 512 means we need to go in 512B increments (VULKAN_LATENCY_HOP_STRIDE_BYTES)
- */
-const uint64_t vulkan_latency_region_sizes[] = {
-    4096, 8192, 12288, 16384, 20480, 24576, 28672, 32768, 40960, 49152, 57344, 65536, 81920, 98304, 114688, 131072,
-    196608, 262144, 393216, 458752, 524288, 786432, 1048576, 1572864, 2097152, 3145728, 4194304, 6291456, 8388608, 12582912, 16777216,
-    25165824, 33554432, 41943040, 50331648, 58720256, 67108864, 100663296, 134217728, 201326592, 268435456, 402653184, 536870912, 805306368,
-    1073741824, 1610612736, 2147483648, 3221225472, 4294967296
+typedef enum vulkan_latency_parameter_t {
+    vulkan_latency_parameter_hop_stride,
+    vulkan_latency_parameter_target_time_us,
+    vulkan_latency_parameter_region_min,
+    vulkan_latency_parameter_region_max,
+    vulkan_latency_parameter_points_per_octave,
+    vulkan_latency_parameter_refine_threshold
+} vulkan_latency_parameter;
+
+static const parameters_definition vulkan_latency_parameters[] = {
+    {"hop_stride", parameters_type_power_of_two, VULKAN_LATENCY_HOP_STRIDE_BYTES, 64, VULKAN_LATENCY_MAXIMUM_HOP_STRIDE_BYTES, "Bytes between pointers of one chain, specialized into the shader"},
+    {"target_time_us", parameters_type_integer, VULKAN_LATENCY_TARGET_TIME_US, PARAMETERS_TARGET_TIME_MINIMUM_US, PARAMETERS_TARGET_TIME_MAXIMUM_US, "Kernel run time the hop count is calibrated towards"},
+    {"region_min", parameters_type_size, VULKAN_LATENCY_SMALLEST_REGION, VULKAN_LATENCY_SMALLEST_REGION, VULKAN_LATENCY_LARGEST_REGION, "Smallest region size measured"},
+    {"region_max", parameters_type_size, VULKAN_LATENCY_LARGEST_REGION, VULKAN_LATENCY_SMALLEST_REGION, VULKAN_LATENCY_LARGEST_REGION, "Largest region size measured"},
+    {"points_per_octave", parameters_type_integer, VULKAN_LATENCY_POINTS_PER_OCTAVE, 1, REGION_SWEEP_MAXIMUM_POINTS_PER_OCTAVE, "Region sizes measured per doubling of the region"},
+    {"refine_threshold", parameters_type_integer, VULKAN_LATENCY_REFINE_THRESHOLD, 0, REGION_SWEEP_MAXIMUM_THRESHOLD, "Percent difference between neighbouring regions that adds a region in between, 0 disables"}
 };
-const uint32_t vulkan_latency_region_count = (uint32_t)(sizeof(vulkan_latency_region_sizes) / sizeof(vulkan_latency_region_sizes[0]));
+
+/* The getters hand out the base sweep of the current parameters, refinement points depend on the results of a run */
+static region_sweep vulkan_latency_sweep;
+static bool vulkan_latency_sweep_created = false;
 
 static test_status _VulkanLatencyEntry(vulkan_physical_device *device, void *config_data);
+static test_status _VulkanLatencyEstimate(vulkan_physical_device *physical_device, void *config_data, planner_estimate *estimate);
+static test_status _VulkanLatencyPrepare(vulkan_physical_device *physical_device, void *config_data);
+static test_status _VulkanLatencyCreateDevice(vulkan_physical_device *physical_device, vulkan_device *device);
+static test_status _VulkanLatencyCreateShader(vulkan_device *device, bool scalar_test, vulkan_shader *shader);
+static test_status _VulkanLatencyCreateSweep(const uint64_t *parameters, region_sweep *sweep);
+static test_status _VulkanLatencyLogRegionResult(uint32_t region_size_index, uint64_t region_size, const statistics_summary *summary);
+static void _VulkanLatencyLogCsvHeader(vulkan_physical_device *physical_device);
+static test_status _VulkanLatencyReplayCheckpoint(vulkan_physical_device *physical_device, uint64_t *parameters);
 
 test_status TestsVulkanLatencyRegister() {
-    test_status status = VulkanRunnerRegisterTest(&_VulkanLatencyEntry, (void*)(uint64_t)VULKAN_LATENCY_TEST_TYPE_SCALAR, TESTS_VULKAN_LATENCY_SCLR_NAME, TESTS_VULKAN_LATENCY_VERSION, false);
+    test_status status = ParametersDeclare("vk_latency_*", vulkan_latency_parameters, PARAMETERS_COUNT(vulkan_latency_parameters));
+    TEST_RETFAIL(status);
+    status = VulkanRunnerRegisterTest(&_VulkanLatencyEntry, &_VulkanLatencyEstimate, &_VulkanLatencyPrepare, (void*)(uint64_t)VULKAN_LATENCY_TEST_TYPE_SCALAR, TESTS_VULKAN_LATENCY_SCLR_NAME, TESTS_VULKAN_LATENCY_VERSION, false, RUNNER_TEST_FLAG_RESUMABLE, "memory,latency,scalar", VULKAN_RUNNER_FEATURE_NONE);
     TEST_RETFAIL(status);
-    return VulkanRunnerRegisterTest(&_VulkanLatencyEntry, (void*)(uint64_t)VULKAN_LATENCY_TEST_TYPE_VECTOR, TESTS_VULKAN_LATENCY_VEC_NAME, TESTS_VULKAN_LATENCY_VERSION, false);
+    return VulkanRunnerRegisterTest(&_VulkanLatencyEntry, &_VulkanLatencyEstimate, &_VulkanLatencyPrepare, (void*)(uint64_t)VULKAN_LATENCY_TEST_TYPE_VECTOR, TESTS_VULKAN_LATENCY_VEC_NAME, TESTS_VULKAN_LATENCY_VERSION, false, RUNNER_TEST_FLAG_RESUMABLE, "memory,latency,vector", VULKAN_RUNNER_FEATURE_NONE);
 }
 
 static test_status _VulkanLatencyEntry(vulkan_physical_device *physical_device, void *config_data) {
     test_status status = TEST_OK;
     VkResult res = VK_SUCCESS;
     bool scalar_test = ((uint64_t)config_data) == VULKAN_LATENCY_TEST_TYPE_SCALAR;
+    uint64_t parameters[PARAMETERS_COUNT(vulkan_latency_parameters)];
+    ParametersGetAll(vulkan_latency_parameters, PARAMETERS_COUNT(vulkan_latency_parameters), parameters);
+    uint32_t hop_stride = (uint32_t)parameters[vulkan_latency_parameter_hop_stride];
+    uint64_t target_time_us = parameters[vulkan_latency_parameter_target_time_us];
+    uint64_t region_min = parameters[vulkan_latency_parameter_region_min];
+    uint32_t refine_threshold = (uint32_t)parameters[vulkan_latency_parameter_refine_threshold];
+    /* Nothing is left to measure, so nothing is set up either */
+    if (CheckpointIsTestComplete()) {
+        INFO("Device Name: %s\n", physical_device->physical_properties.properties.deviceName);
+        return _VulkanLatencyReplayCheckpoint(physical_device, parameters);
+    }
 
-    latency_helper_lru lru;
-    status = LatencyHelperLRUInitialize(&lru, VULKAN_LATENCY_HOP_STRIDE_BYTES);
+    region_sweep sweep;
+    status = _VulkanLatencyCreateSweep(parameters, &sweep);
     if (!TEST_SUCCESS(status)) {
         goto error;
     }
-
-    INFO("Device Name: %s\n", physical_device->physical_properties.properties.deviceName);
-
-    VkQueueFamilyProperties *queue_family_properties = NULL;
-    uint32_t queue_family_count = 0;
-    status = VulkanGetPhysicalQueueFamilyProperties(physical_device, &queue_family_properties, &queue_family_count);
+    latency_helper_lru lru;
+    status = LatencyHelperLRUInitialize(&lru, hop_stride);
     if (!TEST_SUCCESS(status)) {
-        goto cleanup_lru;
+        goto cleanup_sweep;
     }
 
+    INFO("Device Name: %s\n", physical_device->physical_properties.properties.deviceName);
+
     vulkan_device device;
-    status = VulkanCreateDevice(physical_device, queue_family_properties, queue_family_count, VK_QUEUE_COMPUTE_BIT | VK_QUEUE_TRANSFER_BIT, &device, NULL);
+    status = _VulkanLatencyCreateDevice(physical_device, &device);
     if (!TEST_SUCCESS(status)) {
-        goto cleanup_queue_properties;
+        goto cleanup_lru;
     }
 
     vulkan_shader shader;
-    status = VulkanShaderInitializeFromFile(&device, scalar_test ? "vulkan_latency_scalar.spv" : "vulkan_latency_vector.spv", VK_SHADER_STAGE_COMPUTE_BIT, &shader);
+    status = _VulkanLatencyCreateShader(&device, scalar_test, &shader);
     if (!TEST_SUCCESS(status)) {
         goto cleanup_device;
     }
-    status = VulkanShaderAddDescriptor(&shader, "data buffer 1", VULKAN_BINDING_STORAGE, 0, 0);
-    if (!TEST_SUCCESS(status)) {
-        goto cleanup_shader;
-    }
-    status = VulkanShaderAddDescriptor(&shader, "data buffer 2", VULKAN_BINDING_STORAGE, 0, 1);
-    if (!TEST_SUCCESS(status)) {
-        goto cleanup_shader;
-    }
-    status = VulkanShaderAddFixedSizeDescriptor(&shader, sizeof(vulkan_latency_uniform_buffer), "uniform buffer", VULKAN_BINDING_UNIFORM, 0, 2);
-    if (!TEST_SUCCESS(status)) {
-        goto cleanup_shader;
-    }
-    status = VulkanShaderCreateDescriptorSets(&shader);
-    if (!TEST_SUCCESS(status)) {
-        goto cleanup_shader;
-    }
     vulkan_compute_pipeline pipeline;
-    status = VulkanComputePipelineInitialize(&shader, "main", &pipeline);
+    uint32_t specialization_constants[] = { hop_stride };
+    status = VulkanComputePipelineInitializeSpecialized(&shader, "main", specialization_constants, 1, &pipeline);
     if (!TEST_SUCCESS(status)) {
         goto cleanup_shader;
     }
@@ -139,20 +168,9 @@ static test_status _VulkanLatencyEntry(vulkan_physical_device *physical_device,
     uint64_t vram_capacity = VulkanMemoryGetPhysicalPoolSize(&memory);
     HelperConvertUnitsBytes1024(vram_capacity, &unit_conversion);
     INFO("Device local memory capacity: %.3f %s\n", unit_conversion.value, unit_conversion.units);
-    uint64_t maximum_region_size = min(maximum_allocation, vram_capacity);
-    uint32_t max_usable_region_size = 0;
-    if (vulkan_latency_region_sizes[vulkan_latency_region_count - 1] <= maximum_region_size) {
-        max_usable_region_size = vulkan_latency_region_count - 1;
-    } else {
-        for (uint32_t i = 1; i < vulkan_latency_region_count; i++) {
-            uint64_t region_size = vulkan_latency_region_sizes[i];
-            if (region_size > maximum_region_size) {
-                max_usable_region_size = i - 1;
-                break;
-            }
-        }
-    }
-    maximum_region_size = vulkan_latency_region_sizes[max_usable_region_size];
+    uint64_t maximum_region_size = min(min(maximum_allocation, vram_capacity), parameters[vulkan_latency_parameter_region_max]);
+    uint32_t max_usable_region_size = (uint32_t)RegionSweepFindLargest(&sweep, maximum_region_size);
+    maximum_region_size = RegionSweepGetSize(&sweep, max_usable_region_size);
     HelperConvertUnitsBytes1024(maximum_region_size, &unit_conversion);
     INFO("Maximum region size: %.0f%s\n", unit_conversion.value, unit_conversion.units);
 
@@ -189,13 +207,15 @@ static test_status _VulkanLatencyEntry(vulkan_physical_device *physical_device,
                 FATAL("Failed to allocate memory!\n");
                 goto cleanup_memory;
             }
-            maximum_region_size = vulkan_latency_region_sizes[max_usable_region_size];
+            maximum_region_size = RegionSweepGetSize(&sweep, max_usable_region_size);
         } else {
             break;
         }
     }
     HelperConvertUnitsBytes1024(maximum_region_size, &unit_conversion);
     INFO("Final region size: %.0f%s\n", unit_conversion.value, unit_conversion.units);
+    /* The base regions above the final size are left out, refinement only adds sizes between measured ones so it never needs more memory */
+    uint32_t skipped_regions = (uint32_t)(sweep.base_count - (max_usable_region_size + 1));
 
     bool uniform_memory_is_visible = false;
     vulkan_memory uniform_memory;
@@ -233,109 +253,238 @@ static test_status _VulkanLatencyEntry(vulkan_physical_device *physical_device,
     if (!TEST_SUCCESS(status)) {
         goto cleanup_command_buffer;
     }
-    uint64_t *results = malloc((max_usable_region_size + 1) * sizeof(uint64_t));
+    bool use_gpu_timestamps = !MainGetUseHostTimer() && VulkanQueryTimestampsSupported(&command_buffer);
+    vulkan_query_pool query_pool;
+    if (use_gpu_timestamps) {
+        status = VulkanQueryPoolInitializeTimestamps(&command_buffer, VULKAN_QUERY_TIMESTAMP_PAIR, &query_pool);
+        if (!TEST_SUCCESS(status)) {
+            goto cleanup_command_buffer;
+        }
+    }
+    INFO("Timing source: %s\n", use_gpu_timestamps ? "GPU timestamps" : "host timer");
+    vulkan_overhead overhead;
+    status = VulkanOverheadCalibrate(&command_sequence, use_gpu_timestamps ? &query_pool : NULL, &overhead);
+    if (!TEST_SUCCESS(status)) {
+        goto cleanup_query_pool;
+    }
+    size_t result_capacity = RegionSweepGetMaximumCount(&sweep);
+    statistics_summary *results = malloc(result_capacity * sizeof(statistics_summary));
     if (results == NULL) {
         status = TEST_OUT_OF_MEMORY;
-        goto cleanup_command_buffer;
+        goto cleanup_query_pool;
+    }
+    memset(results, 0, result_capacity * sizeof(statistics_summary));
+    convergence_controller controller;
+    status = ConvergenceInitialize(target_time_us, UINT32_MAX, &controller);
+    if (!TEST_SUCCESS(status)) {
+        goto free_results;
     }
     vulkan_region *uniform_region = VulkanMemoryGetRegion(&uniform_memory, "uniform buffer");
     vulkan_region *data_region_1 = VulkanMemoryGetRegion(&memory, "data buffer 1");
     bool warmup = true;
+    warmup_detector warmup_state;
+    WarmupStart(&warmup_state);
+    helper_timer timer;
 
+    /* Regions are reported as soon as they are measured, a sweep that times out still leaves everything before it */
+    _VulkanLatencyLogCsvHeader(physical_device);
     uint32_t region_size_index = 0;
-    while (region_size_index <= max_usable_region_size) {
-        uint64_t region_size = vulkan_latency_region_sizes[region_size_index];
+    while (true) {
+        if (region_size_index == RegionSweepGetCount(&sweep)) {
+            /* Knees between the sizes measured so far get a size in between, which is measured like the rest */
+            size_t added_count = 0;
+            status = RegionSweepRefine(&sweep, results, refine_threshold, &added_count);
+            if (!TEST_SUCCESS(status)) {
+                goto cleanup_controller;
+            }
+            if (added_count == 0) {
+                break;
+            }
+            INFO("Refining %llu region sizes\n", (uint64_t)added_count);
+        }
+        uint64_t region_size = RegionSweepGetSize(&sweep, region_size_index);
         uint32_t hop_count = VULKAN_LATENCY_STARTING_HOPS;
+        if (region_size < region_min || region_size > maximum_region_size) {
+            region_size_index++;
+            continue;
+        }
+        if (CheckpointGetUnit(region_size_index, region_size, NULL, &(results[region_size_index]))) {
+            /* Measured before the run was interrupted */
+            status = _VulkanLatencyLogRegionResult(region_size_index, region_size, &(results[region_size_index]));
+            if (!TEST_SUCCESS(status)) {
+                goto cleanup_controller;
+            }
+            region_size_index++;
+            continue;
+        }
+        LoggerChannelSendProgress(region_size_index - ((region_size_index > max_usable_region_size) ? skipped_regions : 0), (uint32_t)RegionSweepGetCount(&sweep) - skipped_regions);
         if (warmup) {
             INFO("Warming up...\n");
         }
         DEBUG("Filling memory with pointer chains...\n");
         status = LatencyHelperLRUFillSubregion(&lru, data_region_1, region_size);
         if (!TEST_SUCCESS(status)) {
-            goto free_results;
+            goto cleanup_controller;
         }
         bool last_was_wg_increase = false;
+        uint64_t last_time_per_hop_100ns = 0;
+        /* The hop/workgroup search below does its own calibration, the controller only decides when to stop sampling */
+        ConvergenceStart(&controller, hop_count);
         uint64_t hops_needed_per_full_pass = region_size / VULKAN_LATENCY_POINTER_SIZE;
         uint32_t workgroups = 1;
+        uint64_t calibrated_hop_count = 0;
+        if (!warmup && CheckpointGetCalibration(region_size_index, region_size, &calibrated_hop_count, &workgroups)) {
+            /* The interrupted run already searched this region's chain length and workgroup count */
+            hop_count = (uint32_t)calibrated_hop_count;
+            ConvergenceStartSampling(&controller, hop_count);
+        }
 
         while (true) {
             bool too_many_workgroups = false;
             volatile vulkan_latency_uniform_buffer *uniform_buffer_memory = VulkanMemoryMap(uniform_region);
             if (uniform_buffer_memory == NULL) {
-                goto free_results;
+                goto cleanup_controller;
             }
             uniform_buffer_memory->hop_count = hop_count;
             uniform_buffer_memory->region_size = (uint32_t)(hops_needed_per_full_pass);
             uniform_buffer_memory->per_wg_offset = uniform_buffer_memory->region_size / workgroups;
-            memcpy((void*)uniform_buffer_memory->lru, lru.lru_table, sizeof(uniform_buffer_memory->lru));
+            memcpy((void*)uniform_buffer_memory->lru, lru.lru_table, (hop_stride / VULKAN_LATENCY_POINTER_SIZE) * sizeof(uint32_t));
 
             VulkanMemoryUnmap(uniform_region);
 
             status = VulkanCommandBufferStart(&command_sequence);
             if (!TEST_SUCCESS(status)) {
-                goto free_results;
+                goto cleanup_controller;
             }
             status = VulkanCommandBufferBindComputePipeline(&command_sequence, &pipeline);
             if (!TEST_SUCCESS(status)) {
                 goto cleanup_command_sequence;
             }
+            if (use_gpu_timestamps) {
+                status = VulkanQueryPoolReset(&command_sequence, &query_pool);
+                if (!TEST_SUCCESS(status)) {
+                    goto cleanup_command_sequence;
+                }
+                status = VulkanQueryWriteTimestamp(&command_sequence, &query_pool, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VULKAN_QUERY_TIMESTAMP_START);
+                if (!TEST_SUCCESS(status)) {
+                    goto cleanup_command_sequence;
+                }
+            }
             status = VulkanCommandBufferDispatch(&command_sequence, workgroups, 1, 1);
             if (!TEST_SUCCESS(status)) {
                 goto cleanup_command_sequence;
             }
+            if (use_gpu_timestamps) {
+                status = VulkanQueryWriteTimestamp(&command_sequence, &query_pool, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, VULKAN_QUERY_TIMESTAMP_END);
+                if (!TEST_SUCCESS(status)) {
+                    goto cleanup_command_sequence;
+                }
+            }
             status = VulkanCommandBufferEnd(&command_sequence);
             if (!TEST_SUCCESS(status)) {
                 goto cleanup_command_sequence;
             }
-            HelperResetTimestamp();
+            HelperTimerReset(&timer);
             status = VulkanCommandBufferSubmit(&command_sequence);
             if (!TEST_SUCCESS(status)) {
                 goto cleanup_command_sequence;
             }
-            status = VulkanCommandBufferWait(&command_sequence, VULKAN_COMMAND_SEQUENCE_WAIT_INFINITE);
+            status = VulkanCommandBufferWait(&command_sequence, VULKAN_COMMAND_SEQUENCE_WAIT_STEP);
             if (!TEST_SUCCESS(status)) {
                 goto cleanup_command_sequence;
             }
-            uint64_t time = HelperMarkTimestamp();
-            float time_per_hop_ns = 0;
+            uint64_t time = HelperTimerMark(&timer);
+            if (use_gpu_timestamps) {
+                uint64_t time_ns = 0;
+                status = VulkanQueryGetElapsedNanoseconds(&query_pool, VULKAN_QUERY_TIMESTAMP_START, VULKAN_QUERY_TIMESTAMP_END, &time_ns);
+                if (!TEST_SUCCESS(status)) {
+                    goto cleanup_command_sequence;
+                }
+                time = time_ns / 1000;
+            }
+            time = VulkanOverheadSubtract(&overhead, time);
+            uint64_t time_per_hop_100ns = 0;
             if (!warmup) {
                 if (time == 0) {
                     INFO("Hop count %lu, WG count %lu took %.3fms (latency: N/A, total hops: %llu)\n", hop_count * VULKAN_LATENCY_HOPS_PER_CYCLE, workgroups, time / 1000.0f, (uint64_t)hop_count *VULKAN_LATENCY_HOPS_PER_CYCLE * (uint64_t)workgroups);
                 } else {
                     uint64_t total_hops = (uint64_t)hop_count * VULKAN_LATENCY_HOPS_PER_CYCLE;
                     uint64_t total_time_100ns = time * 100000;
-                    uint64_t time_per_hop_100ns = total_time_100ns / total_hops;
-                    time_per_hop_ns = (float)((double)time_per_hop_100ns / 100.0);
-                    if (last_was_wg_increase && (results[region_size_index] * VULKAN_LATENCY_BACKOFF_THRESHOLD) < time_per_hop_100ns) {
+                    time_per_hop_100ns = total_time_100ns / total_hops;
+                    float time_per_hop_ns = (float)((double)time_per_hop_100ns / 100.0);
+                    if (ConvergenceGetState(&controller) == convergence_state_calibrating && last_was_wg_increase && (last_time_per_hop_100ns * VULKAN_LATENCY_BACKOFF_THRESHOLD) < time_per_hop_100ns) {
                         INFO("Hop count %lu, WG count %lu took %.3fms (latency: %.3fns INVALID (WG overload), total hops: %llu)\n", hop_count * VULKAN_LATENCY_HOPS_PER_CYCLE, workgroups, time / 1000.0f, time_per_hop_ns, (uint64_t)hop_count * VULKAN_LATENCY_HOPS_PER_CYCLE * (uint64_t)workgroups);
                         too_many_workgroups = true;
-                        time_per_hop_ns = (float)((double)results[region_size_index] / 100.0);
                     } else {
                         INFO("Hop count %lu, WG count %lu took %.3fms (latency: %.3fns, total hops: %llu)\n", hop_count * VULKAN_LATENCY_HOPS_PER_CYCLE, workgroups, time / 1000.0f, time_per_hop_ns, (uint64_t)hop_count * VULKAN_LATENCY_HOPS_PER_CYCLE * (uint64_t)workgroups);
-                        results[region_size_index] = time_per_hop_100ns;
+                        last_time_per_hop_100ns = time_per_hop_100ns;
                     }
                 }
             }
 
-            if (too_many_workgroups || time >= VULKAN_LATENCY_TARGET_TIME_US) {
+            if (ConvergenceGetState(&controller) == convergence_state_calibrating) {
+                if (!too_many_workgroups && time < target_time_us) {
+                    hop_count *= 2;
+                    last_was_wg_increase = false;
+                    continue;
+                }
                 if (warmup) {
-                    INFO("Warmup finished\n");
-                    break;
-                } else {
-                    if (too_many_workgroups || ((uint64_t)hop_count * VULKAN_LATENCY_HOPS_PER_CYCLE * (uint64_t)workgroups) >= (hops_needed_per_full_pass * VULKAN_LATENCY_COVERAGE_MULTIPLE)) {
-                        helper_unit_pair region_conversion;
-                        HelperConvertUnitsBytes1024(region_size, &region_conversion);
-                        INFO("%.1f %s latency: %.3fns\n", region_conversion.value, region_conversion.units, time_per_hop_ns);
+                    /* Keep repeating the calibrated chain until the timings settle */
+                    WarmupAddRun(&warmup_state, time, hop_count);
+                    if (WarmupIsFinished(&warmup_state)) {
                         break;
-                    } else {
-                        workgroups *= 2;
-                        hop_count /= 2;
-                        last_was_wg_increase = true;
                     }
+                    continue;
+                }
+                if (too_many_workgroups) {
+                    /* Go back to the last valid configuration and take all trials from there */
+                    workgroups /= 2;
+                    hop_count *= 2;
+                    ConvergenceStartSampling(&controller, hop_count);
+                    status = CheckpointRecordCalibration(region_size_index, region_size, hop_count, workgroups);
+                    if (!TEST_SUCCESS(status)) {
+                        goto cleanup_command_sequence;
+                    }
+                    continue;
+                }
+                if (((uint64_t)hop_count * VULKAN_LATENCY_HOPS_PER_CYCLE * (uint64_t)workgroups) < (hops_needed_per_full_pass * VULKAN_LATENCY_COVERAGE_MULTIPLE)) {
+                    workgroups *= 2;
+                    hop_count /= 2;
+                    last_was_wg_increase = true;
+                    continue;
+                }
+                ConvergenceStartSampling(&controller, hop_count);
+                status = CheckpointRecordCalibration(region_size_index, region_size, hop_count, workgroups);
+                if (!TEST_SUCCESS(status)) {
+                    goto cleanup_command_sequence;
+                }
+            }
+            status = ConvergenceAddRun(&controller, time, (double)time_per_hop_100ns);
+            if (!TEST_SUCCESS(status)) {
+                goto cleanup_command_sequence;
+            }
+            if (ConvergenceGetState(&controller) == convergence_state_finished) {
+                status = ConvergenceSummarize(&controller, &(results[region_size_index]));
+                if (!TEST_SUCCESS(status)) {
+                    goto cleanup_command_sequence;
+                }
+                /* Samples are stored in hundredths of a nanosecond */
+                status = ResultsRecordSamples(region_size_index, &(controller.samples), &(controller.timings), 1.0 / 100.0);
+                if (!TEST_SUCCESS(status)) {
+                    goto cleanup_command_sequence;
+                }
+                helper_unit_pair region_conversion;
+                HelperConvertUnitsBytes1024(region_size, &region_conversion);
+                INFO("%.1f %s latency: %.3fns (median of %lu, %lu outliers, CI +-%.2f%%%s)\n", region_conversion.value, region_conversion.units, results[region_size_index].median / 100.0, results[region_size_index].sample_count, results[region_size_index].rejected_outliers, controller.relative_error * 100.0, controller.converged ? "" : ", not converged");
+                status = _VulkanLatencyLogRegionResult(region_size_index, region_size, &(results[region_size_index]));
+                if (!TEST_SUCCESS(status)) {
+                    goto cleanup_command_sequence;
+                }
+                status = CheckpointRecordUnit(region_size_index, region_size, hop_count, &(results[region_size_index]));
+                if (!TEST_SUCCESS(status)) {
+                    goto cleanup_command_sequence;
                 }
-            } else {
-                hop_count *= 2;
-                last_was_wg_increase = false;
+                break;
             }
         }
         if (warmup) {
@@ -345,32 +494,21 @@ static test_status _VulkanLatencyEntry(vulkan_physical_device *physical_device,
         }
     }
 
-    INFO("Final results for %s:\n", physical_device->physical_properties.properties.deviceName);
-    if (MainGetTestResultFormat() == test_result_csv) {
-        LOG_PLAIN("%s,\n", physical_device->physical_properties.properties.deviceName);
-        LOG_PLAIN("Region size,Latency (ns)\n");
-    }
-    for (uint32_t i = 0; i <= max_usable_region_size; i++) {
-        uint64_t region_size = vulkan_latency_region_sizes[i];
-        uint64_t result = results[i];
-        float result_ns = (float)((double)result / 100.0);
-
-        helper_unit_pair region_conversion;
-        HelperConvertUnitsBytes1024(region_size, &region_conversion);
-
-        if (MainGetTestResultFormat() == test_result_csv) {
-            LOG_PLAIN("%.1f%s,%.3f\n", region_conversion.value, region_conversion.units, result_ns);
-        } else if(MainGetTestResultFormat() == test_result_raw) {
-            LOG_RESULT(i, "%llu", "%llu", region_size, result * 10);
-        } else {
-            INFO("Latency for %.1f %s: %.3fns\n", region_conversion.value, region_conversion.units, result_ns);
-        }
-    }
+    LoggerChannelSendProgress((uint32_t)RegionSweepGetCount(&sweep) - skipped_regions, (uint32_t)RegionSweepGetCount(&sweep) - skipped_regions);
+    VulkanOverheadLogResult(&overhead);
+    WarmupLogResult(&warmup_state);
+    ParametersLogResult(vulkan_latency_parameters, parameters, PARAMETERS_COUNT(vulkan_latency_parameters));
 
 cleanup_command_sequence:
     VulkanCommandBufferReset(&command_sequence);
+cleanup_controller:
+    ConvergenceCleanUp(&controller);
 free_results:
     free(results);
+cleanup_query_pool:
+    if (use_gpu_timestamps) {
+        VulkanQueryPoolCleanUp(&query_pool);
+    }
 cleanup_command_buffer:
     VulkanCommandBufferCleanUp(&command_buffer);
 free_memory2:
@@ -387,18 +525,188 @@ cleanup_shader:
     VulkanShaderCleanUp(&shader);
 cleanup_device:
     VulkanDestroyDevice(&device);
-cleanup_queue_properties:
-    free(queue_family_properties);
 cleanup_lru:
     LatencyHelperLRUCleanUp(&lru);
+cleanup_sweep:
+    RegionSweepCleanUp(&sweep);
 error:
     return status;
 }
 
+static test_status _VulkanLatencyLogRegionResult(uint32_t region_size_index, uint64_t region_size, const statistics_summary *summary) {
+    statistics_summary result = *summary;
+    /* Samples are stored in hundredths of a nanosecond */
+    StatisticsScaleSummary(&result, 1.0 / 100.0);
+
+    helper_unit_pair region_conversion;
+    HelperConvertUnitsBytes1024(region_size, &region_conversion);
+
+    if (MainGetTestResultFormat() == test_result_csv) {
+        LOG_PLAIN("%.1f%s,%.3f," STATISTICS_CSV_FORMAT "\n", region_conversion.value, region_conversion.units, result.median, STATISTICS_CSV_VALUES(&result));
+    } else if(MainGetTestResultFormat() == test_result_raw) {
+        StatisticsScaleSummary(&result, 1000.0);
+        LOG_RESULT(region_size_index, "%llu", "%llu", region_size, (uint64_t)result.median);
+        LOG_RESULT_STATISTICS(region_size_index, "%llu", region_size, &result);
+    } else if (MainGetTestResultFormat() == test_result_json) {
+        char key[RESULTS_MAXIMUM_NAME_LENGTH];
+        snprintf(key, sizeof(key), "%llu", (unsigned long long)region_size);
+        test_status status = ResultsAddMeasurement(region_size_index, key, "ns", &result);
+        TEST_RETFAIL(status);
+    } else {
+        INFO("Latency for %.1f %s: %.3fns (p5 %.3fns, p95 %.3fns, stddev %.3fns)\n", region_conversion.value, region_conversion.units, result.median, result.p5, result.p95, result.standard_deviation);
+    }
+    LoggerFlushCapture();
+    return TEST_OK;
+}
+
+static void _VulkanLatencyLogCsvHeader(vulkan_physical_device *physical_device) {
+    if (MainGetTestResultFormat() == test_result_csv) {
+        LOG_PLAIN("%s,\n", physical_device->physical_properties.properties.deviceName);
+        LOG_PLAIN("Region size,Latency (ns)," STATISTICS_CSV_HEADER "\n");
+    }
+}
+
+/* Refinement runs again on the same results, which adds the sizes the interrupted run refined with */
+static test_status _VulkanLatencyReplayCheckpoint(vulkan_physical_device *physical_device, uint64_t *parameters) {
+    INFO("Replaying the results of the interrupted run\n");
+    region_sweep sweep;
+    test_status status = _VulkanLatencyCreateSweep(parameters, &sweep);
+    TEST_RETFAIL(status);
+    size_t result_capacity = RegionSweepGetMaximumCount(&sweep);
+    statistics_summary *results = malloc(result_capacity * sizeof(statistics_summary));
+    if (results == NULL) {
+        status = TEST_OUT_OF_MEMORY;
+        goto cleanup_sweep;
+    }
+    memset(results, 0, result_capacity * sizeof(statistics_summary));
+
+    _VulkanLatencyLogCsvHeader(physical_device);
+    size_t region_size_index = 0;
+    while (true) {
+        if (region_size_index == RegionSweepGetCount(&sweep)) {
+            size_t added_count = 0;
+            status = RegionSweepRefine(&sweep, results, (uint32_t)parameters[vulkan_latency_parameter_refine_threshold], &added_count);
+            if (!TEST_SUCCESS(status) || added_count == 0) {
+                break;
+            }
+        }
+        uint64_t region_size = RegionSweepGetSize(&sweep, region_size_index);
+        if (CheckpointGetUnit((uint32_t)region_size_index, region_size, NULL, &(results[region_size_index]))) {
+            status = _VulkanLatencyLogRegionResult((uint32_t)region_size_index, region_size, &(results[region_size_index]));
+            if (!TEST_SUCCESS(status)) {
+                break;
+            }
+        }
+        region_size_index++;
+    }
+    if (TEST_SUCCESS(status)) {
+        LoggerChannelSendProgress((uint32_t)RegionSweepGetCount(&sweep), (uint32_t)RegionSweepGetCount(&sweep));
+        ParametersLogResult(vulkan_latency_parameters, parameters, PARAMETERS_COUNT(vulkan_latency_parameters));
+    }
+    free(results);
+cleanup_sweep:
+    RegionSweepCleanUp(&sweep);
+    return status;
+}
+
+/* The hop stride is specialized into the shader */
+static test_status _VulkanLatencyPrepare(vulkan_physical_device *physical_device, void *config_data) {
+    bool scalar_test = ((uint64_t)config_data) == VULKAN_LATENCY_TEST_TYPE_SCALAR;
+    vulkan_device device;
+    test_status status = _VulkanLatencyCreateDevice(physical_device, &device);
+    TEST_RETFAIL(status);
+    vulkan_pipeline_builder *builder = NULL;
+    status = VulkanRunnerGetPipelineBuilder(&device, &builder);
+    TEST_RETFAIL(status);
+    vulkan_shader shader;
+    status = _VulkanLatencyCreateShader(builder->device, scalar_test, &shader);
+    TEST_RETFAIL(status);
+    vulkan_shader *owned_shader = NULL;
+    status = VulkanPipelineBuilderAddShader(builder, &shader, &owned_shader);
+    TEST_RETFAIL(status);
+    uint32_t specialization_constants[] = { (uint32_t)ParametersGet(&(vulkan_latency_parameters[vulkan_latency_parameter_hop_stride])) };
+    return VulkanPipelineBuilderAddPipeline(builder, owned_shader, "main", specialization_constants, 1);
+}
+
+/* Shared with the pipeline build, which has to create the same device for the test to be handed it warm */
+static test_status _VulkanLatencyCreateDevice(vulkan_physical_device *physical_device, vulkan_device *device) {
+    VkQueueFamilyProperties *queue_family_properties = NULL;
+    uint32_t queue_family_count = 0;
+    test_status status = VulkanGetPhysicalQueueFamilyProperties(physical_device, &queue_family_properties, &queue_family_count);
+    TEST_RETFAIL(status);
+    status = VulkanCreateDevice(physical_device, queue_family_properties, queue_family_count, VK_QUEUE_COMPUTE_BIT | VK_QUEUE_TRANSFER_BIT, device, NULL);
+    free(queue_family_properties);
+    return status;
+}
+
+/* Shared with the pipeline build, the layout has to match for the driver to find the pipeline it compiled */
+static test_status _VulkanLatencyCreateShader(vulkan_device *device, bool scalar_test, vulkan_shader *shader) {
+    test_status status = VulkanShaderInitializeFromFile(device, scalar_test ? "vulkan_latency_scalar.spv" : "vulkan_latency_vector.spv", VK_SHADER_STAGE_COMPUTE_BIT, shader);
+    TEST_RETFAIL(status);
+    status = VulkanShaderAddDescriptor(shader, "data buffer 1", VULKAN_BINDING_STORAGE, 0, 0);
+    if (!TEST_SUCCESS(status)) {
+        goto cleanup_shader;
+    }
+    status = VulkanShaderAddDescriptor(shader, "data buffer 2", VULKAN_BINDING_STORAGE, 0, 1);
+    if (!TEST_SUCCESS(status)) {
+        goto cleanup_shader;
+    }
+    status = VulkanShaderAddFixedSizeDescriptor(shader, sizeof(vulkan_latency_uniform_buffer), "uniform buffer", VULKAN_BINDING_UNIFORM, 0, 2);
+    if (!TEST_SUCCESS(status)) {
+        goto cleanup_shader;
+    }
+    status = VulkanShaderCreateDescriptorSets(shader);
+    if (!TEST_SUCCESS(status)) {
+        goto cleanup_shader;
+    }
+    return TEST_OK;
+cleanup_shader:
+    VulkanShaderCleanUp(shader);
+    return status;
+}
+
+/* The workgroup search runs before sampling starts, so it is fixed time the scheduler can't shorten
+ * Refinement depends on the results, so only the base sweep is part of the estimate */
+static test_status _VulkanLatencyEstimate(vulkan_physical_device *physical_device, void *config_data, planner_estimate *estimate) {
+    TEST_UNUSED(config_data);
+    uint64_t parameters[PARAMETERS_COUNT(vulkan_latency_parameters)];
+    ParametersGetAll(vulkan_latency_parameters, PARAMETERS_COUNT(vulkan_latency_parameters), parameters);
+    uint64_t maximum_allocation = min(physical_device->physical_properties.properties.limits.maxStorageBufferRange, physical_device->physical_maintenance_properties_3.maxMemoryAllocationSize);
+    uint64_t maximum_region_size = min(min(maximum_allocation, VulkanGetDeviceLocalMemorySize(physical_device)), parameters[vulkan_latency_parameter_region_max]);
+    uint64_t target_time_us = parameters[vulkan_latency_parameter_target_time_us];
+    region_sweep sweep;
+    test_status status = _VulkanLatencyCreateSweep(parameters, &sweep);
+    TEST_RETFAIL(status);
+    for (size_t i = 0; i < RegionSweepGetCount(&sweep) && RegionSweepGetSize(&sweep, i) <= maximum_region_size; i++) {
+        if (RegionSweepGetSize(&sweep, i) >= parameters[vulkan_latency_parameter_region_min]) {
+            estimate->step_count++;
+        }
+    }
+    RegionSweepCleanUp(&sweep);
+    estimate->sample_time_us = target_time_us;
+    estimate->fixed_time_us = WarmupEstimateTime(target_time_us) + estimate->step_count * VULKAN_LATENCY_ESTIMATED_SEARCH_RUNS * target_time_us;
+    return TEST_OK;
+}
+
+static test_status _VulkanLatencyCreateSweep(const uint64_t *parameters, region_sweep *sweep) {
+    return RegionSweepInitialize(parameters[vulkan_latency_parameter_region_min], parameters[vulkan_latency_parameter_region_max], (uint32_t)parameters[vulkan_latency_parameter_points_per_octave], VULKAN_LATENCY_REGION_GRANULARITY, sweep);
+}
+
 const uint64_t *VulkanLatencyGetRegionSizes() {
-    return vulkan_latency_region_sizes;
+    if (!vulkan_latency_sweep_created) {
+        uint64_t parameters[PARAMETERS_COUNT(vulkan_latency_parameters)];
+        ParametersGetAll(vulkan_latency_parameters, PARAMETERS_COUNT(vulkan_latency_parameters), parameters);
+        if (!TEST_SUCCESS(_VulkanLatencyCreateSweep(parameters, &vulkan_latency_sweep))) {
+            return NULL;
+        }
+        vulkan_latency_sweep_created = true;
+    }
+    return RegionSweepGetSizes(&vulkan_latency_sweep);
 }
 
 size_t VulkanLatencyGetRegionCount() {
-    return vulkan_latency_region_count;
+    if (VulkanLatencyGetRegionSizes() == NULL) {
+        return 0;
+    }
+    return RegionSweepGetCount(&vulkan_latency_sweep);
 }
\ No newline at end of file
@@ -90,5 +90,5 @@ static test_status _VulkanListEntry(int32_t device_id, void *config_data) {
 }
 
 test_status TestsVulkanListRegister() {
-    return RunnerRegisterTest(&_VulkanListEntry, NULL, TESTS_VULKAN_LIST_NAME, TESTS_VULKAN_LIST_VERSION);
+    return RunnerRegisterTest(&_VulkanListEntry, NULL, NULL, NULL, TESTS_VULKAN_LIST_NAME, TESTS_VULKAN_LIST_VERSION, RUNNER_TEST_FLAG_ALL_DEVICES, "info");
 }
\ No newline at end of file
@@ -24,14 +24,25 @@
 #include "main.h"
 #include "logger.h"
 #include "vulkan_helper.h"
+#include "runner.h"
+#include "planner.h"
 #include "vulkan_runner.h"
 #include "vulkan_memory.h"
 #include "vulkan_shader.h"
 #include "vulkan_compute_pipeline.h"
+#include "vulkan_pipeline_builder.h"
 #include "vulkan_command_buffer.h"
+#include "vulkan_query.h"
+#include "vulkan_overhead.h"
 #include "vulkan_texture.h"
 #include "buffer_filler.h"
 #include "vulkan_staging.h"
+#include "statistics.h"
+#include "convergence.h"
+#include "warmup.h"
+#include "soak.h"
+#include "parameters.h"
+#include "results.h"
 #include "tests/test_vk_rate.h"
 
 #define VULKAN_RATE_PARALLEL_OPS                (16)    /* 4 4D vectors for each thread */
@@ -39,6 +50,9 @@
 #define VULKAN_RATE_STARTING_WORKGROUP_COUNT    (16)
 #define VULKAN_RATE_STARTING_LOOP_COUNT         (1024)
 #define VULKAN_RATE_TARGET_TIME_US              (250000)
+#define VULKAN_RATE_WARMUP_WORKGROUP_COUNT      (1024)  /* Enough to occupy every shader core of current GPUs */
+#define VULKAN_RATE_WARMUP_TIME_US              (25000)
+#define VULKAN_RATE_ESTIMATED_SWEEP_STEPS       (8)     /* Workgroup counts swept before one run passes the target time, 16 to 4096 */
 
 #define VULKAN_RATE_OP_TYPE_OP                  (0)
 #define VULKAN_RATE_OP_TYPE_FLOP                (1)
@@ -48,7 +62,7 @@
 
 #define VULKAN_RATE_REGISTER_SUBTEST(type, op, size, ops_per_cycle, op_type) \
 {\
-    test_status status = _VulkanRateRegisterSubtest(type, op, TESTS_VULKAN_RATE_NAME_PREFIX type TESTS_VULKAN_RATE_NAME_SEPARATOR op, size, ops_per_cycle, op_type);\
+    test_status status = _VulkanRateRegisterSubtest(type, op, TESTS_VULKAN_RATE_NAME_PREFIX type TESTS_VULKAN_RATE_NAME_SEPARATOR op, "compute,rate," type "," op, size, ops_per_cycle, op_type);\
     if (!TEST_SUCCESS(status)) {\
         return status;\
     }\
@@ -61,6 +75,16 @@ VULKAN_RATE_REGISTER_SUBTEST(type, TESTS_VULKAN_RATE_OP_MAC, size, ops_per_cycle
 VULKAN_RATE_REGISTER_SUBTEST(type, TESTS_VULKAN_RATE_OP_DIV, size, ops_per_cycle, op_type) \
 VULKAN_RATE_REGISTER_SUBTEST(type, TESTS_VULKAN_RATE_OP_REM, size, ops_per_cycle, op_type)
 
+typedef enum vulkan_rate_parameter_t {
+    vulkan_rate_parameter_target_time_us,
+    vulkan_rate_parameter_starting_loop_count
+} vulkan_rate_parameter;
+
+static const parameters_definition vulkan_rate_parameters[] = {
+    {"target_time_us", parameters_type_integer, VULKAN_RATE_TARGET_TIME_US, PARAMETERS_TARGET_TIME_MINIMUM_US, PARAMETERS_TARGET_TIME_MAXIMUM_US, "Kernel run time the loop count is scaled towards"},
+    {"starting_loop_count", parameters_type_power_of_two, VULKAN_RATE_STARTING_LOOP_COUNT, 1, 1048576, "Loop count every workgroup count starts from"}
+};
+
 typedef struct vulkan_rate_uniform_buffer_t {
     uint32_t loop_count;
 } vulkan_rate_uniform_buffer;
@@ -87,14 +111,21 @@ static const char *_vulkan_rate_op_map[] = {
 };
 
 static test_status _VulkanRateEntry(vulkan_physical_device *device, void *config_data);
-static test_status _VulkanRateExecuteKernel(uint64_t workgroup_count, uint32_t loop_count, uint32_t ops_per_cycle, uint64_t *result, uint64_t *time_taken, vulkan_device *device, vulkan_region *uniform_region, vulkan_command_sequence *command_sequence, vulkan_compute_pipeline *pipeline);
+static test_status _VulkanRateEstimate(vulkan_physical_device *physical_device, void *config_data, planner_estimate *estimate);
+static test_status _VulkanRatePrepare(vulkan_physical_device *physical_device, void *config_data);
+static test_status _VulkanRateCreateDevice(vulkan_physical_device *physical_device, int32_t test_type_index, bool validate_invocations, vulkan_device *device);
+static test_status _VulkanRateCreateShader(vulkan_device *device, const char *test_datatype_string, const char *test_op_string, vulkan_shader *shader);
+static test_status _VulkanRateExecuteKernel(uint64_t workgroup_count, uint32_t loop_count, uint32_t ops_per_cycle, uint64_t *result, uint64_t *time_taken, vulkan_device *device, vulkan_region *uniform_region, vulkan_command_sequence *command_sequence, vulkan_compute_pipeline *pipeline, vulkan_query_pool *query_pool, vulkan_overhead *overhead, vulkan_query_pool *invocation_pool, bool *invocations_valid);
 static int32_t _VulkanRateGetIndexOfType(const char *type);
 static int32_t _VulkanRateGetIndexOfOp(const char *op);
 static const char *_VulkanRateGetTypeFromIndex(int32_t index);
 static const char *_VulkanRateGetOpFromIndex(int32_t index);
-static test_status _VulkanRateRegisterSubtest(const char *type, const char *op, const char *test_name, size_t datatype_size, uint32_t ops_per_cycle, uint32_t op_type);
+static uint32_t _VulkanRateGetRequiredFeatures(int32_t type_index);
+static test_status _VulkanRateRegisterSubtest(const char *type, const char *op, const char *test_name, const char *tags, size_t datatype_size, uint32_t ops_per_cycle, uint32_t op_type);
 
 test_status TestsVulkanRateRegister() {
+    test_status status = ParametersDeclare(TESTS_VULKAN_RATE_NAME_PREFIX "*", vulkan_rate_parameters, PARAMETERS_COUNT(vulkan_rate_parameters));
+    TEST_RETFAIL(status);
     VULKAN_RATE_REGISTER_SUBTEST(TESTS_VULKAN_RATE_TYPE_FP16, TESTS_VULKAN_RATE_OP_ISQRT, sizeof(float), 2, VULKAN_RATE_OP_TYPE_OP);
     VULKAN_RATE_REGISTER_SUBTEST(TESTS_VULKAN_RATE_TYPE_FP32, TESTS_VULKAN_RATE_OP_ISQRT, sizeof(float), 1, VULKAN_RATE_OP_TYPE_OP);
     VULKAN_RATE_REGISTER_SUBTEST(TESTS_VULKAN_RATE_TYPE_FP64, TESTS_VULKAN_RATE_OP_ISQRT, sizeof(double), 1, VULKAN_RATE_OP_TYPE_OP);
@@ -114,6 +145,10 @@ test_status TestsVulkanRateRegister() {
 static test_status _VulkanRateEntry(vulkan_physical_device *physical_device, void *config_data) {
     test_status status = TEST_OK;
     VkResult res = VK_SUCCESS;
+    uint64_t parameters[PARAMETERS_COUNT(vulkan_rate_parameters)];
+    ParametersGetAll(vulkan_rate_parameters, PARAMETERS_COUNT(vulkan_rate_parameters), parameters);
+    uint64_t target_time_us = parameters[vulkan_rate_parameter_target_time_us];
+    uint32_t starting_loop_count = (uint32_t)parameters[vulkan_rate_parameter_starting_loop_count];
 
     int32_t test_type_index = (int32_t)((((uint64_t)config_data) >> 16) & 0xFFFF);
     int32_t test_op_index = (int32_t)(((uint64_t)config_data) & 0xFFFF);
@@ -122,77 +157,41 @@ static test_status _VulkanRateEntry(vulkan_physical_device *physical_device, voi
     uint32_t test_op_type = (uint32_t)((((uint64_t)config_data) >> 56) & 0xFF);
     const char *test_datatype_string = _VulkanRateGetTypeFromIndex(test_type_index);
     const char *test_op_string = _VulkanRateGetOpFromIndex(test_op_index);
+    const char *test_op_type_string = "OPS";
+    switch (test_op_type) {
+    case VULKAN_RATE_OP_TYPE_FLOP:
+    case VULKAN_RATE_OP_TYPE_FLOPX2:
+        test_op_type_string = "FLOPS";
+        break;
+    case VULKAN_RATE_OP_TYPE_IOP:
+    case VULKAN_RATE_OP_TYPE_IOPX2:
+        test_op_type_string = "IOPS";
+        break;
+    default:
+        break;
+    }
 
     if (test_datatype_string == NULL || test_op_string == NULL || test_datatype_size == 0) {
         return TEST_PROGRAMMING_ERROR;
     }
     INFO("Device Name: %s\n", physical_device->physical_properties.properties.deviceName);
 
-    VkQueueFamilyProperties *queue_family_properties = NULL;
-    uint32_t queue_family_count = 0;
-    status = VulkanGetPhysicalQueueFamilyProperties(physical_device, &queue_family_properties, &queue_family_count);
-    if (!TEST_SUCCESS(status)) {
-        goto error;
-    }
-
-    VkPhysicalDeviceVulkan12Features enabled_features_vk12 = {0};
-    enabled_features_vk12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
-    enabled_features_vk12.pNext = NULL;
-    VkPhysicalDeviceVulkan11Features enabled_features_vk11 = {0};
-    enabled_features_vk11.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_1_FEATURES;
-    enabled_features_vk11.pNext = &enabled_features_vk12;
-    VkPhysicalDeviceFeatures2 enabled_features = {0};
-    enabled_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
-    enabled_features.pNext = &enabled_features_vk11;
-
-    if (test_type_index == _VulkanRateGetIndexOfType(TESTS_VULKAN_RATE_TYPE_FP64)) {
-        enabled_features.features.shaderFloat64 = VK_TRUE;
-    } else if (test_type_index == _VulkanRateGetIndexOfType(TESTS_VULKAN_RATE_TYPE_FP16)) {
-        enabled_features_vk12.shaderFloat16 = VK_TRUE;
-        enabled_features_vk11.storageBuffer16BitAccess = VK_TRUE;
-    } else if (test_type_index == _VulkanRateGetIndexOfType(TESTS_VULKAN_RATE_TYPE_INT64)) {
-        enabled_features.features.shaderInt64 = VK_TRUE;
-    } else if (test_type_index == _VulkanRateGetIndexOfType(TESTS_VULKAN_RATE_TYPE_INT16)) {
-        enabled_features.features.shaderInt16 = VK_TRUE;
-        enabled_features_vk11.storageBuffer16BitAccess = VK_TRUE;
-    } else if (test_type_index == _VulkanRateGetIndexOfType(TESTS_VULKAN_RATE_TYPE_INT8)) {
-        enabled_features_vk12.shaderInt8 = VK_TRUE;
-        enabled_features_vk12.uniformAndStorageBuffer8BitAccess = VK_TRUE;
+    bool validate_invocations = MainGetValidateInvocations() && VulkanQueryInvocationsSupported(physical_device);
+    if (!validate_invocations && MainGetValidateInvocations()) {
+        WARNING("Pipeline statistics queries are unsupported, compute shader invocations won't be validated\n");
     }
 
     vulkan_device device;
-    status = VulkanCreateDevice(physical_device, queue_family_properties, queue_family_count, VK_QUEUE_COMPUTE_BIT | VK_QUEUE_TRANSFER_BIT, &device, &enabled_features);
+    status = _VulkanRateCreateDevice(physical_device, test_type_index, validate_invocations, &device);
     if (!TEST_SUCCESS(status)) {
-        goto cleanup_queue_properties;
+        goto error;
     }
 
     vulkan_shader shader;
-    const char *shader_name = NULL;
-    status = HelperPrintToBuffer(&shader_name, NULL, "vulkan_rate_%s_%s.spv", test_datatype_string, test_op_string);
-    if (!TEST_SUCCESS(status)) {
-        goto cleanup_device;
-    }
-    status = VulkanShaderInitializeFromFile(&device, shader_name, VK_SHADER_STAGE_COMPUTE_BIT, &shader);
-    free((void*)shader_name);
+    status = _VulkanRateCreateShader(&device, test_datatype_string, test_op_string, &shader);
     if (!TEST_SUCCESS(status)) {
         goto cleanup_device;
     }
-    status = VulkanShaderAddDescriptor(&shader, "dummy inputs", VULKAN_BINDING_STORAGE, 0, 0);
-    if (!TEST_SUCCESS(status)) {
-        goto cleanup_shader;
-    }
-    status = VulkanShaderAddDescriptor(&shader, "dummy outputs", VULKAN_BINDING_STORAGE, 0, 1);
-    if (!TEST_SUCCESS(status)) {
-        goto cleanup_shader;
-    }
-    status = VulkanShaderAddFixedSizeDescriptor(&shader, sizeof(vulkan_rate_uniform_buffer), "uniform buffer", VULKAN_BINDING_UNIFORM, 0, 2);
-    if (!TEST_SUCCESS(status)) {
-        goto cleanup_shader;
-    }
-    status = VulkanShaderCreateDescriptorSets(&shader);
-    if (!TEST_SUCCESS(status)) {
-        goto cleanup_shader;
-    }
     vulkan_compute_pipeline pipeline;
     status = VulkanComputePipelineInitialize(&shader, "main", &pipeline);
     if (!TEST_SUCCESS(status)) {
@@ -259,17 +258,48 @@ static test_status _VulkanRateEntry(vulkan_physical_device *physical_device, voi
     if (!TEST_SUCCESS(status)) {
         goto cleanup_command_buffer;
     }
+    bool use_gpu_timestamps = !MainGetUseHostTimer() && VulkanQueryTimestampsSupported(&command_buffer);
+    vulkan_query_pool query_pool;
+    if (use_gpu_timestamps) {
+        status = VulkanQueryPoolInitializeTimestamps(&command_buffer, VULKAN_QUERY_TIMESTAMP_PAIR, &query_pool);
+        if (!TEST_SUCCESS(status)) {
+            goto cleanup_command_buffer;
+        }
+    }
+    INFO("Timing source: %s\n", use_gpu_timestamps ? "GPU timestamps" : "host timer");
+    vulkan_query_pool invocation_pool;
+    bool invocations_valid = true;
+    if (validate_invocations) {
+        status = VulkanQueryPoolInitializeInvocations(&command_buffer, VULKAN_QUERY_INVOCATIONS_COUNT, &invocation_pool);
+        if (!TEST_SUCCESS(status)) {
+            goto cleanup_query_pool;
+        }
+    }
+    vulkan_overhead overhead;
+    status = VulkanOverheadCalibrate(&command_sequence, use_gpu_timestamps ? &query_pool : NULL, &overhead);
+    if (!TEST_SUCCESS(status)) {
+        goto cleanup_invocation_pool;
+    }
     vulkan_region *uniform_region = VulkanMemoryGetRegion(&uniform_memory, "uniform buffer");
 
     /* Warmup */
     INFO("Warming up...\n");
-    for (int i = 0; i < 10; i++) {
-        status = _VulkanRateExecuteKernel(VULKAN_RATE_STARTING_WORKGROUP_COUNT, VULKAN_RATE_STARTING_WORKGROUP_COUNT, test_ops_per_cycle, NULL, NULL, &device, uniform_region, &command_sequence, &pipeline);
+    warmup_detector warmup_state;
+    WarmupStart(&warmup_state);
+    uint32_t warmup_loops = starting_loop_count;
+    while (!WarmupIsFinished(&warmup_state)) {
+        uint64_t time_taken = 0;
+        status = _VulkanRateExecuteKernel(VULKAN_RATE_WARMUP_WORKGROUP_COUNT, warmup_loops, test_ops_per_cycle, NULL, &time_taken, &device, uniform_region, &command_sequence, &pipeline, use_gpu_timestamps ? &query_pool : NULL, &overhead, NULL, NULL);
         if (!TEST_SUCCESS(status)) {
-            goto cleanup_command_buffer;
+            goto cleanup_invocation_pool;
         }
+        /* Short kernels leave the GPU idle between submits, only runs of a sensible length count towards steady state */
+        if (time_taken < VULKAN_RATE_WARMUP_TIME_US && warmup_loops <= UINT32_MAX / 2) {
+            warmup_loops *= 2;
+            continue;
+        }
+        WarmupAddRun(&warmup_state, time_taken, warmup_loops);
     }
-    INFO("Warmup finished\n");
 
     uint64_t top_result = 0;
     uint64_t top_loops = 0;
@@ -279,12 +309,12 @@ static test_status _VulkanRateEntry(vulkan_physical_device *physical_device, voi
     while (true) {
         uint64_t result = 0;
         uint64_t time_taken = 0;
-        uint32_t loop_count = VULKAN_RATE_STARTING_LOOP_COUNT;
+        uint32_t loop_count = starting_loop_count;
 
-        while (time_taken < VULKAN_RATE_TARGET_TIME_US) {
-            status = _VulkanRateExecuteKernel(workgroup_count, loop_count, test_ops_per_cycle, &result, &time_taken, &device, uniform_region, &command_sequence, &pipeline);
+        while (time_taken < target_time_us) {
+            status = _VulkanRateExecuteKernel(workgroup_count, loop_count, test_ops_per_cycle, &result, &time_taken, &device, uniform_region, &command_sequence, &pipeline, use_gpu_timestamps ? &query_pool : NULL, &overhead, validate_invocations ? &invocation_pool : NULL, &invocations_valid);
             if (!TEST_SUCCESS(status)) {
-                goto cleanup_command_buffer;
+                goto cleanup_invocation_pool;
             }
             if (result > top_result) {
                 top_result = result;
@@ -293,39 +323,111 @@ static test_status _VulkanRateEntry(vulkan_physical_device *physical_device, voi
             }
             loop_count *= 2;
         }
-        if (loop_count == VULKAN_RATE_STARTING_LOOP_COUNT * 2) {
+        if (loop_count == starting_loop_count * 2) {
             /* We exited after the first run */
             break;
         }
         workgroup_count *= 2;
     }
+
+    /* Repeat the best configuration found above for the statistics */
+    INFO("Repeating loop count %llu workgroup count %llu until the result converges\n", top_loops, top_workgroups);
+    convergence_controller controller;
+    status = ConvergenceInitialize(target_time_us, UINT32_MAX, &controller);
+    if (!TEST_SUCCESS(status)) {
+        goto cleanup_invocation_pool;
+    }
+    ConvergenceStartSampling(&controller, top_loops);
+    while (ConvergenceGetState(&controller) != convergence_state_finished) {
+        uint64_t result = 0;
+        uint64_t time_taken = 0;
+        status = _VulkanRateExecuteKernel(top_workgroups, (uint32_t)top_loops, test_ops_per_cycle, &result, &time_taken, &device, uniform_region, &command_sequence, &pipeline, use_gpu_timestamps ? &query_pool : NULL, &overhead, validate_invocations ? &invocation_pool : NULL, &invocations_valid);
+        if (!TEST_SUCCESS(status)) {
+            goto cleanup_controller;
+        }
+        status = ConvergenceAddRun(&controller, time_taken, (double)result);
+        if (!TEST_SUCCESS(status)) {
+            goto cleanup_controller;
+        }
+    }
+    statistics_summary summary;
+    status = ConvergenceSummarize(&controller, &summary);
+    if (!TEST_SUCCESS(status)) {
+        goto cleanup_controller;
+    }
+    bool soak_enabled = MainGetSoakMinutes() > 0;
+    soak_series soak;
+    if (soak_enabled) {
+        status = SoakInitialize(MainGetSoakMinutes(), &soak);
+        if (!TEST_SUCCESS(status)) {
+            goto cleanup_controller;
+        }
+        INFO("Soaking loop count %llu workgroup count %llu for %lu minutes...\n", top_loops, top_workgroups, MainGetSoakMinutes());
+        while (!SoakIsFinished(&soak)) {
+            uint64_t result = 0;
+            uint64_t time_taken = 0;
+            status = _VulkanRateExecuteKernel(top_workgroups, (uint32_t)top_loops, test_ops_per_cycle, &result, &time_taken, &device, uniform_region, &command_sequence, &pipeline, use_gpu_timestamps ? &query_pool : NULL, &overhead, NULL, NULL);
+            if (!TEST_SUCCESS(status)) {
+                goto cleanup_soak;
+            }
+            SoakAddRun(&soak, time_taken, (double)result * (double)time_taken / 1000000.0);
+        }
+    }
+    double ops_multiplier = 1.0;
     if (test_op_type == VULKAN_RATE_OP_TYPE_FLOPX2 || test_op_type == VULKAN_RATE_OP_TYPE_IOPX2) {
-        top_result *= 2;
+        ops_multiplier = 2.0;
+        StatisticsScaleSummary(&summary, 2.0);
+    }
+    status = ResultsRecordSamples(0, &(controller.samples), &(controller.timings), ops_multiplier);
+    if (!TEST_SUCCESS(status)) {
+        goto cleanup_soak;
     }
     INFO("Final results for %s:\n", physical_device->physical_properties.properties.deviceName);
     if (MainGetTestResultFormat() == test_result_csv) {
+        statistics_summary summary_giga = summary;
+        StatisticsScaleSummary(&summary_giga, 1.0 / 1000000000.0);
         LOG_PLAIN("%s,\n", physical_device->physical_properties.properties.deviceName);
-        LOG_PLAIN("Datatype,Operations (GFLOPS/GIOPS/GOPS)\n");
-        LOG_PLAIN("%s,%f\n", test_datatype_string, (float)(top_result / 1000000) / 1000.0f);
+        LOG_PLAIN("Datatype,Operations (GFLOPS/GIOPS/GOPS)," STATISTICS_CSV_HEADER "\n");
+        LOG_PLAIN("%s,%f," STATISTICS_CSV_FORMAT "\n", test_datatype_string, summary_giga.median, STATISTICS_CSV_VALUES(&summary_giga));
     } else if (MainGetTestResultFormat() == test_result_raw) {
-        LOG_RESULT(0, "%s", "%llu", test_datatype_string, top_result);
+        LOG_RESULT(0, "%s", "%llu", test_datatype_string, (uint64_t)summary.median);
+        LOG_RESULT_STATISTICS(0, "%s", test_datatype_string, &summary);
+    } else if (MainGetTestResultFormat() == test_result_json) {
+        status = ResultsAddMeasurement(0, test_datatype_string, test_op_type_string, &summary);
+        if (!TEST_SUCCESS(status)) {
+            goto cleanup_soak;
+        }
     } else {
         helper_unit_pair ops_conversion;
-        HelperConvertUnitsPlain1000(top_result, &ops_conversion);
-        const char *op_type_string = "OPS";
-        switch (test_op_type) {
-        case VULKAN_RATE_OP_TYPE_FLOP:
-        case VULKAN_RATE_OP_TYPE_FLOPX2:
-            op_type_string = "FLOPS";
-            break;
-        case VULKAN_RATE_OP_TYPE_IOP:
-        case VULKAN_RATE_OP_TYPE_IOPX2:
-            op_type_string = "IOPS";
-            break;
-        default:
-            break;
+        HelperConvertUnitsPlain1000((uint64_t)summary.median, &ops_conversion);
+        INFO("Rate for %s %s: %.3f %s%s (median of %lu, stddev %.2f%%, %lu outliers, CI +-%.2f%%%s)\n", test_datatype_string, test_op_string, ops_conversion.value, ops_conversion.units, test_op_type_string, summary.sample_count, (summary.mean > 0.0) ? (100.0 * summary.standard_deviation / summary.mean) : 0.0, summary.rejected_outliers, controller.relative_error * 100.0, controller.converged ? "" : ", not converged");
+    }
+    VulkanOverheadLogResult(&overhead);
+    WarmupLogResult(&warmup_state);
+    ParametersLogResult(vulkan_rate_parameters, parameters, PARAMETERS_COUNT(vulkan_rate_parameters));
+    if (soak_enabled) {
+        const char *soak_unit = NULL;
+        status = HelperPrintToBuffer(&soak_unit, NULL, "G%s", test_op_type_string);
+        if (!TEST_SUCCESS(status)) {
+            goto cleanup_soak;
         }
-        INFO("Rate for %s %s: %.3f %s%s\n", test_datatype_string, test_op_string, ops_conversion.value, ops_conversion.units, op_type_string);
+        SoakLogResult(&soak, soak_unit, ops_multiplier / 1000000000.0);
+        free((void*)soak_unit);
+    }
+    VulkanQueryLogInvocationResult(validate_invocations ? &invocation_pool : NULL, invocations_valid);
+cleanup_soak:
+    if (soak_enabled) {
+        SoakCleanUp(&soak);
+    }
+cleanup_controller:
+    ConvergenceCleanUp(&controller);
+cleanup_invocation_pool:
+    if (validate_invocations) {
+        VulkanQueryPoolCleanUp(&invocation_pool);
+    }
+cleanup_query_pool:
+    if (use_gpu_timestamps) {
+        VulkanQueryPoolCleanUp(&query_pool);
     }
 cleanup_command_buffer:
     VulkanCommandBufferCleanUp(&command_buffer);
@@ -343,13 +445,11 @@ cleanup_shader:
     VulkanShaderCleanUp(&shader);
 cleanup_device:
     VulkanDestroyDevice(&device);
-cleanup_queue_properties:
-    free(queue_family_properties);
 error:
     return status;
 }
 
-static test_status _VulkanRateExecuteKernel(uint64_t workgroup_count, uint32_t loop_count, uint32_t ops_per_cycle, uint64_t *result, uint64_t *time_taken, vulkan_device *device, vulkan_region *uniform_region, vulkan_command_sequence *command_sequence, vulkan_compute_pipeline *pipeline) {
+static test_status _VulkanRateExecuteKernel(uint64_t workgroup_count, uint32_t loop_count, uint32_t ops_per_cycle, uint64_t *result, uint64_t *time_taken, vulkan_device *device, vulkan_region *uniform_region, vulkan_command_sequence *command_sequence, vulkan_compute_pipeline *pipeline, vulkan_query_pool *query_pool, vulkan_overhead *overhead, vulkan_query_pool *invocation_pool, bool *invocations_valid) {
     helper_unit_pair unit_conversion;
     test_status status = TEST_OK;
     volatile vulkan_rate_uniform_buffer *uniform_buffer_memory = VulkanMemoryMap(uniform_region);
@@ -375,24 +475,73 @@ static test_status _VulkanRateExecuteKernel(uint64_t workgroup_count, uint32_t l
     if (!TEST_SUCCESS(status)) {
         goto cleanup_command_sequence;
     }
+    if (query_pool != NULL) {
+        status = VulkanQueryPoolReset(command_sequence, query_pool);
+        if (!TEST_SUCCESS(status)) {
+            goto cleanup_command_sequence;
+        }
+        status = VulkanQueryWriteTimestamp(command_sequence, query_pool, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VULKAN_QUERY_TIMESTAMP_START);
+        if (!TEST_SUCCESS(status)) {
+            goto cleanup_command_sequence;
+        }
+    }
+    if (invocation_pool != NULL) {
+        status = VulkanQueryPoolReset(command_sequence, invocation_pool);
+        if (!TEST_SUCCESS(status)) {
+            goto cleanup_command_sequence;
+        }
+        status = VulkanQueryBegin(command_sequence, invocation_pool, VULKAN_QUERY_INVOCATIONS);
+        if (!TEST_SUCCESS(status)) {
+            goto cleanup_command_sequence;
+        }
+    }
     status = VulkanCommandBufferDispatch(command_sequence, groups_x, groups_y, groups_z);
     if (!TEST_SUCCESS(status)) {
         goto cleanup_command_sequence;
     }
+    if (invocation_pool != NULL) {
+        status = VulkanQueryEnd(command_sequence, invocation_pool, VULKAN_QUERY_INVOCATIONS);
+        if (!TEST_SUCCESS(status)) {
+            goto cleanup_command_sequence;
+        }
+    }
+    if (query_pool != NULL) {
+        status = VulkanQueryWriteTimestamp(command_sequence, query_pool, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, VULKAN_QUERY_TIMESTAMP_END);
+        if (!TEST_SUCCESS(status)) {
+            goto cleanup_command_sequence;
+        }
+    }
     status = VulkanCommandBufferEnd(command_sequence);
     if (!TEST_SUCCESS(status)) {
         goto cleanup_command_sequence;
     }
-    HelperResetTimestamp();
+    helper_timer timer;
+    HelperTimerReset(&timer);
     status = VulkanCommandBufferSubmit(command_sequence);
     if (!TEST_SUCCESS(status)) {
         goto cleanup_command_sequence;
     }
-    status = VulkanCommandBufferWait(command_sequence, VULKAN_COMMAND_SEQUENCE_WAIT_INFINITE);
+    status = VulkanCommandBufferWait(command_sequence, VULKAN_COMMAND_SEQUENCE_WAIT_STEP);
     if (!TEST_SUCCESS(status)) {
         goto cleanup_command_sequence;
     }
-    uint64_t time = HelperMarkTimestamp();
+    uint64_t time = HelperTimerMark(&timer);
+    if (query_pool != NULL) {
+        uint64_t time_ns = 0;
+        status = VulkanQueryGetElapsedNanoseconds(query_pool, VULKAN_QUERY_TIMESTAMP_START, VULKAN_QUERY_TIMESTAMP_END, &time_ns);
+        if (!TEST_SUCCESS(status)) {
+            goto cleanup_command_sequence;
+        }
+        time = time_ns / 1000;
+    }
+    if (invocation_pool != NULL) {
+        uint64_t expected_invocations = (uint64_t)groups_x * (uint64_t)groups_y * (uint64_t)groups_z * VULKAN_RATE_WORKGROUP_SIZE;
+        status = VulkanQueryCheckInvocations(invocation_pool, VULKAN_QUERY_INVOCATIONS, expected_invocations, invocations_valid);
+        if (!TEST_SUCCESS(status)) {
+            goto cleanup_command_sequence;
+        }
+    }
+    time = VulkanOverheadSubtract(overhead, time);
     if (time_taken != NULL) {
         *time_taken = time;
     }
@@ -452,12 +601,130 @@ static const char *_VulkanRateGetOpFromIndex(int32_t index) {
     return _vulkan_rate_op_map[index];
 }
 
-static test_status _VulkanRateRegisterSubtest(const char *type, const char *op, const char *test_name, size_t datatype_size, uint32_t ops_per_cycle, uint32_t op_type) {
+static uint32_t _VulkanRateGetRequiredFeatures(int32_t type_index) {
+    if (type_index == _VulkanRateGetIndexOfType(TESTS_VULKAN_RATE_TYPE_FP16)) {
+        return VULKAN_RUNNER_FEATURE_FLOAT16;
+    } else if (type_index == _VulkanRateGetIndexOfType(TESTS_VULKAN_RATE_TYPE_FP64)) {
+        return VULKAN_RUNNER_FEATURE_FLOAT64;
+    } else if (type_index == _VulkanRateGetIndexOfType(TESTS_VULKAN_RATE_TYPE_INT8)) {
+        return VULKAN_RUNNER_FEATURE_INT8;
+    } else if (type_index == _VulkanRateGetIndexOfType(TESTS_VULKAN_RATE_TYPE_INT16)) {
+        return VULKAN_RUNNER_FEATURE_INT16;
+    } else if (type_index == _VulkanRateGetIndexOfType(TESTS_VULKAN_RATE_TYPE_INT64)) {
+        return VULKAN_RUNNER_FEATURE_INT64;
+    }
+    return VULKAN_RUNNER_FEATURE_NONE;
+}
+
+/* Each workgroup count of the sweep doubles the loop count up to the target time, which adds up to about twice the target */
+static test_status _VulkanRatePrepare(vulkan_physical_device *physical_device, void *config_data) {
+    int32_t test_type_index = (int32_t)((((uint64_t)config_data) >> 16) & 0xFFFF);
+    const char *test_datatype_string = _VulkanRateGetTypeFromIndex(test_type_index);
+    const char *test_op_string = _VulkanRateGetOpFromIndex((int32_t)(((uint64_t)config_data) & 0xFFFF));
+    if (test_datatype_string == NULL || test_op_string == NULL) {
+        return TEST_PROGRAMMING_ERROR;
+    }
+    vulkan_device device;
+    test_status status = _VulkanRateCreateDevice(physical_device, test_type_index, MainGetValidateInvocations() && VulkanQueryInvocationsSupported(physical_device), &device);
+    TEST_RETFAIL(status);
+    vulkan_pipeline_builder *builder = NULL;
+    status = VulkanRunnerGetPipelineBuilder(&device, &builder);
+    TEST_RETFAIL(status);
+    vulkan_shader shader;
+    status = _VulkanRateCreateShader(builder->device, test_datatype_string, test_op_string, &shader);
+    TEST_RETFAIL(status);
+    vulkan_shader *owned_shader = NULL;
+    status = VulkanPipelineBuilderAddShader(builder, &shader, &owned_shader);
+    TEST_RETFAIL(status);
+    return VulkanPipelineBuilderAddPipeline(builder, owned_shader, "main", NULL, 0);
+}
+
+/* Shared with the pipeline build, which has to create the same device for the test to be handed it warm */
+static test_status _VulkanRateCreateDevice(vulkan_physical_device *physical_device, int32_t test_type_index, bool validate_invocations, vulkan_device *device) {
+    VkQueueFamilyProperties *queue_family_properties = NULL;
+    uint32_t queue_family_count = 0;
+    test_status status = VulkanGetPhysicalQueueFamilyProperties(physical_device, &queue_family_properties, &queue_family_count);
+    TEST_RETFAIL(status);
+    VkPhysicalDeviceVulkan12Features enabled_features_vk12 = {0};
+    enabled_features_vk12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    enabled_features_vk12.pNext = NULL;
+    VkPhysicalDeviceVulkan11Features enabled_features_vk11 = {0};
+    enabled_features_vk11.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_1_FEATURES;
+    enabled_features_vk11.pNext = &enabled_features_vk12;
+    VkPhysicalDeviceFeatures2 enabled_features = {0};
+    enabled_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    enabled_features.pNext = &enabled_features_vk11;
+
+    if (test_type_index == _VulkanRateGetIndexOfType(TESTS_VULKAN_RATE_TYPE_FP64)) {
+        enabled_features.features.shaderFloat64 = VK_TRUE;
+    } else if (test_type_index == _VulkanRateGetIndexOfType(TESTS_VULKAN_RATE_TYPE_FP16)) {
+        enabled_features_vk12.shaderFloat16 = VK_TRUE;
+        enabled_features_vk11.storageBuffer16BitAccess = VK_TRUE;
+    } else if (test_type_index == _VulkanRateGetIndexOfType(TESTS_VULKAN_RATE_TYPE_INT64)) {
+        enabled_features.features.shaderInt64 = VK_TRUE;
+    } else if (test_type_index == _VulkanRateGetIndexOfType(TESTS_VULKAN_RATE_TYPE_INT16)) {
+        enabled_features.features.shaderInt16 = VK_TRUE;
+        enabled_features_vk11.storageBuffer16BitAccess = VK_TRUE;
+    } else if (test_type_index == _VulkanRateGetIndexOfType(TESTS_VULKAN_RATE_TYPE_INT8)) {
+        enabled_features_vk12.shaderInt8 = VK_TRUE;
+        enabled_features_vk12.uniformAndStorageBuffer8BitAccess = VK_TRUE;
+    }
+    if (validate_invocations) {
+        enabled_features.features.pipelineStatisticsQuery = VK_TRUE;
+    }
+    status = VulkanCreateDevice(physical_device, queue_family_properties, queue_family_count, VK_QUEUE_COMPUTE_BIT | VK_QUEUE_TRANSFER_BIT, device, &enabled_features);
+    free(queue_family_properties);
+    return status;
+}
+
+/* Shared with the pipeline build, the layout has to match for the driver to find the pipeline it compiled */
+static test_status _VulkanRateCreateShader(vulkan_device *device, const char *test_datatype_string, const char *test_op_string, vulkan_shader *shader) {
+    const char *shader_name = NULL;
+    test_status status = HelperPrintToBuffer(&shader_name, NULL, "vulkan_rate_%s_%s.spv", test_datatype_string, test_op_string);
+    TEST_RETFAIL(status);
+    status = VulkanShaderInitializeFromFile(device, shader_name, VK_SHADER_STAGE_COMPUTE_BIT, shader);
+    free((void*)shader_name);
+    TEST_RETFAIL(status);
+    status = VulkanShaderAddDescriptor(shader, "dummy inputs", VULKAN_BINDING_STORAGE, 0, 0);
+    if (!TEST_SUCCESS(status)) {
+        goto cleanup_shader;
+    }
+    status = VulkanShaderAddDescriptor(shader, "dummy outputs", VULKAN_BINDING_STORAGE, 0, 1);
+    if (!TEST_SUCCESS(status)) {
+        goto cleanup_shader;
+    }
+    status = VulkanShaderAddFixedSizeDescriptor(shader, sizeof(vulkan_rate_uniform_buffer), "uniform buffer", VULKAN_BINDING_UNIFORM, 0, 2);
+    if (!TEST_SUCCESS(status)) {
+        goto cleanup_shader;
+    }
+    status = VulkanShaderCreateDescriptorSets(shader);
+    if (!TEST_SUCCESS(status)) {
+        goto cleanup_shader;
+    }
+    return TEST_OK;
+cleanup_shader:
+    VulkanShaderCleanUp(shader);
+    return status;
+}
+
+static test_status _VulkanRateEstimate(vulkan_physical_device *physical_device, void *config_data, planner_estimate *estimate) {
+    TEST_UNUSED(physical_device);
+    TEST_UNUSED(config_data);
+    uint64_t parameters[PARAMETERS_COUNT(vulkan_rate_parameters)];
+    ParametersGetAll(vulkan_rate_parameters, PARAMETERS_COUNT(vulkan_rate_parameters), parameters);
+    uint64_t target_time_us = parameters[vulkan_rate_parameter_target_time_us];
+    estimate->step_count = 1;
+    estimate->sample_time_us = target_time_us;
+    estimate->fixed_time_us = WarmupEstimateTime(2 * VULKAN_RATE_WARMUP_TIME_US) + VULKAN_RATE_ESTIMATED_SWEEP_STEPS * 2 * target_time_us + MainGetSoakMinutes() * 60000000ULL;
+    return TEST_OK;
+}
+
+static test_status _VulkanRateRegisterSubtest(const char *type, const char *op, const char *test_name, const char *tags, size_t datatype_size, uint32_t ops_per_cycle, uint32_t op_type) {
     int32_t type_index = _VulkanRateGetIndexOfType(type);
     int32_t op_index = _VulkanRateGetIndexOfOp(op);
     if (type_index < 0 || op_index < 0) {
         return TEST_PROGRAMMING_ERROR;
     }
     uint64_t config = (((uint64_t)op_type) << 56) | (((uint64_t)ops_per_cycle) << 48) | (((uint64_t)datatype_size) << 32) | (((uint64_t)type_index) << 16) | ((uint64_t)op_index);
-    return VulkanRunnerRegisterTest(&_VulkanRateEntry, (void *)config, test_name, TESTS_VULKAN_RATE_VERSION, false);
+    return VulkanRunnerRegisterTest(&_VulkanRateEntry, &_VulkanRateEstimate, &_VulkanRatePrepare, (void *)config, test_name, TESTS_VULKAN_RATE_VERSION, false, RUNNER_TEST_FLAG_NONE, tags, _VulkanRateGetRequiredFeatures(type_index));
 }
\ No newline at end of file
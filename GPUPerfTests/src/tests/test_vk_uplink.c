@@ -24,15 +24,23 @@
 #include "main.h"
 #include "logger.h"
 #include "vulkan_helper.h"
+#include "runner.h"
+#include "planner.h"
 #include "vulkan_runner.h"
 #include "vulkan_memory.h"
 #include "vulkan_shader.h"
 #include "vulkan_compute_pipeline.h"
+#include "vulkan_pipeline_builder.h"
 #include "vulkan_command_buffer.h"
 #include "vulkan_texture.h"
 #include "buffer_filler.h"
 #include "vulkan_staging.h"
 #include "latency_helper.h"
+#include "statistics.h"
+#include "convergence.h"
+#include "parameters.h"
+#include "results.h"
+#include "checkpoint.h"
 #include "tests/test_vk_uplink.h"
 
 #define VULKAN_UPLINK_TEST_TYPE_READ            0
@@ -55,6 +63,17 @@
 #define VULKAN_UPLINK_COMPUTE_WORKGROUP_SIZE        (256)
 #define VULKAN_UPLINK_COMPUTE_BYTES_PER_WORKGROUP   (16 * VULKAN_UPLINK_COMPUTE_WORKGROUP_SIZE)
 #define VULKAN_UPLINK_MINIMUM_COPY_SIZE             (512)
+#define VULKAN_UPLINK_ESTIMATED_SWEEP_STEPS         (8)             // Batch sizes tried before a single cycle passes the cutoff
+
+typedef enum vulkan_uplink_parameter_t {
+    vulkan_uplink_parameter_target_time_us,
+    vulkan_uplink_parameter_seed
+} vulkan_uplink_parameter;
+
+static const parameters_definition vulkan_uplink_parameters[] = {
+    {"target_time_us", parameters_type_integer, VULKAN_UPLINK_TARGET_TIME_US, PARAMETERS_TARGET_TIME_MINIMUM_US, PARAMETERS_TARGET_TIME_MAXIMUM_US, "Transfer time each bandwidth trial is scaled towards"},
+    {"seed", parameters_type_integer, VULKAN_UPLINK_RNG_SEED, 0, UINT64_MAX, "Seed of the random buffer contents and pointer chains"}
+};
 
 typedef struct vulkan_uplink_uniform_buffer_t {
     uint32_t region_size;
@@ -73,27 +92,33 @@ static helper_thread *memcpy_threads;
 static vulkan_uplink_thread_data **memcpy_thread_data;
 
 static test_status _VulkanUplinkEntry(vulkan_physical_device *device, void *config_data);
+static test_status _VulkanUplinkEstimate(vulkan_physical_device *physical_device, void *config_data, planner_estimate *estimate);
+static test_status _VulkanUplinkPrepare(vulkan_physical_device *physical_device, void *config_data);
+static test_status _VulkanUplinkCreateShader(vulkan_device *device, bool read_test, vulkan_shader *shader);
 static test_status _VulkanUplinkInitializeMemcpyThreads(uint32_t *source, uint32_t *destination, uint64_t size);
 static void _VulkanUplinkCleanUpMemcpyThreads();
-static uint64_t _VulkanUplinkMemcpy();
+static uint64_t _VulkanUplinkMemcpy(uint64_t target_time_us);
 static void _VulkanUplinkMemcpyThreadFunc(uint32_t thread_id, void *data);
+static test_status _VulkanUplinkLogLatencyResult(vulkan_physical_device *physical_device, const statistics_summary *summary);
 
 test_status TestsVulkanUplinkRegister() {
-    test_status status = VulkanRunnerRegisterTest(&_VulkanUplinkEntry, (void *)VULKAN_UPLINK_TEST_TYPE_READ, TESTS_VULKAN_UPLINK_CPU_READ_NAME, TESTS_VULKAN_UPLINK_VERSION, false);
+    test_status status = ParametersDeclare("vk_uplink_*", vulkan_uplink_parameters, PARAMETERS_COUNT(vulkan_uplink_parameters));
+    TEST_RETFAIL(status);
+    status = VulkanRunnerRegisterTest(&_VulkanUplinkEntry, &_VulkanUplinkEstimate, NULL, (void *)VULKAN_UPLINK_TEST_TYPE_READ, TESTS_VULKAN_UPLINK_CPU_READ_NAME, TESTS_VULKAN_UPLINK_VERSION, false, RUNNER_TEST_FLAG_HOST_EXCLUSIVE, "uplink,transfer,bandwidth", VULKAN_RUNNER_FEATURE_NONE);
     TEST_RETFAIL(status);
-    status = VulkanRunnerRegisterTest(&_VulkanUplinkEntry, (void *)VULKAN_UPLINK_TEST_TYPE_WRITE, TESTS_VULKAN_UPLINK_CPU_WRITE_NAME, TESTS_VULKAN_UPLINK_VERSION, false);
+    status = VulkanRunnerRegisterTest(&_VulkanUplinkEntry, &_VulkanUplinkEstimate, NULL, (void *)VULKAN_UPLINK_TEST_TYPE_WRITE, TESTS_VULKAN_UPLINK_CPU_WRITE_NAME, TESTS_VULKAN_UPLINK_VERSION, false, RUNNER_TEST_FLAG_HOST_EXCLUSIVE, "uplink,transfer,bandwidth", VULKAN_RUNNER_FEATURE_NONE);
     TEST_RETFAIL(status);
-    status = VulkanRunnerRegisterTest(&_VulkanUplinkEntry, (void *)VULKAN_UPLINK_TEST_TYPE_LATENCY_SHORT, TESTS_VULKAN_UPLINK_CPU_LATENCY_NAME, TESTS_VULKAN_UPLINK_VERSION, false);
+    status = VulkanRunnerRegisterTest(&_VulkanUplinkEntry, &_VulkanUplinkEstimate, NULL, (void *)VULKAN_UPLINK_TEST_TYPE_LATENCY_SHORT, TESTS_VULKAN_UPLINK_CPU_LATENCY_NAME, TESTS_VULKAN_UPLINK_VERSION, false, RUNNER_TEST_FLAG_HOST_EXCLUSIVE | RUNNER_TEST_FLAG_RESUMABLE, "uplink,latency", VULKAN_RUNNER_FEATURE_NONE);
     TEST_RETFAIL(status);
-    status = VulkanRunnerRegisterTest(&_VulkanUplinkEntry, (void *)VULKAN_UPLINK_TEST_TYPE_LATENCY_LONG, TESTS_VULKAN_UPLINK_CPU_LATENCY_LONG_NAME, TESTS_VULKAN_UPLINK_VERSION, false);
+    status = VulkanRunnerRegisterTest(&_VulkanUplinkEntry, &_VulkanUplinkEstimate, NULL, (void *)VULKAN_UPLINK_TEST_TYPE_LATENCY_LONG, TESTS_VULKAN_UPLINK_CPU_LATENCY_LONG_NAME, TESTS_VULKAN_UPLINK_VERSION, false, RUNNER_TEST_FLAG_HOST_EXCLUSIVE | RUNNER_TEST_FLAG_RESUMABLE, "uplink,latency", VULKAN_RUNNER_FEATURE_NONE);
     TEST_RETFAIL(status);
-    status = VulkanRunnerRegisterTest(&_VulkanUplinkEntry, (void *)VULKAN_UPLINK_TEST_TYPE_COMPUTE_READ, TESTS_VULKAN_UPLINK_GPU_READ_NAME, TESTS_VULKAN_UPLINK_VERSION, false);
+    status = VulkanRunnerRegisterTest(&_VulkanUplinkEntry, &_VulkanUplinkEstimate, &_VulkanUplinkPrepare, (void *)VULKAN_UPLINK_TEST_TYPE_COMPUTE_READ, TESTS_VULKAN_UPLINK_GPU_READ_NAME, TESTS_VULKAN_UPLINK_VERSION, false, RUNNER_TEST_FLAG_HOST_EXCLUSIVE, "uplink,compute,bandwidth", VULKAN_RUNNER_FEATURE_NONE);
     TEST_RETFAIL(status);
-    status = VulkanRunnerRegisterTest(&_VulkanUplinkEntry, (void *)VULKAN_UPLINK_TEST_TYPE_COMPUTE_WRITE, TESTS_VULKAN_UPLINK_GPU_WRITE_NAME, TESTS_VULKAN_UPLINK_VERSION, false);
+    status = VulkanRunnerRegisterTest(&_VulkanUplinkEntry, &_VulkanUplinkEstimate, &_VulkanUplinkPrepare, (void *)VULKAN_UPLINK_TEST_TYPE_COMPUTE_WRITE, TESTS_VULKAN_UPLINK_GPU_WRITE_NAME, TESTS_VULKAN_UPLINK_VERSION, false, RUNNER_TEST_FLAG_HOST_EXCLUSIVE, "uplink,compute,bandwidth", VULKAN_RUNNER_FEATURE_NONE);
     TEST_RETFAIL(status);
-    status = VulkanRunnerRegisterTest(&_VulkanUplinkEntry, (void *)VULKAN_UPLINK_TEST_TYPE_MEMCPY_READ, TESTS_VULKAN_UPLINK_MAP_READ_NAME, TESTS_VULKAN_UPLINK_VERSION, false);
+    status = VulkanRunnerRegisterTest(&_VulkanUplinkEntry, &_VulkanUplinkEstimate, NULL, (void *)VULKAN_UPLINK_TEST_TYPE_MEMCPY_READ, TESTS_VULKAN_UPLINK_MAP_READ_NAME, TESTS_VULKAN_UPLINK_VERSION, false, RUNNER_TEST_FLAG_HOST_EXCLUSIVE, "uplink,mapped,bandwidth", VULKAN_RUNNER_FEATURE_NONE);
     TEST_RETFAIL(status);
-    status = VulkanRunnerRegisterTest(&_VulkanUplinkEntry, (void *)VULKAN_UPLINK_TEST_TYPE_MEMCPY_WRITE, TESTS_VULKAN_UPLINK_MAP_WRITE_NAME, TESTS_VULKAN_UPLINK_VERSION, false);
+    status = VulkanRunnerRegisterTest(&_VulkanUplinkEntry, &_VulkanUplinkEstimate, NULL, (void *)VULKAN_UPLINK_TEST_TYPE_MEMCPY_WRITE, TESTS_VULKAN_UPLINK_MAP_WRITE_NAME, TESTS_VULKAN_UPLINK_VERSION, false, RUNNER_TEST_FLAG_HOST_EXCLUSIVE, "uplink,mapped,bandwidth", VULKAN_RUNNER_FEATURE_NONE);
     TEST_RETFAIL(status);
     return status;
 }
@@ -102,20 +127,39 @@ static test_status _VulkanUplinkEntry(vulkan_physical_device *physical_device, v
     test_status status = TEST_OK;
     VkResult res = VK_SUCCESS;
     uint32_t test_type = (uint32_t)((uint64_t)config_data);
+    uint64_t parameters[PARAMETERS_COUNT(vulkan_uplink_parameters)];
+    ParametersGetAll(vulkan_uplink_parameters, PARAMETERS_COUNT(vulkan_uplink_parameters), parameters);
+    uint64_t target_time_us = parameters[vulkan_uplink_parameter_target_time_us];
+    uint64_t seed = parameters[vulkan_uplink_parameter_seed];
 
     INFO("Device Name: %s\n", physical_device->physical_properties.properties.deviceName);
+    /* A latency run is a single measurement, the checkpoint either has all of it or it starts over */
+    statistics_summary checkpoint_summary;
+    if ((test_type == VULKAN_UPLINK_TEST_TYPE_LATENCY_SHORT || test_type == VULKAN_UPLINK_TEST_TYPE_LATENCY_LONG) && CheckpointGetUnit(0, 0, NULL, &checkpoint_summary)) {
+        INFO("Replaying the result of the interrupted run\n");
+        status = _VulkanUplinkLogLatencyResult(physical_device, &checkpoint_summary);
+        ParametersLogResult(vulkan_uplink_parameters, parameters, PARAMETERS_COUNT(vulkan_uplink_parameters));
+        return status;
+    }
 
     latency_helper_lru lru;
     status = LatencyHelperLRUInitialize(&lru, VULKAN_UPLINK_HOP_STRIDE_BYTES);
     if (!TEST_SUCCESS(status)) {
         goto error;
     }
+    convergence_controller controller;
+    status = ConvergenceInitialize(target_time_us, UINT32_MAX, &controller);
+    if (!TEST_SUCCESS(status)) {
+        goto cleanup_lru;
+    }
+    statistics_summary summary;
+    uint32_t trial_count = MainGetTrialCount();
 
     VkQueueFamilyProperties *queue_family_properties = NULL;
     uint32_t queue_family_property_count = 0;
     status = VulkanGetPhysicalQueueFamilyProperties(physical_device, &queue_family_properties, &queue_family_property_count);
     if (!TEST_SUCCESS(status)) {
-        goto cleanup_lru;
+        goto cleanup_controller;
     }
     uint32_t *queue_family_indices = 0;
     uint32_t queue_family_count = 0;
@@ -125,7 +169,7 @@ static test_status _VulkanUplinkEntry(vulkan_physical_device *physical_device, v
     }
     status = VulkanSelectQueueFamilyMultiple(&queue_family_indices, &queue_family_count, queue_family_properties, queue_family_property_count, desired_queue_flags);
     if (!TEST_SUCCESS(status)) {
-        goto cleanup_lru;
+        goto cleanup_controller;
     }
     INFO("Found %lu suitable queue %s:\n", queue_family_count, (queue_family_count == 1) ? "family" : "families");
     for (uint32_t i = 0; i < queue_family_count; i++) {
@@ -152,27 +196,10 @@ static test_status _VulkanUplinkEntry(vulkan_physical_device *physical_device, v
     vulkan_shader compute_shader;
     vulkan_compute_pipeline compute_pipeline;
     if (test_type == VULKAN_UPLINK_TEST_TYPE_COMPUTE_READ || test_type == VULKAN_UPLINK_TEST_TYPE_COMPUTE_WRITE) {
-        bool read_test = test_type == VULKAN_UPLINK_TEST_TYPE_COMPUTE_READ;
-        status = VulkanShaderInitializeFromFile(&device, "vulkan_uplink_gpu.spv", VK_SHADER_STAGE_COMPUTE_BIT, &compute_shader);
+        status = _VulkanUplinkCreateShader(&device, test_type == VULKAN_UPLINK_TEST_TYPE_COMPUTE_READ, &compute_shader);
         if (!TEST_SUCCESS(status)) {
             goto cleanup_device;
         }
-        status = VulkanShaderAddDescriptor(&compute_shader, "device buffer", VULKAN_BINDING_STORAGE, 0, read_test ? 0 : 1);
-        if (!TEST_SUCCESS(status)) {
-            goto cleanup_shader;
-        }
-        status = VulkanShaderAddDescriptor(&compute_shader, "host buffer", VULKAN_BINDING_STORAGE, 0, read_test ? 1 : 0);
-        if (!TEST_SUCCESS(status)) {
-            goto cleanup_shader;
-        }
-        status = VulkanShaderAddFixedSizeDescriptor(&compute_shader, sizeof(vulkan_uplink_uniform_buffer), "uniform buffer", VULKAN_BINDING_UNIFORM, 0, 2);
-        if (!TEST_SUCCESS(status)) {
-            goto cleanup_shader;
-        }
-        status = VulkanShaderCreateDescriptorSets(&compute_shader);
-        if (!TEST_SUCCESS(status)) {
-            goto cleanup_shader;
-        }
         status = VulkanComputePipelineInitialize(&compute_shader, "main", &compute_pipeline);
         if (!TEST_SUCCESS(status)) {
             goto cleanup_shader;
@@ -330,13 +357,36 @@ static test_status _VulkanUplinkEntry(vulkan_physical_device *physical_device, v
         uint32_t pointer_index = 0;
         uint32_t runtime = (test_type == VULKAN_UPLINK_TEST_TYPE_LATENCY_SHORT) ? VULKAN_UPLINK_LATENCY_SHORT_US : VULKAN_UPLINK_LATENCY_LONG_US;
         uint32_t print_state = 0;
+        /* The runtime is split into one window per trial, each window's average is a sample */
+        uint64_t window_runtime = 0;
+        uint64_t window_cycles = 0;
+        uint64_t window_length = max(runtime / trial_count, 1);
 
+        helper_timer timer;
         while (current_runtime < runtime) {
-            HelperResetTimestamp();
+            HelperTimerReset(&timer);
             for (uint32_t i = 0; i < VULKAN_UPLINK_HOP_TIME_CHECK; i++) {
                 pointer_index = device_memory[pointer_index];
             }
-            current_runtime += HelperGetTimestamp();
+            uint64_t cycle_time = HelperTimerGet(&timer);
+            current_runtime += cycle_time;
+            window_runtime += cycle_time;
+            window_cycles++;
+            if (window_runtime >= window_length || current_runtime >= runtime) {
+                status = StatisticsAddSample(&(controller.samples), (double)(window_runtime * 1000000) / (double)(window_cycles * VULKAN_UPLINK_HOP_TIME_CHECK));
+                if (!TEST_SUCCESS(status)) {
+                    VulkanMemoryUnmap(device_region);
+                    goto cleanup_host_memory;
+                }
+                status = StatisticsAddSample(&(controller.timings), (double)window_runtime);
+                if (!TEST_SUCCESS(status)) {
+                    VulkanMemoryUnmap(device_region);
+                    goto cleanup_host_memory;
+                }
+                LoggerChannelSendProgress((uint32_t)(min(current_runtime, runtime) / 1000), (uint32_t)(runtime / 1000));
+                window_runtime = 0;
+                window_cycles = 0;
+            }
             if (test_type == VULKAN_UPLINK_TEST_TYPE_LATENCY_LONG) {
                 uint32_t progress = (uint32_t)(current_runtime / (VULKAN_UPLINK_LATENCY_LONG_US / 10));
                 if (print_state != progress) {
@@ -365,17 +415,28 @@ static test_status _VulkanUplinkEntry(vulkan_physical_device *physical_device, v
             executed_cycles++;
         }
         INFO("Executed %llu access cycles\n", executed_cycles *VULKAN_UPLINK_HOP_TIME_CHECK);
-        uint64_t result_latency_ps = (current_runtime * 1000000) / (executed_cycles * VULKAN_UPLINK_HOP_TIME_CHECK);
-        INFO("Final results for %s:\n", physical_device->physical_properties.properties.deviceName);
-        if (MainGetTestResultFormat() == test_result_csv) {
-            LOG_PLAIN("%s\n", physical_device->physical_properties.properties.deviceName);
-            LOG_PLAIN("Latency (ns)\n");
-            LOG_PLAIN("%.3f\n", result_latency_ps / 1000.0f);
-        } else if (MainGetTestResultFormat() == test_result_raw) {
-            LOG_RESULT(0, "%s", "%llu", "latency", result_latency_ps);
-        } else {
-            INFO("Average latency: %.3fns\n", result_latency_ps / 1000.0f);
+        status = ConvergenceSummarize(&controller, &summary);
+        if (!TEST_SUCCESS(status)) {
+            VulkanMemoryUnmap(device_region);
+            goto cleanup_host_memory;
+        }
+        /* Samples are in picoseconds per hop */
+        status = ResultsRecordSamples(0, &(controller.samples), &(controller.timings), 1.0 / 1000.0);
+        if (!TEST_SUCCESS(status)) {
+            VulkanMemoryUnmap(device_region);
+            goto cleanup_host_memory;
+        }
+        status = _VulkanUplinkLogLatencyResult(physical_device, &summary);
+        if (!TEST_SUCCESS(status)) {
+            VulkanMemoryUnmap(device_region);
+            goto cleanup_host_memory;
+        }
+        status = CheckpointRecordUnit(0, 0, executed_cycles * VULKAN_UPLINK_HOP_TIME_CHECK, &summary);
+        if (!TEST_SUCCESS(status)) {
+            VulkanMemoryUnmap(device_region);
+            goto cleanup_host_memory;
         }
+        ParametersLogResult(vulkan_uplink_parameters, parameters, PARAMETERS_COUNT(vulkan_uplink_parameters));
 
         VulkanMemoryUnmap(device_region);
     } else {
@@ -390,7 +451,7 @@ static test_status _VulkanUplinkEntry(vulkan_physical_device *physical_device, v
             }
         }
         INFO("Filling memory with random numbers...\n");
-        status = BufferFillerRandomIntegers(write_test ? host_region : device_region, VULKAN_UPLINK_RNG_SEED);
+        status = BufferFillerRandomIntegers(write_test ? host_region : device_region, seed);
         if (!TEST_SUCCESS(status)) {
             goto cleanup_host_memory;
         }
@@ -446,8 +507,10 @@ static test_status _VulkanUplinkEntry(vulkan_physical_device *physical_device, v
 
         uint64_t result_speed = 0;
         uint32_t current_batch_size = compute_test ? VULKAN_UPLINK_COMPUTE_STARTING_WORKGROUPS : 1;
+        uint32_t best_batch_size = current_batch_size;
         bool first_run = true;
         bool keep_running = true;
+        bool measuring = false;
 
         while (keep_running) {
             if (!first_run) {
@@ -506,7 +569,8 @@ static test_status _VulkanUplinkEntry(vulkan_physical_device *physical_device, v
                 }
             }
             if (keep_running) {
-                HelperResetTimestamp();
+                helper_timer timer;
+                HelperTimerReset(&timer);
                 bool first_cycle = true;
                 uint64_t transfer_cycles = 0;
                 uint64_t memcpy_total_data = 0;
@@ -519,7 +583,7 @@ static test_status _VulkanUplinkEntry(vulkan_physical_device *physical_device, v
                             }
                         }
                         for (uint32_t i = 0; i < queue_family_count; i++) {
-                            status = VulkanCommandBufferWaitOnQueue(&(command_sequences[i]), VULKAN_COMMAND_SEQUENCE_WAIT_INFINITE, compute_test ? 0 : VULKAN_QUEUES_ALL);
+                            status = VulkanCommandBufferWaitOnQueue(&(command_sequences[i]), VULKAN_COMMAND_SEQUENCE_WAIT_STEP, compute_test ? 0 : VULKAN_QUEUES_ALL);
                             if (!TEST_SUCCESS(status)) {
                                 goto cleanup_command_sequence;
                             }
@@ -527,13 +591,13 @@ static test_status _VulkanUplinkEntry(vulkan_physical_device *physical_device, v
                         transfer_cycles++;
                     } else {
                         //memcpy(destination_memory, source_memory, allocation_size);
-                        memcpy_total_data = _VulkanUplinkMemcpy();
+                        memcpy_total_data = _VulkanUplinkMemcpy(target_time_us);
                     }
-                    uint64_t current_runtime = HelperGetTimestamp();
-                    if ((first_cycle || mapped_test) && current_runtime >= VULKAN_UPLINK_TIME_CUTOFF_US) {
+                    uint64_t current_runtime = HelperTimerGet(&timer);
+                    if (!measuring && (first_cycle || mapped_test) && current_runtime >= VULKAN_UPLINK_TIME_CUTOFF_US) {
                         keep_running = false;
                     }
-                    if (current_runtime > VULKAN_UPLINK_TARGET_TIME_US) {
+                    if (current_runtime > target_time_us) {
                         uint64_t total_data = 0;
                         if (compute_test) {
                             total_data = transfer_cycles * current_batch_size * VULKAN_UPLINK_COMPUTE_BYTES_PER_WORKGROUP;
@@ -545,8 +609,19 @@ static test_status _VulkanUplinkEntry(vulkan_physical_device *physical_device, v
                         uint64_t data_rate = (total_data * 1000000) / current_runtime;
                         HelperConvertUnitsBytes1024(data_rate, &unit_conversion);
                         INFO("Batch size %lu bandwidth: %.3f %s/s\n", current_batch_size, unit_conversion.value, unit_conversion.units);
+                        if (measuring) {
+                            status = ConvergenceAddRun(&controller, current_runtime, (double)data_rate);
+                            if (!TEST_SUCCESS(status)) {
+                                goto cleanup_command_sequence;
+                            }
+                            if (ConvergenceGetState(&controller) == convergence_state_finished) {
+                                keep_running = false;
+                            }
+                            break;
+                        }
                         if (data_rate > result_speed) {
                             result_speed = data_rate;
+                            best_batch_size = current_batch_size;
                         }
                         current_batch_size *= 2;
                         break;
@@ -554,20 +629,45 @@ static test_status _VulkanUplinkEntry(vulkan_physical_device *physical_device, v
                     first_cycle = false;
                 }
             }
+            if (!keep_running && !measuring && result_speed > 0) {
+                /* Repeat the fastest batch size for the statistics */
+                INFO("Repeating batch size %lu until the result converges\n", best_batch_size);
+                ConvergenceStartSampling(&controller, best_batch_size);
+                measuring = true;
+                keep_running = true;
+                current_batch_size = best_batch_size;
+            }
+        }
+        status = ConvergenceSummarize(&controller, &summary);
+        if (!TEST_SUCCESS(status)) {
+            goto cleanup_command_sequence;
+        }
+        status = ResultsRecordSamples(0, &(controller.samples), &(controller.timings), 1.0);
+        if (!TEST_SUCCESS(status)) {
+            goto cleanup_command_sequence;
         }
 
         const char *test_key = (test_type == VULKAN_UPLINK_TEST_TYPE_WRITE) ? "write" : "read";
         INFO("Final results for %s:\n", physical_device->physical_properties.properties.deviceName);
         if (MainGetTestResultFormat() == test_result_csv) {
+            statistics_summary summary_giga = summary;
+            StatisticsScaleSummary(&summary_giga, 1.0 / 1000000000.0);
             LOG_PLAIN("%s\n", physical_device->physical_properties.properties.deviceName);
-            LOG_PLAIN("Bandwidth (GiB/s)\n");
-            LOG_PLAIN("%f\n", (float)(result_speed / 1000000) / 1000.0f);
+            LOG_PLAIN("Bandwidth (GiB/s)," STATISTICS_CSV_HEADER "\n");
+            LOG_PLAIN("%f," STATISTICS_CSV_FORMAT "\n", summary_giga.median, STATISTICS_CSV_VALUES(&summary_giga));
         } else if (MainGetTestResultFormat() == test_result_raw) {
-            LOG_RESULT(0, "%s", "%llu", test_key, result_speed);
+            LOG_RESULT(0, "%s", "%llu", test_key, (uint64_t)summary.median);
+            LOG_RESULT_STATISTICS(0, "%s", test_key, &summary);
+        } else if (MainGetTestResultFormat() == test_result_json) {
+            status = ResultsAddMeasurement(0, test_key, "B/s", &summary);
+            if (!TEST_SUCCESS(status)) {
+                goto cleanup_command_sequence;
+            }
         } else {
-            HelperConvertUnitsBytes1024(result_speed, &unit_conversion);
-            INFO("Maximum %s bandwidth: %.3f %s/s\n", test_key, unit_conversion.value, unit_conversion.units);
+            HelperConvertUnitsBytes1024((uint64_t)summary.median, &unit_conversion);
+            INFO("Median %s bandwidth: %.3f %s/s (%lu trials, stddev %.2f%%, %lu outliers)\n", test_key, unit_conversion.value, unit_conversion.units, summary.sample_count, (summary.mean > 0.0) ? (100.0 * summary.standard_deviation / summary.mean) : 0.0, summary.rejected_outliers);
         }
+        ParametersLogResult(vulkan_uplink_parameters, parameters, PARAMETERS_COUNT(vulkan_uplink_parameters));
 
         VulkanMemoryUnmap(device_region);
         VulkanMemoryUnmap(host_region);
@@ -610,12 +710,87 @@ cleanup_device:
     VulkanDestroyDevice(&device);
 cleanup_queue_properties:
     free(queue_family_properties);
+cleanup_controller:
+    ConvergenceCleanUp(&controller);
 cleanup_lru:
     LatencyHelperLRUCleanUp(&lru);
 error:
     return status;
 }
 
+/* Only the compute tests create a pipeline, the others aren't registered with this */
+/* Only the compute tests have pipelines, their device has all queues of the first compute family like the test's */
+static test_status _VulkanUplinkPrepare(vulkan_physical_device *physical_device, void *config_data) {
+    VkQueueFamilyProperties *queue_family_properties = NULL;
+    uint32_t queue_family_property_count = 0;
+    test_status status = VulkanGetPhysicalQueueFamilyProperties(physical_device, &queue_family_properties, &queue_family_property_count);
+    TEST_RETFAIL(status);
+    uint32_t *queue_family_indices = NULL;
+    uint32_t queue_family_count = 0;
+    vulkan_device device;
+    status = VulkanSelectQueueFamilyMultiple(&queue_family_indices, &queue_family_count, queue_family_properties, queue_family_property_count, VK_QUEUE_COMPUTE_BIT);
+    if (TEST_SUCCESS(status)) {
+        status = VulkanCreateDeviceWithQueues(physical_device, queue_family_properties, queue_family_indices, NULL, 1, &device, NULL);
+        free(queue_family_indices);
+    }
+    free(queue_family_properties);
+    TEST_RETFAIL(status);
+    vulkan_pipeline_builder *builder = NULL;
+    status = VulkanRunnerGetPipelineBuilder(&device, &builder);
+    TEST_RETFAIL(status);
+    vulkan_shader shader;
+    status = _VulkanUplinkCreateShader(builder->device, (uint32_t)((uint64_t)config_data) == VULKAN_UPLINK_TEST_TYPE_COMPUTE_READ, &shader);
+    TEST_RETFAIL(status);
+    vulkan_shader *owned_shader = NULL;
+    status = VulkanPipelineBuilderAddShader(builder, &shader, &owned_shader);
+    TEST_RETFAIL(status);
+    return VulkanPipelineBuilderAddPipeline(builder, owned_shader, "main", NULL, 0);
+}
+
+/* Shared with the pipeline build, the layout has to match for the driver to find the pipeline it compiled. Reads and writes swap the buffer bindings */
+static test_status _VulkanUplinkCreateShader(vulkan_device *device, bool read_test, vulkan_shader *shader) {
+    test_status status = VulkanShaderInitializeFromFile(device, "vulkan_uplink_gpu.spv", VK_SHADER_STAGE_COMPUTE_BIT, shader);
+    TEST_RETFAIL(status);
+    status = VulkanShaderAddDescriptor(shader, "device buffer", VULKAN_BINDING_STORAGE, 0, read_test ? 0 : 1);
+    if (!TEST_SUCCESS(status)) {
+        goto cleanup_shader;
+    }
+    status = VulkanShaderAddDescriptor(shader, "host buffer", VULKAN_BINDING_STORAGE, 0, read_test ? 1 : 0);
+    if (!TEST_SUCCESS(status)) {
+        goto cleanup_shader;
+    }
+    status = VulkanShaderAddFixedSizeDescriptor(shader, sizeof(vulkan_uplink_uniform_buffer), "uniform buffer", VULKAN_BINDING_UNIFORM, 0, 2);
+    if (!TEST_SUCCESS(status)) {
+        goto cleanup_shader;
+    }
+    status = VulkanShaderCreateDescriptorSets(shader);
+    if (!TEST_SUCCESS(status)) {
+        goto cleanup_shader;
+    }
+    return TEST_OK;
+cleanup_shader:
+    VulkanShaderCleanUp(shader);
+    return status;
+}
+
+/* Latency runs for a fixed time, the bandwidth tests sweep batch sizes at the target time before converging on the best one */
+static test_status _VulkanUplinkEstimate(vulkan_physical_device *physical_device, void *config_data, planner_estimate *estimate) {
+    TEST_UNUSED(physical_device);
+    uint32_t test_type = (uint32_t)((uint64_t)config_data);
+    uint64_t parameters[PARAMETERS_COUNT(vulkan_uplink_parameters)];
+    ParametersGetAll(vulkan_uplink_parameters, PARAMETERS_COUNT(vulkan_uplink_parameters), parameters);
+    uint64_t target_time_us = parameters[vulkan_uplink_parameter_target_time_us];
+    if (test_type == VULKAN_UPLINK_TEST_TYPE_LATENCY_SHORT || test_type == VULKAN_UPLINK_TEST_TYPE_LATENCY_LONG) {
+        estimate->fixed_time_us = (test_type == VULKAN_UPLINK_TEST_TYPE_LATENCY_SHORT) ? VULKAN_UPLINK_LATENCY_SHORT_US : VULKAN_UPLINK_LATENCY_LONG_US;
+        return TEST_OK;
+    }
+    bool mapped_test = (test_type == VULKAN_UPLINK_TEST_TYPE_MEMCPY_READ || test_type == VULKAN_UPLINK_TEST_TYPE_MEMCPY_WRITE);
+    estimate->step_count = 1;
+    estimate->sample_time_us = target_time_us;
+    estimate->fixed_time_us = (mapped_test ? 1 : VULKAN_UPLINK_ESTIMATED_SWEEP_STEPS) * target_time_us;
+    return TEST_OK;
+}
+
 static test_status _VulkanUplinkInitializeMemcpyThreads(uint32_t *source, uint32_t *destination, uint64_t size) {
     memcpy_thread_count = HelperGetProcessorCount();
     INFO("Detected %lu CPU threads\n", memcpy_thread_count);
@@ -659,13 +834,13 @@ static void _VulkanUplinkCleanUpMemcpyThreads() {
     }
 }
 
-static uint64_t _VulkanUplinkMemcpy() {
+static uint64_t _VulkanUplinkMemcpy(uint64_t target_time_us) {
     HelperAtomicBoolSet(&memcpy_thread_run_flag);
     memcpy_threads = HelperCreateThreads(memcpy_thread_count, _VulkanUplinkMemcpyThreadFunc, (void **)memcpy_thread_data);
     if (memcpy_threads == NULL) {
         return 0;
     }
-    HelperSleep(VULKAN_UPLINK_TARGET_TIME_US / 1000);
+    HelperSleep(target_time_us / 1000);
     HelperAtomicBoolClear(&memcpy_thread_run_flag);
     HelperWaitForThreads(memcpy_threads, memcpy_thread_count);
     HelperCleanUpThreads(memcpy_threads, memcpy_thread_count);
@@ -688,4 +863,24 @@ static void _VulkanUplinkMemcpyThreadFunc(uint32_t thread_id, void *data) {
             thread_data->cycles++;
         }
     }
+}
+
+/* Samples are in picoseconds per hop */
+static test_status _VulkanUplinkLogLatencyResult(vulkan_physical_device *physical_device, const statistics_summary *summary) {
+    INFO("Final results for %s:\n", physical_device->physical_properties.properties.deviceName);
+    statistics_summary summary_ns = *summary;
+    StatisticsScaleSummary(&summary_ns, 1.0 / 1000.0);
+    if (MainGetTestResultFormat() == test_result_csv) {
+        LOG_PLAIN("%s\n", physical_device->physical_properties.properties.deviceName);
+        LOG_PLAIN("Latency (ns)," STATISTICS_CSV_HEADER "\n");
+        LOG_PLAIN("%.3f," STATISTICS_CSV_FORMAT "\n", summary_ns.median, STATISTICS_CSV_VALUES(&summary_ns));
+    } else if (MainGetTestResultFormat() == test_result_raw) {
+        LOG_RESULT(0, "%s", "%llu", "latency", (uint64_t)summary->median);
+        LOG_RESULT_STATISTICS(0, "%s", "latency", summary);
+    } else if (MainGetTestResultFormat() == test_result_json) {
+        return ResultsAddMeasurement(0, "latency", "ns", &summary_ns);
+    } else {
+        INFO("Median latency: %.3fns (p5 %.3fns p95 %.3fns, %lu windows, %lu outliers)\n", summary_ns.median, summary_ns.p5, summary_ns.p95, summary->sample_count, summary->rejected_outliers);
+    }
+    return TEST_OK;
 }
\ No newline at end of file
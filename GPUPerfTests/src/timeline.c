@@ -0,0 +1,197 @@
+// Copyright (c) 2021 - 2022, Nemes <nemes@nemez.net>
+// SPDX-License-Identifier: MIT
+// 
+// MIT License
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software andassociated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, andto permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+// 
+// The above copyright notice andthis permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "main.h"
+#include "logger.h"
+#include "helper.h"
+#include "timeline.h"
+
+static const char *timeline_filepath = NULL;
+static bool timeline_enabled = false;
+static helper_timer timeline_epoch;
+static uint32_t timeline_buffer_count = 0;
+static helper_atomic_uint32 timeline_unassigned_dropped_count;
+static timeline_thread_buffer timeline_buffers[TIMELINE_MAXIMUM_THREADS];
+static HELPER_THREAD_LOCAL timeline_thread_buffer *timeline_local_buffer = NULL;
+
+static timeline_thread_buffer *_TimelineGetThreadBuffer();
+static timeline_event *_TimelineReserveEvent();
+static void _TimelineWriteEvent(void *file, timeline_event *event, uint32_t thread_index);
+static void _TimelineFreeBuffers();
+
+test_status TimelineInitialize(const char *filepath) {
+    if (filepath == NULL) {
+        return TEST_INVALID_PARAMETER;
+    }
+    /* Fail early rather than after a long run if the file can't be written */
+    void *file = HelperOpenFileForWriting(filepath);
+    if (file == NULL) {
+        return TEST_FILE_IO_ERROR;
+    }
+    HelperCloseFile(file);
+    memset(timeline_buffers, 0, sizeof(timeline_buffers));
+    timeline_unassigned_dropped_count = 0;
+    /* Every buffer is allocated up front so no measured event pays for one, threads that exit hand theirs on */
+    timeline_buffer_count = min(HelperGetProcessorCount() + 1, TIMELINE_MAXIMUM_THREADS);
+    for (uint32_t i = 0; i < timeline_buffer_count; i++) {
+        timeline_buffers[i].events = malloc(TIMELINE_EVENTS_PER_THREAD * sizeof(timeline_event));
+        if (timeline_buffers[i].events == NULL) {
+            _TimelineFreeBuffers();
+            return TEST_OUT_OF_MEMORY;
+        }
+        timeline_buffers[i].thread_index = i;
+    }
+    timeline_filepath = filepath;
+    HelperTimerReset(&timeline_epoch);
+    timeline_enabled = true;
+    _TimelineGetThreadBuffer();
+    return TEST_OK;
+}
+
+test_status TimelineFinish() {
+    if (!timeline_enabled) {
+        return TEST_OK;
+    }
+    timeline_enabled = false;
+    test_status status = TEST_OK;
+    void *file = HelperOpenFileForWriting(timeline_filepath);
+    if (file == NULL) {
+        status = TEST_FILE_IO_ERROR;
+        goto free_buffers;
+    }
+    uint64_t dropped_count = timeline_unassigned_dropped_count;
+    HelperWriteFile(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    HelperWriteFile(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%lu,\"tid\":0,\"args\":{\"name\":\"CPU\"}},\n", TIMELINE_TRACK_CPU);
+    HelperWriteFile(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%lu,\"tid\":0,\"args\":{\"name\":\"GPU\"}}", TIMELINE_TRACK_GPU);
+    for (uint32_t i = 0; i < timeline_buffer_count; i++) {
+        timeline_thread_buffer *buffer = &(timeline_buffers[i]);
+        for (uint32_t j = 0; j < buffer->event_count; j++) {
+            _TimelineWriteEvent(file, &(buffer->events[j]), buffer->thread_index);
+        }
+        dropped_count += buffer->dropped_count;
+    }
+    HelperWriteFile(file, "\n]}\n");
+    HelperCloseFile(file);
+    if (dropped_count > 0) {
+        WARNING("%llu trace events were dropped, a buffer was full or more threads recorded at once than there are buffers\n", dropped_count);
+    }
+    INFO("Trace written to %s\n", timeline_filepath);
+free_buffers:
+    _TimelineFreeBuffers();
+    return status;
+}
+
+bool TimelineIsEnabled() {
+    return timeline_enabled;
+}
+
+uint64_t TimelineBegin() {
+    if (!timeline_enabled) {
+        return 0;
+    }
+    return HelperTimerGetNanoseconds(&timeline_epoch);
+}
+
+void TimelineEnd(uint64_t start_ns, const char *name, const char *category, uint64_t argument) {
+    if (!timeline_enabled) {
+        return;
+    }
+    uint64_t end_ns = HelperTimerGetNanoseconds(&timeline_epoch);
+    timeline_event *event = _TimelineReserveEvent();
+    if (event == NULL) {
+        return;
+    }
+    event->name = name;
+    event->category = category;
+    event->start_ns = start_ns;
+    event->duration_ns = end_ns - start_ns;
+    event->argument = argument;
+    event->track = TIMELINE_TRACK_CPU;
+}
+
+/* GPU timestamps aren't in the host's time domain, so the span is placed to end at the time it was read back */
+void TimelineRecordGpu(uint64_t duration_ns, const char *name, uint64_t argument) {
+    if (!timeline_enabled) {
+        return;
+    }
+    uint64_t end_ns = HelperTimerGetNanoseconds(&timeline_epoch);
+    timeline_event *event = _TimelineReserveEvent();
+    if (event == NULL) {
+        return;
+    }
+    event->name = name;
+    event->category = TIMELINE_CATEGORY_GPU;
+    event->start_ns = (end_ns > duration_ns) ? (end_ns - duration_ns) : 0;
+    event->duration_ns = duration_ns;
+    event->argument = argument;
+    event->track = TIMELINE_TRACK_GPU;
+}
+
+/* Called by every helper thread as it exits */
+void TimelineReleaseThread() {
+    if (timeline_local_buffer != NULL) {
+        HelperAtomicBoolClear(&(timeline_local_buffer->in_use));
+        timeline_local_buffer = NULL;
+    }
+}
+
+/* Each thread claims a free buffer on its first event, recording never locks or allocates */
+static timeline_thread_buffer *_TimelineGetThreadBuffer() {
+    if (timeline_local_buffer != NULL) {
+        return timeline_local_buffer;
+    }
+    for (uint32_t i = 0; i < timeline_buffer_count; i++) {
+        if (!HelperAtomicBoolSet(&(timeline_buffers[i].in_use))) {
+            timeline_local_buffer = &(timeline_buffers[i]);
+            return timeline_local_buffer;
+        }
+    }
+    return NULL;
+}
+
+static timeline_event *_TimelineReserveEvent() {
+    timeline_thread_buffer *buffer = _TimelineGetThreadBuffer();
+    if (buffer == NULL) {
+        HelperAtomicIncrementUint32(&timeline_unassigned_dropped_count);
+        return NULL;
+    }
+    if (buffer->event_count >= TIMELINE_EVENTS_PER_THREAD) {
+        buffer->dropped_count++;
+        return NULL;
+    }
+    return &(buffer->events[buffer->event_count++]);
+}
+
+static void _TimelineWriteEvent(void *file, timeline_event *event, uint32_t thread_index) {
+    HelperWriteFile(file, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%lu,\"tid\":%lu,\"args\":{\"value\":%llu}}", event->name, event->category, event->start_ns / 1000.0, event->duration_ns / 1000.0, event->track, thread_index, event->argument);
+}
+
+static void _TimelineFreeBuffers() {
+    for (uint32_t i = 0; i < TIMELINE_MAXIMUM_THREADS; i++) {
+        free(timeline_buffers[i].events);
+        timeline_buffers[i].events = NULL;
+    }
+    timeline_buffer_count = 0;
+    timeline_local_buffer = NULL;
+}
\ No newline at end of file
@@ -27,6 +27,8 @@
 #include "vulkan_shader.h"
 #include "vulkan_compute_pipeline.h"
 #include "vulkan_command_buffer.h"
+#include "timeline.h"
+#include "watchdog.h"
 
 #ifdef VULKAN_COMMAND_BUFFER_TRACE
 #define TRACE_COMMAND(format, ...)   TRACE("[COMMAND] " format, __VA_ARGS__)
@@ -38,6 +40,8 @@
 #define SET_BIT(bit_array, index)   bit_array[(index) / 64] |= 1ULL << ((index) % 64)
 #define CLEAR_BIT(bit_array, index) bit_array[(index) / 64] &= ~(1ULL << ((index) % 64))
 
+static test_status _VulkanCommandBufferAbandonWait(vulkan_command_sequence *sequence_handle, uint32_t queue_count, test_status status);
+
 test_status VulkanCommandBufferInitializeOnQueue(vulkan_device *device, uint32_t queue_family_index, uint32_t command_buffer_count, vulkan_command_buffer *command_handle) {
     TRACE_COMMAND("Initializing command buffer 0x%p (device: 0x%p, buffer count: %lu)\n", command_handle, device, command_buffer_count);
     if (command_handle == NULL || command_buffer_count == 0) {
@@ -112,7 +116,8 @@ test_status VulkanCommandBufferCleanUp(vulkan_command_buffer *command_handle) {
     if (command_handle == NULL) {
         return TEST_INVALID_PARAMETER;
     }
-    for (uint32_t i = 0; i < command_handle->command_buffer_count; i++) {
+    bool lost = command_handle->device->lost;
+    for (uint32_t i = 0; i < command_handle->command_buffer_count && !lost; i++) {
         if (GET_BIT(command_handle->command_buffer_use_bitmask, i) == 0) {
             SET_BIT(command_handle->command_buffer_use_bitmask, i);
             vkResetCommandBuffer(command_handle->command_buffers[i], VK_COMMAND_BUFFER_RESET_RELEASE_RESOURCES_BIT);
@@ -123,11 +128,13 @@ test_status VulkanCommandBufferCleanUp(vulkan_command_buffer *command_handle) {
         command_handle->command_buffer_use_bitmask = NULL;
     }
     if (command_handle->command_buffers != NULL) {
-        vkFreeCommandBuffers(command_handle->device->device, command_handle->command_pool, command_handle->command_buffer_count, command_handle->command_buffers);
+        if (!lost) {
+            vkFreeCommandBuffers(command_handle->device->device, command_handle->command_pool, command_handle->command_buffer_count, command_handle->command_buffers);
+        }
         free(command_handle->command_buffers);
         command_handle->command_buffers = NULL;
     }
-    if (command_handle->command_pool != VK_NULL_HANDLE) {
+    if (command_handle->command_pool != VK_NULL_HANDLE && !lost) {
         vkDestroyCommandPool(command_handle->device->device, command_handle->command_pool, NULL);
     }
     return TEST_OK;
@@ -172,6 +179,7 @@ test_status VulkanCommandBufferStart(vulkan_command_sequence *sequence_handle) {
     if (sequence_handle->command_buffer != VK_NULL_HANDLE) {
         return TEST_VK_COMMAND_SEQUENCE_ALREADY_STARTED;
     }
+    uint64_t timeline_start = TimelineBegin();
     for (uint32_t i = 0; i < sequence_handle->command_pool->command_buffer_count; i++) {
         if (GET_BIT(sequence_handle->command_pool->command_buffer_use_bitmask, i) == 0) {
             SET_BIT(sequence_handle->command_pool->command_buffer_use_bitmask, i);
@@ -219,6 +227,7 @@ test_status VulkanCommandBufferStart(vulkan_command_sequence *sequence_handle) {
         sequence_handle->wait_fences = NULL;
         return TEST_VK_COMMAND_BUFFER_BEGIN_ERROR;
     }
+    TimelineEnd(timeline_start, "Begin command buffer", TIMELINE_CATEGORY_COMMAND, sequence_handle->command_buffer_index);
     return TEST_OK;
 }
 
@@ -244,11 +253,16 @@ test_status VulkanCommandBufferReset(vulkan_command_sequence *sequence_handle) {
         /* For convenience: Don't return an error if this is a self-resetting command buffer */
         return ((sequence_handle->flags & VULKAN_COMMAND_SEQUENCE_RESET_ON_COMPLETION) != 0) ? TEST_OK : TEST_VK_COMMAND_SEQUENCE_NOT_STARTED;
     }
-    VkResult res = vkResetCommandBuffer(sequence_handle->command_buffer, 0);
-    VULKAN_RETFAIL(res, TEST_VK_COMMAND_BUFFER_RESET_ERROR);
+    bool lost = sequence_handle->command_pool->device->lost;
+    if (!lost) {
+        VkResult res = vkResetCommandBuffer(sequence_handle->command_buffer, 0);
+        VULKAN_RETFAIL(res, TEST_VK_COMMAND_BUFFER_RESET_ERROR);
+    }
 
     for (uint32_t i = 0; i < sequence_handle->queue_count; i++) {
-        vkDestroyFence(sequence_handle->command_pool->device->device, sequence_handle->wait_fences[i], NULL);
+        if (!lost) {
+            vkDestroyFence(sequence_handle->command_pool->device->device, sequence_handle->wait_fences[i], NULL);
+        }
         sequence_handle->wait_fences[i] = VK_NULL_HANDLE;
     }
     CLEAR_BIT(sequence_handle->command_pool->command_buffer_use_bitmask, sequence_handle->command_buffer_index);
@@ -273,10 +287,12 @@ test_status VulkanCommandBufferSubmitOnQueues(vulkan_command_sequence *sequence_
     submit_info.commandBufferCount = 1;
     submit_info.pCommandBuffers = &(sequence_handle->command_buffer);
 
+    uint64_t timeline_start = TimelineBegin();
     for (uint32_t i = 0; i < queue_count; i++) {
         VkResult res = vkQueueSubmit(sequence_handle->command_pool->device->queues[sequence_handle->command_pool->queue_family->queue_offset + queue_offset + i], 1, &submit_info, sequence_handle->wait_fences[i]);
         VULKAN_RETFAIL(res, TEST_VK_QUEUE_SUBMIT_ERROR);
     }
+    TimelineEnd(timeline_start, "Submit", TIMELINE_CATEGORY_COMMAND, queue_count);
     return TEST_OK;
 }
 test_status VulkanCommandBufferSubmitOnQueue(vulkan_command_sequence *sequence_handle, uint32_t queue_index) {
@@ -302,8 +318,12 @@ test_status VulkanCommandBufferSubmit(vulkan_command_sequence *sequence_handle)
     return VulkanCommandBufferSubmitOnQueue(sequence_handle, 0);
 }
 
+/* Every wait is also cut short by the deadline of the running test, which fails it with TEST_TIMEOUT instead */
 test_status VulkanCommandBufferWaitOnQueues(vulkan_command_sequence *sequence_handle, size_t max_wait_nanoseconds, uint32_t queue_offset, uint32_t queue_count) {
     TEST_UNUSED(queue_offset);
+    if (max_wait_nanoseconds == VULKAN_COMMAND_SEQUENCE_WAIT_STEP) {
+        max_wait_nanoseconds = (MainGetStepTimeout() == 0) ? VULKAN_COMMAND_SEQUENCE_WAIT_INFINITE : (size_t)MainGetStepTimeout() * 1000000ULL;
+    }
 #ifdef VULKAN_COMMAND_BUFFER_TRACE
     if (max_wait_nanoseconds == VULKAN_COMMAND_SEQUENCE_WAIT_INFINITE) {
         TRACE_COMMAND("Waiting for command sequence 0x%p on queues %lu-%lu (timeout: INFINITE)\n", sequence_handle, queue_offset, queue_offset + queue_count - 1);
@@ -320,17 +340,22 @@ test_status VulkanCommandBufferWaitOnQueues(vulkan_command_sequence *sequence_ha
     if (queue_count > sequence_handle->queue_count) {
         return TEST_VK_INVALID_QUEUE_INDEX;
     }
+    uint64_t timeline_start = TimelineBegin();
     while (true) {
         VkResult res;
         if (max_wait_nanoseconds == 0) {
             res = vkGetFenceStatus(sequence_handle->command_pool->device->device, sequence_handle->wait_fences[0]);
         } else {
-            res = vkWaitForFences(sequence_handle->command_pool->device->device, queue_count, sequence_handle->wait_fences, VK_TRUE, (max_wait_nanoseconds == VULKAN_COMMAND_SEQUENCE_WAIT_INFINITE) ? 1000000ULL : max_wait_nanoseconds);
+            uint64_t wait_nanoseconds = (max_wait_nanoseconds == VULKAN_COMMAND_SEQUENCE_WAIT_INFINITE) ? 1000000ULL : max_wait_nanoseconds;
+            res = vkWaitForFences(sequence_handle->command_pool->device->device, queue_count, sequence_handle->wait_fences, VK_TRUE, min(wait_nanoseconds, WatchdogGetRemainingNanoseconds()));
         }
         if (!VULKAN_SUCCESS(res)) {
             if (res == VK_TIMEOUT) {
+                if (WatchdogHasExpired()) {
+                    return _VulkanCommandBufferAbandonWait(sequence_handle, queue_count, TEST_TIMEOUT);
+                }
                 if (max_wait_nanoseconds != VULKAN_COMMAND_SEQUENCE_WAIT_INFINITE) {
-                    return TEST_VK_WAIT_FOR_FENCES_TIMEOUT;
+                    return _VulkanCommandBufferAbandonWait(sequence_handle, queue_count, TEST_VK_WAIT_FOR_FENCES_TIMEOUT);
                 }
             } else if (res == VK_NOT_READY) {
                 return TEST_VK_WAIT_FOR_FENCES_NOT_READY;
@@ -341,6 +366,7 @@ test_status VulkanCommandBufferWaitOnQueues(vulkan_command_sequence *sequence_ha
             break;
         }
     }
+    TimelineEnd(timeline_start, "Wait for fences", TIMELINE_CATEGORY_COMMAND, queue_count);
     if ((sequence_handle->flags & VULKAN_COMMAND_SEQUENCE_RESET_ON_COMPLETION) != 0) {
         return VulkanCommandBufferReset(sequence_handle);
     } else {
@@ -434,7 +460,9 @@ test_status VulkanCommandBufferBindComputePipeline(vulkan_command_sequence *sequ
 
     uint32_t set_count = (uint32_t)HelperArrayListSize(&(pipeline_handle->shader->descriptor_set_array));
     vkCmdBindPipeline(sequence_handle->command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_handle->pipeline);
-    vkCmdBindDescriptorSets(sequence_handle->command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_handle->shader->pipeline_layout, 0, set_count, pipeline_handle->descriptor_sets, 0, NULL);
+    if (set_count > 0) {
+        vkCmdBindDescriptorSets(sequence_handle->command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_handle->shader->pipeline_layout, 0, set_count, pipeline_handle->descriptor_sets, 0, NULL);
+    }
     return TEST_OK;
 }
 
@@ -542,4 +570,20 @@ test_status VulkanCommandBufferCopyBufferSubimage(vulkan_command_sequence *seque
 
 test_status VulkanCommandBufferCopyBufferImage(vulkan_command_sequence *sequence_handle, vulkan_region *source, vulkan_texture *destination, uint32_t mip_level) {
     return VulkanCommandBufferCopyBufferSubimage(sequence_handle, source, 0, destination, 0, 0, 0, destination->image_width, destination->image_height, destination->image_depth, mip_level);
+}
+
+/*
+ * The caller unwinds and frees everything the timed out submission uses, so it gets a little longer to finish first.
+ * If the GPU is hung the device is marked lost instead, the cleanup functions then leak what is still in flight.
+ * The device isn't trusted with another test either way.
+ */
+static test_status _VulkanCommandBufferAbandonWait(vulkan_command_sequence *sequence_handle, uint32_t queue_count, test_status status) {
+    vulkan_device *device = sequence_handle->command_pool->device;
+    VkResult res = vkWaitForFences(device->device, queue_count, sequence_handle->wait_fences, VK_TRUE, VULKAN_COMMAND_SEQUENCE_DRAIN_NANOSECONDS);
+    if (!VULKAN_SUCCESS(res)) {
+        WARNING("GPU didn't finish a timed out submission, its device is abandoned\n");
+        device->lost = true;
+    }
+    VulkanDeviceMarkLost(device);
+    return status;
 }
\ No newline at end of file
@@ -34,38 +34,38 @@
 #endif
 
 test_status VulkanComputePipelineInitialize(vulkan_shader *compute_shader, const char *entrypoint, vulkan_compute_pipeline *pipeline_handle) {
-    TRACE_COMPUTE("Initializing compute pipeline 0x%p (compute shader: 0x%p, entrypoint: \"%s\")\n", pipeline_handle, compute_shader, entrypoint);
-    if (compute_shader == NULL || pipeline_handle == NULL) {
+    return VulkanComputePipelineInitializeSpecialized(compute_shader, entrypoint, NULL, 0, pipeline_handle);
+}
+
+/* constants[i] sets the 32-bit specialization constant with constant_id i */
+test_status VulkanComputePipelineInitializeSpecialized(vulkan_shader *compute_shader, const char *entrypoint, const uint32_t *constants, uint32_t constant_count, vulkan_compute_pipeline *pipeline_handle) {
+    TRACE_COMPUTE("Initializing compute pipeline 0x%p (compute shader: 0x%p, entrypoint: \"%s\", specialization constants: %lu)\n", pipeline_handle, compute_shader, entrypoint, constant_count);
+    if (pipeline_handle == NULL) {
         return TEST_INVALID_PARAMETER;
     }
-    if (compute_shader->pipeline_layout == VK_NULL_HANDLE) {
-        return TEST_VK_SHADER_DESCRIPTORS_NOT_CREATED;
-    }
-    if ((compute_shader->shader_stages & VK_SHADER_STAGE_COMPUTE_BIT) == 0) {
-        return TEST_VK_COMPUTE_PIPELINE_SHADER_STAGE_MISMATCH;
-    }
+    vulkan_compute_pipeline_description description;
+    test_status status = VulkanComputePipelineDescribe(compute_shader, entrypoint, constants, constant_count, &description);
+    TEST_RETFAIL(status);
     pipeline_handle->pipeline = VK_NULL_HANDLE;
     pipeline_handle->descriptor_pool = VK_NULL_HANDLE;
 
-    VkComputePipelineCreateInfo compute_pipeline_create_info = {0};
-    compute_pipeline_create_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
-    compute_pipeline_create_info.pNext = NULL;
-    compute_pipeline_create_info.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    compute_pipeline_create_info.stage.pName = NULL;
-    compute_pipeline_create_info.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
-    compute_pipeline_create_info.stage.module = compute_shader->shader_module;
-    compute_pipeline_create_info.stage.pName = entrypoint;
-    compute_pipeline_create_info.layout = compute_shader->pipeline_layout;
-
-    VkResult res = vkCreateComputePipelines(compute_shader->device->device, VK_NULL_HANDLE, 1, &compute_pipeline_create_info, NULL, &(pipeline_handle->pipeline));
+    VkResult res = vkCreateComputePipelines(compute_shader->device->device, compute_shader->device->pipeline_cache, 1, &(description.create_info), NULL, &(pipeline_handle->pipeline));
     VULKAN_RETFAIL(res, TEST_VK_COMPUTE_PIPELINE_CREATION_ERROR);
 
+    size_t set_count = HelperArrayListSize(&(compute_shader->descriptor_set_array));
+    if (set_count == 0) {
+        // Descriptor pools can't be empty, shaders without any bindings don't need one
+        pipeline_handle->descriptor_sets = NULL;
+        pipeline_handle->descriptor_set_indices = NULL;
+        pipeline_handle->device = compute_shader->device;
+        pipeline_handle->shader = compute_shader;
+        return TEST_OK;
+    }
     helper_arraylist descriptor_pool_sizes;
-    test_status status = HelperArrayListInitialize(&descriptor_pool_sizes, sizeof(VkDescriptorPoolSize));
+    status = HelperArrayListInitialize(&descriptor_pool_sizes, sizeof(VkDescriptorPoolSize));
     if (!TEST_SUCCESS(status)) {
         goto cleanup_pipeline;
     }
-    size_t set_count = HelperArrayListSize(&(compute_shader->descriptor_set_array));
     for (size_t i = 0; i < set_count; i++) {
         vulkan_shader_descriptor_set *descriptor_set = (vulkan_shader_descriptor_set *)HelperArrayListGet(&(compute_shader->descriptor_set_array), i);
         size_t descriptor_count = HelperArrayListSize(&(descriptor_set->descriptor_array));
@@ -158,15 +158,51 @@ cleanup_pipeline:
     return status;
 }
 
+/* Lets pipelines be created in batches, the same shader and constants describe the pipeline VulkanComputePipelineInitializeSpecialized creates */
+test_status VulkanComputePipelineDescribe(vulkan_shader *compute_shader, const char *entrypoint, const uint32_t *constants, uint32_t constant_count, vulkan_compute_pipeline_description *description) {
+    if (compute_shader == NULL || entrypoint == NULL || description == NULL || (constants == NULL && constant_count > 0) || constant_count > VULKAN_COMPUTE_PIPELINE_MAXIMUM_CONSTANTS) {
+        return TEST_INVALID_PARAMETER;
+    }
+    if (compute_shader->pipeline_layout == VK_NULL_HANDLE) {
+        return TEST_VK_SHADER_DESCRIPTORS_NOT_CREATED;
+    }
+    if ((compute_shader->shader_stages & VK_SHADER_STAGE_COMPUTE_BIT) == 0) {
+        return TEST_VK_COMPUTE_PIPELINE_SHADER_STAGE_MISMATCH;
+    }
+    memset(description, 0, sizeof(vulkan_compute_pipeline_description));
+    description->create_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    description->create_info.pNext = NULL;
+    description->create_info.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    description->create_info.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    description->create_info.stage.module = compute_shader->shader_module;
+    description->create_info.stage.pName = entrypoint;
+    description->create_info.layout = compute_shader->pipeline_layout;
+
+    if (constant_count > 0) {
+        for (uint32_t i = 0; i < constant_count; i++) {
+            description->constants[i] = constants[i];
+            description->map_entries[i].constantID = i;
+            description->map_entries[i].offset = i * sizeof(uint32_t);
+            description->map_entries[i].size = sizeof(uint32_t);
+        }
+        description->specialization_info.mapEntryCount = constant_count;
+        description->specialization_info.pMapEntries = description->map_entries;
+        description->specialization_info.dataSize = constant_count * sizeof(uint32_t);
+        description->specialization_info.pData = description->constants;
+        description->create_info.stage.pSpecializationInfo = &(description->specialization_info);
+    }
+    return TEST_OK;
+}
+
 test_status VulkanComputePipelineCleanUp(vulkan_compute_pipeline *pipeline_handle) {
     TRACE_COMPUTE("Cleaning up compute pipeline 0x%p\n", pipeline_handle);
     if (pipeline_handle == NULL) {
         return TEST_INVALID_PARAMETER;
     }
-    if (pipeline_handle->pipeline != VK_NULL_HANDLE) {
+    if (pipeline_handle->pipeline != VK_NULL_HANDLE && !pipeline_handle->device->lost) {
         vkDestroyPipeline(pipeline_handle->device->device, pipeline_handle->pipeline, NULL);
     }
-    if (pipeline_handle->descriptor_pool != VK_NULL_HANDLE) {
+    if (pipeline_handle->descriptor_pool != VK_NULL_HANDLE && !pipeline_handle->device->lost) {
         vkDestroyDescriptorPool(pipeline_handle->device->device, pipeline_handle->descriptor_pool, NULL);
     }
     if (pipeline_handle->descriptor_set_indices != NULL) {
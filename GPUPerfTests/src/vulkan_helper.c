@@ -23,6 +23,7 @@
 
 #include "vulkan_helper.h"
 #include "logger.h"
+#include "vulkan_pipeline_cache.h"
 
 static const char *_vulkan_validation_layers[] = {
     "VK_LAYER_KHRONOS_validation"
@@ -36,6 +37,34 @@ static const char *_vulkan_debug_extensions[] = {
 static VKAPI_ATTR VkBool32 VKAPI_CALL _VulkanDebugReportEXTCallback(VkDebugUtilsMessageSeverityFlagBitsEXT message_severity, VkDebugUtilsMessageTypeFlagsEXT message_type, const VkDebugUtilsMessengerCallbackDataEXT *data, void *user);
 static test_status _VulkanGetSupportedLayersGlobal(VkLayerProperties **layers, uint32_t *layer_count);
 
+/* Everything that makes two VkDeviceCreateInfos equivalent, pNext pointers are zeroed so the key can be compared with memcmp */
+typedef struct vulkan_device_cache_key_t {
+    VkPhysicalDevice physical_device;
+    uint32_t queue_family_count;
+    uint32_t queue_family_indices[VULKAN_DEVICE_CACHE_MAXIMUM_FAMILIES];
+    uint32_t queue_counts[VULKAN_DEVICE_CACHE_MAXIMUM_FAMILIES];
+    VkPhysicalDeviceFeatures2 features;
+    VkPhysicalDeviceVulkan11Features features_vk11;
+    VkPhysicalDeviceVulkan12Features features_vk12;
+} vulkan_device_cache_key;
+
+typedef struct vulkan_device_cache_entry_t {
+    vulkan_device_cache_key key;
+    vulkan_device device;
+    bool valid;
+    uint32_t users;             /* More than one only while devices are shared */
+    bool lost;                  /* A wait on it timed out, it's destroyed instead of handed to the next test */
+} vulkan_device_cache_entry;
+
+static bool device_cache_enabled = false;
+static bool device_cache_shared = false;
+/* Workers running tests on different devices at once share the cache */
+static helper_mutex device_cache_mutex = NULL;
+static vulkan_device_cache_entry device_cache[VULKAN_DEVICE_CACHE_SIZE];
+
+static bool _VulkanBuildDeviceCacheKey(vulkan_physical_device *physical_device, VkQueueFamilyProperties *queue_family_properties, uint32_t *queue_family_indices, uint32_t *queue_counts, uint32_t queue_family_count, const void *pNext, vulkan_device_cache_key *key);
+static void _VulkanDestroyDeviceObjects(vulkan_device *device);
+
 test_status VulkanCreateInstance(bool graphical, const char *test_name, uint32_t test_version, vulkan_instance *instance) {
     bool debug_mode = false; // in case I ever decide to turn this into an input arg
 #ifdef _DEBUG
@@ -224,8 +253,10 @@ test_status VulkanGetPhysicalDevices(vulkan_instance *instance, vulkan_physical_
         vkGetPhysicalDeviceProperties2(*physical_device, &(device->physical_properties));
         device->physical_features_vk12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
         device->physical_features_vk12.pNext = NULL;
+        device->physical_features_vk11.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_1_FEATURES;
+        device->physical_features_vk11.pNext = &(device->physical_features_vk12);
         device->physical_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
-        device->physical_features.pNext = &(device->physical_features_vk12);
+        device->physical_features.pNext = &(device->physical_features_vk11);
         vkGetPhysicalDeviceFeatures2(*physical_device, &(device->physical_features));
         device->physical_memory_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
         device->physical_memory_properties.pNext = NULL;
@@ -387,6 +418,20 @@ test_status VulkanCreateDeviceWithQueues(vulkan_physical_device *physical_device
     if (physical_device == NULL || device == NULL || queue_family_properties == NULL || queue_family_indices == NULL || queue_family_count == 0) {
         return TEST_INVALID_PARAMETER;
     }
+    vulkan_device_cache_key cache_key;
+    bool cacheable = device_cache_enabled && _VulkanBuildDeviceCacheKey(physical_device, queue_family_properties, queue_family_indices, queue_counts, queue_family_count, pNext, &cache_key);
+    if (cacheable) {
+        HelperLockMutex(device_cache_mutex);
+        for (uint32_t i = 0; i < VULKAN_DEVICE_CACHE_SIZE; i++) {
+            if (device_cache[i].valid && (device_cache[i].users == 0 || device_cache_shared) && memcmp(&(device_cache[i].key), &cache_key, sizeof(cache_key)) == 0) {
+                device_cache[i].users++;
+                *device = device_cache[i].device;
+                HelperUnlockMutex(device_cache_mutex);
+                return TEST_OK;
+            }
+        }
+        HelperUnlockMutex(device_cache_mutex);
+    }
     VkDeviceQueueCreateInfo *device_queue_create_infos = malloc(queue_family_count * sizeof(VkDeviceQueueCreateInfo));
     if (device_queue_create_infos == NULL) {
         return TEST_OUT_OF_MEMORY;
@@ -443,6 +488,7 @@ test_status VulkanCreateDeviceWithQueues(vulkan_physical_device *physical_device
         return TEST_VK_DEVICE_CREATE_ERROR;
     }
     device->physical_device = physical_device;
+    device->lost = false;
     device->queue_families = queue_families;
     device->queue_family_count = queue_family_count;
     device->total_queue_count = total_queue_count;
@@ -457,6 +503,30 @@ test_status VulkanCreateDeviceWithQueues(vulkan_physical_device *physical_device
             vkGetDeviceQueue(device->device, queue_families[i].family_index, j, &(device->queues[queue_families[i].queue_offset + j]));
         }
     }
+    VulkanPipelineCacheLoad(device);
+    if (cacheable) {
+        /* Take an empty slot, or evict a device no test is using. If every slot is busy the device just isn't cached */
+        vulkan_device_cache_entry *slot = NULL;
+        HelperLockMutex(device_cache_mutex);
+        for (uint32_t i = 0; i < VULKAN_DEVICE_CACHE_SIZE && slot == NULL; i++) {
+            if (!device_cache[i].valid) {
+                slot = &(device_cache[i]);
+            }
+        }
+        for (uint32_t i = 0; i < VULKAN_DEVICE_CACHE_SIZE && slot == NULL; i++) {
+            if (device_cache[i].users == 0) {
+                slot = &(device_cache[i]);
+                _VulkanDestroyDeviceObjects(&(slot->device));
+            }
+        }
+        if (slot != NULL) {
+            slot->key = cache_key;
+            slot->device = *device;
+            slot->valid = true;
+            slot->users = 1;
+        }
+        HelperUnlockMutex(device_cache_mutex);
+    }
     return TEST_OK;
 }
 
@@ -475,11 +545,72 @@ test_status VulkanCreateDevice(vulkan_physical_device *physical_device, VkQueueF
 }
 
 test_status VulkanDestroyDevice(vulkan_device *device) {
-    free(device->queues);
-    vkDestroyDevice(device->device, NULL);
+    HelperLockMutex(device_cache_mutex);
+    for (uint32_t i = 0; i < VULKAN_DEVICE_CACHE_SIZE; i++) {
+        if (device_cache[i].valid && device_cache[i].device.device == device->device) {
+            if (device_cache[i].lost || device->lost) {
+                memset(&(device_cache[i]), 0, sizeof(device_cache[i]));
+                break;
+            }
+            device_cache[i].users--;
+            HelperUnlockMutex(device_cache_mutex);
+            return TEST_OK;
+        }
+    }
+    HelperUnlockMutex(device_cache_mutex);
+    if (device->lost) {
+        /* Destroying a device the GPU is still executing on is undefined, it's leaked until the process exits */
+        WARNING("Leaking a device whose GPU didn't finish its work\n");
+        return TEST_OK;
+    }
+    _VulkanDestroyDeviceObjects(device);
     return TEST_OK;
 }
 
+/* Keeps a device whose GPU may still be busy or hung out of the cache, VulkanDestroyDevice destroys it for real */
+void VulkanDeviceMarkLost(vulkan_device *device) {
+    HelperLockMutex(device_cache_mutex);
+    for (uint32_t i = 0; i < VULKAN_DEVICE_CACHE_SIZE; i++) {
+        if (device_cache[i].valid && device_cache[i].device.device == device->device) {
+            device_cache[i].lost = true;
+        }
+    }
+    HelperUnlockMutex(device_cache_mutex);
+}
+
+void VulkanDeviceCacheEnable() {
+    if (device_cache_mutex == NULL) {
+        device_cache_mutex = HelperCreateMutex();
+    }
+    device_cache_enabled = (device_cache_mutex != NULL);
+}
+
+/*
+ * While shared, a device equivalent to one that is already handed out is handed out again instead of creating another.
+ * Only for a single thread that doesn't submit work, such as the pipeline build, every user destroys its device as usual.
+ */
+void VulkanDeviceCacheShare(bool shared) {
+    device_cache_shared = shared;
+}
+
+test_status VulkanDeviceCacheFlush() {
+    test_status status = TEST_OK;
+    for (uint32_t i = 0; i < VULKAN_DEVICE_CACHE_SIZE; i++) {
+        if (device_cache[i].valid) {
+            if (device_cache[i].users != 0) {
+                status = TEST_PROGRAMMING_ERROR;
+            }
+            _VulkanDestroyDeviceObjects(&(device_cache[i].device));
+        }
+    }
+    memset(device_cache, 0, sizeof(device_cache));
+    device_cache_enabled = false;
+    device_cache_shared = false;
+    HelperCleanUpMutex(device_cache_mutex);
+    device_cache_mutex = NULL;
+    return status;
+}
+
 test_status VulkanCalculateWorkgroupDispatch(vulkan_device *device, uint64_t total_workgroups, uint32_t *x, uint32_t *y, uint32_t *z) {
     if (device == NULL || x == NULL || y == NULL || z == NULL) {
         return TEST_INVALID_PARAMETER;
@@ -527,6 +658,64 @@ test_status VulkanCalculateWorkgroupDispatch(vulkan_device *device, uint64_t tot
     }
 }
 
+/* Largest device local heap, what a test allocating VULKAN_MEMORY_NORMAL memory can get without creating a device */
+uint64_t VulkanGetDeviceLocalMemorySize(vulkan_physical_device *physical_device) {
+    VkPhysicalDeviceMemoryProperties *memory_properties = &(physical_device->physical_memory_properties.memoryProperties);
+    uint64_t heap_size = 0;
+    for (uint32_t i = 0; i < memory_properties->memoryHeapCount; i++) {
+        if ((memory_properties->memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0) {
+            heap_size = max(heap_size, memory_properties->memoryHeaps[i].size);
+        }
+    }
+    return heap_size;
+}
+
+/* Only the feature structures the tests use are understood, any other pNext chain makes the device uncacheable */
+static bool _VulkanBuildDeviceCacheKey(vulkan_physical_device *physical_device, VkQueueFamilyProperties *queue_family_properties, uint32_t *queue_family_indices, uint32_t *queue_counts, uint32_t queue_family_count, const void *pNext, vulkan_device_cache_key *key) {
+    if (queue_family_count > VULKAN_DEVICE_CACHE_MAXIMUM_FAMILIES) {
+        return false;
+    }
+    memset(key, 0, sizeof(vulkan_device_cache_key));
+    key->physical_device = physical_device->physical_device;
+    key->queue_family_count = queue_family_count;
+    for (uint32_t i = 0; i < queue_family_count; i++) {
+        key->queue_family_indices[i] = queue_family_indices[i];
+        if (queue_counts == NULL || queue_counts[i] == VULKAN_QUEUES_ALL) {
+            key->queue_counts[i] = queue_family_properties[queue_family_indices[i]].queueCount;
+        } else {
+            key->queue_counts[i] = queue_counts[i];
+        }
+    }
+    const VkBaseInStructure *chain = (const VkBaseInStructure *)pNext;
+    while (chain != NULL) {
+        switch (chain->sType) {
+        case VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2:
+            memcpy(&(key->features), chain, sizeof(VkPhysicalDeviceFeatures2));
+            key->features.pNext = NULL;
+            break;
+        case VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_1_FEATURES:
+            memcpy(&(key->features_vk11), chain, sizeof(VkPhysicalDeviceVulkan11Features));
+            key->features_vk11.pNext = NULL;
+            break;
+        case VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES:
+            memcpy(&(key->features_vk12), chain, sizeof(VkPhysicalDeviceVulkan12Features));
+            key->features_vk12.pNext = NULL;
+            break;
+        default:
+            return false;
+        }
+        chain = chain->pNext;
+    }
+    return true;
+}
+
+static void _VulkanDestroyDeviceObjects(vulkan_device *device) {
+    VulkanPipelineCacheSave(device);
+    VulkanPipelineCacheDestroy(device);
+    free(device->queues);
+    vkDestroyDevice(device->device, NULL);
+}
+
 static VKAPI_ATTR VkBool32 VKAPI_CALL _VulkanDebugReportEXTCallback(VkDebugUtilsMessageSeverityFlagBitsEXT message_severity, VkDebugUtilsMessageTypeFlagsEXT message_type, const VkDebugUtilsMessengerCallbackDataEXT *data, void *user) {
     TEST_UNUSED(user);
     const char *message_type_string;
@@ -24,6 +24,7 @@
 #include "vulkan_helper.h"
 #include "logger.h"
 #include "vulkan_memory.h"
+#include "timeline.h"
 
 #ifdef VULKAN_MEMORY_TRACE
 #define TRACE_MEMORY(format, ...)   TRACE("[MEMORY] " format, __VA_ARGS__)
@@ -32,6 +33,7 @@
 #endif
 
 static void _VulkanMemoryDestroyBuffers(vulkan_memory *memory_handle);
+static test_status _VulkanMemoryAllocateBacking(vulkan_memory *memory_handle);
 static test_status _VulkanMemoryAddTextureGeneric(vulkan_memory *memory_handle, uint32_t width, uint32_t height, uint32_t depth, VkFormat texture_format, uint32_t mipmaps, const char *texture_name, uint32_t texture_type);
 
 test_status VulkanMemoryInitializeForQueues(vulkan_device *device, uint32_t *queue_family_indices, uint32_t queue_family_count, uint32_t memory_type, vulkan_memory *memory_handle) {
@@ -164,6 +166,14 @@ test_status VulkanMemoryAddTexture3D(vulkan_memory *memory_handle, uint32_t widt
 }
 
 test_status VulkanMemoryAllocateBacking(vulkan_memory *memory_handle) {
+    /* Failed attempts are recorded as well, so allocation retries show up on the timeline */
+    uint64_t timeline_start = TimelineBegin();
+    test_status status = _VulkanMemoryAllocateBacking(memory_handle);
+    TimelineEnd(timeline_start, "Allocate memory", TIMELINE_CATEGORY_MEMORY, (uint64_t)status);
+    return status;
+}
+
+static test_status _VulkanMemoryAllocateBacking(vulkan_memory *memory_handle) {
     TRACE_MEMORY("Allocating backing of memory pool 0x%p\n", memory_handle);
     if (memory_handle == NULL) {
         return TEST_INVALID_PARAMETER;
@@ -475,12 +485,18 @@ test_status VulkanMemoryFreeBuffersAndBacking(vulkan_memory *memory_handle) {
     if (memory_handle->memory == VK_NULL_HANDLE) {
         return TEST_VK_BACKING_NOT_ALLOCATED;
     }
+    /* The GPU may still be using the memory of a lost device, it's left mapped and allocated */
+    bool lost = memory_handle->device->lost;
     if (memory_handle->mapped_pool_base != NULL) {
         memory_handle->mapped_pool_base = NULL;
-        vkUnmapMemory(memory_handle->device->device, memory_handle->memory);
+        if (!lost) {
+            vkUnmapMemory(memory_handle->device->device, memory_handle->memory);
+        }
     }
     _VulkanMemoryDestroyBuffers(memory_handle);
-    vkFreeMemory(memory_handle->device->device, memory_handle->memory, NULL);
+    if (!lost) {
+        vkFreeMemory(memory_handle->device->device, memory_handle->memory, NULL);
+    }
     memory_handle->memory = VK_NULL_HANDLE;
     return TEST_OK;
 }
@@ -623,6 +639,7 @@ uint64_t VulkanMemoryGetPhysicalPoolSize(vulkan_memory *memory_handle) {
 }
 
 static void _VulkanMemoryDestroyBuffers(vulkan_memory *memory_handle) {
+    bool lost = memory_handle->device->lost;
     for (uint32_t i = 0; i <= VULKAN_REGION_TYPE_MAX; i++) {
         size_t buffer_count = HelperArrayListSize(&(memory_handle->buffer_list[i]));
         for (uint32_t j = 0; j < (uint32_t)buffer_count; j++) {
@@ -630,23 +647,23 @@ static void _VulkanMemoryDestroyBuffers(vulkan_memory *memory_handle) {
 
             if (i == VULKAN_REGION_TEXTURE_1D || i == VULKAN_REGION_TEXTURE_2D || i == VULKAN_REGION_TEXTURE_3D) {
                 if (buffer->texture != NULL) {
-                    if (buffer->texture->image_view != VK_NULL_HANDLE) {
+                    if (buffer->texture->image_view != VK_NULL_HANDLE && !lost) {
                         vkDestroyImageView(memory_handle->device->device, buffer->texture->image_view, NULL);
                         buffer->texture->image_view = VK_NULL_HANDLE;
                     }
-                    if (buffer->texture->image_sampler != VK_NULL_HANDLE) {
+                    if (buffer->texture->image_sampler != VK_NULL_HANDLE && !lost) {
                         vkDestroySampler(memory_handle->device->device, buffer->texture->image_sampler, NULL);
                         buffer->texture->image_sampler = VK_NULL_HANDLE;
                     }
                     free(buffer->texture);
                     buffer->texture = NULL;
                 }
-                if (buffer->image != VK_NULL_HANDLE) {
+                if (buffer->image != VK_NULL_HANDLE && !lost) {
                     vkDestroyImage(memory_handle->device->device, buffer->image, NULL);
                     buffer->image = VK_NULL_HANDLE;
                 }
             } else {
-                if (buffer->buffer != VK_NULL_HANDLE) {
+                if (buffer->buffer != VK_NULL_HANDLE && !lost) {
                     vkDestroyBuffer(memory_handle->device->device, buffer->buffer, NULL);
                     buffer->buffer = VK_NULL_HANDLE;
                 }
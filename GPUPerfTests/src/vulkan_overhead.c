@@ -0,0 +1,201 @@
+// Copyright (c) 2021 - 2022, Nemes <nemes@nemez.net>
+// SPDX-License-Identifier: MIT
+// 
+// MIT License
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software andassociated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, andto permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+// 
+// The above copyright notice andthis permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "main.h"
+#include "logger.h"
+#include "helper.h"
+#include "vulkan_helper.h"
+#include "vulkan_memory.h"
+#include "vulkan_shader.h"
+#include "vulkan_compute_pipeline.h"
+#include "vulkan_pipeline_builder.h"
+#include "vulkan_command_buffer.h"
+#include "vulkan_query.h"
+#include "statistics.h"
+#include "vulkan_overhead.h"
+#include "results.h"
+
+static test_status _VulkanOverheadCreateShader(vulkan_device *device, vulkan_shader *shader);
+static test_status _VulkanOverheadMeasure(vulkan_command_sequence *command_sequence, vulkan_compute_pipeline *pipeline, vulkan_query_pool *query_pool, uint64_t *time_ns);
+static test_status _VulkanOverheadMedian(vulkan_command_sequence *command_sequence, vulkan_compute_pipeline *pipeline, vulkan_query_pool *query_pool, statistics_samples *samples, uint64_t *median_ns);
+
+test_status VulkanOverheadCalibrate(vulkan_command_sequence *command_sequence, vulkan_query_pool *query_pool, vulkan_overhead *overhead) {
+    if (command_sequence == NULL || overhead == NULL) {
+        return TEST_INVALID_PARAMETER;
+    }
+    memset(overhead, 0, sizeof(vulkan_overhead));
+    overhead->gpu_timestamps = (query_pool != NULL);
+
+    vulkan_shader shader;
+    test_status status = _VulkanOverheadCreateShader(command_sequence->command_pool->device, &shader);
+    TEST_RETFAIL(status);
+    vulkan_compute_pipeline pipeline;
+    status = VulkanComputePipelineInitialize(&shader, "main", &pipeline);
+    if (!TEST_SUCCESS(status)) {
+        goto cleanup_shader;
+    }
+    statistics_samples samples;
+    status = StatisticsInitialize(&samples);
+    if (!TEST_SUCCESS(status)) {
+        goto cleanup_pipeline;
+    }
+    status = _VulkanOverheadMedian(command_sequence, NULL, query_pool, &samples, &(overhead->empty_submit_ns));
+    if (!TEST_SUCCESS(status)) {
+        goto cleanup_samples;
+    }
+    status = _VulkanOverheadMedian(command_sequence, &pipeline, query_pool, &samples, &(overhead->dispatch_ns));
+    if (!TEST_SUCCESS(status)) {
+        goto cleanup_samples;
+    }
+    INFO("Submit overhead (%s): empty %.3fus, dispatch %.3fus%s\n", overhead->gpu_timestamps ? "GPU timestamps" : "host timer", overhead->empty_submit_ns / 1000.0, overhead->dispatch_ns / 1000.0, MainGetSubtractOverhead() ? ", subtracting from results" : "");
+cleanup_samples:
+    StatisticsCleanUp(&samples);
+cleanup_pipeline:
+    VulkanComputePipelineCleanUp(&pipeline);
+cleanup_shader:
+    VulkanShaderCleanUp(&shader);
+    return status;
+}
+
+/* Every test that measures calibrates, so the runner queues this once per device instead of the tests */
+test_status VulkanOverheadPrepare(vulkan_pipeline_builder *builder) {
+    if (builder == NULL) {
+        return TEST_INVALID_PARAMETER;
+    }
+    vulkan_shader shader;
+    test_status status = _VulkanOverheadCreateShader(builder->device, &shader);
+    TEST_RETFAIL(status);
+    vulkan_shader *owned_shader = NULL;
+    status = VulkanPipelineBuilderAddShader(builder, &shader, &owned_shader);
+    TEST_RETFAIL(status);
+    return VulkanPipelineBuilderAddPipeline(builder, owned_shader, "main", NULL, 0);
+}
+
+uint64_t VulkanOverheadSubtract(vulkan_overhead *overhead, uint64_t time_us) {
+    if (overhead == NULL || !MainGetSubtractOverhead()) {
+        return time_us;
+    }
+    uint64_t overhead_us = (overhead->dispatch_ns + 500) / 1000;
+    return (time_us > overhead_us) ? (time_us - overhead_us) : 0;
+}
+
+void VulkanOverheadLogResult(vulkan_overhead *overhead) {
+    if (MainGetTestResultFormat() == test_result_csv) {
+        LOG_PLAIN("Empty submit overhead (us),%.3f\n", overhead->empty_submit_ns / 1000.0);
+        LOG_PLAIN("Dispatch overhead (us),%.3f\n", overhead->dispatch_ns / 1000.0);
+        LOG_PLAIN("Overhead subtracted,%s\n", MainGetSubtractOverhead() ? "yes" : "no");
+    } else if (MainGetTestResultFormat() == test_result_raw) {
+        LOG_RESULT_METADATA("empty_submit_ns", "%llu", overhead->empty_submit_ns);
+        LOG_RESULT_METADATA("dispatch_ns", "%llu", overhead->dispatch_ns);
+        LOG_RESULT_METADATA("overhead_subtracted", "%lu", MainGetSubtractOverhead() ? 1 : 0);
+    } else if (MainGetTestResultFormat() == test_result_json) {
+        ResultsAddMetadata("empty_submit_ns", (double)overhead->empty_submit_ns);
+        ResultsAddMetadata("dispatch_ns", (double)overhead->dispatch_ns);
+        ResultsAddMetadata("overhead_subtracted", MainGetSubtractOverhead() ? 1.0 : 0.0);
+    } else {
+        INFO("Submit overhead: empty %.3fus, dispatch %.3fus (%s)\n", overhead->empty_submit_ns / 1000.0, overhead->dispatch_ns / 1000.0, MainGetSubtractOverhead() ? "subtracted" : "not subtracted");
+    }
+}
+
+static test_status _VulkanOverheadMedian(vulkan_command_sequence *command_sequence, vulkan_compute_pipeline *pipeline, vulkan_query_pool *query_pool, statistics_samples *samples, uint64_t *median_ns) {
+    StatisticsReset(samples);
+    for (uint32_t i = 0; i < VULKAN_OVERHEAD_CALIBRATION_RUNS; i++) {
+        uint64_t time_ns = 0;
+        test_status status = _VulkanOverheadMeasure(command_sequence, pipeline, query_pool, &time_ns);
+        TEST_RETFAIL(status);
+        status = StatisticsAddSample(samples, (double)time_ns);
+        TEST_RETFAIL(status);
+    }
+    statistics_summary summary;
+    test_status status = StatisticsSummarize(samples, &summary);
+    TEST_RETFAIL(status);
+    *median_ns = (uint64_t)summary.median;
+    return TEST_OK;
+}
+
+/* Same recording, submission and timing path as the tests, minus the actual work */
+static test_status _VulkanOverheadMeasure(vulkan_command_sequence *command_sequence, vulkan_compute_pipeline *pipeline, vulkan_query_pool *query_pool, uint64_t *time_ns) {
+    test_status status = VulkanCommandBufferStart(command_sequence);
+    TEST_RETFAIL(status);
+    if (pipeline != NULL) {
+        status = VulkanCommandBufferBindComputePipeline(command_sequence, pipeline);
+        if (!TEST_SUCCESS(status)) {
+            goto cleanup_command_sequence;
+        }
+    }
+    if (query_pool != NULL) {
+        status = VulkanQueryPoolReset(command_sequence, query_pool);
+        if (!TEST_SUCCESS(status)) {
+            goto cleanup_command_sequence;
+        }
+        status = VulkanQueryWriteTimestamp(command_sequence, query_pool, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VULKAN_QUERY_TIMESTAMP_START);
+        if (!TEST_SUCCESS(status)) {
+            goto cleanup_command_sequence;
+        }
+    }
+    if (pipeline != NULL) {
+        status = VulkanCommandBufferDispatch(command_sequence, 1, 1, 1);
+        if (!TEST_SUCCESS(status)) {
+            goto cleanup_command_sequence;
+        }
+    }
+    if (query_pool != NULL) {
+        status = VulkanQueryWriteTimestamp(command_sequence, query_pool, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, VULKAN_QUERY_TIMESTAMP_END);
+        if (!TEST_SUCCESS(status)) {
+            goto cleanup_command_sequence;
+        }
+    }
+    status = VulkanCommandBufferEnd(command_sequence);
+    if (!TEST_SUCCESS(status)) {
+        goto cleanup_command_sequence;
+    }
+    helper_timer timer;
+    HelperTimerReset(&timer);
+    status = VulkanCommandBufferSubmit(command_sequence);
+    if (!TEST_SUCCESS(status)) {
+        goto cleanup_command_sequence;
+    }
+    status = VulkanCommandBufferWait(command_sequence, VULKAN_COMMAND_SEQUENCE_WAIT_STEP);
+    if (!TEST_SUCCESS(status)) {
+        goto cleanup_command_sequence;
+    }
+    *time_ns = HelperTimerMarkNanoseconds(&timer);
+    if (query_pool != NULL) {
+        status = VulkanQueryGetElapsedNanoseconds(query_pool, VULKAN_QUERY_TIMESTAMP_START, VULKAN_QUERY_TIMESTAMP_END, time_ns);
+    }
+    return status;
+cleanup_command_sequence:
+    VulkanCommandBufferReset(command_sequence);
+    return status;
+}
+
+static test_status _VulkanOverheadCreateShader(vulkan_device *device, vulkan_shader *shader) {
+    test_status status = VulkanShaderInitializeFromFile(device, "vulkan_empty.spv", VK_SHADER_STAGE_COMPUTE_BIT, shader);
+    TEST_RETFAIL(status);
+    status = VulkanShaderCreateDescriptorSets(shader);
+    if (!TEST_SUCCESS(status)) {
+        VulkanShaderCleanUp(shader);
+    }
+    return status;
+}
\ No newline at end of file
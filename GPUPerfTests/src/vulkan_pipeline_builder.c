@@ -0,0 +1,219 @@
+// Copyright (c) 2021 - 2022, Nemes <nemes@nemez.net>
+// SPDX-License-Identifier: MIT
+// 
+// MIT License
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software andassociated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, andto permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+// 
+// The above copyright notice andthis permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "vulkan_helper.h"
+#include "logger.h"
+#include "vulkan_memory.h"
+#include "vulkan_shader.h"
+#include "vulkan_compute_pipeline.h"
+#include "vulkan_pipeline_builder.h"
+
+#ifdef VULKAN_PIPELINE_BUILDER_TRACE
+#define TRACE_PIPELINE_BUILDER(format, ...)   TRACE("[PIPELINE BUILDER] " format, __VA_ARGS__)
+#else
+#define TRACE_PIPELINE_BUILDER(format, ...)
+#endif
+
+typedef struct vulkan_pipeline_builder_worker_t {
+    vulkan_pipeline_builder *builder;
+    size_t first_request;
+    size_t request_count;
+    test_status status;
+} vulkan_pipeline_builder_worker;
+
+static void _VulkanPipelineBuilderWorkerThread(uint32_t thread_id, void *data);
+static test_status _VulkanPipelineBuilderBuildRange(vulkan_pipeline_builder *builder, size_t first_request, size_t request_count);
+
+test_status VulkanPipelineBuilderInitialize(vulkan_device *device, vulkan_pipeline_builder *builder) {
+    if (device == NULL || builder == NULL) {
+        return TEST_INVALID_PARAMETER;
+    }
+    memset(builder, 0, sizeof(vulkan_pipeline_builder));
+    builder->device = device;
+    test_status status = HelperArrayListInitialize(&(builder->shaders), sizeof(vulkan_shader *));
+    TEST_RETFAIL(status);
+    status = HelperArrayListInitialize(&(builder->requests), sizeof(vulkan_pipeline_builder_request));
+    if (!TEST_SUCCESS(status)) {
+        HelperArrayListClean(&(builder->shaders));
+    }
+    return status;
+}
+
+/* The builder takes the shader over, it is cleaned up with the builder and must not be cleaned up by the caller, even on failure */
+test_status VulkanPipelineBuilderAddShader(vulkan_pipeline_builder *builder, vulkan_shader *shader, vulkan_shader **owned_shader) {
+    if (builder == NULL || shader == NULL || owned_shader == NULL) {
+        return TEST_INVALID_PARAMETER;
+    }
+    vulkan_shader *copy = malloc(sizeof(vulkan_shader));
+    if (copy == NULL) {
+        VulkanShaderCleanUp(shader);
+        return TEST_OUT_OF_MEMORY;
+    }
+    memcpy(copy, shader, sizeof(vulkan_shader));
+    test_status status = HelperArrayListAdd(&(builder->shaders), &copy, sizeof(vulkan_shader *), NULL);
+    if (!TEST_SUCCESS(status)) {
+        VulkanShaderCleanUp(copy);
+        free(copy);
+        return status;
+    }
+    *owned_shader = copy;
+    return TEST_OK;
+}
+
+/* entrypoint has to outlive the builder, the tests only ever pass string literals */
+test_status VulkanPipelineBuilderAddPipeline(vulkan_pipeline_builder *builder, vulkan_shader *shader, const char *entrypoint, const uint32_t *constants, uint32_t constant_count) {
+    if (builder == NULL || shader == NULL || entrypoint == NULL || (constants == NULL && constant_count > 0) || constant_count > VULKAN_COMPUTE_PIPELINE_MAXIMUM_CONSTANTS) {
+        return TEST_INVALID_PARAMETER;
+    }
+    vulkan_pipeline_builder_request request;
+    memset(&request, 0, sizeof(request));
+    request.shader = shader;
+    request.entrypoint = entrypoint;
+    request.constant_count = constant_count;
+    if (constant_count > 0) {
+        memcpy(request.constants, constants, constant_count * sizeof(uint32_t));
+    }
+    return HelperArrayListAdd(&(builder->requests), &request, sizeof(request), NULL);
+}
+
+/* Pipeline caches are internally synchronized, so the workers share the device's without any locking of their own */
+test_status VulkanPipelineBuilderBuild(vulkan_pipeline_builder *builder) {
+    if (builder == NULL) {
+        return TEST_INVALID_PARAMETER;
+    }
+    size_t request_count = HelperArrayListSize(&(builder->requests));
+    if (request_count == 0) {
+        return TEST_OK;
+    }
+    size_t thread_count = (request_count + VULKAN_PIPELINE_BUILDER_MINIMUM_BATCH - 1) / VULKAN_PIPELINE_BUILDER_MINIMUM_BATCH;
+    thread_count = max(1, min(thread_count, HelperGetProcessorCount()));
+    TRACE_PIPELINE_BUILDER("Building %llu pipelines on %llu threads\n", (uint64_t)request_count, (uint64_t)thread_count);
+    if (thread_count == 1) {
+        return _VulkanPipelineBuilderBuildRange(builder, 0, request_count);
+    }
+    vulkan_pipeline_builder_worker *workers = malloc(thread_count * sizeof(vulkan_pipeline_builder_worker));
+    if (workers == NULL) {
+        return TEST_OUT_OF_MEMORY;
+    }
+    void **worker_data = malloc(thread_count * sizeof(void *));
+    if (worker_data == NULL) {
+        free(workers);
+        return TEST_OUT_OF_MEMORY;
+    }
+    size_t first_request = 0;
+    for (size_t i = 0; i < thread_count; i++) {
+        /* The first request_count % thread_count workers take one more */
+        size_t share = request_count / thread_count + ((i < request_count % thread_count) ? 1 : 0);
+        workers[i].builder = builder;
+        workers[i].first_request = first_request;
+        workers[i].request_count = share;
+        workers[i].status = TEST_OK;
+        worker_data[i] = &(workers[i]);
+        first_request += share;
+    }
+    test_status status = TEST_OK;
+    helper_thread *threads = HelperCreateThreads((uint32_t)thread_count, _VulkanPipelineBuilderWorkerThread, worker_data);
+    if (threads == NULL) {
+        status = TEST_FAILED_TO_SPAWN_THREAD;
+        goto cleanup;
+    }
+    HelperWaitForThreads(threads, (uint32_t)thread_count);
+    HelperCleanUpThreads(threads, (uint32_t)thread_count);
+    for (size_t i = 0; i < thread_count && TEST_SUCCESS(status); i++) {
+        status = workers[i].status;
+    }
+cleanup:
+    free(worker_data);
+    free(workers);
+    return status;
+}
+
+void VulkanPipelineBuilderCleanUp(vulkan_pipeline_builder *builder) {
+    if (builder == NULL) {
+        return;
+    }
+    size_t shader_count = HelperArrayListSize(&(builder->shaders));
+    for (size_t i = 0; i < shader_count; i++) {
+        vulkan_shader *shader = *(vulkan_shader **)HelperArrayListGet(&(builder->shaders), i);
+        VulkanShaderCleanUp(shader);
+        free(shader);
+    }
+    HelperArrayListClean(&(builder->shaders));
+    HelperArrayListClean(&(builder->requests));
+}
+
+static void _VulkanPipelineBuilderWorkerThread(uint32_t thread_id, void *data) {
+    TEST_UNUSED(thread_id);
+    vulkan_pipeline_builder_worker *worker = (vulkan_pipeline_builder_worker *)data;
+    worker->status = _VulkanPipelineBuilderBuildRange(worker->builder, worker->first_request, worker->request_count);
+}
+
+/* Only the compiled code is wanted, it stays in the pipeline cache where the test's own vkCreateComputePipelines finds it */
+static test_status _VulkanPipelineBuilderBuildRange(vulkan_pipeline_builder *builder, size_t first_request, size_t request_count) {
+    if (request_count == 0) {
+        return TEST_OK;
+    }
+    test_status status = TEST_OK;
+    vulkan_compute_pipeline_description *descriptions = malloc(request_count * sizeof(vulkan_compute_pipeline_description));
+    if (descriptions == NULL) {
+        return TEST_OUT_OF_MEMORY;
+    }
+    VkComputePipelineCreateInfo *create_infos = malloc(request_count * sizeof(VkComputePipelineCreateInfo));
+    if (create_infos == NULL) {
+        status = TEST_OUT_OF_MEMORY;
+        goto free_descriptions;
+    }
+    VkPipeline *pipelines = malloc(request_count * sizeof(VkPipeline));
+    if (pipelines == NULL) {
+        status = TEST_OUT_OF_MEMORY;
+        goto free_create_infos;
+    }
+    for (size_t i = 0; i < request_count; i++) {
+        vulkan_pipeline_builder_request *request = (vulkan_pipeline_builder_request *)HelperArrayListGet(&(builder->requests), first_request + i);
+        status = VulkanComputePipelineDescribe(request->shader, request->entrypoint, request->constants, request->constant_count, &(descriptions[i]));
+        if (!TEST_SUCCESS(status)) {
+            goto free_pipelines;
+        }
+        /* The copy still points into descriptions[i], which doesn't move */
+        create_infos[i] = descriptions[i].create_info;
+        pipelines[i] = VK_NULL_HANDLE;
+    }
+    VkResult res = vkCreateComputePipelines(builder->device->device, builder->device->pipeline_cache, (uint32_t)request_count, create_infos, NULL, pipelines);
+    if (!VULKAN_SUCCESS(res)) {
+        status = TEST_VK_COMPUTE_PIPELINE_CREATION_ERROR;
+    }
+    /* A failed batch can still have created some of the pipelines */
+    for (size_t i = 0; i < request_count; i++) {
+        if (pipelines[i] != VK_NULL_HANDLE) {
+            vkDestroyPipeline(builder->device->device, pipelines[i], NULL);
+        }
+    }
+free_pipelines:
+    free(pipelines);
+free_create_infos:
+    free(create_infos);
+free_descriptions:
+    free(descriptions);
+    return status;
+}
\ No newline at end of file
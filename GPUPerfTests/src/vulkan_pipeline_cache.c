@@ -0,0 +1,177 @@
+// Copyright (c) 2021 - 2022, Nemes <nemes@nemez.net>
+// SPDX-License-Identifier: MIT
+// 
+// MIT License
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software andassociated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, andto permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+// 
+// The above copyright notice andthis permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "vulkan_helper.h"
+#include "logger.h"
+#include "vulkan_pipeline_cache.h"
+
+#ifdef VULKAN_PIPELINE_CACHE_TRACE
+#define TRACE_PIPELINE_CACHE(format, ...)   TRACE("[PIPELINE CACHE] " format, __VA_ARGS__)
+#else
+#define TRACE_PIPELINE_CACHE(format, ...)
+#endif
+
+/* Layout of the version one header from the specification, spelled out since older SDK headers lack the struct */
+typedef struct vulkan_pipeline_cache_header {
+    uint32_t header_size;
+    uint32_t header_version;
+    uint32_t vendor_id;
+    uint32_t device_id;
+    uint8_t pipeline_cache_uuid[VK_UUID_SIZE];
+} vulkan_pipeline_cache_header;
+
+static test_status _VulkanPipelineCacheGetPath(vulkan_device *device, const char **path);
+static bool _VulkanPipelineCacheValidateHeader(vulkan_device *device, const char *data, size_t size);
+
+/* A missing, stale or unreadable cache file only costs compile time, so nothing here fails device creation */
+test_status VulkanPipelineCacheLoad(vulkan_device *device) {
+    if (device == NULL) {
+        return TEST_INVALID_PARAMETER;
+    }
+    device->pipeline_cache = VK_NULL_HANDLE;
+    device->pipeline_cache_loaded_size = 0;
+
+    const char *data = NULL;
+    size_t size = 0;
+    const char *path = NULL;
+    test_status status = _VulkanPipelineCacheGetPath(device, &path);
+    if (TEST_SUCCESS(status)) {
+        status = HelperLoadFile(path, &data, &size);
+        if (TEST_SUCCESS(status) && !_VulkanPipelineCacheValidateHeader(device, data, size)) {
+            DEBUG("Ignoring pipeline cache %s, it was written by a different device or driver\n", path);
+            free((void *)data);
+            data = NULL;
+            size = 0;
+        }
+        TRACE_PIPELINE_CACHE("Loaded %llu bytes from %s\n", (uint64_t)size, path);
+        free((void *)path);
+    }
+
+    VkPipelineCacheCreateInfo pipeline_cache_create_info = {0};
+    pipeline_cache_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    pipeline_cache_create_info.pNext = NULL;
+    pipeline_cache_create_info.flags = 0;
+    pipeline_cache_create_info.initialDataSize = size;
+    pipeline_cache_create_info.pInitialData = data;
+
+    VkResult res = vkCreatePipelineCache(device->device, &pipeline_cache_create_info, NULL, &(device->pipeline_cache));
+    if (!VULKAN_SUCCESS(res) && data != NULL) {
+        /* The driver rejected the data even though the header matched, start over with an empty cache */
+        pipeline_cache_create_info.initialDataSize = 0;
+        pipeline_cache_create_info.pInitialData = NULL;
+        size = 0;
+        res = vkCreatePipelineCache(device->device, &pipeline_cache_create_info, NULL, &(device->pipeline_cache));
+    }
+    free((void *)data);
+    if (!VULKAN_SUCCESS(res)) {
+        device->pipeline_cache = VK_NULL_HANDLE;
+        return TEST_OK;
+    }
+    device->pipeline_cache_loaded_size = size;
+    return TEST_OK;
+}
+
+test_status VulkanPipelineCacheSave(vulkan_device *device) {
+    if (device == NULL) {
+        return TEST_INVALID_PARAMETER;
+    }
+    if (device->pipeline_cache == VK_NULL_HANDLE) {
+        return TEST_OK;
+    }
+    size_t size = 0;
+    VkResult res = vkGetPipelineCacheData(device->device, device->pipeline_cache, &size, NULL);
+    VULKAN_RETFAIL(res, TEST_VK_PIPELINE_CACHE_ERROR);
+    /* Nothing was compiled that wasn't already in the file */
+    if (size == 0 || size == device->pipeline_cache_loaded_size) {
+        return TEST_OK;
+    }
+    void *data = malloc(size);
+    if (data == NULL) {
+        return TEST_OUT_OF_MEMORY;
+    }
+    res = vkGetPipelineCacheData(device->device, device->pipeline_cache, &size, data);
+    if (!VULKAN_SUCCESS(res)) {
+        free(data);
+        return TEST_VK_PIPELINE_CACHE_ERROR;
+    }
+    const char *path = NULL;
+    test_status status = _VulkanPipelineCacheGetPath(device, &path);
+    if (TEST_SUCCESS(status)) {
+        status = HelperWriteFileAtomic(path, data, size);
+        if (TEST_SUCCESS(status)) {
+            device->pipeline_cache_loaded_size = size;
+        }
+        TRACE_PIPELINE_CACHE("Saved %llu bytes to %s\n", (uint64_t)size, path);
+        free((void *)path);
+    }
+    free(data);
+    if (!TEST_SUCCESS(status)) {
+        WARNING("Failed to save the pipeline cache: 0x%08lx %s\n", status, LoggerLookUpError(status));
+    }
+    return status;
+}
+
+void VulkanPipelineCacheDestroy(vulkan_device *device) {
+    if (device != NULL && device->pipeline_cache != VK_NULL_HANDLE) {
+        vkDestroyPipelineCache(device->device, device->pipeline_cache, NULL);
+        device->pipeline_cache = VK_NULL_HANDLE;
+    }
+}
+
+/* The header carries vendor, device and cache UUID but not the driver version, so all of them go into the file name */
+static test_status _VulkanPipelineCacheGetPath(vulkan_device *device, const char **path) {
+    const char *directory = NULL;
+    test_status status = HelperGetUserCacheDirectory(VULKAN_PIPELINE_CACHE_DIRECTORY, &directory);
+    TEST_RETFAIL(status);
+    VkPhysicalDeviceProperties *properties = &(device->physical_device->physical_properties.properties);
+    char uuid[VK_UUID_SIZE * 2 + 1];
+    for (uint32_t i = 0; i < VK_UUID_SIZE; i++) {
+        snprintf(&(uuid[i * 2]), 3, "%02x", properties->pipelineCacheUUID[i]);
+    }
+#ifdef _WIN32
+    status = HelperPrintToBuffer(path, NULL, "%s\\%04lx_%04lx_%08lx_%s.bin", directory, properties->vendorID, properties->deviceID, properties->driverVersion, uuid);
+#else
+    status = HelperPrintToBuffer(path, NULL, "%s/%04lx_%04lx_%08lx_%s.bin", directory, properties->vendorID, properties->deviceID, properties->driverVersion, uuid);
+#endif
+    free((void *)directory);
+    return status;
+}
+
+static bool _VulkanPipelineCacheValidateHeader(vulkan_device *device, const char *data, size_t size) {
+    vulkan_pipeline_cache_header header;
+    if (data == NULL || size < sizeof(header)) {
+        return false;
+    }
+    memcpy(&header, data, sizeof(header));
+    VkPhysicalDeviceProperties *properties = &(device->physical_device->physical_properties.properties);
+    if (header.header_size < sizeof(header) || header.header_size > size) {
+        return false;
+    }
+    if (header.header_version != VK_PIPELINE_CACHE_HEADER_VERSION_ONE) {
+        return false;
+    }
+    if (header.vendor_id != properties->vendorID || header.device_id != properties->deviceID) {
+        return false;
+    }
+    return memcmp(header.pipeline_cache_uuid, properties->pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
\ No newline at end of file
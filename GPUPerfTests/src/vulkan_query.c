@@ -0,0 +1,265 @@
+// Copyright (c) 2021 - 2022, Nemes <nemes@nemez.net>
+// SPDX-License-Identifier: MIT
+// 
+// MIT License
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software andassociated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, andto permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+// 
+// The above copyright notice andthis permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "vulkan_helper.h"
+#include "logger.h"
+#include "vulkan_memory.h"
+#include "vulkan_shader.h"
+#include "vulkan_compute_pipeline.h"
+#include "vulkan_command_buffer.h"
+#include "vulkan_query.h"
+#include "timeline.h"
+#include "statistics.h"
+#include "results.h"
+
+#ifdef VULKAN_QUERY_TRACE
+#define TRACE_QUERY(format, ...)   TRACE("[QUERY] " format, __VA_ARGS__)
+#else
+#define TRACE_QUERY(format, ...)
+#endif
+
+static test_status _VulkanQueryGetTimestampValidBits(vulkan_command_buffer *command_handle, uint32_t *valid_bits) {
+    VkQueueFamilyProperties *queue_family_properties = NULL;
+    uint32_t queue_family_count = 0;
+    test_status status = VulkanGetPhysicalQueueFamilyProperties(command_handle->device->physical_device, &queue_family_properties, &queue_family_count);
+    TEST_RETFAIL(status);
+    uint32_t family_index = command_handle->queue_family->family_index;
+    if (family_index >= queue_family_count) {
+        free(queue_family_properties);
+        return TEST_VK_INVALID_QUEUE_INDEX;
+    }
+    *valid_bits = queue_family_properties[family_index].timestampValidBits;
+    free(queue_family_properties);
+    return TEST_OK;
+}
+
+bool VulkanQueryTimestampsSupported(vulkan_command_buffer *command_handle) {
+    if (command_handle == NULL) {
+        return false;
+    }
+    if (command_handle->device->physical_device->physical_properties.properties.limits.timestampPeriod <= 0.0f) {
+        return false;
+    }
+    uint32_t valid_bits = 0;
+    test_status status = _VulkanQueryGetTimestampValidBits(command_handle, &valid_bits);
+    return TEST_SUCCESS(status) && valid_bits > 0;
+}
+
+test_status VulkanQueryPoolInitializeTimestamps(vulkan_command_buffer *command_handle, uint32_t query_count, vulkan_query_pool *query_handle) {
+    TRACE_QUERY("Initializing timestamp query pool 0x%p (command buffer: 0x%p, query count: %lu)\n", query_handle, command_handle, query_count);
+    if (command_handle == NULL || query_handle == NULL || query_count == 0) {
+        return TEST_INVALID_PARAMETER;
+    }
+    query_handle->device = command_handle->device;
+    query_handle->query_pool = VK_NULL_HANDLE;
+    query_handle->query_type = VK_QUERY_TYPE_TIMESTAMP;
+    query_handle->query_count = query_count;
+    query_handle->timestamp_period = (double)command_handle->device->physical_device->physical_properties.properties.limits.timestampPeriod;
+
+    uint32_t valid_bits = 0;
+    test_status status = _VulkanQueryGetTimestampValidBits(command_handle, &valid_bits);
+    TEST_RETFAIL(status);
+    if (valid_bits == 0 || query_handle->timestamp_period <= 0.0) {
+        return TEST_VK_TIMESTAMPS_UNSUPPORTED;
+    }
+    query_handle->timestamp_mask = (valid_bits >= 64) ? 0xFFFFFFFFFFFFFFFFULL : ((1ULL << valid_bits) - 1);
+    TRACE_QUERY("Timestamp period: %.3fns, valid bits: %lu\n", query_handle->timestamp_period, valid_bits);
+
+    VkQueryPoolCreateInfo query_pool_create_info = {0};
+    query_pool_create_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    query_pool_create_info.pNext = NULL;
+    query_pool_create_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    query_pool_create_info.queryCount = query_count;
+    query_pool_create_info.pipelineStatistics = 0;
+
+    VkResult res = vkCreateQueryPool(command_handle->device->device, &query_pool_create_info, NULL, &(query_handle->query_pool));
+    VULKAN_RETFAIL(res, TEST_VK_QUERY_POOL_CREATION_ERROR);
+    return TEST_OK;
+}
+
+bool VulkanQueryInvocationsSupported(vulkan_physical_device *physical_device) {
+    if (physical_device == NULL) {
+        return false;
+    }
+    return physical_device->physical_features.features.pipelineStatisticsQuery == VK_TRUE;
+}
+
+/* Requires the pipelineStatisticsQuery feature to be enabled on the device */
+test_status VulkanQueryPoolInitializeInvocations(vulkan_command_buffer *command_handle, uint32_t query_count, vulkan_query_pool *query_handle) {
+    TRACE_QUERY("Initializing invocation query pool 0x%p (command buffer: 0x%p, query count: %lu)\n", query_handle, command_handle, query_count);
+    if (command_handle == NULL || query_handle == NULL || query_count == 0) {
+        return TEST_INVALID_PARAMETER;
+    }
+    if (!VulkanQueryInvocationsSupported(command_handle->device->physical_device)) {
+        return TEST_VK_FEATURE_UNSUPPORTED;
+    }
+    query_handle->device = command_handle->device;
+    query_handle->query_pool = VK_NULL_HANDLE;
+    query_handle->query_type = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+    query_handle->query_count = query_count;
+    query_handle->timestamp_mask = 0xFFFFFFFFFFFFFFFFULL;
+    query_handle->timestamp_period = 0.0;
+
+    VkQueryPoolCreateInfo query_pool_create_info = {0};
+    query_pool_create_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    query_pool_create_info.pNext = NULL;
+    query_pool_create_info.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+    query_pool_create_info.queryCount = query_count;
+    query_pool_create_info.pipelineStatistics = VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT;
+
+    VkResult res = vkCreateQueryPool(command_handle->device->device, &query_pool_create_info, NULL, &(query_handle->query_pool));
+    VULKAN_RETFAIL(res, TEST_VK_QUERY_POOL_CREATION_ERROR);
+    return TEST_OK;
+}
+
+test_status VulkanQueryPoolCleanUp(vulkan_query_pool *query_handle) {
+    TRACE_QUERY("Cleaning up query pool 0x%p\n", query_handle);
+    if (query_handle == NULL) {
+        return TEST_INVALID_PARAMETER;
+    }
+    if (query_handle->query_pool != VK_NULL_HANDLE) {
+        if (!query_handle->device->lost) {
+            vkDestroyQueryPool(query_handle->device->device, query_handle->query_pool, NULL);
+        }
+        query_handle->query_pool = VK_NULL_HANDLE;
+    }
+    return TEST_OK;
+}
+
+test_status VulkanQueryPoolReset(vulkan_command_sequence *sequence_handle, vulkan_query_pool *query_handle) {
+    TRACE_QUERY("Resetting query pool 0x%p (command sequence: 0x%p)\n", query_handle, sequence_handle);
+    if (sequence_handle == NULL || query_handle == NULL) {
+        return TEST_INVALID_PARAMETER;
+    }
+    if (sequence_handle->command_buffer == VK_NULL_HANDLE) {
+        return TEST_VK_COMMAND_SEQUENCE_NOT_STARTED;
+    }
+    vkCmdResetQueryPool(sequence_handle->command_buffer, query_handle->query_pool, 0, query_handle->query_count);
+    return TEST_OK;
+}
+
+test_status VulkanQueryWriteTimestamp(vulkan_command_sequence *sequence_handle, vulkan_query_pool *query_handle, VkPipelineStageFlagBits stage, uint32_t query_index) {
+    TRACE_QUERY("Writing timestamp %lu of query pool 0x%p (command sequence: 0x%p, stage: %08x)\n", query_index, query_handle, sequence_handle, stage);
+    if (sequence_handle == NULL || query_handle == NULL || query_index >= query_handle->query_count) {
+        return TEST_INVALID_PARAMETER;
+    }
+    if (sequence_handle->command_buffer == VK_NULL_HANDLE) {
+        return TEST_VK_COMMAND_SEQUENCE_NOT_STARTED;
+    }
+    vkCmdWriteTimestamp(sequence_handle->command_buffer, stage, query_handle->query_pool, query_index);
+    return TEST_OK;
+}
+
+test_status VulkanQueryBegin(vulkan_command_sequence *sequence_handle, vulkan_query_pool *query_handle, uint32_t query_index) {
+    TRACE_QUERY("Beginning query %lu of query pool 0x%p (command sequence: 0x%p)\n", query_index, query_handle, sequence_handle);
+    if (sequence_handle == NULL || query_handle == NULL || query_index >= query_handle->query_count || query_handle->query_type == VK_QUERY_TYPE_TIMESTAMP) {
+        return TEST_INVALID_PARAMETER;
+    }
+    if (sequence_handle->command_buffer == VK_NULL_HANDLE) {
+        return TEST_VK_COMMAND_SEQUENCE_NOT_STARTED;
+    }
+    vkCmdBeginQuery(sequence_handle->command_buffer, query_handle->query_pool, query_index, 0);
+    return TEST_OK;
+}
+
+test_status VulkanQueryEnd(vulkan_command_sequence *sequence_handle, vulkan_query_pool *query_handle, uint32_t query_index) {
+    TRACE_QUERY("Ending query %lu of query pool 0x%p (command sequence: 0x%p)\n", query_index, query_handle, sequence_handle);
+    if (sequence_handle == NULL || query_handle == NULL || query_index >= query_handle->query_count || query_handle->query_type == VK_QUERY_TYPE_TIMESTAMP) {
+        return TEST_INVALID_PARAMETER;
+    }
+    if (sequence_handle->command_buffer == VK_NULL_HANDLE) {
+        return TEST_VK_COMMAND_SEQUENCE_NOT_STARTED;
+    }
+    vkCmdEndQuery(sequence_handle->command_buffer, query_handle->query_pool, query_index);
+    return TEST_OK;
+}
+
+test_status VulkanQueryGetTimestamps(vulkan_query_pool *query_handle, uint32_t first_query, uint32_t query_count, uint64_t *timestamps) {
+    TRACE_QUERY("Reading timestamps %lu-%lu of query pool 0x%p\n", first_query, first_query + query_count - 1, query_handle);
+    if (query_handle == NULL || timestamps == NULL || query_count == 0 || first_query + query_count > query_handle->query_count) {
+        return TEST_INVALID_PARAMETER;
+    }
+    VkResult res = vkGetQueryPoolResults(query_handle->device->device, query_handle->query_pool, first_query, query_count, query_count * sizeof(uint64_t), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+    VULKAN_RETFAIL(res, TEST_VK_QUERY_RESULTS_ERROR);
+    for (uint32_t i = 0; i < query_count; i++) {
+        timestamps[i] &= query_handle->timestamp_mask;
+    }
+    return TEST_OK;
+}
+
+test_status VulkanQueryGetElapsedNanoseconds(vulkan_query_pool *query_handle, uint32_t start_query, uint32_t end_query, uint64_t *elapsed_nanoseconds) {
+    if (query_handle == NULL || elapsed_nanoseconds == NULL || start_query >= query_handle->query_count || end_query >= query_handle->query_count) {
+        return TEST_INVALID_PARAMETER;
+    }
+    uint64_t start_timestamp;
+    uint64_t end_timestamp;
+    test_status status = VulkanQueryGetTimestamps(query_handle, start_query, 1, &start_timestamp);
+    TEST_RETFAIL(status);
+    status = VulkanQueryGetTimestamps(query_handle, end_query, 1, &end_timestamp);
+    TEST_RETFAIL(status);
+    /* The counter only has timestamp_mask worth of bits, a single wraparound is handled by the masked subtraction */
+    uint64_t ticks = (end_timestamp - start_timestamp) & query_handle->timestamp_mask;
+    *elapsed_nanoseconds = (uint64_t)((double)ticks * query_handle->timestamp_period + 0.5);
+    TimelineRecordGpu(*elapsed_nanoseconds, "GPU execution", end_query - start_query);
+    return TEST_OK;
+}
+
+test_status VulkanQueryGetInvocations(vulkan_query_pool *query_handle, uint32_t query_index, uint64_t *invocations) {
+    TRACE_QUERY("Reading invocations %lu of query pool 0x%p\n", query_index, query_handle);
+    if (query_handle == NULL || invocations == NULL || query_index >= query_handle->query_count || query_handle->query_type != VK_QUERY_TYPE_PIPELINE_STATISTICS) {
+        return TEST_INVALID_PARAMETER;
+    }
+    VkResult res = vkGetQueryPoolResults(query_handle->device->device, query_handle->query_pool, query_index, 1, sizeof(uint64_t), invocations, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+    VULKAN_RETFAIL(res, TEST_VK_QUERY_RESULTS_ERROR);
+    return TEST_OK;
+}
+
+/* Only the dispatch size is verified, invocation counts can't tell whether the loop inside the kernel was optimized away */
+test_status VulkanQueryCheckInvocations(vulkan_query_pool *query_handle, uint32_t query_index, uint64_t expected_invocations, bool *invocations_valid) {
+    if (invocations_valid == NULL) {
+        return TEST_INVALID_PARAMETER;
+    }
+    uint64_t invocations = 0;
+    test_status status = VulkanQueryGetInvocations(query_handle, query_index, &invocations);
+    TEST_RETFAIL(status);
+    if (invocations != expected_invocations) {
+        if (*invocations_valid) {
+            WARNING("Compute shader invocations don't match the dispatched work (measured: %llu, expected: %llu), the result is invalid\n", invocations, expected_invocations);
+        }
+        *invocations_valid = false;
+    }
+    return TEST_OK;
+}
+
+void VulkanQueryLogInvocationResult(vulkan_query_pool *query_handle, bool invocations_valid) {
+    if (query_handle == NULL) {
+        return;
+    }
+    if (MainGetTestResultFormat() == test_result_raw) {
+        LOG_RESULT_METADATA("invocations_valid", "%lu", invocations_valid ? 1 : 0);
+    } else if (MainGetTestResultFormat() == test_result_json) {
+        ResultsAddMetadata("invocations_valid", invocations_valid ? 1.0 : 0.0);
+    } else if (!invocations_valid) {
+        WARNING("INVALID RESULT: the measured compute shader invocations did not match the assumed work\n");
+    }
+}
\ No newline at end of file
@@ -26,14 +26,74 @@
 #include "helper.h"
 #include "runner.h"
 #include "vulkan_helper.h"
+#include "planner.h"
 #include "vulkan_runner.h"
+#include "vulkan_memory.h"
+#include "vulkan_shader.h"
+#include "vulkan_compute_pipeline.h"
+#include "vulkan_pipeline_builder.h"
+#include "vulkan_pipeline_cache.h"
+#include "vulkan_command_buffer.h"
+#include "vulkan_query.h"
+#include "vulkan_overhead.h"
+#include "statistics.h"
+#include "results.h"
+#include "checkpoint.h"
+#include "parameters.h"
 #include "tests/test_vk_info.h"
 #include "tests/test_vk_bandwidth.h"
 #include "tests/test_vk_latency.h"
 #include "tests/test_vk_rate.h"
 #include "tests/test_vk_uplink.h"
 
+/* One per GPU while the pipelines of a batch are compiled */
+/* One per distinct logical device the prepared tests create, held until the build ends */
+typedef struct vulkan_runner_pipeline_build_t {
+    vulkan_device device;
+    vulkan_pipeline_builder builder;
+} vulkan_runner_pipeline_build;
+
+/* While a batch is running the instance, physical devices and compatible logical devices are shared between tests */
+typedef struct vulkan_runner_batch_t {
+    bool active;
+    uint32_t depth;                 /* Batches nest, a run inside the daemon's batch keeps the daemon's instance warm */
+    bool parallel;
+    bool has_instance;
+    bool graphical;
+    vulkan_instance instance;
+    vulkan_physical_device *devices;
+    uint32_t device_count;
+    bool pipelines_building;
+    int32_t pipeline_build_device_id;
+    helper_arraylist pipeline_builds;      /* vulkan_runner_pipeline_build * */
+    bool pipelines_built;           /* Once per batch, the daemon builds for every test when it starts and its requests don't again */
+} vulkan_runner_batch;
+
+/* Each feature is also a tag of the tests that need it, so the name shows up in --filter and in the skip message */
+typedef struct vulkan_runner_feature_t {
+    uint32_t feature;
+    const char *name;
+} vulkan_runner_feature;
+
+static vulkan_runner_batch runner_batch;
+static const vulkan_runner_feature vulkan_runner_features[] = {
+    { VULKAN_RUNNER_FEATURE_FLOAT16, "fp16" },
+    { VULKAN_RUNNER_FEATURE_FLOAT64, "fp64" },
+    { VULKAN_RUNNER_FEATURE_INT8, "int8" },
+    { VULKAN_RUNNER_FEATURE_INT16, "int16" },
+    { VULKAN_RUNNER_FEATURE_INT64, "int64" }
+};
+
 static test_status _VulkanRunnerEntry(int32_t device_id, void *config_data);
+static test_status _VulkanRunnerEstimateEntry(int32_t device_id, void *config_data);
+static test_status _VulkanRunnerPrepareEntry(int32_t device_id, void *config_data);
+static test_status _VulkanRunnerBatchEntry(vulkan_runner_context *context, int32_t device_id);
+static test_status _VulkanRunnerCreateBatchInstance(bool graphical);
+static test_status _VulkanRunnerReleaseBatchInstance();
+static test_status _VulkanRunnerRunOnDevices(vulkan_runner_context *context, vulkan_physical_device *devices, uint32_t device_count, int32_t device_id);
+static test_status _VulkanRunnerRunOnDevice(vulkan_runner_context *context, vulkan_physical_device *device);
+static uint32_t _VulkanRunnerGetMissingFeatures(vulkan_physical_device *device, uint32_t required_features);
+static uint64_t _VulkanRunnerHashSettings(vulkan_runner_context *context);
 
 test_status VulkanRunnerRegisterTests() {
     test_status status = TEST_OK;
@@ -50,23 +110,236 @@ test_status VulkanRunnerRegisterTests() {
     return status;
 }
 
-test_status VulkanRunnerRegisterTest(vulkan_test_main *entrypoint, void *config_data, const char *const test_name, uint32_t test_version, bool graphical_context) {
+test_status VulkanRunnerRegisterTest(vulkan_test_main *entrypoint, vulkan_test_estimate *estimate, vulkan_test_prepare *prepare, void *config_data, const char *const test_name, uint32_t test_version, bool graphical_context, uint32_t flags, const char *tags, uint32_t required_features) {
     vulkan_runner_context *context = malloc(sizeof(vulkan_runner_context));
     if (context == NULL) {
         return TEST_OUT_OF_MEMORY;
     }
     memset(context, 0, sizeof(vulkan_runner_context));
     context->entrypoint = entrypoint;
+    context->estimate = estimate;
+    context->prepare = prepare;
     context->config_data = config_data;
     context->name = test_name;
     context->version = test_version;
     context->graphical = graphical_context;
+    context->flags = flags;
+    context->required_features = required_features;
+
+    return RunnerRegisterTest(&_VulkanRunnerEntry, (estimate != NULL) ? &_VulkanRunnerEstimateEntry : NULL, (prepare != NULL) ? &_VulkanRunnerPrepareEntry : NULL, (void *)context, test_name, test_version, flags, tags);
+}
+
+test_status VulkanRunnerBeginBatch() {
+    if (runner_batch.active) {
+        runner_batch.depth++;
+        return TEST_OK;
+    }
+    memset(&runner_batch, 0, sizeof(runner_batch));
+    runner_batch.active = true;
+    runner_batch.depth = 1;
+    VulkanDeviceCacheEnable();
+    return TEST_OK;
+}
+
+/* Workers share one instance, so it is created up front and never swapped. A graphical instance also serves compute-only tests */
+test_status VulkanRunnerBeginParallelBatch(uint32_t *device_count) {
+    if (!runner_batch.active || device_count == NULL) {
+        return TEST_INVALID_PARAMETER;
+    }
+    test_status status = _VulkanRunnerReleaseBatchInstance();
+    TEST_RETFAIL(status);
+    status = _VulkanRunnerCreateBatchInstance(true);
+    TEST_RETFAIL(status);
+    runner_batch.parallel = true;
+    *device_count = runner_batch.device_count;
+    return TEST_OK;
+}
+
+test_status VulkanRunnerEndBatch() {
+    if (runner_batch.depth > 1) {
+        runner_batch.depth--;
+        runner_batch.parallel = false;
+        return TEST_OK;
+    }
+    runner_batch.depth = 0;
+    test_status status = _VulkanRunnerReleaseBatchInstance();
+    runner_batch.active = false;
+    runner_batch.parallel = false;
+    return status;
+}
+
+/*
+ * Each test's prepare creates its device the way the test itself does and compiles into it. Equivalent devices are shared
+ * while the build runs, so tests that would get the same device build together. Once built the devices go back to the
+ * device cache, the tests are handed the same warm devices with the compiled pipelines still in their pipeline caches.
+ */
+test_status VulkanRunnerBeginPipelineBuild(int32_t device_id) {
+    if (!runner_batch.active) {
+        return TEST_INVALID_PARAMETER;
+    }
+    if (runner_batch.pipelines_built) {
+        return TEST_OK;
+    }
+    if (!runner_batch.has_instance) {
+        test_status status = _VulkanRunnerCreateBatchInstance(false);
+        TEST_RETFAIL(status);
+    }
+    memset(&(runner_batch.pipeline_builds), 0, sizeof(runner_batch.pipeline_builds));
+    runner_batch.pipeline_build_device_id = device_id;
+    runner_batch.pipelines_building = true;
+    VulkanDeviceCacheShare(true);
+    return TEST_OK;
+}
+
+/* Also ends a build that never began, which is what batches nested in one that already built get */
+test_status VulkanRunnerEndPipelineBuild() {
+    VulkanDeviceCacheShare(false);
+    test_status status = TEST_OK;
+    size_t build_count = HelperArrayListSize(&(runner_batch.pipeline_builds));
+    for (size_t i = 0; i < build_count; i++) {
+        vulkan_runner_pipeline_build *build = *(vulkan_runner_pipeline_build **)HelperArrayListGet(&(runner_batch.pipeline_builds), i);
+        size_t pipeline_count = HelperArrayListSize(&(build->builder.requests));
+        helper_timer build_timer;
+        HelperTimerReset(&build_timer);
+        test_status build_status = VulkanPipelineBuilderBuild(&(build->builder));
+        if (TEST_SUCCESS(build_status)) {
+            INFO("Built %llu pipelines for %s in %.3fs\n", (uint64_t)pipeline_count, build->device.physical_device->physical_properties.properties.deviceName, HelperTimerGet(&build_timer) / 1000000.0);
+            build_status = VulkanPipelineCacheSave(&(build->device));
+        }
+        if (TEST_SUCCESS(status)) {
+            status = build_status;
+        }
+        VulkanPipelineBuilderCleanUp(&(build->builder));
+        VulkanDestroyDevice(&(build->device));
+        free(build);
+    }
+    if (HelperArrayListRawData(&(runner_batch.pipeline_builds)) != NULL) {
+        HelperArrayListClean(&(runner_batch.pipeline_builds));
+    }
+    if (runner_batch.pipelines_building && runner_batch.active) {
+        runner_batch.pipelines_built = true;
+    }
+    runner_batch.pipelines_building = false;
+    return status;
+}
+
+/*
+ * Takes over device, which a test's prepare created exactly like the test will. An equivalent device another test
+ * already prepared was handed out again by the device cache, its builder is returned and the extra use dropped.
+ */
+test_status VulkanRunnerGetPipelineBuilder(vulkan_device *device, struct vulkan_pipeline_builder_t **builder) {
+    if (device == NULL || builder == NULL) {
+        return TEST_INVALID_PARAMETER;
+    }
+    if (!runner_batch.pipelines_building) {
+        VulkanDestroyDevice(device);
+        return TEST_INVALID_PARAMETER;
+    }
+    size_t build_count = HelperArrayListSize(&(runner_batch.pipeline_builds));
+    for (size_t i = 0; i < build_count; i++) {
+        vulkan_runner_pipeline_build *build = *(vulkan_runner_pipeline_build **)HelperArrayListGet(&(runner_batch.pipeline_builds), i);
+        if (build->device.device == device->device) {
+            *builder = &(build->builder);
+            return VulkanDestroyDevice(device);
+        }
+    }
+    vulkan_runner_pipeline_build *build = malloc(sizeof(vulkan_runner_pipeline_build));
+    if (build == NULL) {
+        VulkanDestroyDevice(device);
+        return TEST_OUT_OF_MEMORY;
+    }
+    build->device = *device;
+    test_status status = VulkanPipelineBuilderInitialize(&(build->device), &(build->builder));
+    if (!TEST_SUCCESS(status)) {
+        goto cleanup_device;
+    }
+    status = HelperArrayListAdd(&(runner_batch.pipeline_builds), &build, sizeof(build), NULL);
+    if (!TEST_SUCCESS(status)) {
+        goto cleanup_builder;
+    }
+    *builder = &(build->builder);
+    /* Every test measures its overhead on its own device */
+    return VulkanOverheadPrepare(&(build->builder));
+
+cleanup_builder:
+    VulkanPipelineBuilderCleanUp(&(build->builder));
+cleanup_device:
+    VulkanDestroyDevice(&(build->device));
+    free(build);
+    return status;
+}
+
+/* Lets the history be looked up for a device by the index the tests use, which is not stable across driver or hardware changes */
+test_status VulkanRunnerGetDeviceUUID(uint32_t device_index, uint8_t *uuid) {
+    if (uuid == NULL) {
+        return TEST_INVALID_PARAMETER;
+    }
+    vulkan_instance instance;
+    test_status status = VulkanCreateInstance(false, "GPUPerfTests", VK_MAKE_VERSION(TEST_VER_MAJOR(TEST_TOOL_VERSION), TEST_VER_MINOR(TEST_TOOL_VERSION), TEST_VER_PATCH(TEST_TOOL_VERSION)), &instance);
+    TEST_RETFAIL(status);
+    vulkan_physical_device *devices = NULL;
+    uint32_t device_count = 0;
+    status = VulkanGetPhysicalDevices(&instance, &devices, &device_count);
+    if (TEST_SUCCESS(status)) {
+        if (device_index < device_count) {
+            memcpy(uuid, devices[device_index].physical_ID_properties.deviceUUID, min(RESULTS_UUID_SIZE, VK_UUID_SIZE));
+        } else {
+            status = TEST_INVALID_PARAMETER;
+        }
+        free(devices);
+    }
+    test_status cleanup_status = VulkanDestroyInstance(&instance);
+    return TEST_SUCCESS(status) ? cleanup_status : status;
+}
+
+static test_status _VulkanRunnerCreateBatchInstance(bool graphical) {
+    test_status status = VulkanCreateInstance(graphical, "GPUPerfTests", VK_MAKE_VERSION(TEST_VER_MAJOR(TEST_TOOL_VERSION), TEST_VER_MINOR(TEST_TOOL_VERSION), TEST_VER_PATCH(TEST_TOOL_VERSION)), &(runner_batch.instance));
+    TEST_RETFAIL(status);
+    status = VulkanGetPhysicalDevices(&(runner_batch.instance), &(runner_batch.devices), &(runner_batch.device_count));
+    if (!TEST_SUCCESS(status)) {
+        VulkanDestroyInstance(&(runner_batch.instance));
+        return status;
+    }
+    runner_batch.has_instance = true;
+    runner_batch.graphical = graphical;
+    VulkanDeviceCacheEnable();
+    return TEST_OK;
+}
 
-    return RunnerRegisterTest(&_VulkanRunnerEntry, (void *)context, test_name, test_version);
+static test_status _VulkanRunnerReleaseBatchInstance() {
+    if (!runner_batch.has_instance) {
+        return TEST_OK;
+    }
+    /* Cached devices reference the instance's physical devices, they have to go first */
+    test_status status = VulkanDeviceCacheFlush();
+    test_status instance_status = VulkanDestroyInstance(&(runner_batch.instance));
+    free(runner_batch.devices);
+    runner_batch.devices = NULL;
+    runner_batch.device_count = 0;
+    runner_batch.has_instance = false;
+    return TEST_SUCCESS(status) ? instance_status : status;
+}
+
+static test_status _VulkanRunnerBatchEntry(vulkan_runner_context *context, int32_t device_id) {
+    test_status status = TEST_OK;
+    if (!runner_batch.parallel) {
+        if (runner_batch.has_instance && runner_batch.graphical != context->graphical) {
+            status = _VulkanRunnerReleaseBatchInstance();
+            TEST_RETFAIL(status);
+        }
+        if (!runner_batch.has_instance) {
+            status = _VulkanRunnerCreateBatchInstance(context->graphical);
+            TEST_RETFAIL(status);
+        }
+    }
+    return _VulkanRunnerRunOnDevices(context, runner_batch.devices, runner_batch.device_count, device_id);
 }
 
 static test_status _VulkanRunnerEntry(int32_t device_id, void *config_data) {
     vulkan_runner_context *context = (vulkan_runner_context *)config_data;
+    if (runner_batch.active) {
+        return _VulkanRunnerBatchEntry(context, device_id);
+    }
     uint32_t vulkan_version = VK_MAKE_VERSION(TEST_VER_MAJOR(context->version), TEST_VER_MINOR(context->version), TEST_VER_PATCH(context->version));
 
     vulkan_instance instance;
@@ -79,14 +352,167 @@ static test_status _VulkanRunnerEntry(int32_t device_id, void *config_data) {
         VulkanDestroyInstance(&instance);
         return status;
     }
+    status = _VulkanRunnerRunOnDevices(context, devices, device_count, device_id);
+    test_status cleanup_status = VulkanDestroyInstance(&instance);
+    return TEST_SUCCESS(status) ? cleanup_status : status;
+}
+
+/* Devices without the features the test needs would skip it, so they aren't part of the plan either */
+static test_status _VulkanRunnerEstimateEntry(int32_t device_id, void *config_data) {
+    vulkan_runner_context *context = (vulkan_runner_context *)config_data;
+    if (!runner_batch.active) {
+        return TEST_INVALID_PARAMETER;
+    }
+    test_status status = TEST_OK;
+    if (!runner_batch.has_instance) {
+        status = _VulkanRunnerCreateBatchInstance(context->graphical);
+        TEST_RETFAIL(status);
+    }
+    for (uint32_t i = 0; i < runner_batch.device_count; i++) {
+        vulkan_physical_device *device = &(runner_batch.devices[i]);
+        if ((device_id != -1 && (uint32_t)device_id != i) || _VulkanRunnerGetMissingFeatures(device, context->required_features) != 0) {
+            continue;
+        }
+        planner_estimate estimate;
+        memset(&estimate, 0, sizeof(estimate));
+        status = context->estimate(device, context->config_data, &estimate);
+        TEST_RETFAIL(status);
+        estimate.fixed_time_us += PLANNER_SETUP_TIME_US;
+        status = PlannerAddEstimate(context->name, device->physical_properties.properties.deviceName, device->physical_ID_properties.deviceUUID, &estimate);
+        TEST_RETFAIL(status);
+    }
+    return status;
+}
+
+/* The builds were already limited to a device when they began, device_id is the same one */
+static test_status _VulkanRunnerPrepareEntry(int32_t device_id, void *config_data) {
+    TEST_UNUSED(device_id);
+    vulkan_runner_context *context = (vulkan_runner_context *)config_data;
+    if (!runner_batch.pipelines_building) {
+        return TEST_OK;
+    }
+    for (uint32_t i = 0; i < runner_batch.device_count; i++) {
+        vulkan_physical_device *device = &(runner_batch.devices[i]);
+        if ((runner_batch.pipeline_build_device_id != -1 && (uint32_t)runner_batch.pipeline_build_device_id != i) || _VulkanRunnerGetMissingFeatures(device, context->required_features) != 0) {
+            continue;
+        }
+        test_status status = context->prepare(device, context->config_data);
+        TEST_RETFAIL(status);
+    }
+    return TEST_OK;
+}
+
+/* TEST_SKIPPED only if no device had the features the test needs */
+static test_status _VulkanRunnerRunOnDevices(vulkan_runner_context *context, vulkan_physical_device *devices, uint32_t device_count, int32_t device_id) {
+    test_status status = TEST_OK;
+    bool any_run = false;
+    bool any_skipped = false;
     for (uint32_t i = 0; i < device_count; i++) {
         if (device_id == -1 || (uint32_t)device_id == i) {
-            status = context->entrypoint(&(devices[i]), context->config_data);
+            status = _VulkanRunnerRunOnDevice(context, &(devices[i]));
+            if (status == TEST_SKIPPED) {
+                any_skipped = true;
+                status = TEST_OK;
+                continue;
+            }
+            any_run = true;
             if (!TEST_SUCCESS(status)) {
                 break;
             }
         }
     }
-    test_status cleanup_status = VulkanDestroyInstance(&instance);
-    return TEST_SUCCESS(status) ? cleanup_status : status;
+    if (TEST_SUCCESS(status) && any_skipped && !any_run) {
+        return TEST_SKIPPED;
+    }
+    return status;
+}
+
+/* Structured results are gathered for the whole run on one device and written once the test is done with it */
+static test_status _VulkanRunnerRunOnDevice(vulkan_runner_context *context, vulkan_physical_device *device) {
+    uint32_t missing_features = _VulkanRunnerGetMissingFeatures(device, context->required_features);
+    if (missing_features != 0) {
+        INFO("Skipping %s on %s, missing:", context->name, device->physical_properties.properties.deviceName);
+        for (size_t i = 0; i < sizeof(vulkan_runner_features) / sizeof(vulkan_runner_feature); i++) {
+            if ((missing_features & vulkan_runner_features[i].feature) != 0) {
+                LOG_PLAIN(" %s", vulkan_runner_features[i].name);
+            }
+        }
+        LOG_PLAIN("\n");
+        return TEST_SKIPPED;
+    }
+    /* Started before the checkpoint is consulted, so the time of a skipped test goes to the ones after it */
+    PlannerBeginTest(context->name, device->physical_ID_properties.deviceUUID);
+    CheckpointBeginTest(context->name, device->physical_ID_properties.deviceUUID, _VulkanRunnerHashSettings(context));
+    bool replay = CheckpointIsTestComplete();
+    if (replay && (context->flags & RUNNER_TEST_FLAG_RESUMABLE) == 0) {
+        INFO("Skipping %s on %s, the checkpoint has it as complete\n", context->name, device->physical_properties.properties.deviceName);
+        CheckpointEndTest(true);
+        PlannerEndTest();
+        return TEST_SKIPPED;
+    }
+    if (ResultsIsEnabled()) {
+        VkPhysicalDeviceProperties *properties = &(device->physical_properties.properties);
+        results_device identity;
+        memset(&identity, 0, sizeof(identity));
+        identity.name = properties->deviceName;
+        identity.driver_name = device->physical_properties_vk12.driverName;
+        identity.driver_info = device->physical_properties_vk12.driverInfo;
+        memcpy(identity.uuid, device->physical_ID_properties.deviceUUID, min(RESULTS_UUID_SIZE, VK_UUID_SIZE));
+        identity.index = device->device_index;
+        identity.vendor_id = properties->vendorID;
+        identity.device_id = properties->deviceID;
+        identity.driver_version = properties->driverVersion;
+        identity.api_version = properties->apiVersion;
+        ResultsBeginTest(context->name, context->version, &identity);
+        if (replay) {
+            ResultsSetReplayed();
+        }
+    }
+    test_status status = context->entrypoint(device, context->config_data);
+    test_status results_status = ResultsEndTest(TEST_SUCCESS(status));
+    test_status checkpoint_status = CheckpointEndTest(TEST_SUCCESS(status));
+    PlannerEndTest();
+    if (TEST_SUCCESS(results_status)) {
+        results_status = checkpoint_status;
+    }
+    return TEST_SUCCESS(status) ? results_status : status;
+}
+
+/* Everything that changes what a test measures, a checkpoint written with different settings isn't replayed */
+static uint64_t _VulkanRunnerHashSettings(vulkan_runner_context *context) {
+    uint64_t hash = HelperHash(HELPER_HASH_SEED, &(context->version), sizeof(context->version));
+    hash = ParametersHash(context->name, hash);
+    bool flags[3] = { MainGetUseHostTimer(), MainGetSubtractOverhead(), MainGetValidateInvocations() };
+    hash = HelperHash(hash, flags, sizeof(flags));
+    uint32_t trial_count = MainGetTrialCount();
+    hash = HelperHash(hash, &trial_count, sizeof(trial_count));
+    double tolerance = MainGetConvergenceTolerance();
+    hash = HelperHash(hash, &tolerance, sizeof(tolerance));
+    uint64_t budget = MainGetConvergenceBudget();
+    hash = HelperHash(hash, &budget, sizeof(budget));
+    uint32_t soak_minutes = MainGetSoakMinutes();
+    return HelperHash(hash, &soak_minutes, sizeof(soak_minutes));
+}
+
+static uint32_t _VulkanRunnerGetMissingFeatures(vulkan_physical_device *device, uint32_t required_features) {
+    VkPhysicalDeviceFeatures *features = &(device->physical_features.features);
+    VkPhysicalDeviceVulkan11Features *features_vk11 = &(device->physical_features_vk11);
+    VkPhysicalDeviceVulkan12Features *features_vk12 = &(device->physical_features_vk12);
+    uint32_t supported_features = 0;
+    if (features_vk12->shaderFloat16 && features_vk11->storageBuffer16BitAccess) {
+        supported_features |= VULKAN_RUNNER_FEATURE_FLOAT16;
+    }
+    if (features->shaderFloat64) {
+        supported_features |= VULKAN_RUNNER_FEATURE_FLOAT64;
+    }
+    if (features_vk12->shaderInt8 && features_vk12->uniformAndStorageBuffer8BitAccess) {
+        supported_features |= VULKAN_RUNNER_FEATURE_INT8;
+    }
+    if (features->shaderInt16 && features_vk11->storageBuffer16BitAccess) {
+        supported_features |= VULKAN_RUNNER_FEATURE_INT16;
+    }
+    if (features->shaderInt64) {
+        supported_features |= VULKAN_RUNNER_FEATURE_INT64;
+    }
+    return required_features & ~supported_features;
 }
\ No newline at end of file
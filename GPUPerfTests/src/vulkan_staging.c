@@ -28,6 +28,7 @@
 #include "vulkan_compute_pipeline.h"
 #include "vulkan_command_buffer.h"
 #include "vulkan_staging.h"
+#include "timeline.h"
 
 // 512MiB means we need a 256MiB/s link to the GPU in order to TDR, should be safe for anything that can actually run Vulkan
 #define VULKAN_STAGING_MAXIMUM_TRANSFER_SIZE    (256*1024*1024)
@@ -88,6 +89,7 @@ test_status VulkanStagingTransferSubrange(vulkan_staging *staging_handle, size_t
     staging_handle->staging_buffer_base = NULL;
 
     test_status status = TEST_OK;
+    uint64_t timeline_start = TimelineBegin();
     vulkan_command_sequence command_sequence;
     // Chunk up the transfer so we don't TDR during big transfers or on slow uplink systems.
     size_t remaining_size = staging_region->size;
@@ -110,7 +112,7 @@ test_status VulkanStagingTransferSubrange(vulkan_staging *staging_handle, size_t
         if (!TEST_SUCCESS(status)) {
             goto reset_command_sequence;
         }
-        status = VulkanCommandBufferWait(&command_sequence, VULKAN_COMMAND_SEQUENCE_WAIT_INFINITE);
+        status = VulkanCommandBufferWait(&command_sequence, VULKAN_COMMAND_SEQUENCE_WAIT_STEP);
         if (!TEST_SUCCESS(status)) {
             goto reset_command_sequence;
         }
@@ -121,6 +123,7 @@ test_status VulkanStagingTransferSubrange(vulkan_staging *staging_handle, size_t
     if (staging_handle->staging_buffer_base == NULL) {
         return TEST_VK_MEMORY_MAPPING_ERROR;
     }
+    TimelineEnd(timeline_start, "Staging transfer", TIMELINE_CATEGORY_TRANSFER, staging_region->size);
     return TEST_OK;
 reset_command_sequence:
     VulkanCommandBufferReset(&command_sequence);
@@ -157,7 +160,7 @@ test_status VulkanStagingTransferSubimage(vulkan_staging *staging_handle, int32_
     if (!TEST_SUCCESS(status)) {
         goto reset_command_sequence;
     }
-    status = VulkanCommandBufferWait(&command_sequence, VULKAN_COMMAND_SEQUENCE_WAIT_INFINITE);
+    status = VulkanCommandBufferWait(&command_sequence, VULKAN_COMMAND_SEQUENCE_WAIT_STEP);
     if (!TEST_SUCCESS(status)) {
         goto reset_command_sequence;
     }
@@ -56,7 +56,7 @@ static test_status _VulkanTextureTransitionLayout(vulkan_texture *texture_handle
         VulkanCommandBufferAbortSingle(&command_buffer);
         return status;
     }
-    status = VulkanCommandBufferFinishSingle(&command_buffer, VULKAN_COMMAND_SEQUENCE_WAIT_INFINITE);
+    status = VulkanCommandBufferFinishSingle(&command_buffer, VULKAN_COMMAND_SEQUENCE_WAIT_STEP);
     TEST_RETFAIL(status);
     texture_handle->current_layout = layout;
     return status;
@@ -0,0 +1,99 @@
+// Copyright (c) 2021 - 2022, Nemes <nemes@nemez.net>
+// SPDX-License-Identifier: MIT
+// 
+// MIT License
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software andassociated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, andto permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+// 
+// The above copyright notice andthis permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "main.h"
+#include "logger.h"
+#include "helper.h"
+#include "warmup.h"
+#include "statistics.h"
+#include "results.h"
+#include <math.h>
+
+void WarmupStart(warmup_detector *detector) {
+    memset(detector, 0, sizeof(warmup_detector));
+    detector->maximum_runs = WARMUP_MAXIMUM_RUNS;
+    detector->maximum_time_us = WARMUP_MAXIMUM_TIME_MS * 1000ULL;
+    detector->tolerance = WARMUP_DEFAULT_TOLERANCE / 100.0;
+    HelperTimerReset(&(detector->timer));
+}
+
+/* Steady once the last WARMUP_WINDOW runs agree and don't trend, a slow clock ramp can otherwise pass as stable */
+void WarmupAddRun(warmup_detector *detector, uint64_t time_us, uint64_t iterations) {
+    if (detector->finished) {
+        return;
+    }
+    memmove(&(detector->window[0]), &(detector->window[1]), (WARMUP_WINDOW - 1) * sizeof(double));
+    detector->window[WARMUP_WINDOW - 1] = (double)time_us / (double)max(1, iterations);
+    detector->run_count++;
+    detector->elapsed_us = HelperTimerGet(&(detector->timer));
+
+    if (detector->run_count >= WARMUP_WINDOW) {
+        double minimum = detector->window[0];
+        double maximum = detector->window[0];
+        double sum = 0.0;
+        for (uint32_t i = 0; i < WARMUP_WINDOW; i++) {
+            minimum = min(minimum, detector->window[i]);
+            maximum = max(maximum, detector->window[i]);
+            sum += detector->window[i];
+        }
+        double mean = sum / WARMUP_WINDOW;
+        double trend = fabs(detector->window[WARMUP_WINDOW - 1] - detector->window[0]);
+        if (mean > 0.0 && (maximum - minimum) / mean <= detector->tolerance && trend / mean <= detector->tolerance / 2.0) {
+            detector->steady = true;
+            detector->finished = true;
+        }
+    }
+    if (detector->run_count >= detector->maximum_runs || detector->elapsed_us >= detector->maximum_time_us) {
+        detector->finished = true;
+    }
+    if (detector->finished) {
+        INFO("Warmup finished after %.3fms and %lu runs%s\n", detector->elapsed_us / 1000.0, detector->run_count, detector->steady ? "" : " (timings did not stabilise)");
+    }
+}
+
+bool WarmupIsFinished(warmup_detector *detector) {
+    return detector->finished;
+}
+
+void WarmupLogResult(warmup_detector *detector) {
+    if (MainGetTestResultFormat() == test_result_csv) {
+        LOG_PLAIN("Warmup time (ms),%.3f\n", detector->elapsed_us / 1000.0);
+        LOG_PLAIN("Warmup runs,%lu\n", detector->run_count);
+        LOG_PLAIN("Warmup steady,%s\n", detector->steady ? "yes" : "no");
+    } else if (MainGetTestResultFormat() == test_result_raw) {
+        LOG_RESULT_METADATA("warmup_us", "%llu", detector->elapsed_us);
+        LOG_RESULT_METADATA("warmup_runs", "%lu", detector->run_count);
+        LOG_RESULT_METADATA("warmup_steady", "%lu", detector->steady ? 1 : 0);
+    } else if (MainGetTestResultFormat() == test_result_json) {
+        ResultsAddMetadata("warmup_us", (double)detector->elapsed_us);
+        ResultsAddMetadata("warmup_runs", (double)detector->run_count);
+        ResultsAddMetadata("warmup_steady", detector->steady ? 1.0 : 0.0);
+    } else {
+        INFO("Warmup: %.3fms over %lu runs (%s)\n", detector->elapsed_us / 1000.0, detector->run_count, detector->steady ? "steady" : "capped before timings stabilised");
+    }
+}
+
+/* A device that is already warm settles within the first window, a cold one takes longer but is capped the same way */
+uint64_t WarmupEstimateTime(uint64_t run_time_us) {
+    return min(WARMUP_WINDOW * run_time_us, WARMUP_MAXIMUM_TIME_MS * 1000ULL);
+}
\ No newline at end of file
@@ -0,0 +1,107 @@
+// Copyright (c) 2021 - 2022, Nemes <nemes@nemez.net>
+// SPDX-License-Identifier: MIT
+// 
+// MIT License
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software andassociated documentation files(the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, andto permit persons to whom the Software is
+// furnished to do so, subject to the following conditions :
+// 
+// The above copyright notice andthis permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "main.h"
+#include "logger.h"
+#include "helper.h"
+#include "watchdog.h"
+
+static HELPER_THREAD_LOCAL watchdog *watchdog_local;
+
+static void _WatchdogThread(uint32_t thread_id, void *data);
+
+/*
+ * Fence waits check the deadline themselves and fail the test with TEST_TIMEOUT, that covers a hung GPU.
+ * The backstop thread is for a driver that ignores wait timeouts or a host side hang, it can't unwind the
+ * stuck thread so it ends the whole process once the grace period is over as well.
+ * With abandoned set it only raises that flag instead, whoever started the thread decides what to do with it.
+ */
+test_status WatchdogArm(const char *test_name, uint32_t timeout_seconds, helper_atomic_bool *abandoned) {
+    if (watchdog_local != NULL) {
+        return TEST_PROGRAMMING_ERROR;
+    }
+    if (timeout_seconds == 0) {
+        return TEST_OK;
+    }
+    watchdog *dog = malloc(sizeof(watchdog));
+    if (dog == NULL) {
+        return TEST_OUT_OF_MEMORY;
+    }
+    memset(dog, 0, sizeof(watchdog));
+    dog->test_name = test_name;
+    dog->timeout_ns = (uint64_t)timeout_seconds * 1000000000ULL;
+    dog->abandoned = abandoned;
+    HelperTimerReset(&(dog->timer));
+    dog->thread = HelperCreateThread(_WatchdogThread, dog);
+    if (dog->thread == NULL) {
+        free(dog);
+        return TEST_FAILED_TO_SPAWN_THREAD;
+    }
+    watchdog_local = dog;
+    return TEST_OK;
+}
+
+void WatchdogDisarm() {
+    watchdog *dog = watchdog_local;
+    if (dog == NULL) {
+        return;
+    }
+    HelperAtomicBoolSet(&(dog->finished));
+    HelperWaitForThread(dog->thread);
+    HelperCleanUpThread(dog->thread);
+    free(dog);
+    watchdog_local = NULL;
+}
+
+bool WatchdogHasExpired() {
+    return watchdog_local != NULL && HelperTimerGetNanoseconds(&(watchdog_local->timer)) >= watchdog_local->timeout_ns;
+}
+
+/* UINT64_MAX when the test running on this thread has no deadline */
+uint64_t WatchdogGetRemainingNanoseconds() {
+    if (watchdog_local == NULL) {
+        return UINT64_MAX;
+    }
+    uint64_t elapsed = HelperTimerGetNanoseconds(&(watchdog_local->timer));
+    return (elapsed >= watchdog_local->timeout_ns) ? 0 : (watchdog_local->timeout_ns - elapsed);
+}
+
+static void _WatchdogThread(uint32_t thread_id, void *data) {
+    TEST_UNUSED(thread_id);
+    watchdog *dog = (watchdog *)data;
+    uint64_t limit_ns = dog->timeout_ns + WATCHDOG_GRACE_MS * 1000000ULL;
+    while (!HelperAtomicBoolRead(&(dog->finished))) {
+        if (HelperTimerGetNanoseconds(&(dog->timer)) >= limit_ns) {
+            if (dog->abandoned != NULL) {
+                FATAL("%s is still running %lus after its timeout ran out, abandoning it\n", dog->test_name, WATCHDOG_GRACE_MS / 1000);
+                HelperAtomicBoolSet(dog->abandoned);
+                return;
+            }
+            FATAL("%s is still running %lus after its timeout ran out, ending the process\n", dog->test_name, WATCHDOG_GRACE_MS / 1000);
+            LoggerChannelSendError(TEST_TIMEOUT);
+            fflush(stdout);
+            _Exit(WATCHDOG_EXIT_CODE);
+        }
+        HelperSleep(WATCHDOG_POLL_MS);
+    }
+}
\ No newline at end of file